@@ -24,18 +24,168 @@ static const char *tag = "data_storage";
 
 #if SCH_STORAGE_MODE == 0
     static uint8_t *db = NULL;  // Memory section for all payloads
-    static uint8_t **storage_addresses;  // Storage pointers to payload memory sections
+    static uint8_t **storage_addresses;  // First memory section of each payload
 #elif SCH_STORAGE_MODE == 1
     static sqlite3 *db = NULL;
 #elif SCH_STORAGE_MODE == 2
     PGconn *conn = NULL;
+#elif SCH_STORAGE_MODE == 3
+    static char storage_path[SCH_BUFF_MAX_LEN];  // Base path of the storage files
 #endif
 
 char* fp_table = "flightplan";
 char fs_db_name[15];
 char postgres_conf_s[SCH_BUFF_MAX_LEN];
 
+/*
+ * Payload retention. The RAM sections and the segment files have a fixed
+ * size, the SQL tables are unbounded unless SCH_STORAGE_SQL_RETENTION is set
+ */
+#if SCH_STORAGE_MODE == 1 || SCH_STORAGE_MODE == 2
+    #define STORAGE_BOUNDED SCH_STORAGE_SQL_RETENTION
+    #define STORAGE_RING    SCH_STORAGE_SQL_RETENTION
+#else
+    #define STORAGE_BOUNDED 1
+    #define STORAGE_RING    SCH_STORAGE_RING
+#endif
+
 static int dummy_callback(void *data, int argc, char **argv, char **names);
+#if STORAGE_BOUNDED
+static int storage_section_len(int payload);
+static int storage_section(int payload, int index);
+static void storage_payload_reclaim(int payload, int index);
+#endif
+
+#if SCH_STORAGE_MODE == 1
+/**
+ * Prepared statements cache. Every statement is prepared once per table and
+ * operation (the table init functions do it at startup), then it is only reset
+ * and bound again. As the rest of this module, the access must be serialized
+ * by the caller.
+ */
+typedef enum storage_stmt_op {
+    STORAGE_STMT_REPO_GET = 0,  ///< Get a status variable by index
+    STORAGE_STMT_REPO_GET_STR,  ///< Get a status variable by name
+    STORAGE_STMT_REPO_GET_ALL,  ///< Get all the status variables
+    STORAGE_STMT_REPO_SET,      ///< Set a status variable by index
+    STORAGE_STMT_FP_SET,        ///< Insert or replace a flight plan entry
+    STORAGE_STMT_FP_GET,        ///< Get a flight plan entry by time
+    STORAGE_STMT_FP_ERASE,      ///< Delete a flight plan entry by time
+    STORAGE_STMT_PAYLOAD_SET,   ///< Insert a payload sample
+    STORAGE_STMT_PAYLOAD_GET,   ///< Get a payload sample by index
+    STORAGE_STMT_PAYLOAD_RANGE, ///< Get a range of payload samples
+} storage_stmt_op_t;
+
+#define STORAGE_STMT_TABLE_LEN 32
+#define STORAGE_STMT_MAX (10 + 3*last_sensor)
+
+typedef struct storage_stmt {
+    storage_stmt_op_t op;
+    char table[STORAGE_STMT_TABLE_LEN];
+    sqlite3_stmt *stmt;
+} storage_stmt_t;
+
+static storage_stmt_t storage_stmt_cache[STORAGE_STMT_MAX];
+static int storage_stmt_count = 0;
+
+static sqlite3_stmt *storage_stmt_get(storage_stmt_op_t op, char *table, int payload);
+static void storage_stmt_finalize(void);
+
+/**
+ * Payload samples are inserted inside an explicit transaction, committed every
+ * SCH_STORAGE_TX_SAMPLES samples or SCH_STORAGE_TX_MS after it was opened, so
+ * the journal is synced once per batch and not once per sample. Status
+ * variables are written inside the open batch and commit it with them, so
+ * they are durable when the write returns OK. Other writes commit the open
+ * batch first (@see storage_commit).
+ */
+static int storage_tx_samples = 0;      ///< Samples inserted in the open transaction
+static portTick storage_tx_tick = 0;    ///< Time the open transaction was started
+static int storage_tx_begin(void);
+static int storage_tx_end(void);
+static int storage_tx_check(void);
+
+#if SCH_STORAGE_PAYLOAD_BLOB == 1
+static char *payload_table = "payloads";    ///< All payloads samples, as packed structs
+#endif
+#endif
+
+#if SCH_STORAGE_MODE == 3
+/**
+ * Memory-mapped segment files. Each payload is stored in up to
+ * data_map[payload].sections segment files (<file>.<table>.<n>), created when
+ * the first sample is written. A segment is a small header followed by fixed
+ * size records [index][sample][crc], so the sample @index lives in segment
+ * storage_section(payload, index) at a fixed offset. Samples are appended
+ * through the mapping and synced by storage_commit. A segment reused for newer
+ * samples (SCH_STORAGE_RING) is reset, the records of the previous samples
+ * are not valid anymore as they hold a different index. On startup the count
+ * of every segment is checked against the records (torn or missing tail
+ * records are dropped), @see storage_get_payload_tail.
+ */
+#define STORAGE_SEG_MAGIC 0x53434847    ///< "SCHG"
+#define STORAGE_SEG_VERSION 2
+#define STORAGE_SEG_RECORD_SIZE(size) (((size) + 2*sizeof(uint32_t) + 3) & ~3)  ///< Index, sample and crc, 4 bytes aligned
+
+typedef struct storage_seg_header {
+    uint32_t magic;         ///< STORAGE_SEG_MAGIC
+    uint16_t version;       ///< STORAGE_SEG_VERSION
+    uint16_t record_size;   ///< Bytes per record, index and crc included
+    uint32_t count;         ///< One past the last record written
+    uint32_t first;         ///< Index of the sample in the first record
+} storage_seg_header_t;
+
+typedef struct storage_seg {
+    uint8_t *base;          ///< Mapped segment file, NULL if not opened
+    size_t len;             ///< Mapped bytes
+    int dirty;              ///< Written since the last sync
+} storage_seg_t;
+
+static storage_seg_t *storage_segs[last_sensor];   ///< Segments of each payload
+
+static int storage_seg_open(int payload, int seg, int create);
+static void storage_seg_close(int payload, int seg);
+static uint8_t *storage_seg_record(int payload, int index, int create);
+static int storage_seg_valid(int payload, const uint8_t *record, int index);
+
+/**
+ * Status variables and flight plan checkpoint. Both tables are kept in RAM and
+ * written as a whole to one of the two slots of the checkpoint file
+ * (<file>.ckpt), alternating slots, so the previous checkpoint is intact while
+ * the next one is written. On startup the valid slot with the highest sequence
+ * number is loaded.
+ */
+#define STORAGE_CKPT_MAGIC 0x53434843   ///< "SCHC"
+#define STORAGE_CKPT_VALUES (dat_status_last_address * 3)  ///< Status variables and their copies
+
+typedef struct storage_ckpt_fp {
+    int32_t time;           ///< Unix time to execute the command
+    int32_t executions;
+    int32_t periodical;
+    int32_t used;           ///< 1 if the entry is used
+    char command[SCH_CMD_MAX_STR_NAME];
+    char args[SCH_CMD_MAX_STR_PARAMS];
+} storage_ckpt_fp_t;
+
+typedef struct storage_ckpt {
+    uint32_t magic;         ///< STORAGE_CKPT_MAGIC
+    uint32_t crc;           ///< From seq to the end of the struct
+    uint32_t seq;           ///< Checkpoint number, the slot is seq%2
+    uint32_t size;          ///< sizeof(storage_ckpt_t)
+    int32_t values[STORAGE_CKPT_VALUES];
+    storage_ckpt_fp_t fp[SCH_FP_MAX_ENTRIES];
+} storage_ckpt_t;
+
+static storage_ckpt_t storage_ckpt;         ///< Current tables
+static uint8_t *storage_ckpt_map = NULL;    ///< Mapped checkpoint file, two slots
+static size_t storage_ckpt_slot = 0;        ///< Slot size, page aligned
+static int storage_ckpt_dirty = 0;          ///< Last slot written is not synced
+
+static int storage_ckpt_load(void);
+static int storage_ckpt_write(void);
+static int storage_ckpt_fp_count(void);
+static uint32_t storage_crc32(const void *data, size_t len);
+#endif
 
 int storage_init(const char *file)
 {
@@ -44,6 +194,8 @@ int storage_init(const char *file)
     if(db != NULL)
     {
         LOGW(tag, "Database already open, closing it");
+        storage_commit();
+        storage_stmt_finalize();
         sqlite3_close(db);
     }
 
@@ -52,11 +204,23 @@ int storage_init(const char *file)
         LOGE(tag, "Can't open database: %s", sqlite3_errmsg(db));
         return -1;
     }
-    else
+
+    LOGD(tag, "Opened database successfully");
+    storage_tx_samples = 0;
+
+    // Journal mode and durability, a WAL journal is only synced at checkpoints
+    // with synchronous NORMAL
+    char *err_msg;
+    char *sql = sqlite3_mprintf("%sPRAGMA synchronous=%s;",
+                                SCH_STORAGE_WAL ? "PRAGMA journal_mode=WAL;" : "",
+                                SCH_STORAGE_SYNCHRONOUS);
+    if(sqlite3_exec(db, sql, 0, 0, &err_msg) != SQLITE_OK)
     {
-        LOGD(tag, "Opened database successfully");
-        return 0;
+        LOGW(tag, "Unable to set the journal mode: %s. SQL: %s", err_msg, sql);
+        sqlite3_free(err_msg);
     }
+    sqlite3_free(sql);
+    return 0;
 #elif SCH_STORAGE_MODE == 2
     sprintf(fs_db_name, "fs_db_%u", SCH_COMM_ADDRESS);
     // Check if database exist by connecting to its own db
@@ -121,6 +285,54 @@ int storage_init(const char *file)
     int ver = PQserverVersion(conn);
     LOGI(tag, "Server version: %d", ver);
 
+#elif SCH_STORAGE_MODE == 3
+    if(storage_ckpt_map != NULL)
+    {
+        LOGW(tag, "Storage already open, closing it");
+        storage_close();
+    }
+
+    snprintf(storage_path, sizeof(storage_path), "%s", file);
+    char ckpt_file[SCH_BUFF_MAX_LEN + 8];
+    snprintf(ckpt_file, sizeof(ckpt_file), "%s.ckpt", storage_path);
+
+    // Two page aligned slots, so each one is synced alone
+    long page = sysconf(_SC_PAGESIZE);
+    storage_ckpt_slot = ((sizeof(storage_ckpt_t) + page - 1) / page) * page;
+
+    int fd = open(ckpt_file, O_RDWR | O_CREAT, 0644);
+    if(fd < 0 || ftruncate(fd, 2*storage_ckpt_slot) != 0)
+    {
+        LOGE(tag, "Can't open checkpoint file %s: %s", ckpt_file, strerror(errno));
+        if(fd >= 0)
+            close(fd);
+        return -1;
+    }
+    // Reserve the blocks now, writing to a hole of the map raises SIGBUS if the disk is full
+    int rc = posix_fallocate(fd, 0, 2*storage_ckpt_slot);
+    if(rc != 0)
+    {
+        LOGE(tag, "Can't allocate checkpoint file %s: %s", ckpt_file, strerror(rc));
+        close(fd);
+        return -1;
+    }
+
+    void *map = mmap(NULL, 2*storage_ckpt_slot, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED)
+    {
+        LOGE(tag, "Can't map checkpoint file %s: %s", ckpt_file, strerror(errno));
+        return -1;
+    }
+    storage_ckpt_map = (uint8_t *)map;
+    storage_ckpt_dirty = 0;
+    int i;
+    for(i = 0; i < last_sensor; i++)
+        storage_segs[i] = (storage_seg_t *)calloc(data_map[i].sections, sizeof(storage_seg_t));
+
+    if(storage_ckpt_load() != 0)
+        LOGW(tag, "No valid checkpoint in %s, status and flight plan are empty", ckpt_file);
+    LOGD(tag, "Opened storage %s successfully (checkpoint %u)", storage_path, storage_ckpt.seq);
 #endif
     return 0;
 }
@@ -132,19 +344,12 @@ int storage_table_repo_init(char* table, int drop)
     int rc;
 
 #if SCH_STORAGE_MODE == 0
-    // Init payload memory
-    db = (uint8_t *)malloc(SCH_SIZE_PER_SECTION*SCH_SECTIONS_PER_PAYLOAD*last_sensor);
-    memset(db, 0, SCH_SIZE_PER_SECTION*SCH_SECTIONS_PER_PAYLOAD*last_sensor);
-    // Init payload sections pointers storage
-    storage_addresses = (uint8_t **)malloc(SCH_SECTIONS_PER_PAYLOAD*last_sensor*sizeof(uint8_t *));
-    int i;
-    // Save the starting address corresponding to each payload memory section
-    for (i = 0; i < SCH_SECTIONS_PER_PAYLOAD*last_sensor; i++)
-        storage_addresses[i] = db + i * SCH_SIZE_PER_SECTION;
+    // Payloads memory is allocated by storage_table_payload_init
     return 0;
 #endif
 
 #if SCH_STORAGE_MODE == 1
+    storage_commit();
 
     /* Drop table if selected */
     if(drop)
@@ -186,6 +391,12 @@ int storage_table_repo_init(char* table, int drop)
         LOGD(tag, "Table %s created successfully", table);
         sqlite3_free(sql);
     }
+
+    if(storage_stmt_get(STORAGE_STMT_REPO_GET, table, -1) == NULL ||
+       storage_stmt_get(STORAGE_STMT_REPO_GET_STR, table, -1) == NULL ||
+       storage_stmt_get(STORAGE_STMT_REPO_GET_ALL, table, -1) == NULL ||
+       storage_stmt_get(STORAGE_STMT_REPO_SET, table, -1) == NULL)
+        return -1;
     return 0;
 
 #elif SCH_STORAGE_MODE == 2
@@ -217,6 +428,18 @@ int storage_table_repo_init(char* table, int drop)
     }
     PQclear(res);
     return 0;
+#elif SCH_STORAGE_MODE == 3
+    // Only one status table, it lives in the checkpoint
+    if(storage_ckpt_map == NULL)
+        return -1;
+    if(drop)
+    {
+        int i;
+        for(i = 0; i < STORAGE_CKPT_VALUES; i++)
+            storage_ckpt.values[i] = -1;
+        return storage_ckpt_write();
+    }
+    return 0;
 #endif
 }
 
@@ -227,6 +450,7 @@ int storage_table_flight_plan_init(int drop, int * entries)
     int rc;
 
 #if SCH_STORAGE_MODE == 1
+    storage_commit();
 
     /* Drop table if selected */
     if (drop)
@@ -270,6 +494,11 @@ int storage_table_flight_plan_init(int drop, int * entries)
         LOGD(tag, "Table %s created successfully", fp_table);
         sqlite3_free(sql);
     }
+
+    if(storage_stmt_get(STORAGE_STMT_FP_SET, fp_table, -1) == NULL ||
+       storage_stmt_get(STORAGE_STMT_FP_GET, fp_table, -1) == NULL ||
+       storage_stmt_get(STORAGE_STMT_FP_ERASE, fp_table, -1) == NULL)
+        return -1;
 #elif  SCH_STORAGE_MODE == 2
     if (drop) {
         char drop_query[SCH_BUFF_MAX_LEN];
@@ -297,6 +526,16 @@ int storage_table_flight_plan_init(int drop, int * entries)
 
     PQclear(res);
     return 0;
+#elif SCH_STORAGE_MODE == 3
+    if(storage_ckpt_map == NULL)
+        return -1;
+    if(drop)
+    {
+        memset(storage_ckpt.fp, 0, sizeof(storage_ckpt.fp));
+        if(storage_ckpt_write() != 0)
+            return -1;
+    }
+    *entries = storage_ckpt_fp_count();
 #endif
     return 0;
 }
@@ -305,14 +544,91 @@ int storage_table_payload_init(int drop)
 {
     int rc = 0;
 #if SCH_STORAGE_MODE == 0
+    // Init payload memory, one block with the sections of all payloads
+    int i;
+    size_t len = 0;
+    for(i = 0; i < last_sensor; i++)
+        len += (size_t)data_map[i].sections*SCH_SIZE_PER_SECTION;
+    if(db == NULL)
+    {
+        db = (uint8_t *)malloc(len);
+        storage_addresses = (uint8_t **)malloc(last_sensor*sizeof(uint8_t *));
+        if(db == NULL || storage_addresses == NULL)
+            return -1;
+        drop = 1;
+    }
     if(drop)
-        if(db != NULL)
-            free(db);
-    db = malloc(SCH_SECTIONS_PER_PAYLOAD*SCH_SIZE_PER_SECTION*last_sensor);
-    rc = db != NULL ? 0 : -1;
+        memset(db, 0, len);
+    // Save the starting address of each payload memory sections
+    for(i = 0, len = 0; i < last_sensor; i++)
+    {
+        storage_addresses[i] = db + len;
+        len += (size_t)data_map[i].sections*SCH_SIZE_PER_SECTION;
+    }
 #endif
 
-#if SCH_STORAGE_MODE > 0
+#if SCH_STORAGE_MODE == 1 && SCH_STORAGE_PAYLOAD_BLOB == 1
+    char* err_msg;
+    storage_commit();
+    if(drop)
+    {
+        char *sql = sqlite3_mprintf("DROP TABLE IF EXISTS %s;", payload_table);
+        rc = sqlite3_exec(db, sql, 0, 0, &err_msg);
+        if (rc != SQLITE_OK )
+        {
+            LOGE(tag, "Failed to drop table %s. Error: %s. SQL: %s", payload_table, err_msg, sql);
+            sqlite3_free(err_msg);
+        }
+        sqlite3_free(sql);
+    }
+
+    // One row per sample, clustered by payload and index
+    char *sql = sqlite3_mprintf("CREATE TABLE IF NOT EXISTS %s(payload INTEGER, idx INTEGER, data BLOB, "
+                                "PRIMARY KEY(payload, idx)) WITHOUT ROWID;", payload_table);
+    LOGD(tag, "SQL command: %s", sql);
+    rc = sqlite3_exec(db, sql, 0, 0, &err_msg);
+    sqlite3_free(sql);
+    if (rc != SQLITE_OK )
+    {
+        LOGE(tag, "Failed to crate table %s. Error: %s", payload_table, err_msg);
+        sqlite3_free(err_msg);
+        return -1;
+    }
+
+    LOGD(tag, "Table %s created successfully", payload_table);
+    storage_stmt_get(STORAGE_STMT_PAYLOAD_SET, payload_table, 0);
+    storage_stmt_get(STORAGE_STMT_PAYLOAD_GET, payload_table, 0);
+    storage_stmt_get(STORAGE_STMT_PAYLOAD_RANGE, payload_table, 0);
+#elif SCH_STORAGE_MODE == 3
+    int i, seg;
+    for(i = 0; i < last_sensor; i++)
+    {
+        for(seg = 0; seg < data_map[i].sections; seg++)
+        {
+            if(drop)
+            {
+                // Segments are created again with the first sample
+                char seg_file[SCH_BUFF_MAX_LEN*2];
+                storage_seg_close(i, seg);
+                snprintf(seg_file, sizeof(seg_file), "%s.%s.%d", storage_path, data_map[i].table, seg);
+                if(unlink(seg_file) != 0 && errno != ENOENT)
+                {
+                    LOGE(tag, "Unable to delete %s: %s", seg_file, strerror(errno));
+                    rc = -1;
+                }
+            }
+            else if(storage_segs[i][seg].base == NULL)
+            {
+                // Map the existing segments and recover their tail
+                storage_seg_open(i, seg, 0);
+            }
+        }
+    }
+    return rc;
+#elif SCH_STORAGE_MODE > 0
+#if SCH_STORAGE_MODE == 1
+    storage_commit();
+#endif
     // FIXME: Handle drop = True
     if(drop)
     {
@@ -354,23 +670,20 @@ int storage_table_payload_init(int drop)
     int i = 0;
     for(i=0; i< last_sensor; ++i)
     {
-        char create_table[SCH_BUFF_MAX_LEN*4];
-        memset(&create_table, 0, SCH_BUFF_MAX_LEN*4);
-        snprintf(create_table, SCH_BUFF_MAX_LEN*4, "CREATE TABLE IF NOT EXISTS %s(id INTEGER, tstz TIMESTAMPTZ,", data_map[i].table);
-        char* tok_sym[300];
-        char* tok_var[300];
-        char order[300];
-        strcpy(order, data_map[i].data_order);
-        char var_names[SCH_BUFF_MAX_LEN*4];
-        memset(&var_names, 0, SCH_BUFF_MAX_LEN*4);
-        strcpy(var_names, data_map[i].var_names);
-        int nparams = get_payloads_tokens(tok_sym, tok_var, order, var_names, i);
+        int nparams;
+        const dat_payload_field_t *fields = dat_get_payload_fields(i, &nparams);
+
+        // Column names plus the type of each one
+        size_t create_len = strlen(data_map[i].var_names) + nparams*24 + SCH_BUFF_MAX_LEN;
+        char create_table[create_len];
+        memset(&create_table, 0, create_len);
+        snprintf(create_table, create_len, "CREATE TABLE IF NOT EXISTS %s(id INTEGER, tstz TIMESTAMPTZ,", data_map[i].table);
 
         int j;
         for(j=0; j < nparams; ++j)
         {
             char line[100];
-            sprintf(line, "%s %s", tok_var[j], get_sql_type(tok_sym[j]));
+            sprintf(line, "%s %s", fields[j].name, get_sql_type(&fields[j]));
             strcat(create_table, line);
             if(j != nparams-1) {
                 strcat(create_table, ",");
@@ -391,6 +704,9 @@ int storage_table_payload_init(int drop)
         else
         {
             LOGD(tag, "Table %s created successfully", data_map[i].table);
+            storage_stmt_get(STORAGE_STMT_PAYLOAD_SET, data_map[i].table, i);
+            storage_stmt_get(STORAGE_STMT_PAYLOAD_GET, data_map[i].table, i);
+            storage_stmt_get(STORAGE_STMT_PAYLOAD_RANGE, data_map[i].table, i);
         }
 #elif SCH_STORAGE_MODE==2
         // TODO: manage connection error in res
@@ -412,27 +728,19 @@ int storage_repo_get_value_idx(int index, char *table)
 {
     int value = -1;
 #if SCH_STORAGE_MODE == 1
-    sqlite3_stmt* stmt = NULL;
-    char *sql = sqlite3_mprintf("SELECT value FROM %s WHERE idx=\"%d\";", table, index);
-
-    // execute statement
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
-    if(rc != SQLITE_OK)
-    {
-        LOGE(tag, "Selecting data from DB Failed (rc=%d)", rc);
+    sqlite3_stmt* stmt = storage_stmt_get(STORAGE_STMT_REPO_GET, table, -1);
+    if(stmt == NULL)
         return -1;
-    }
 
     // fetch only one row's status
-    rc = sqlite3_step(stmt);
-    value = -1;
+    sqlite3_bind_int(stmt, 1, index);
+    int rc = sqlite3_step(stmt);
     if(rc == SQLITE_ROW)
         value = sqlite3_column_int(stmt, 0);
     else
-    LOGE(tag, "Some error encountered (rc=%d)", rc);
+        LOGE(tag, "Some error encountered (rc=%d) getting status var %d", rc, index);
 
-    sqlite3_finalize(stmt);
-    sqlite3_free(sql);
+    sqlite3_reset(stmt);
 #elif SCH_STORAGE_MODE == 2
     char get_value_query[SCH_BUFF_MAX_LEN];
     memset(&get_value_query, 0, SCH_BUFF_MAX_LEN);
@@ -453,34 +761,81 @@ int storage_repo_get_value_idx(int index, char *table)
         LOGE(tag, "Value does not for status variable index: %d", index);
     }
     PQclear(res);
+#elif SCH_STORAGE_MODE == 3
+    if(index >= 0 && index < STORAGE_CKPT_VALUES)
+        value = storage_ckpt.values[index];
+    else
+        LOGE(tag, "Status variable index %d out of bounds", index);
 #endif
     return value;
 }
 
-int storage_repo_get_value_str(char *name, char *table)
+int storage_repo_get_values(int *values, int n, char *table)
 {
-    int value = -1;
+    int i;
+    for(i = 0; i < n; i++)
+        values[i] = -1;
+
 #if SCH_STORAGE_MODE == 1
-    sqlite3_stmt* stmt = NULL;
-    char *sql = sqlite3_mprintf("SELECT value FROM %s WHERE name=\"%s\";", table, name);
+    sqlite3_stmt* stmt = storage_stmt_get(STORAGE_STMT_REPO_GET_ALL, table, -1);
+    if(stmt == NULL)
+        return -1;
 
-    // execute statement
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
-    if(rc != 0)
+    int rc;
+    while((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        int index = sqlite3_column_int(stmt, 0);
+        if(index >= 0 && index < n)
+            values[index] = sqlite3_column_int(stmt, 1);
+    }
+    sqlite3_reset(stmt);
+
+    if(rc != SQLITE_DONE)
     {
-        LOGE(tag, "Selecting data from DB Failed (rc=%d)", rc);
+        LOGE(tag, "Some error encountered (rc=%d) getting values from %s", rc, table);
+        return -1;
+    }
+#elif SCH_STORAGE_MODE == 2
+    char get_values_query[SCH_BUFF_MAX_LEN];
+    memset(&get_values_query, 0, SCH_BUFF_MAX_LEN);
+    snprintf(get_values_query, SCH_BUFF_MAX_LEN, "SELECT idx, value FROM %s;", table);
+    LOGD(tag, "%s",  get_values_query);
+    PGresult * res = PQexec(conn, get_values_query);
+    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+        LOGE(tag, "command storage_repo_get_values failed: %s", PQerrorMessage(conn));
+        PQclear(res);
         return -1;
     }
+    for(i = 0; i < PQntuples(res); i++)
+    {
+        int index = atoi(PQgetvalue(res, i, 0));
+        if(index >= 0 && index < n)
+            values[index] = atoi(PQgetvalue(res, i, 1));
+    }
+    PQclear(res);
+#elif SCH_STORAGE_MODE == 3
+    memcpy(values, storage_ckpt.values, sizeof(int32_t)*(n < STORAGE_CKPT_VALUES ? n : STORAGE_CKPT_VALUES));
+#endif
+    return 0;
+}
+
+int storage_repo_get_value_str(char *name, char *table)
+{
+    int value = -1;
+#if SCH_STORAGE_MODE == 1
+    sqlite3_stmt* stmt = storage_stmt_get(STORAGE_STMT_REPO_GET_STR, table, -1);
+    if(stmt == NULL)
+        return -1;
 
     // fetch only one row's status
-    rc = sqlite3_step(stmt);
+    sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
+    int rc = sqlite3_step(stmt);
     if(rc == SQLITE_ROW)
         value = sqlite3_column_int(stmt, 0);
     else
         LOGE(tag, "Some error encountered (rc=%d)", rc);
 
-    sqlite3_finalize(stmt);
-    sqlite3_free(sql);
+    sqlite3_reset(stmt);
 #elif SCH_STORAGE_MODE == 2
     char get_value_query[SCH_BUFF_MAX_LEN];
     memset(&get_value_query, 0, sizeof(get_value_query));
@@ -499,6 +854,8 @@ int storage_repo_get_value_str(char *name, char *table)
         LOGE(tag, "Value not found for sys variable: %s", name);
     }
 
+#elif SCH_STORAGE_MODE == 3
+    LOGE(tag, "Status variables are only stored by index (%s)", name);
 #endif
     return value;
 }
@@ -506,30 +863,26 @@ int storage_repo_get_value_str(char *name, char *table)
 int storage_repo_set_value_idx(int index, int value, char *table)
 {
 #if SCH_STORAGE_MODE == 1
-    char *err_msg;
-    char *sql = sqlite3_mprintf("INSERT OR REPLACE INTO %s (idx, name, value) "
-                                "VALUES ("
-                                "%d, "
-                                "(SELECT name FROM %s WHERE idx = \"%d\"), "
-                                "%d);",
-                                table, index, table, index, value);
+    // Written inside the open payload samples batch, if any, and committed
+    // with it. A failed commit is reported so the value is written again
+    sqlite3_stmt* stmt = storage_stmt_get(STORAGE_STMT_REPO_SET, table, -1);
+    if(stmt == NULL)
+        return -1;
 
-    /* Execute SQL statement */
-    int rc = sqlite3_exec(db, sql, dummy_callback, 0, &err_msg);
+    sqlite3_bind_int(stmt, 1, index);
+    sqlite3_bind_int(stmt, 2, value);
+    int rc = sqlite3_step(stmt);
+    sqlite3_reset(stmt);
 
-    if( rc != SQLITE_OK )
+    if( rc != SQLITE_DONE )
     {
-        LOGE(tag, "SQL error: %s", err_msg);
-        sqlite3_free(err_msg);
-        sqlite3_free(sql);
+        LOGE(tag, "SQL error: %s", sqlite3_errmsg(db));
         return -1;
     }
     else
     {
         LOGV(tag, "Inserted %d to %d in %s", value, index, table);
-        sqlite3_free(err_msg);
-        sqlite3_free(sql);
-        return 0;
+        return storage_commit();
     }
 #elif SCH_STORAGE_MODE == 2
     char set_value_query[SCH_BUFF_MAX_LEN];
@@ -549,6 +902,96 @@ int storage_repo_set_value_idx(int index, int value, char *table)
         return -1;
     }
     PQclear(res);
+#elif SCH_STORAGE_MODE == 3
+    return storage_repo_set_values_idx(&index, &value, 1, table);
+#endif
+
+    return 0;
+}
+
+int storage_repo_set_values_idx(int *index, int *value, int n, char *table)
+{
+#if SCH_STORAGE_MODE == 1
+    char *err_msg;
+    int i, rc;
+
+    sqlite3_stmt *stmt = storage_stmt_get(STORAGE_STMT_REPO_SET, table, -1);
+    if(stmt == NULL)
+        return -1;
+
+    // A savepoint is nested in the open payload samples batch, if any,
+    // otherwise it is a transaction of its own. The batch is committed with
+    // the values, a failed commit is reported so they are written again
+    rc = sqlite3_exec(db, "SAVEPOINT status;", 0, 0, &err_msg);
+    if(rc != SQLITE_OK)
+    {
+        LOGE(tag, "SQL error: %s", err_msg);
+        sqlite3_free(err_msg);
+        return -1;
+    }
+
+    for(i = 0; i < n && rc == SQLITE_OK; i++)
+    {
+        sqlite3_bind_int(stmt, 1, index[i]);
+        sqlite3_bind_int(stmt, 2, value[i]);
+        rc = sqlite3_step(stmt) == SQLITE_DONE ? SQLITE_OK : SQLITE_ERROR;
+        sqlite3_reset(stmt);
+    }
+
+    if(rc != SQLITE_OK)
+    {
+        LOGE(tag, "Unable to write %d values to %s: %s", n, table, sqlite3_errmsg(db));
+        sqlite3_exec(db, "ROLLBACK TO status; RELEASE status;", 0, 0, 0);
+        return -1;
+    }
+
+    rc = sqlite3_exec(db, "RELEASE status;", 0, 0, &err_msg);
+    if(rc != SQLITE_OK)
+    {
+        LOGE(tag, "SQL error: %s", err_msg);
+        sqlite3_free(err_msg);
+        sqlite3_exec(db, "ROLLBACK TO status; RELEASE status;", 0, 0, 0);
+        return -1;
+    }
+    LOGV(tag, "Inserted %d values in %s", n, table);
+    return storage_commit();
+#elif SCH_STORAGE_MODE == 2
+    int i, rc = 0;
+    PGresult *res = PQexec(conn, "BEGIN;");
+    if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+        LOGE(tag, "command BEGIN failed: %s", PQerrorMessage(conn));
+        PQclear(res);
+        return -1;
+    }
+    PQclear(res);
+
+    for(i = 0; i < n && rc == 0; i++)
+        rc = storage_repo_set_value_idx(index[i], value[i], table);
+
+    res = PQexec(conn, rc == 0 ? "COMMIT;" : "ROLLBACK;");
+    if (rc != 0 || PQresultStatus(res) != PGRES_COMMAND_OK) {
+        LOGE(tag, "Unable to write %d values to %s: %s", n, table, PQerrorMessage(conn));
+        rc = -1;
+    }
+    PQclear(res);
+    return rc;
+#elif SCH_STORAGE_MODE == 3
+    // All the values are written in one checkpoint, or none
+    int i;
+    for(i = 0; i < n; i++)
+    {
+        if(index[i] < 0 || index[i] >= STORAGE_CKPT_VALUES)
+        {
+            LOGE(tag, "Status variable index %d out of bounds", index[i]);
+            return -1;
+        }
+    }
+    for(i = 0; i < n; i++)
+        storage_ckpt.values[index[i]] = value[i];
+    if(storage_ckpt_write() != 0)
+        return -1;
+    LOGV(tag, "Inserted %d values in %s", n, table);
+    return 0;
 #endif
 
     return 0;
@@ -557,11 +1000,11 @@ int storage_repo_set_value_idx(int index, int value, char *table)
 int storage_flight_plan_set(int timetodo, char* command, char* args, int executions, int periodical, int * entries)
 {
     #if SCH_STORAGE_MODE > 0
-        char * insert_query_template =  "INSERT INTO %s (time, command, args, executions, periodical) "
-                               "VALUES (%d, \'%s\', \'%s\', %d, %d) ON CONFLICT (time) DO UPDATE "
-                               "SET command=\'%s\', args=\'%s\', executions=%d, periodical=%d;";
-
         #if SCH_STORAGE_MODE == 2
+            char * insert_query_template =  "INSERT INTO %s (time, command, args, executions, periodical) "
+                                   "VALUES (%d, \'%s\', \'%s\', %d, %d) ON CONFLICT (time) DO UPDATE "
+                                   "SET command=\'%s\', args=\'%s\', executions=%d, periodical=%d;";
+
             char insert_query[SCH_BUFF_MAX_LEN*2];
             memset(&insert_query, 0, sizeof(insert_query));
             snprintf(insert_query,SCH_BUFF_MAX_LEN*2, insert_query_template, fp_table, timetodo, command, args, executions, periodical,
@@ -576,28 +1019,59 @@ int storage_flight_plan_set(int timetodo, char* command, char* args, int executi
             PQclear(res);
 
         #elif SCH_STORAGE_MODE == 1
-        char *err_msg;
-            char *sql = sqlite3_mprintf(
-                    "INSERT OR REPLACE INTO %s (time, command, args, executions, periodical)\n VALUES (%d, \"%s\", \"%s\", %d, %d);",
-                    fp_table, timetodo, command, args, executions, periodical);
+            storage_commit();
+            sqlite3_stmt *stmt = storage_stmt_get(STORAGE_STMT_FP_SET, fp_table, -1);
+            if(stmt == NULL)
+                return -1;
 
-            /* Execute SQL statement */
-            int rc = sqlite3_exec(db, sql, dummy_callback, 0, &err_msg);
+            sqlite3_bind_int(stmt, 1, timetodo);
+            sqlite3_bind_text(stmt, 2, command, -1, SQLITE_STATIC);
+            sqlite3_bind_text(stmt, 3, args, -1, SQLITE_STATIC);
+            sqlite3_bind_int(stmt, 4, executions);
+            sqlite3_bind_int(stmt, 5, periodical);
+            int rc = sqlite3_step(stmt);
+            sqlite3_reset(stmt);
 
-            if (rc != SQLITE_OK)
+            if (rc != SQLITE_DONE)
             {
-                LOGE(tag, "SQL error: %s", err_msg);
-                sqlite3_free(err_msg);
-                sqlite3_free(sql);
+                LOGE(tag, "SQL error: %s", sqlite3_errmsg(db));
                 return -1;
             }
             else
             {
                 LOGV(tag, "Inserted (%d, %s, %s, %d, %d) in %s", timetodo, command, args, executions, periodical, fp_table);
-                sqlite3_free(err_msg);
-                sqlite3_free(sql);
                 return 0;
             }
+        #elif SCH_STORAGE_MODE == 3
+            // Replace the entry at the same time, or use a free one
+            int i, free_entry = -1;
+            for(i = 0; i < SCH_FP_MAX_ENTRIES; i++)
+            {
+                if(storage_ckpt.fp[i].used && storage_ckpt.fp[i].time == timetodo)
+                    break;
+                if(!storage_ckpt.fp[i].used && free_entry < 0)
+                    free_entry = i;
+            }
+            if(i == SCH_FP_MAX_ENTRIES)
+                i = free_entry;
+            if(i < 0)
+            {
+                LOGE(tag, "Flight plan table full (%d entries)", SCH_FP_MAX_ENTRIES);
+                return -1;
+            }
+
+            storage_ckpt_fp_t *entry = &storage_ckpt.fp[i];
+            entry->time = timetodo;
+            entry->executions = executions;
+            entry->periodical = periodical;
+            entry->used = 1;
+            snprintf(entry->command, sizeof(entry->command), "%s", command);
+            snprintf(entry->args, sizeof(entry->args), "%s", args);
+            if(storage_ckpt_write() != 0)
+                return -1;
+
+            *entries = storage_ckpt_fp_count();
+            LOGV(tag, "Inserted (%d, %s, %s, %d, %d) in %s", timetodo, command, args, executions, periodical, fp_table);
         #endif
     #endif
     return 0;
@@ -645,38 +1119,48 @@ int storage_flight_plan_get(int timetodo, char* command, char* args, int* execut
             return 0;
 
         #elif SCH_STORAGE_MODE == 1
-            char **results;
-            char *err_msg;
-            int row;
-            int col;
-
-            char* sql = sqlite3_mprintf("SELECT * FROM %s WHERE time = %d", fp_table, timetodo);
-
-            sqlite3_get_table(db, sql, &results,&row,&col,&err_msg);
+            sqlite3_stmt *stmt = storage_stmt_get(STORAGE_STMT_FP_GET, fp_table, -1);
+            if(stmt == NULL)
+                return -1;
 
-            if(row==0 || col==0)
+            sqlite3_bind_int(stmt, 1, timetodo);
+            if(sqlite3_step(stmt) != SQLITE_ROW)
             {
-                sqlite3_free(sql);
-                LOGV(tag, "SQL error: %s", err_msg);
-                sqlite3_free(err_msg);
-                sqlite3_free_table(results);
+                sqlite3_reset(stmt);
                 return -1;
             }
             else
             {
-                strcpy(command, results[6]);
-                strcpy(args,results[7]);
-                *executions = atoi(results[8]);
-                *periodical = atoi(results[9]);
+                const char *str = (const char *)sqlite3_column_text(stmt, 0);
+                strcpy(command, str != NULL ? str : "");
+                str = (const char *)sqlite3_column_text(stmt, 1);
+                strcpy(args, str != NULL ? str : "");
+                *executions = sqlite3_column_int(stmt, 2);
+                *periodical = sqlite3_column_int(stmt, 3);
+                sqlite3_reset(stmt);
 
                 storage_flight_plan_erase(timetodo, entries);
 
-                //if (atoi(results[9]) > 0)
-                    //storage_flight_plan_set(timetodo+*periodical,results[6],results[7],*executions,*periodical);
+                //if (*periodical > 0)
+                    //storage_flight_plan_set(timetodo+*periodical,command,args,*executions,*periodical);
 
-                sqlite3_free(sql);
                 return 0;
             }
+        #elif SCH_STORAGE_MODE == 3
+            int i;
+            for(i = 0; i < SCH_FP_MAX_ENTRIES; i++)
+            {
+                storage_ckpt_fp_t *entry = &storage_ckpt.fp[i];
+                if(entry->used && entry->time == timetodo)
+                {
+                    strcpy(command, entry->command);
+                    strcpy(args, entry->args);
+                    *executions = entry->executions;
+                    *periodical = entry->periodical;
+                    return storage_flight_plan_erase(timetodo, entries);
+                }
+            }
+            return -1;
         #endif
     #endif
     return 0;
@@ -699,26 +1183,39 @@ int storage_flight_plan_erase(int timetodo, int * entries)
             return 0;
 
         #elif SCH_STORAGE_MODE ==1
-            char *err_msg;
-            char *sql = sqlite3_mprintf("DELETE FROM %s\n WHERE time = %d", fp_table, timetodo);
+            storage_commit();
+            sqlite3_stmt *stmt = storage_stmt_get(STORAGE_STMT_FP_ERASE, fp_table, -1);
+            if(stmt == NULL)
+                return -1;
 
-            /* Execute SQL statement */
-            int rc = sqlite3_exec(db, sql, dummy_callback, 0, &err_msg);
+            sqlite3_bind_int(stmt, 1, timetodo);
+            int rc = sqlite3_step(stmt);
+            sqlite3_reset(stmt);
 
-            if (rc != SQLITE_OK)
+            if (rc != SQLITE_DONE)
             {
-                LOGE(tag, "SQL error: %s", err_msg);
-                sqlite3_free(err_msg);
-                sqlite3_free(sql);
+                LOGE(tag, "SQL error: %s", sqlite3_errmsg(db));
                 return -1;
             }
             else
             {
                 LOGV(tag, "Command in time %d, table %s was deleted", timetodo, fp_table);
-                sqlite3_free(err_msg);
-                sqlite3_free(sql);
                 return 0;
             }
+        #elif SCH_STORAGE_MODE == 3
+            int i;
+            for(i = 0; i < SCH_FP_MAX_ENTRIES; i++)
+            {
+                if(storage_ckpt.fp[i].used && storage_ckpt.fp[i].time == timetodo)
+                {
+                    memset(&storage_ckpt.fp[i], 0, sizeof(storage_ckpt_fp_t));
+                    if(storage_ckpt_write() != 0)
+                        return -1;
+                    *entries = storage_ckpt_fp_count();
+                    LOGV(tag, "Command in time %d, table %s was deleted", timetodo, fp_table);
+                    return 0;
+                }
+            }
         #endif
     #endif
     return 0;
@@ -801,6 +1298,25 @@ int storage_flight_plan_show_table (int entries) {
                 if ((i + 1) % col == 0)
                     printf("\n");
             }
+        #elif SCH_STORAGE_MODE == 3
+            if(storage_ckpt_fp_count() == 0)
+            {
+                LOGI(tag, "Flight plan table empty");
+                return 0;
+            }
+
+            LOGI(tag, "Flight plan table");
+            printf("When\tCommand\tArguments\tExecutions\tPeriodical\n");
+            int i;
+            for(i = 0; i < SCH_FP_MAX_ENTRIES; i++)
+            {
+                storage_ckpt_fp_t *entry = &storage_ckpt.fp[i];
+                if(!entry->used)
+                    continue;
+                time_t timef = entry->time;
+                printf("%s\t%s\t%s\t%d\t%d\n", ctime(&timef), entry->command, entry->args,
+                       entry->executions, entry->periodical);
+            }
         #endif
     #endif
     return 0;
@@ -814,21 +1330,20 @@ int storage_set_payload_data(int index, void* data, int payload)
         return -1;
     }
 
-#if SCH_STORAGE_MODE == 0
-    int payloads_per_section = SCH_SIZE_PER_SECTION/data_map[payload].size;
-
-    int payload_section = index/payloads_per_section;
-    int index_in_section = index%payloads_per_section;
-    int section_index = payload*SCH_SECTIONS_PER_PAYLOAD + payload_section;
-
-    uint8_t *add;
-    add = storage_addresses[section_index] + index_in_section*data_map[payload].size;
-
-    if((payload_section >= SCH_SECTIONS_PER_PAYLOAD) || (index_in_section*data_map[payload].size >= SCH_SIZE_PER_SECTION))
+#if STORAGE_BOUNDED
+    int section = storage_section(payload, index);
+    if(section < 0)
     {
-        LOGE(tag, "Payload address: %p is out of bounds", add);
+        LOGE(tag, "Payload %d index %d is out of bounds", payload, index);
         return -1;
     }
+    storage_payload_reclaim(payload, index);
+#endif
+
+#if SCH_STORAGE_MODE == 0
+    uint8_t *add;
+    add = storage_addresses[payload] + (size_t)section*SCH_SIZE_PER_SECTION +
+          (index%storage_section_len(payload))*data_map[payload].size;
 
     LOGI(tag, "Writing in address: %p, %d bytes\n", add, data_map[payload].size);
     void *des = memcpy(add, data, data_map[payload].size);
@@ -837,32 +1352,82 @@ int storage_set_payload_data(int index, void* data, int payload)
     }
     return 0;
 #endif
-#if SCH_STORAGE_MODE > 0
-    char* tok_sym[300];
-    char* tok_var[300];
-    char *order = (char *)malloc(300);
-    strcpy(order, data_map[payload].data_order);
-    char *var_names = (char *)malloc(1000);
-    strcpy(var_names, data_map[payload].var_names);
-    int nparams = get_payloads_tokens(tok_sym, tok_var, order, var_names, payload);
-
-    char *values = (char *)malloc(1000);
-    char *names = (char *)malloc(1000);
-    strcpy(names, "(id, tstz,");
-    sprintf(values, "(%d, current_timestamp,", index);
+#if SCH_STORAGE_MODE == 1 && SCH_STORAGE_PAYLOAD_BLOB == 1
+    // The sample is stored as is, no conversion per field
+    sqlite3_stmt *stmt = storage_stmt_get(STORAGE_STMT_PAYLOAD_SET, payload_table, payload);
+    if(stmt == NULL)
+        return -1;
+
+    sqlite3_bind_int(stmt, 1, payload);
+    sqlite3_bind_int(stmt, 2, index);
+    sqlite3_bind_blob(stmt, 3, data, data_map[payload].size, SQLITE_STATIC);
+
+    int rc = storage_tx_begin() == 0 ? sqlite3_step(stmt) : SQLITE_ERROR;
+    sqlite3_reset(stmt);
 
+    if (rc != SQLITE_DONE )
+    {
+        LOGE(tag, "Failed to add payload %d sample. Error: %s", payload, sqlite3_errmsg(db));
+        return -1;
+    }
+    if(storage_tx_end() != 0)
+        return -1;
+#elif SCH_STORAGE_MODE == 3
+    uint8_t *record = storage_seg_record(payload, index, 1);
+    if(record == NULL)
+        return -1;
+
+    // The crc is written last, a torn record is not valid
+    int size = data_map[payload].size;
+    uint32_t record_index = (uint32_t)index;
+    memcpy(record, &record_index, sizeof(uint32_t));
+    memcpy(record + sizeof(uint32_t), data, size);
+    uint32_t crc = storage_crc32(record, sizeof(uint32_t) + size);
+    memcpy(record + sizeof(uint32_t) + size, &crc, sizeof(uint32_t));
+
+    int records = storage_section_len(payload);
+    storage_seg_t *seg = &storage_segs[payload][section];
+    storage_seg_header_t *header = (storage_seg_header_t *)seg->base;
+    if(header->count <= (uint32_t)(index%records))
+        header->count = index%records + 1;
+    seg->dirty = 1;
+#elif SCH_STORAGE_MODE > 0
+    int nparams;
+    const dat_payload_field_t *fields = dat_get_payload_fields(payload, &nparams);
     int j;
-    for(j=0; j < nparams; ++j) {
-        int param_size = get_sizeof_type(tok_sym[j]);
-        char buff[param_size];
-        memcpy(buff, data+(j*param_size), param_size);
 
-        char name[20];
-        sprintf(name, " %s", tok_var[j]);
+#if SCH_STORAGE_MODE == 1
+    sqlite3_stmt *stmt = storage_stmt_get(STORAGE_STMT_PAYLOAD_SET, data_map[payload].table, payload);
+    if(stmt == NULL)
+        return -1;
+
+    sqlite3_bind_int(stmt, 1, index);
+    for(j=0; j < nparams; ++j)
+        bind_sqlite_value(&fields[j], data, stmt, j+2);
+
+    int rc = storage_tx_begin() == 0 ? sqlite3_step(stmt) : SQLITE_ERROR;
+    sqlite3_reset(stmt);
+
+    if (rc != SQLITE_DONE )
+    {
+        LOGE(tag, "Failed to add value to table %s. Error: %s", data_map[payload].table, sqlite3_errmsg(db));
+        return -1;
+    }
+    if(storage_tx_end() != 0)
+        return -1;
+#elif SCH_STORAGE_MODE == 2
+    char *values = (char *)malloc(nparams*48 + SCH_BUFF_MAX_LEN);
+    char *names = (char *)malloc(strlen(data_map[payload].var_names) + 2*nparams + SCH_BUFF_MAX_LEN);
+    strcpy(names, "(id, tstz,");
+    sprintf(values, "(%d, current_timestamp,", index);
+
+    for(j=0; j < nparams; ++j) {
+        char name[SCH_BUFF_MAX_LEN];
+        sprintf(name, " %s", fields[j].name);
         strcat(names, name);
 
-        char val[20];
-        get_value_string(val, tok_sym[j], buff);
+        char val[48];
+        get_value_string(val, &fields[j], data);
         strcat(values, val);
 
         if(j != nparams-1){
@@ -873,26 +1438,12 @@ int storage_set_payload_data(int index, void* data, int payload)
 
     strcat(names, ")");
     strcat(values, ")");
-    char*  insert_row = (char *)malloc(2000);
+    char*  insert_row = (char *)malloc(strlen(names) + strlen(values) + SCH_BUFF_MAX_LEN);
     sprintf(insert_row, "INSERT INTO %s %s VALUES %s",data_map[payload].table, names, values);
-    free(order);
-    free(var_names);
     free(values);
     free(names);
     LOGD(tag, "%s", insert_row);
 
-#if SCH_STORAGE_MODE == 1
-    char* err_msg;
-    int rc;
-    rc = sqlite3_exec(db, insert_row, 0, 0, &err_msg);
-
-    if (rc != SQLITE_OK )
-    {
-        LOGE(tag, "Failed to add value to table %s. Error: %s. SQL: %s", data_map[payload].table, err_msg, insert_row);
-        sqlite3_free(err_msg);
-        return -1;
-    }
-#elif SCH_STORAGE_MODE == 2
     PGresult *res = PQexec(conn, insert_row);
     free(insert_row);
     if (PQresultStatus(res) != PGRES_COMMAND_OK) {
@@ -915,84 +1466,87 @@ int storage_get_payload_data(int index, void* data, int payload)
     }
 
 #if SCH_STORAGE_MODE == 0
-    int payloads_per_section = SCH_SIZE_PER_SECTION/data_map[payload].size;
-
-    int payload_section = index/payloads_per_section;
-    int index_in_section = index%payloads_per_section;
-    int section_index = payload*SCH_SECTIONS_PER_PAYLOAD + payload_section;
-
-    uint8_t *add;
-    add = storage_addresses[section_index] + index_in_section*data_map[payload].size;
-
-    if((payload_section >= SCH_SECTIONS_PER_PAYLOAD) || (index_in_section*data_map[payload].size >= SCH_SIZE_PER_SECTION))
+    int section = storage_section(payload, index);
+    if(section < 0)
     {
-        LOGE(tag, "Payload address: %p is out of bounds", add);
+        LOGE(tag, "Payload %d index %d is out of bounds", payload, index);
         return -1;
     }
 
+    uint8_t *add;
+    add = storage_addresses[payload] + (size_t)section*SCH_SIZE_PER_SECTION +
+          (index%storage_section_len(payload))*data_map[payload].size;
+
     LOGI(tag, "Reading in address: %p, %d bytes\n", add, data_map[payload].size);
     memcpy(data, add, data_map[payload].size);
 #endif
-#if SCH_STORAGE_MODE > 0
-    char* tok_sym[300];
-    char* tok_var[300];
-    char order[300];
-    strcpy(order, data_map[payload].data_order);
-    char var_names[1000];
-    strcpy(var_names, data_map[payload].var_names);
-    int nparams = get_payloads_tokens(tok_sym, tok_var, order, var_names, payload);
-
-    char values[1000];
-    char names[1000];
-
-    strcpy(names, "");
-    int j;
-    for(j=0; j < nparams; ++j) {
+#if SCH_STORAGE_MODE == 1 && SCH_STORAGE_PAYLOAD_BLOB == 1
+    sqlite3_stmt* stmt = storage_stmt_get(STORAGE_STMT_PAYLOAD_GET, payload_table, payload);
+    if(stmt == NULL)
+        return -1;
 
-        char name[20];
-        sprintf(name, " %s", tok_var[j]);
-        strcat(names, name);
+    sqlite3_bind_int(stmt, 1, payload);
+    sqlite3_bind_int(stmt, 2, index);
+    int rc = sqlite3_step(stmt);
+    if(rc == SQLITE_ROW && sqlite3_column_bytes(stmt, 0) == data_map[payload].size)
+        memcpy(data, sqlite3_column_blob(stmt, 0), data_map[payload].size);
+    else
+        LOGE(tag, "Payload %d sample %d not found (rc=%d)", payload, index, rc);
+    sqlite3_reset(stmt);
 
-        if(j != nparams-1){
-            strcat(names, ",");
-        }
+    if(rc != SQLITE_ROW)
+        return -1;
+#elif SCH_STORAGE_MODE == 3
+    uint8_t *record = storage_seg_record(payload, index, 0);
+    if(record == NULL || !storage_seg_valid(payload, record, index))
+    {
+        LOGE(tag, "Payload %d sample %d not found", payload, index);
+        return -1;
     }
-
-    char get_value[2000];
-    sprintf(get_value,"SELECT %s FROM %s WHERE id=%d LIMIT 1"
-            ,names, data_map[payload].table, index);
-    LOGD(tag, "%s",  get_value);
+    memcpy(data, record + sizeof(uint32_t), data_map[payload].size);
+#elif SCH_STORAGE_MODE > 0
+    int nparams;
+    const dat_payload_field_t *fields = dat_get_payload_fields(payload, &nparams);
+    int j;
 
 #if SCH_STORAGE_MODE == 1
-    char* err_msg;
     int rc;
-    sqlite3_stmt* stmt = NULL;
-
-    // execute statement
-    rc = sqlite3_prepare_v2(db, get_value, -1, &stmt, 0);
-    if(rc != SQLITE_OK)
-    {
-        LOGE(tag, "Selecting data from DB Failed (rc=%d)", rc);
+    sqlite3_stmt* stmt = storage_stmt_get(STORAGE_STMT_PAYLOAD_GET, data_map[payload].table, payload);
+    if(stmt == NULL)
         return -1;
-    }
 
     // fetch only one row's status
+    sqlite3_bind_int(stmt, 1, index);
     rc = sqlite3_step(stmt);
-    int val;
     if(rc == SQLITE_ROW) {
-        for(j=0; j < nparams; ++j) {
-            int param_size = get_sizeof_type(tok_sym[j]);
-            get_sqlite_value(tok_sym[j], &val, stmt, j);
-            // TODO: sum data pointer with accumulative param sizes
-            memcpy(data+(j*4), &val, param_size);
-        }
+        for(j=0; j < nparams; ++j)
+            get_sqlite_value(&fields[j], data, stmt, j);
     }
     else {
         LOGE(tag, "Some error encountered (rc=%d)", rc);
     }
 
-    sqlite3_finalize(stmt);
+    sqlite3_reset(stmt);
 #elif SCH_STORAGE_MODE == 2
+    char names[strlen(data_map[payload].var_names) + 2*nparams + 1];
+
+    strcpy(names, "");
+    for(j=0; j < nparams; ++j) {
+
+        char name[SCH_BUFF_MAX_LEN];
+        sprintf(name, " %s", fields[j].name);
+        strcat(names, name);
+
+        if(j != nparams-1){
+            strcat(names, ",");
+        }
+    }
+
+    char get_value[sizeof(names) + SCH_BUFF_MAX_LEN];
+    sprintf(get_value,"SELECT %s FROM %s WHERE id=%d LIMIT 1"
+            ,names, data_map[payload].table, index);
+    LOGD(tag, "%s",  get_value);
+
     PGresult *res = PQexec(conn, get_value);
     int status = PQresultStatus(res);
     if (status != PGRES_TUPLES_OK || status == PGRES_COMMAND_OK) {
@@ -1001,14 +1555,11 @@ int storage_get_payload_data(int index, void* data, int payload)
         return -1;
     }
 
-    int val;
     for(j=0; j < nparams; ++j) {
-        int param_size = get_sizeof_type(tok_sym[j]);
-        if (get_psql_value(tok_sym[j], &val, res, j) == -1) {
+        if (get_psql_value(&fields[j], data, res, 0, j) == -1) {
+            PQclear(res);
             return -1;
         }
-        // TODO: sum data pointer with accumulative param sizes
-        memcpy(data+(j*4), &val, param_size);
     }
     PQclear(res);
 #endif
@@ -1017,9 +1568,217 @@ int storage_get_payload_data(int index, void* data, int payload)
     return 0;
 }
 
+int storage_get_payload_range(int from, int count, void* data, int payload)
+{
+    if(payload >= last_sensor)
+    {
+        LOGE(tag, "payload id: %d greater than maximum id: %d", payload, last_sensor);
+        return -1;
+    }
+    if(from < 0 || count <= 0)
+        return 0;
+
+    int size = data_map[payload].size;
+    int read = 0;
+
+#if SCH_STORAGE_MODE == 0
+    // Copy the consecutive samples of each section at once
+    int payloads_per_section = storage_section_len(payload);
+    while(read < count)
+    {
+        int index = from + read;
+        int payload_section = storage_section(payload, index);
+        int index_in_section = index%payloads_per_section;
+        if(payload_section < 0)
+            break;
+
+        int n = payloads_per_section - index_in_section;
+        if(n > count - read)
+            n = count - read;
+
+        uint8_t *add = storage_addresses[payload] + (size_t)payload_section*SCH_SIZE_PER_SECTION + index_in_section*size;
+        LOGV(tag, "Reading in address: %p, %d samples", add, n);
+        memcpy((uint8_t *)data + read*size, add, n*size);
+        read += n;
+    }
+#elif SCH_STORAGE_MODE == 1
+#if SCH_STORAGE_PAYLOAD_BLOB == 1
+    sqlite3_stmt* stmt = storage_stmt_get(STORAGE_STMT_PAYLOAD_RANGE, payload_table, payload);
+    if(stmt == NULL)
+        return -1;
+    sqlite3_bind_int(stmt, 1, payload);
+    sqlite3_bind_int(stmt, 2, from);
+    sqlite3_bind_int(stmt, 3, from + count - 1);
+#else
+    int j, nparams;
+    const dat_payload_field_t *fields = dat_get_payload_fields(payload, &nparams);
+    sqlite3_stmt* stmt = storage_stmt_get(STORAGE_STMT_PAYLOAD_RANGE, data_map[payload].table, payload);
+    if(stmt == NULL)
+        return -1;
+    sqlite3_bind_int(stmt, 1, from);
+    sqlite3_bind_int(stmt, 2, from + count - 1);
+#endif
+
+    // Rows are sorted by index, stop at the first missing sample
+    while(read < count && sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        int index = sqlite3_column_int(stmt, 0);
+        if(index < from + read)
+            continue;   // Repeated index
+        if(index > from + read)
+            break;
+        uint8_t *sample = (uint8_t *)data + read*size;
+#if SCH_STORAGE_PAYLOAD_BLOB == 1
+        if(sqlite3_column_bytes(stmt, 1) != size)
+            break;
+        memcpy(sample, sqlite3_column_blob(stmt, 1), size);
+#else
+        for(j=0; j < nparams; ++j)
+            get_sqlite_value(&fields[j], sample, stmt, j+1);
+#endif
+        read++;
+    }
+    sqlite3_reset(stmt);
+#elif SCH_STORAGE_MODE == 2
+    int j, nparams;
+    const dat_payload_field_t *fields = dat_get_payload_fields(payload, &nparams);
+    char names[strlen(data_map[payload].var_names) + 2*nparams + 1];
+
+    strcpy(names, "");
+    for(j=0; j < nparams; ++j) {
+        strcat(names, ", ");
+        strcat(names, fields[j].name);
+    }
+
+    char get_value[sizeof(names) + SCH_BUFF_MAX_LEN];
+    sprintf(get_value, "SELECT id%s FROM %s WHERE id BETWEEN %d AND %d ORDER BY id",
+            names, data_map[payload].table, from, from + count - 1);
+    LOGD(tag, "%s",  get_value);
+
+    PGresult *res = PQexec(conn, get_value);
+    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+        LOGE(tag, "command storage_get_payload_range failed: %s", PQerrorMessage(conn));
+        PQclear(res);
+        return -1;
+    }
+
+    int row, rows = PQntuples(res);
+    for(row = 0; row < rows && read < count; row++)
+    {
+        int index = atoi(PQgetvalue(res, row, 0));
+        if(index < from + read)
+            continue;
+        if(index > from + read)
+            break;
+        for(j=0; j < nparams; ++j)
+            get_psql_value(&fields[j], (uint8_t *)data + read*size, res, row, j+1);
+        read++;
+    }
+    PQclear(res);
+#elif SCH_STORAGE_MODE == 3
+    // Stop at the first missing sample
+    for(; read < count; read++)
+    {
+        uint8_t *record = storage_seg_record(payload, from + read, 0);
+        if(record == NULL || !storage_seg_valid(payload, record, from + read))
+            break;
+        memcpy((uint8_t *)data + read*size, record + sizeof(uint32_t), size);
+    }
+#endif
+    return read;
+}
+
 int storage_delete_memory_sections(void)
 {
-    storage_table_payload_init(1);
+    return storage_table_payload_init(1);
+}
+
+int storage_get_payload_tail(int payload)
+{
+#if SCH_STORAGE_MODE == 3
+    if(payload < 0 || payload >= last_sensor)
+        return -1;
+
+    // The segment with the newest samples
+    int seg, tail = 0;
+    for(seg = 0; seg < data_map[payload].sections; seg++)
+    {
+        storage_seg_header_t *header = (storage_seg_header_t *)storage_segs[payload][seg].base;
+        if(header != NULL && header->count > 0 && (int)(header->first + header->count) > tail)
+            tail = header->first + header->count;
+    }
+    return tail;
+#else
+    return -1;
+#endif
+}
+
+int storage_get_payload_first(int payload, int next)
+{
+    if(payload < 0 || payload >= last_sensor || next <= 0)
+        return 0;
+#if STORAGE_RING == 1
+    // The section of the last sample and the previous ones are kept
+    int len = storage_section_len(payload);
+    int first = ((next - 1)/len - data_map[payload].sections + 1)*len;
+    return first > 0 ? first : 0;
+#else
+    return 0;
+#endif
+}
+
+int storage_commit(void)
+{
+#if SCH_STORAGE_MODE == 1
+    // Nothing to commit without an open transaction
+    if(db == NULL || sqlite3_get_autocommit(db))
+        return 0;
+
+    char *err_msg;
+    int rc = sqlite3_exec(db, "COMMIT;", 0, 0, &err_msg);
+    if(rc != SQLITE_OK)
+    {
+        LOGE(tag, "Unable to commit %d samples: %s", storage_tx_samples, err_msg);
+        sqlite3_free(err_msg);
+        sqlite3_exec(db, "ROLLBACK;", 0, 0, 0);
+        storage_tx_samples = 0;
+        return -1;
+    }
+    LOGV(tag, "Committed %d samples", storage_tx_samples);
+    storage_tx_samples = 0;
+#elif SCH_STORAGE_MODE == 3
+    // Samples first, then the checkpoint with their indexes
+    int rc = 0;
+    int payload, seg;
+    for(payload = 0; payload < last_sensor; payload++)
+    {
+        for(seg = 0; seg < data_map[payload].sections; seg++)
+        {
+            storage_seg_t *segment = &storage_segs[payload][seg];
+            if(segment->base == NULL || !segment->dirty)
+                continue;
+            if(msync(segment->base, segment->len, MS_SYNC) != 0)
+            {
+                LOGE(tag, "Unable to sync payload %d segment %d: %s", payload, seg, strerror(errno));
+                rc = -1;
+                continue;
+            }
+            segment->dirty = 0;
+        }
+    }
+
+    if(storage_ckpt_map != NULL && storage_ckpt_dirty)
+    {
+        if(msync(storage_ckpt_map + (storage_ckpt.seq%2)*storage_ckpt_slot, storage_ckpt_slot, MS_SYNC) != 0)
+        {
+            LOGE(tag, "Unable to sync checkpoint %u: %s", storage_ckpt.seq, strerror(errno));
+            return -1;
+        }
+        storage_ckpt_dirty = 0;
+    }
+    return rc;
+#endif
+    return 0;
 }
 
 int storage_close(void)
@@ -1027,11 +1786,15 @@ int storage_close(void)
 #if SCH_STORAGE_MODE == 0
     free(storage_addresses);
     free(db);
+    storage_addresses = NULL;
+    db = NULL;
 #endif
 #if SCH_STORAGE_MODE == 1
         if(db != NULL)
         {
             LOGD(tag, "Closing database");
+            storage_commit();
+            storage_stmt_finalize();
             sqlite3_close(db);
             db = NULL;
             return 0;
@@ -1042,6 +1805,27 @@ int storage_close(void)
             return -1;
         }
 #endif
+#if SCH_STORAGE_MODE == 3
+    if(storage_ckpt_map == NULL)
+    {
+        LOGW(tag, "Attempting to close a storage not opened");
+        return -1;
+    }
+
+    LOGD(tag, "Closing storage");
+    int rc = storage_commit();
+    int payload, seg;
+    for(payload = 0; payload < last_sensor; payload++)
+    {
+        for(seg = 0; seg < data_map[payload].sections; seg++)
+            storage_seg_close(payload, seg);
+        free(storage_segs[payload]);
+        storage_segs[payload] = NULL;
+    }
+    munmap(storage_ckpt_map, 2*storage_ckpt_slot);
+    storage_ckpt_map = NULL;
+    return rc;
+#endif
 //FIXME: Handle case storage mode == 2
     return 0;
 }
@@ -1051,70 +1835,577 @@ static int dummy_callback(void *data, int argc, char **argv, char **names)
     return 0;
 }
 
-const char* get_sql_type(char* c_type)
+#if STORAGE_BOUNDED
+/**
+ * Number of samples of a payload stored in each memory section
+ * @param payload Payload id
+ * @return Samples per section
+ */
+static int storage_section_len(int payload)
+{
+#if SCH_STORAGE_MODE == 3
+    return SCH_SIZE_PER_SECTION / STORAGE_SEG_RECORD_SIZE(data_map[payload].size);
+#else
+    return SCH_SIZE_PER_SECTION / data_map[payload].size;
+#endif
+}
+
+/**
+ * Memory section of a payload sample. With SCH_STORAGE_RING the sections are
+ * reused in order, otherwise the index is out of bounds once all of them are
+ * full
+ * @param payload Payload id
+ * @param index Sample index
+ * @return Section number or -1 if @index is out of bounds
+ */
+static int storage_section(int payload, int index)
 {
-    if(strcmp(c_type, "%f") == 0) {
+    if(index < 0)
+        return -1;
+    int section = index/storage_section_len(payload);
+#if STORAGE_RING == 1
+    return section % data_map[payload].sections;
+#else
+    return section < data_map[payload].sections ? section : -1;
+#endif
+}
+
+/**
+ * Reclaim the oldest section of a payload if the sample @index starts a
+ * section already used, the samples stored in it are deleted (only with
+ * SCH_STORAGE_SQL_RETENTION in the SQL modes). The RAM sections are just
+ * overwritten and the segments are reset when the sample is written (@see
+ * storage_seg_record).
+ * @param payload Payload id
+ * @param index Index of the sample to write
+ */
+static void storage_payload_reclaim(int payload, int index)
+{
+    int len = storage_section_len(payload);
+    if(STORAGE_RING == 0 || index%len != 0 || index < len*data_map[payload].sections)
+        return;
+
+    int first = storage_get_payload_first(payload, index + 1);
+    LOGI(tag, "Reclaiming payload %d section %d, samples before %d are discarded",
+         payload, storage_section(payload, index), first);
+#if SCH_STORAGE_MODE == 1
+    char *err_msg = NULL;
+#if SCH_STORAGE_PAYLOAD_BLOB == 1
+    char *sql = sqlite3_mprintf("DELETE FROM %s WHERE payload = %d AND idx < %d;", payload_table, payload, first);
+#else
+    char *sql = sqlite3_mprintf("DELETE FROM %s WHERE id < %d;", data_map[payload].table, first);
+#endif
+    if(storage_tx_begin() != 0 || sqlite3_exec(db, sql, 0, 0, &err_msg) != SQLITE_OK)
+    {
+        LOGE(tag, "Unable to reclaim payload %d samples. SQL: %s", payload, sql);
+        sqlite3_free(err_msg);
+    }
+    sqlite3_free(sql);
+#elif SCH_STORAGE_MODE == 2
+    char del_query[SCH_BUFF_MAX_LEN];
+    snprintf(del_query, SCH_BUFF_MAX_LEN, "DELETE FROM %s WHERE id < %d;", data_map[payload].table, first);
+    PGresult *res = PQexec(conn, del_query);
+    if (PQresultStatus(res) != PGRES_COMMAND_OK)
+        LOGE(tag, "Unable to reclaim payload %d samples: %s", payload, PQerrorMessage(conn));
+    PQclear(res);
+#endif
+}
+#endif
+
+const char* get_sql_type(const dat_payload_field_t *field)
+{
+    if(field->type == 'f') {
 #if SCH_STORAGE_MODE == 2
         return "DOUBLE PRECISION";
 #else
         return "REAL";
 #endif
     }
-    else if(strcmp(c_type, "%d") == 0) {
-        return "INTEGER";
-    } else if(strcmp(c_type, "%u") == 0) {
-        return "BIGINT";
-    } else {
-        return "TEXT";
+    else if(field->type == 'd') {
+        return field->size == 8 ? "BIGINT" : "INTEGER";
+    }
+    else {
+        // Unsigned 32 bits values do not fit in a signed INTEGER
+        return field->size >= 4 ? "BIGINT" : "INTEGER";
     }
 }
 
 #if SCH_STORAGE_MODE == 1
-    void get_sqlite_value(char* c_type, void* buff, sqlite3_stmt* stmt, int j)
+    void get_sqlite_value(const dat_payload_field_t *field, void* data, sqlite3_stmt* stmt, int j)
     {
-        if(strcmp(c_type, "%f") == 0) {
-            float val;
-            val =(float) sqlite3_column_double(stmt, j);
-            memcpy(buff, &val, sizeof(float));
+        if(field->type == 'f')
+            dat_set_payload_field_real(field, data, sqlite3_column_double(stmt, j));
+        else
+            dat_set_payload_field_int(field, data, sqlite3_column_int64(stmt, j));
+    }
+
+    void bind_sqlite_value(const dat_payload_field_t *field, void* data, sqlite3_stmt* stmt, int j)
+    {
+        if(field->type == 'f') {
+            int32_t bits = 0;
+            if(field->size == sizeof(float))
+                memcpy(&bits, (uint8_t *)data + field->offset, sizeof(bits));
+            if (bits == -1)
+                sqlite3_bind_text(stmt, j, "nan", -1, SQLITE_STATIC);
+            else
+                sqlite3_bind_double(stmt, j, dat_get_payload_field_real(field, data));
+        }
+        else {
+            sqlite3_bind_int64(stmt, j, dat_get_payload_field_int(field, data));
+        }
+    }
+
+    /**
+     * Build the SQL of a cached statement
+     * @param op Operation
+     * @param table Table name
+     * @param payload Payload id, only for payload operations
+     * @return SQL string, free with sqlite3_free
+     */
+    static char *storage_stmt_sql(storage_stmt_op_t op, char *table, int payload)
+    {
+#if SCH_STORAGE_PAYLOAD_BLOB == 1
+        if(op == STORAGE_STMT_PAYLOAD_SET)
+            return sqlite3_mprintf("INSERT OR REPLACE INTO %s (payload, idx, data) VALUES (?1, ?2, ?3);", table);
+        if(op == STORAGE_STMT_PAYLOAD_GET)
+            return sqlite3_mprintf("SELECT data FROM %s WHERE payload = ?1 AND idx = ?2;", table);
+        if(op == STORAGE_STMT_PAYLOAD_RANGE)
+            return sqlite3_mprintf("SELECT idx, data FROM %s WHERE payload = ?1 AND idx BETWEEN ?2 AND ?3 "
+                                   "ORDER BY idx;", table);
+#else
+        if(op == STORAGE_STMT_PAYLOAD_SET || op == STORAGE_STMT_PAYLOAD_GET || op == STORAGE_STMT_PAYLOAD_RANGE)
+        {
+            int nparams;
+            const dat_payload_field_t *fields = dat_get_payload_fields(payload, &nparams);
+
+            char names[strlen(data_map[payload].var_names) + 2*nparams + 1];
+            char values[8*nparams + 1];
+            strcpy(names, "");
+            strcpy(values, "");
+            int j;
+            for(j=0; j < nparams; ++j) {
+                char name[SCH_BUFF_MAX_LEN];
+                sprintf(name, "%s%s", j == 0 ? "" : ", ", fields[j].name);
+                strcat(names, name);
+                sprintf(name, ", ?%d", j+2);
+                strcat(values, name);
+            }
+
+            if(op == STORAGE_STMT_PAYLOAD_SET)
+                return sqlite3_mprintf("INSERT INTO %s (id, tstz, %s) VALUES (?1, current_timestamp%s);",
+                                       table, names, values);
+            else if(op == STORAGE_STMT_PAYLOAD_GET)
+                return sqlite3_mprintf("SELECT %s FROM %s WHERE id = ?1 LIMIT 1;", names, table);
+            else
+                return sqlite3_mprintf("SELECT id, %s FROM %s WHERE id BETWEEN ?1 AND ?2 ORDER BY id;", names, table);
+        }
+#endif
+
+        switch(op)
+        {
+            case STORAGE_STMT_REPO_GET:
+                return sqlite3_mprintf("SELECT value FROM %s WHERE idx = ?1;", table);
+            case STORAGE_STMT_REPO_GET_STR:
+                return sqlite3_mprintf("SELECT value FROM %s WHERE name = ?1;", table);
+            case STORAGE_STMT_REPO_GET_ALL:
+                return sqlite3_mprintf("SELECT idx, value FROM %s;", table);
+            case STORAGE_STMT_REPO_SET:
+                return sqlite3_mprintf("INSERT OR REPLACE INTO %s (idx, name, value) "
+                                       "VALUES (?1, (SELECT name FROM %s WHERE idx = ?1), ?2);",
+                                       table, table);
+            case STORAGE_STMT_FP_SET:
+                return sqlite3_mprintf("INSERT OR REPLACE INTO %s (time, command, args, executions, periodical) "
+                                       "VALUES (?1, ?2, ?3, ?4, ?5);", table);
+            case STORAGE_STMT_FP_GET:
+                return sqlite3_mprintf("SELECT command, args, executions, periodical FROM %s WHERE time = ?1;", table);
+            case STORAGE_STMT_FP_ERASE:
+                return sqlite3_mprintf("DELETE FROM %s WHERE time = ?1;", table);
+            default:
+                return NULL;
+        }
+    }
+
+    /**
+     * Get the prepared statement of an operation over a table, prepare it the
+     * first time. The statement must be reset after use.
+     * @param op Operation
+     * @param table Table name
+     * @param payload Payload id, only for payload operations
+     * @return Statement or NULL on error
+     */
+    static sqlite3_stmt *storage_stmt_get(storage_stmt_op_t op, char *table, int payload)
+    {
+        int i;
+        for(i = 0; i < storage_stmt_count; i++)
+        {
+            if(storage_stmt_cache[i].op == op && strcmp(storage_stmt_cache[i].table, table) == 0)
+                return storage_stmt_cache[i].stmt;
         }
-        else if(strcmp(c_type, "%d") == 0) {
-            int val;
-            val = sqlite3_column_int(stmt, j);
-            memcpy(buff, &val, sizeof(int));
+
+        if(storage_stmt_count >= STORAGE_STMT_MAX || strlen(table) >= STORAGE_STMT_TABLE_LEN)
+        {
+            LOGE(tag, "Unable to cache statement %d for table %s", op, table);
+            return NULL;
         }
-        else if(strcmp(c_type, "%u") == 0) {
-            unsigned int val;
-            val = (unsigned int) sqlite3_column_int(stmt, j);
-            memcpy(buff, &val, sizeof(unsigned int));
+
+        sqlite3_stmt *stmt = NULL;
+        char *sql = storage_stmt_sql(op, table, payload);
+        int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
+        if(rc != SQLITE_OK)
+        {
+            LOGE(tag, "Unable to prepare statement: %s. SQL: %s", sqlite3_errmsg(db), sql);
+            sqlite3_free(sql);
+            return NULL;
+        }
+        LOGD(tag, "Prepared statement: %s", sql);
+        sqlite3_free(sql);
+
+        storage_stmt_t *entry = &storage_stmt_cache[storage_stmt_count++];
+        entry->op = op;
+        strcpy(entry->table, table);
+        entry->stmt = stmt;
+        return stmt;
+    }
+
+    /**
+     * Release all the cached statements, before closing the database
+     */
+    static void storage_stmt_finalize(void)
+    {
+        int i;
+        for(i = 0; i < storage_stmt_count; i++)
+            sqlite3_finalize(storage_stmt_cache[i].stmt);
+        storage_stmt_count = 0;
+    }
+
+    /**
+     * Open a payload samples transaction, if there is none
+     * @return 0 if OK, -1 on error
+     */
+    static int storage_tx_begin(void)
+    {
+        if(SCH_STORAGE_TX_SAMPLES <= 1 || !sqlite3_get_autocommit(db))
+            return 0;
+
+        char *err_msg;
+        if(sqlite3_exec(db, "BEGIN TRANSACTION;", 0, 0, &err_msg) != SQLITE_OK)
+        {
+            LOGE(tag, "SQL error: %s", err_msg);
+            sqlite3_free(err_msg);
+            return -1;
         }
+        storage_tx_tick = osTaskGetTickCount();
+        return 0;
+    }
+
+    /**
+     * Account one more sample in the open transaction, commit it if it is
+     * full or older than SCH_STORAGE_TX_MS
+     * @return 0 if OK, -1 on error
+     */
+    static int storage_tx_end(void)
+    {
+        storage_tx_samples++;
+        if(storage_tx_samples >= SCH_STORAGE_TX_SAMPLES)
+            return storage_commit();
+        return storage_tx_check();
+    }
+
+    /**
+     * Commit the open payload samples transaction if it is older than
+     * SCH_STORAGE_TX_MS
+     * @return 0 if OK, -1 on error
+     */
+    static int storage_tx_check(void)
+    {
+        if(sqlite3_get_autocommit(db) ||
+           osTaskGetTickCount() - storage_tx_tick < osDefineTime(SCH_STORAGE_TX_MS))
+            return 0;
+        return storage_commit();
     }
 #elif SCH_STORAGE_MODE == 2
-    int get_psql_value(char* c_type, void* buff, PGresult *res, int j)
+    int get_psql_value(const dat_payload_field_t *field, void* data, PGresult *res, int row, int j)
     {
-        char * res_str = PQgetvalue(res, 0, j);
+        char * res_str = PQgetvalue(res, row, j);
 
         if( res_str == NULL ) {
             return -1 ;
         }
 
-        if(strcmp(c_type, "%f") == 0) {
-            float val;
-            val =(float) atof(res_str);
-            memcpy(buff, &val, sizeof(float));
+        if(field->type == 'f')
+            dat_set_payload_field_real(field, data, strtod(res_str, NULL));
+        else if(field->type == 'd')
+            dat_set_payload_field_int(field, data, strtoll(res_str, NULL, 10));
+        else
+            dat_set_payload_field_int(field, data, (int64_t)strtoull(res_str, NULL, 10));
+        return 0;
+    }
+#elif SCH_STORAGE_MODE == 3
+    /**
+     * Open and map a payload segment file. An existing segment is checked: if
+     * the layout does not match it is discarded, otherwise its count is
+     * moved back over the invalid (torn) records at the tail and forward over
+     * the valid records written after the count was last updated.
+     * @param payload Payload id
+     * @param seg Segment number
+     * @param create Create the segment file if it does not exist
+     * @return 0 if OK, -1 if the segment does not exist or on error
+     */
+    static int storage_seg_open(int payload, int seg, int create)
+    {
+        storage_seg_t *segment = &storage_segs[payload][seg];
+        if(segment->base != NULL)
+            return 0;
+
+        char seg_file[SCH_BUFF_MAX_LEN*2];
+        snprintf(seg_file, sizeof(seg_file), "%s.%s.%d", storage_path, data_map[payload].table, seg);
+        int fd = open(seg_file, O_RDWR | (create ? O_CREAT : 0), 0644);
+        if(fd < 0)
+        {
+            if(create || errno != ENOENT)
+                LOGE(tag, "Can't open segment file %s: %s", seg_file, strerror(errno));
+            return -1;
         }
-        else if(strcmp(c_type, "%d") == 0) {
-            int val;
-            val =  atoi(res_str);
-            memcpy(buff, &val, sizeof(int));
+
+        uint32_t record_size = STORAGE_SEG_RECORD_SIZE(data_map[payload].size);
+        uint32_t records = storage_section_len(payload);
+        size_t len = sizeof(storage_seg_header_t) + records*record_size;
+
+        struct stat st;
+        storage_seg_header_t file_header;
+        int valid = fstat(fd, &st) == 0 && (size_t)st.st_size == len &&
+                    pread(fd, &file_header, sizeof(file_header), 0) == sizeof(file_header) &&
+                    file_header.magic == STORAGE_SEG_MAGIC &&
+                    file_header.version == STORAGE_SEG_VERSION &&
+                    file_header.record_size == record_size;
+        if(!valid)
+        {
+            if(!create)
+                LOGW(tag, "Payload %d segment %d layout does not match, discarded", payload, seg);
+            // The records are zero (not valid) until written
+            if(ftruncate(fd, 0) != 0 || ftruncate(fd, len) != 0)
+            {
+                LOGE(tag, "Can't resize segment file %s: %s", seg_file, strerror(errno));
+                close(fd);
+                return -1;
+            }
         }
-        else if(strcmp(c_type, "%u") == 0) {
-            unsigned int val;
-            // TODO: Change to  strtoul()
-            val = (unsigned int) atol(res_str);
-            memcpy(buff, &val, sizeof(unsigned int));
+
+        // Reserve the blocks of the whole segment, also the holes of a file
+        // written sparse, so a full disk fails here and not with a SIGBUS
+        // when a record is stored through the map
+        int rc = posix_fallocate(fd, 0, len);
+        if(rc != 0)
+        {
+            LOGE(tag, "Can't allocate segment file %s: %s", seg_file, strerror(rc));
+            close(fd);
+            return -1;
+        }
+
+        void *map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if(map == MAP_FAILED)
+        {
+            LOGE(tag, "Can't map segment file %s: %s", seg_file, strerror(errno));
+            return -1;
+        }
+        segment->base = (uint8_t *)map;
+        segment->len = len;
+        segment->dirty = 0;
+
+        storage_seg_header_t *header = (storage_seg_header_t *)segment->base;
+        if(!valid)
+        {
+            header->magic = STORAGE_SEG_MAGIC;
+            header->version = STORAGE_SEG_VERSION;
+            header->record_size = record_size;
+            header->count = 0;
+            header->first = seg*records;
+            segment->dirty = 1;
+            return 0;
+        }
+
+        // Tail recovery
+        int first = header->first;
+        uint8_t *base = segment->base + sizeof(storage_seg_header_t);
+        uint32_t count = header->count < records ? header->count : records;
+        while(count > 0 && !storage_seg_valid(payload, base + (count-1)*record_size, first + count - 1))
+            count--;
+        while(count < records && storage_seg_valid(payload, base + count*record_size, first + count))
+            count++;
+        if(count != header->count)
+        {
+            LOGW(tag, "Payload %d segment %d recovered with %u records (was %u)", payload, seg, count, header->count);
+            header->count = count;
+            segment->dirty = 1;
         }
         return 0;
     }
+
+    /**
+     * Unmap a payload segment, the pending changes are written by the kernel
+     * @param payload Payload id
+     * @param seg Segment number
+     */
+    static void storage_seg_close(int payload, int seg)
+    {
+        storage_seg_t *segment = &storage_segs[payload][seg];
+        if(segment->base != NULL)
+            munmap(segment->base, segment->len);
+        memset(segment, 0, sizeof(storage_seg_t));
+    }
+
+    /**
+     * Get the address of the record of a sample, O(1)
+     * @param payload Payload id
+     * @param index Sample index
+     * @param create Create the segment if it does not exist, or reset it if it
+     * holds older samples, to write the sample
+     * @return Record address or NULL if the segment does not exist or the index is out of bounds
+     */
+    static uint8_t *storage_seg_record(int payload, int index, int create)
+    {
+        int records = storage_section_len(payload);
+        int seg = storage_section(payload, index);
+        if(seg < 0)
+            return NULL;
+
+        storage_seg_t *segment = &storage_segs[payload][seg];
+        if(segment->base == NULL && (!create || storage_seg_open(payload, seg, 1) != 0))
+            return NULL;
+
+        storage_seg_header_t *header = (storage_seg_header_t *)segment->base;
+        uint32_t first = index - index%records;
+        if(create && header->first != first)
+        {
+            LOGD(tag, "Payload %d segment %d reused from index %u", payload, seg, first);
+            header->first = first;
+            header->count = 0;
+            segment->dirty = 1;
+        }
+        return segment->base + sizeof(storage_seg_header_t) +
+               (size_t)(index%records)*STORAGE_SEG_RECORD_SIZE(data_map[payload].size);
+    }
+
+    /**
+     * Check that a record holds the sample @index and it was completely written
+     * @param payload Payload id
+     * @param record Record address
+     * @param index Sample index
+     * @return 1 if valid, 0 if not
+     */
+    static int storage_seg_valid(int payload, const uint8_t *record, int index)
+    {
+        uint32_t record_index, crc;
+        int size = data_map[payload].size;
+        memcpy(&record_index, record, sizeof(uint32_t));
+        memcpy(&crc, record + sizeof(uint32_t) + size, sizeof(uint32_t));
+        return record_index == (uint32_t)index && crc == storage_crc32(record, sizeof(uint32_t) + size);
+    }
+
+    /**
+     * Load the newest valid checkpoint slot, or empty tables if there is none
+     * @return 0 if OK, -1 if no slot is valid
+     */
+    static int storage_ckpt_load(void)
+    {
+        int slot, best = -1;
+        for(slot = 0; slot < 2; slot++)
+        {
+            storage_ckpt_t *ckpt = (storage_ckpt_t *)(storage_ckpt_map + slot*storage_ckpt_slot);
+            if(ckpt->magic != STORAGE_CKPT_MAGIC || ckpt->size != sizeof(storage_ckpt_t) ||
+               ckpt->crc != storage_crc32(&ckpt->seq, sizeof(storage_ckpt_t) - offsetof(storage_ckpt_t, seq)))
+                continue;
+            if(best < 0 || ckpt->seq > ((storage_ckpt_t *)(storage_ckpt_map + best*storage_ckpt_slot))->seq)
+                best = slot;
+        }
+
+        if(best < 0)
+        {
+            int i;
+            memset(&storage_ckpt, 0, sizeof(storage_ckpt_t));
+            for(i = 0; i < STORAGE_CKPT_VALUES; i++)
+                storage_ckpt.values[i] = -1;
+            return -1;
+        }
+
+        memcpy(&storage_ckpt, storage_ckpt_map + best*storage_ckpt_slot, sizeof(storage_ckpt_t));
+        return 0;
+    }
+
+    /**
+     * Write the tables to the checkpoint slot not holding the last checkpoint.
+     * The last checkpoint is synced first, so one of the slots is always valid
+     * @return 0 if OK, -1 on error
+     */
+    static int storage_ckpt_write(void)
+    {
+        if(storage_ckpt_map == NULL)
+            return -1;
+
+        if(storage_ckpt_dirty)
+        {
+            if(msync(storage_ckpt_map + (storage_ckpt.seq%2)*storage_ckpt_slot, storage_ckpt_slot, MS_SYNC) != 0)
+            {
+                LOGE(tag, "Unable to sync checkpoint %u: %s", storage_ckpt.seq, strerror(errno));
+                return -1;
+            }
+            storage_ckpt_dirty = 0;
+        }
+
+        storage_ckpt.magic = STORAGE_CKPT_MAGIC;
+        storage_ckpt.size = sizeof(storage_ckpt_t);
+        storage_ckpt.seq++;
+        storage_ckpt.crc = storage_crc32(&storage_ckpt.seq, sizeof(storage_ckpt_t) - offsetof(storage_ckpt_t, seq));
+        memcpy(storage_ckpt_map + (storage_ckpt.seq%2)*storage_ckpt_slot, &storage_ckpt, sizeof(storage_ckpt_t));
+        storage_ckpt_dirty = 1;
+        return 0;
+    }
+
+    /**
+     * Count the used flight plan entries
+     * @return Number of entries
+     */
+    static int storage_ckpt_fp_count(void)
+    {
+        int i, n = 0;
+        for(i = 0; i < SCH_FP_MAX_ENTRIES; i++)
+            n += storage_ckpt.fp[i].used ? 1 : 0;
+        return n;
+    }
+
+    /**
+     * CRC-32 (IEEE 802.3) of a buffer, the table is built in the first call
+     * @param data Buffer
+     * @param len Buffer size in bytes
+     * @return CRC
+     */
+    static uint32_t storage_crc32(const void *data, size_t len)
+    {
+        static uint32_t table[256];
+        static int table_ready = 0;
+        uint32_t crc;
+        size_t i;
+
+        if(!table_ready)
+        {
+            int j;
+            for(i = 0; i < 256; i++)
+            {
+                crc = (uint32_t)i;
+                for(j = 0; j < 8; j++)
+                    crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+                table[i] = crc;
+            }
+            table_ready = 1;
+        }
+
+        const uint8_t *buff = (const uint8_t *)data;
+        crc = 0xFFFFFFFF;
+        for(i = 0; i < len; i++)
+            crc = table[(crc ^ buff[i]) & 0xFF] ^ (crc >> 8);
+        return crc ^ 0xFFFFFFFF;
+    }
 #endif
 
 //TODO: Remove not used function?
@@ -15,11 +15,19 @@
 #include <stdio.h>
 #include "config.h"
 #include "repoData.h"
+#include "repoDataSchema.h"
 
 #if SCH_STORAGE_MODE == 1
     #include <sqlite3.h>
 #elif SCH_STORAGE_MODE == 2
     #include <libpq-fe.h>
+#elif SCH_STORAGE_MODE == 3
+    #include <stddef.h>
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
 #endif
 
 /**
@@ -82,6 +90,19 @@ int storage_table_payload_init(int drop);
  */
 int storage_repo_get_value_idx(int index, char *table);
 
+/**
+ * Get all the INT (integer) values of a table with one query. Each value is
+ * stored in values[index], indexes not found in the table are set to -1.
+ *
+ * @note: non-reentrant function, use mutex to sync access
+ *
+ * @param values Int array. Values by index
+ * @param n Int. Size of the values array
+ * @param table Str. Table name
+ * @return 0 OK, -1 Error
+ */
+int storage_repo_get_values(int *values, int n, char *table);
+
 /**
  * Get a INT (integer) value from table by name
  *
@@ -105,6 +126,19 @@ int storage_repo_get_value_str(char *name, char *table);
  */
 int storage_repo_set_value_idx(int index, int value, char *table);
 
+/**
+ * Set or update the values of several INT (integer) variables by index in a
+ * single transaction, so the storage is written once. If a value can not be
+ * written the transaction is rolled back.
+ * @note: non-reentrant function, use mutex to sync access
+ * @param index Int array. Variables indexes
+ * @param value Int array. Values to set
+ * @param n Int. Number of variables
+ * @param table Str. Table name
+ * @return 0 OK, -1 Error
+ */
+int storage_repo_set_values_idx(int *index, int *value, int n, char *table);
+
 /**
  * Set or update the row of a certain time
  *
@@ -188,6 +222,47 @@ int storage_set_payload_data(int index, void * data, int payload);
  */
 int storage_get_payload_data(int index, void* data, int payload);
 
+/**
+ * Get @count consecutive samples of a payload, starting at index @from, with
+ * a single query (or one copy per memory section in RAM)
+ *
+ * @note: non-reentrant function, use mutex to sync access
+ *
+ * @param from Int. index of the first sample
+ * @param count Int. max number of samples to read
+ * @param data Pointer to an array of at least @count structs
+ * @param payload Int. payload to get values
+ * @return Number of consecutive samples read from @from, -1 Error
+ */
+int storage_get_payload_range(int from, int count, void* data, int payload);
+
+/**
+ * Get the index of the oldest sample of a payload still stored, when @next is
+ * the index of the next sample to write. With SCH_STORAGE_RING the oldest
+ * section of a payload is reclaimed when all its sections
+ * (data_map[payload].sections) are full, so only the samples of the section
+ * being written and the previous ones are kept.
+ *
+ * @param payload Int. payload id
+ * @param next Int. index of the next sample (the payload sys_index)
+ * @return Index of the oldest sample kept, 0 if no sample was reclaimed
+ */
+int storage_get_payload_first(int payload, int next);
+
+/**
+ * Get the index following the last sample of a payload found in the storage,
+ * after the tail recovery done by storage_table_payload_init. Samples written
+ * but not yet synced when the system went down may be lost, the payload index
+ * should be moved to this value on startup.
+ *
+ * @note: only with SCH_STORAGE_MODE 3
+ * @note: non-reentrant function, use mutex to sync access
+ *
+ * @param payload Int. payload id
+ * @return Next sample index, -1 Error or not supported
+ */
+int storage_get_payload_tail(int payload);
+
 /**
  * Delete payload databases
  *
@@ -196,6 +271,23 @@ int storage_get_payload_data(int index, void* data, int payload);
  */
 int storage_delete_memory_sections(void);
 
+/**
+ * Commit the open payload samples transaction, if any. Samples are inserted
+ * in batches of up to SCH_STORAGE_TX_SAMPLES, a batch is also committed
+ * SCH_STORAGE_TX_MS after it was opened (checked when the next sample is
+ * written), before any other write and when the database is closed. Status
+ * variables are written inside the open batch and commit it with them, so
+ * they are only reported as written once they are durable. Call it to make
+ * the last samples durable, dat_flush does.
+ * With SCH_STORAGE_MODE 3 the written segments and the last checkpoint are
+ * synced to their files.
+ *
+ * @note: non-reentrant function, use mutex to sync access
+ *
+ * @return 0 OK, -1 Error
+ */
+int storage_commit(void);
+
 /**
  * Close the opened database
  *
@@ -206,16 +298,22 @@ int storage_delete_memory_sections(void);
 int storage_close(void);
 
 /**
- * Translate to sql format a c format type
- * @param c_type
+ * Translate to sql format a payload field type
+ * @param field Field descriptor, @see dat_get_payload_fields
  * @return string in sql syntax
  */
-const char* get_sql_type(char* c_type);
+const char* get_sql_type(const dat_payload_field_t *field);
 
+/*
+ * Copy one column of the current row to a payload field, or bind a payload
+ * field to a statement parameter. @data is the payload struct, the field
+ * offset is applied inside.
+ */
 #if SCH_STORAGE_MODE == 1
-    void get_sqlite_value(char* c_type, void* buff, sqlite3_stmt* stmt, int j);
+    void get_sqlite_value(const dat_payload_field_t *field, void* data, sqlite3_stmt* stmt, int j);
+    void bind_sqlite_value(const dat_payload_field_t *field, void* data, sqlite3_stmt* stmt, int j);
 #elif SCH_STORAGE_MODE == 2
-    int get_psql_value(char* c_type, void* buff, PGresult *res, int j);
+    int get_psql_value(const dat_payload_field_t *field, void* data, PGresult *res, int row, int j);
 #endif
 
 // TODO: Remove not used function?
@@ -14,6 +14,12 @@ char* fp_table = "flightPlan";
  */
 static uint32_t* storage_addresses_payloads;
 static uint32_t* storage_addresses_flight_plan;
+/**
+ * First section of each payload in storage_addresses_payloads, the payload
+ * uses data_map[payload].sections sections from there
+ */
+static int storage_payload_sections[last_sensor];
+static int storage_payload_sections_total;
 
 typedef struct {
     uint32_t exec, peri, name_len, args_len;
@@ -50,7 +56,13 @@ int storage_init(const char *file)
 
     /* Init storage addresses */
     //FIXME: According to repoData->dat_repo_init this code should be in storage_table_payload_init function
-    int payload_tables_amount = SCH_SECTIONS_PER_PAYLOAD*last_sensor;
+    int payload_tables_amount = 0;
+    for (int i = 0; i < last_sensor; i++)
+    {
+        storage_payload_sections[i] = payload_tables_amount;
+        payload_tables_amount += data_map[i].sections;
+    }
+    storage_payload_sections_total = payload_tables_amount;
     storage_addresses_payloads = malloc(payload_tables_amount*sizeof(uint32_t));
     int sections_for_fp = (SCH_FP_MAX_ENTRIES*max_command_size)/SCH_SIZE_PER_SECTION + 1;
     storage_addresses_flight_plan = malloc(sections_for_fp*sizeof(uint32_t));
@@ -92,6 +104,16 @@ int storage_repo_get_value_idx(int index, char *table)
     return (int)(data.data32);
 }
 
+int storage_repo_get_values(int *values, int n, char *table)
+{
+    // Values are stored consecutively from address 0
+    uint16_t len = (uint16_t)(n*sizeof(uint32_t));
+    gs_fm33256b_fram_read(0, 0, (uint8_t *)values, len);
+
+    LOGV(tag, "Read %d values", n);
+    return 0;
+}
+
 int storage_repo_get_value_str(char *name, char *table)
 {
     // FIXME: return -1 if not implemented?
@@ -112,6 +134,14 @@ int storage_repo_set_value_idx(int index, int value, char *table)
     return 0;
 }
 
+int storage_repo_set_values_idx(int *index, int *value, int n, char *table)
+{
+    int i, rc = 0;
+    for(i = 0; i < n; i++)
+        rc |= storage_repo_set_value_idx(index[i], value[i], table);
+    return rc;
+}
+
 int storage_repo_set_value_str(char *name, int value, char *table)
 {
     return 0;
@@ -465,6 +495,26 @@ int storage_flight_plan_show_table(int entries)
     return 0;
 }
 
+int storage_get_payload_first(int payload, int next)
+{
+    if(payload < 0 || payload >= last_sensor || next <= 0)
+        return 0;
+#if SCH_STORAGE_RING == 1
+    // The section of the last sample and the previous ones are kept
+    int len = SCH_SIZE_PER_SECTION/data_map[payload].size;
+    int first = ((next - 1)/len - data_map[payload].sections + 1)*len;
+    return first > 0 ? first : 0;
+#else
+    return 0;
+#endif
+}
+
+int storage_commit(void)
+{
+    // Payload samples are written to flash one by one, nothing is pending
+    return 0;
+}
+
 int storage_close(void)
 {
     free(storage_addresses_payloads);
@@ -500,6 +550,62 @@ int write_data_with_check(uint32_t add, uint8_t * data, uint16_t size)
     return -1;
 }
 
+/**
+ * Memory section of a payload sample in storage_addresses_payloads. With
+ * SCH_STORAGE_RING the payload sections are reused in order, otherwise the
+ * index is out of bounds once all of them are full
+ * @param payload Payload id
+ * @param index Sample index
+ * @return Section index or -1 if @index is out of bounds
+ */
+static int storage_section(int payload, int index)
+{
+    if(index < 0)
+        return -1;
+    int section = index/(SCH_SIZE_PER_SECTION/data_map[payload].size);
+#if SCH_STORAGE_RING == 1
+    section = section % data_map[payload].sections;
+#else
+    if(section >= data_map[payload].sections)
+        return -1;
+#endif
+    return storage_payload_sections[payload] + section;
+}
+
+/**
+ * Erase the block of a sample address if it still holds samples of a
+ * previous round of the payload sections. The sample address is checked
+ * instead of the section start because write_data_with_check may skip some
+ * indexes, and it also works after a reset.
+ * @param payload Payload id
+ * @param index Index of the sample to write
+ * @param add Sample address
+ * @return 0 OK, -1 Error
+ */
+static int storage_payload_reclaim(int payload, int index, uint32_t add)
+{
+    int payloads_per_section = SCH_SIZE_PER_SECTION/data_map[payload].size;
+    if(SCH_STORAGE_RING == 0 || index < payloads_per_section*data_map[payload].sections)
+        return 0;
+
+    uint32_t word = 0;
+    if(spn_fl512s_read_data(0, add, (uint8_t *)&word, sizeof(word)) != 0)
+        return -1;
+    if(word == 0xffffffff)
+        return 0;
+
+    int section = storage_section(payload, index);
+    LOGI(tag, "Reclaiming payload %d section in address %u, samples before %d are discarded",
+         payload, (unsigned int)storage_addresses_payloads[section],
+         storage_get_payload_first(payload, index + 1));
+    if(spn_fl512s_erase_block(0, storage_addresses_payloads[section]) != 0)
+    {
+        LOGE(tag, "Failed attempt at deleting data in storage address %u", (unsigned int)storage_addresses_payloads[section]);
+        return -1;
+    }
+    return 0;
+}
+
 int storage_set_payload_data(int index, void* data, int payload)
 {
     if(payload >= last_sensor)
@@ -510,18 +616,19 @@ int storage_set_payload_data(int index, void* data, int payload)
 
     int payloads_per_section = SCH_SIZE_PER_SECTION/data_map[payload].size;
 
-    int payload_section = index/payloads_per_section;
+    int section_index = storage_section(payload, index);
     int index_in_section = index%payloads_per_section;
 
-    int section_index = payload*SCH_SECTIONS_PER_PAYLOAD + payload_section;
+    if (section_index < 0)
+    {
+        LOGE(tag, "Payload index: %d is out of bounds", index);
+        return -1;
+    }
 
     uint32_t add = storage_addresses_payloads[section_index] + index_in_section*data_map[payload].size;
 
-    if (payload_section >= SCH_SECTIONS_PER_PAYLOAD)
-    {
-        LOGE(tag, "Payload address: %u is out of bounds", (unsigned int)add);
+    if (storage_payload_reclaim(payload, index, add) != 0)
         return -1;
-    }
 
     LOGI(tag, "Writing in address: %u, %d bytes\n", (unsigned int)add, data_map[payload].size);
 //    int ret = spn_fl512s_write_data(0, add, data, data_map[payload].size);
@@ -563,19 +670,17 @@ int storage_get_payload_data(int index, void* data, int payload)
 
     int payloads_per_section = SCH_SIZE_PER_SECTION/data_map[payload].size;
 
-    int payload_section = index/payloads_per_section;
+    int section_index = storage_section(payload, index);
     int index_in_section = index%payloads_per_section;
 
-    int section_index = payload*SCH_SECTIONS_PER_PAYLOAD + payload_section;
-
-    uint32_t add = storage_addresses_payloads[section_index] + index_in_section*data_map[payload].size;
-
-    if (payload_section >= SCH_SECTIONS_PER_PAYLOAD)
+    if (section_index < 0)
     {
-        LOGE(tag, "payload address: %u is out of bounds", (unsigned int)add);
+        LOGE(tag, "payload index: %d is out of bounds", index);
         return -1;
     }
 
+    uint32_t add = storage_addresses_payloads[section_index] + index_in_section*data_map[payload].size;
+
     LOGI(tag, "Reading in address: %u, %d bytes\n", (unsigned int)add, data_map[payload].size);
 //    printf("Reading values of size %u \n", data_map[payload]);
 //    spn_fl512s_read_data(add, (uint8_t *) data, data_map[payload]);
@@ -588,11 +693,61 @@ int storage_get_payload_data(int index, void* data, int payload)
     return 0;
 }
 
+int storage_get_payload_range(int from, int count, void* data, int payload)
+{
+    if(payload >= last_sensor)
+    {
+        LOGE(tag, "payload id: %d greater than maximum id: %d", payload, last_sensor);
+        return -1;
+    }
+    if(from < 0 || count <= 0)
+        return 0;
+
+    int size = data_map[payload].size;
+    int payloads_per_section = SCH_SIZE_PER_SECTION/size;
+    int read = 0;
+
+    while(read < count)
+    {
+        int index = from + read;
+        int section_index = storage_section(payload, index);
+        int index_in_section = index%payloads_per_section;
+        if (section_index < 0)
+            break;
+
+        int n = payloads_per_section - index_in_section;
+        if(n > count - read)
+            n = count - read;
+
+        // Read the consecutive samples of this section at once
+        uint32_t add = storage_addresses_payloads[section_index] + index_in_section*size;
+        uint8_t *buff = (uint8_t *)data + read*size;
+        LOGI(tag, "Reading in address: %u, %d samples\n", (unsigned int)add, n);
+        if(spn_fl512s_read_data(0, add, buff, n*size) != 0)
+            return read > 0 ? read : -1;
+
+        // Samples with erased words are read again as in read_data_with_check
+        int i, j;
+        for(i=0; i < n; i++)
+        {
+            uint8_t *sample = buff + i*size;
+            for(j=0; j < size/4; ++j) {
+                if(((uint32_t *)sample)[j] == 0xffffffff)
+                    break;
+            }
+            if(j < size/4 && read_data_with_check(add + i*size, sample, size) < 0)
+                return read + i;
+        }
+        read += n;
+    }
+    return read;
+}
+
 int storage_delete_memory_sections()
 {
     // Deleting Payload Memory Sections
     //spn_fl512s_erase_chip(0);
-    for(int i = 0;  i < SCH_SECTIONS_PER_PAYLOAD*last_sensor; ++i)
+    for(int i = 0;  i < storage_payload_sections_total; ++i)
     {
         LOGI(tag, "deleting section in address %u\n", (unsigned int)storage_addresses_payloads[i]);
         int rc = spn_fl512s_erase_block(0, storage_addresses_payloads[i]);
@@ -76,6 +76,19 @@ int storage_table_flight_plan_init(int drop, int * entries);
  */
 int storage_repo_get_value_idx(int index, char *table);
 
+/**
+ * Get the first n INT (integer) values of the repository with one FRAM read.
+ * Each value is stored in values[index].
+ *
+ * @note: non-reentrant function, use mutex to sync access
+ *
+ * @param values Int array. Values by index
+ * @param n Int. Size of the values array
+ * @param table Str. Table name
+ * @return 0 OK, -1 Error
+ */
+int storage_repo_get_values(int *values, int n, char *table);
+
 /**
  * Get a INT (integer) value from table by name
  *
@@ -103,6 +116,20 @@ int storage_repo_get_value_str(char *name, char *table);
  */
 int storage_repo_set_value_idx(int index, int value, char *table);
 
+/**
+ * Set the values of several INT (integer) variables by index. The FM33256B
+ * FRAM has no transactions, the values are written one by one.
+ *
+ * @note: non-reentrant function, use mutex to sync access
+ *
+ * @param index Int array. Variables indexes
+ * @param value Int array. Values to set
+ * @param n Int. Number of variables
+ * @param table Str. Table name
+ * @return 0 OK, -1 Error
+ */
+int storage_repo_set_values_idx(int *index, int *value, int n, char *table);
+
 /**
  * Set or update the value of a INT (integer) variable by name.
  *
@@ -208,6 +235,31 @@ int storage_set_payload_data(int index, void * data, int payload);
  */
 int storage_get_payload_data(int index, void* data, int payload);
 
+/**
+ * Get consecutive samples for specific payload in NOR FLASH, with one read
+ * per memory section
+ *
+ * @note: non-reentrant function, use mutex to sync access
+ *
+ * @param from Int. index of the first sample
+ * @param count Int. max number of samples to read
+ * @param data Pointer to an array of at least count structs
+ * @param payload Int. payload to get values
+ * @return Number of consecutive samples read, -1 Error
+ */
+int storage_get_payload_range(int from, int count, void* data, int payload);
+
+/**
+ * Get the index of the oldest sample of a payload still stored, when @next is
+ * the index of the next sample to write. With SCH_STORAGE_RING the block of
+ * the oldest section is erased when a sample of a new round is written to it.
+ *
+ * @param payload Int. payload id
+ * @param next Int. index of the next sample (the payload sys_index)
+ * @return Index of the oldest sample kept, 0 if no sample was reclaimed
+ */
+int storage_get_payload_first(int payload, int next);
+
 /**
  * Get recent values from for specific payload
  * in NOR FLASH
@@ -229,6 +281,14 @@ int storage_get_payload_data(int index, void* data, int payload);
  */
 int storage_delete_memory_sections(void);
 
+/**
+ * Commit the payload samples pending to be written. Samples are written to
+ * flash one by one, so there is nothing to do.
+ *
+ * @return 0 OK
+ */
+int storage_commit(void);
+
 /**
  * Close the opened database.
  *
@@ -30,4 +30,17 @@ int osQueueSend(osQueue queue, void * value, uint32_t timeout) {
 
 int osQueueReceive(osQueue queue, void * buf, uint32_t timeout){
     return xQueueReceive(queue, buf, timeout);
-}
\ No newline at end of file
+}
+
+int osQueueReceiveMany(osQueue queue, void * buf, size_t item_size, int max_items, uint32_t timeout){
+    int n = 0;
+    if(max_items > 0 && xQueueReceive(queue, buf, timeout) == pdPASS)
+    {
+        for(n = 1; n < max_items; n++)
+        {
+            if(xQueueReceive(queue, (char *)buf + n*item_size, 0) != pdPASS)
+                break;
+        }
+    }
+    return n;
+}
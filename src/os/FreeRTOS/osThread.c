@@ -39,3 +39,13 @@ void osTaskDelete(void *task_handle)
 {
     vTaskDelete(task_handle);
 }
+
+os_task_id osTaskGetCurrent(void)
+{
+    return (os_task_id)xTaskGetCurrentTaskHandle();
+}
+
+int osTaskIsCurrent(os_task_id task)
+{
+    return task == (os_task_id)xTaskGetCurrentTaskHandle();
+}
@@ -20,6 +20,32 @@
 
 #include "osQueue.h"
 
+/*
+ * SCH_OS_QUEUE_RING selects the queue implementation at build time. Both
+ * return the same values (1 on success, 0 on timeout) as FreeRTOS queues.
+ */
+#if SCH_OS_QUEUE_RING
+
+osQueue osQueueCreate(int length, size_t item_size)
+{
+	return os_ring_queue_create(length, item_size);
+}
+
+int osQueueSend(osQueue queue, void * value, uint32_t timeout)
+{
+	return os_ring_queue_send(queue, value, timeout);
+}
+
+int osQueueReceive(osQueue queue, void * buf, uint32_t timeout){
+    return os_ring_queue_receive(queue, buf, timeout);
+}
+
+int osQueueReceiveMany(osQueue queue, void * buf, size_t item_size, int max_items, uint32_t timeout){
+    return os_ring_queue_receive_many(queue, buf, max_items, timeout);
+}
+
+#else
+
 osQueue osQueueCreate(int length, size_t item_size)
 {
 	return os_pthread_queue_create(length, item_size);
@@ -34,3 +60,8 @@ int osQueueReceive(osQueue queue, void * buf, uint32_t timeout){
     return os_pthread_queue_receive(queue, buf, timeout);
 }
 
+int osQueueReceiveMany(osQueue queue, void * buf, size_t item_size, int max_items, uint32_t timeout){
+    return os_pthread_queue_receive_many(queue, buf, max_items, timeout);
+}
+
+#endif
@@ -56,3 +56,12 @@ void osTaskDelete(void *task_handle)
     if (s != 0) printf("[WARN] Failed to cancel thread %lu\n", thread);
 }
 
+os_task_id osTaskGetCurrent(void)
+{
+    return pthread_self();
+}
+
+int osTaskIsCurrent(os_task_id task)
+{
+    return pthread_equal(task, pthread_self()) != 0;
+}
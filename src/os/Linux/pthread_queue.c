@@ -141,3 +141,31 @@ int os_pthread_queue_receive(os_pthread_queue_t *queue, void *buf,
 	
 }
 
+int os_pthread_queue_receive_many(os_pthread_queue_t *queue, void *buf,
+                                  int max_items, uint32_t timeout) {
+
+	int n;
+
+	if (max_items <= 0)
+		return 0;
+
+	/* Wait for the first item */
+	if (os_pthread_queue_receive(queue, buf, timeout) != PTHREAD_QUEUE_OK)
+		return 0;
+
+	/* Copy the remaining items with one lock */
+	pthread_mutex_lock(&(queue->mutex));
+	for (n = 1; n < max_items && queue->items > 0; n++) {
+		memcpy((char *)buf + n * queue->item_size, queue->buffer+(queue->out * queue->item_size), queue->item_size);
+		queue->items--;
+		queue->out = (queue->out + 1) % queue->size;
+	}
+	pthread_mutex_unlock(&(queue->mutex));
+
+	/* Nofify blocked threads */
+	if (n > 1)
+		pthread_cond_broadcast(&(queue->cond_full));
+
+	return n;
+
+}
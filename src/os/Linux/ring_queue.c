@@ -0,0 +1,321 @@
+/*                                 SUCHAI
+ *                      NANOSATELLITE FLIGHT SOFTWARE
+ *
+ *      Copyright 2020, Carlos Gonzalez Cortes, carlgonz@uchile.cl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "ring_queue.h"
+
+/*
+ * Cell layout: [uint64_t seq][item]. A cell at index i is free for the writer
+ * of position p (p % size == i) when seq == p, and holds an item for the
+ * reader of position p when seq == p + 1. Positions are 64 bits so they never
+ * wrap and the ring length does not need to be a power of two.
+ */
+#define RING_CELL_SEQ(q, pos) ((uint64_t *)((q)->cells + ((pos) % (uint64_t)(q)->size) * (q)->cell_size))
+#define RING_CELL_DATA(seq) ((uint8_t *)(seq) + sizeof(uint64_t))
+
+static int ring_futex_wait(uint32_t *addr, uint32_t val, const struct timespec *deadline);
+static void ring_futex_wake(uint32_t *addr);
+static void ring_notify_put(os_ring_queue_t *q, uint64_t pos);
+static void ring_notify_get(os_ring_queue_t *q, uint64_t first, uint64_t last);
+static int ring_deadline(uint32_t timeout, struct timespec *deadline);
+
+os_ring_queue_t * os_ring_queue_create(int length, size_t item_size)
+{
+	if(length <= 0 || item_size == 0)
+		return NULL;
+
+	os_ring_queue_t *q = NULL;
+	if(posix_memalign((void **)&q, RING_QUEUE_CACHE_LINE, sizeof(os_ring_queue_t)) != 0)
+		return NULL;
+
+	/* With only one cell a full cell and a free one have the same sequence
+	 * number, so the smallest queue holds two items */
+	if(length < 2)
+		length = 2;
+
+	memset(q, 0, sizeof(os_ring_queue_t));
+	q->size = length;
+	q->item_size = (int)item_size;
+	q->cell_size = (sizeof(uint64_t) + item_size + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+	q->cells = malloc(q->cell_size * length);
+	if(q->cells == NULL)
+	{
+		free(q);
+		return NULL;
+	}
+
+	uint64_t i;
+	for(i = 0; i < (uint64_t)length; i++)
+		*RING_CELL_SEQ(q, i) = i;
+
+	return q;
+}
+
+/**
+ * Claim the next write position and copy the item, without blocking
+ * @param pos_out Position used by the item
+ * @return 1 if the item was queued, 0 if the queue is full
+ */
+static int ring_push(os_ring_queue_t *q, const void *value, uint64_t *pos_out)
+{
+	uint64_t *seq;
+	uint64_t pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+	while(1)
+	{
+		seq = RING_CELL_SEQ(q, pos);
+		int64_t dif = (int64_t)(__atomic_load_n(seq, __ATOMIC_ACQUIRE) - pos);
+		if(dif == 0)
+		{
+			// On failure pos is updated with the current tail
+			if(__atomic_compare_exchange_n(&q->tail, &pos, pos + 1, 1, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+				break;
+		}
+		else if(dif < 0)
+			return 0;
+		else
+			pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+	}
+
+	memcpy(RING_CELL_DATA(seq), value, q->item_size);
+	__atomic_store_n(seq, pos + 1, __ATOMIC_RELEASE);
+	*pos_out = pos;
+	return 1;
+}
+
+/**
+ * Claim the next read position and copy the item, without blocking
+ * @param pos_out Position of the item
+ * @return 1 if an item was read, 0 if the queue is empty
+ */
+static int ring_pop(os_ring_queue_t *q, void *buf, uint64_t *pos_out)
+{
+	uint64_t *seq;
+	uint64_t pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+	while(1)
+	{
+		seq = RING_CELL_SEQ(q, pos);
+		int64_t dif = (int64_t)(__atomic_load_n(seq, __ATOMIC_ACQUIRE) - (pos + 1));
+		if(dif == 0)
+		{
+			if(__atomic_compare_exchange_n(&q->head, &pos, pos + 1, 1, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+				break;
+		}
+		else if(dif < 0)
+			return 0;
+		else
+			pos = __atomic_load_n(&q->head, __ATOMIC_RELAXED);
+	}
+
+	memcpy(buf, RING_CELL_DATA(seq), q->item_size);
+	__atomic_store_n(seq, pos + q->size, __ATOMIC_RELEASE);
+	*pos_out = pos;
+	return 1;
+}
+
+int os_ring_queue_send(os_ring_queue_t *queue, void *value, uint32_t timeout)
+{
+	struct timespec ts;
+	int has_deadline = 0;
+	uint64_t pos;
+
+	while(!ring_push(queue, value, &pos))
+	{
+		if(timeout == 0)
+			return RING_QUEUE_FULL;
+		if(!has_deadline)
+		{
+			if(ring_deadline(timeout, &ts) != 0)
+				return RING_QUEUE_ERROR;
+			has_deadline = 1;
+		}
+
+		/* Register as waiter, then check again before going to sleep. A
+		 * receiver that frees a cell after this point either is seen by the
+		 * second push or changes get_seq so the futex does not block */
+		uint32_t seq = __atomic_load_n(&queue->get_seq, __ATOMIC_SEQ_CST);
+		__atomic_fetch_add(&queue->send_waiters, 1, __ATOMIC_SEQ_CST);
+		if(ring_push(queue, value, &pos))
+		{
+			__atomic_fetch_sub(&queue->send_waiters, 1, __ATOMIC_SEQ_CST);
+			break;
+		}
+		int rc = ring_futex_wait(&queue->get_seq, seq, timeout == RING_QUEUE_FOREVER ? NULL : &ts);
+		__atomic_fetch_sub(&queue->send_waiters, 1, __ATOMIC_SEQ_CST);
+		if(rc == ETIMEDOUT)
+		{
+			if(!ring_push(queue, value, &pos))
+				return RING_QUEUE_FULL;
+			break;
+		}
+	}
+
+	ring_notify_put(queue, pos);
+	return RING_QUEUE_OK;
+}
+
+/**
+ * Block until one item is read or the timeout expires
+ * @param pos Position of the item read
+ * @return 1 if an item was read, 0 on timeout, -1 on error
+ */
+static int ring_pop_wait(os_ring_queue_t *queue, void *buf, uint32_t timeout, uint64_t *pos)
+{
+	struct timespec ts;
+	int has_deadline = 0;
+
+	while(!ring_pop(queue, buf, pos))
+	{
+		if(timeout == 0)
+			return 0;
+		if(!has_deadline)
+		{
+			if(ring_deadline(timeout, &ts) != 0)
+				return -1;
+			has_deadline = 1;
+		}
+
+		/* Same protocol as in os_ring_queue_send, on the put_seq futex */
+		uint32_t seq = __atomic_load_n(&queue->put_seq, __ATOMIC_SEQ_CST);
+		__atomic_fetch_add(&queue->recv_waiters, 1, __ATOMIC_SEQ_CST);
+		if(ring_pop(queue, buf, pos))
+		{
+			__atomic_fetch_sub(&queue->recv_waiters, 1, __ATOMIC_SEQ_CST);
+			break;
+		}
+		int rc = ring_futex_wait(&queue->put_seq, seq, timeout == RING_QUEUE_FOREVER ? NULL : &ts);
+		__atomic_fetch_sub(&queue->recv_waiters, 1, __ATOMIC_SEQ_CST);
+		if(rc == ETIMEDOUT)
+			return ring_pop(queue, buf, pos);
+	}
+
+	return 1;
+}
+
+int os_ring_queue_receive(os_ring_queue_t *queue, void *buf, uint32_t timeout)
+{
+	uint64_t pos;
+	int rc = ring_pop_wait(queue, buf, timeout, &pos);
+	if(rc < 0)
+		return RING_QUEUE_ERROR;
+	if(rc == 0)
+		return RING_QUEUE_EMPTY;
+
+	ring_notify_get(queue, pos, pos);
+	return RING_QUEUE_OK;
+}
+
+int os_ring_queue_receive_many(os_ring_queue_t *queue, void *buf, int max_items, uint32_t timeout)
+{
+	uint64_t first, pos;
+	if(max_items <= 0 || ring_pop_wait(queue, buf, timeout, &first) != 1)
+		return 0;
+
+	int n = 1;
+	while(n < max_items && ring_pop(queue, (uint8_t *)buf + n * queue->item_size, &pos))
+		n++;
+
+	// Notify once for the whole batch
+	ring_notify_get(queue, first, n > 1 ? pos : first);
+	return n;
+}
+
+/**
+ * Called after an item was queued at @pos. Receivers only sleep on an empty
+ * queue, so they are woken when this item is the first one to read (the
+ * queue was empty). Otherwise an earlier item is pending and the receiver is
+ * either awake or will be woken by the sender of that item. When another
+ * sender is also waiting and there is room left, pass the wake up on.
+ */
+static void ring_notify_put(os_ring_queue_t *q, uint64_t pos)
+{
+	__atomic_fetch_add(&q->put_seq, 1, __ATOMIC_SEQ_CST);
+	if(__atomic_load_n(&q->recv_waiters, __ATOMIC_SEQ_CST) > 0 &&
+	   __atomic_load_n(&q->head, __ATOMIC_SEQ_CST) == pos)
+		ring_futex_wake(&q->put_seq);
+
+	if(__atomic_load_n(&q->send_waiters, __ATOMIC_SEQ_CST) > 0 &&
+	   __atomic_load_n(RING_CELL_SEQ(q, pos + 1), __ATOMIC_ACQUIRE) == pos + 1)
+		ring_futex_wake(&q->get_seq);
+}
+
+/**
+ * Called after the items from @first to @last were read. Senders only sleep
+ * on a full queue, so they are woken when the queue was full, that is, the
+ * next position to write is one of the cells just freed. When another
+ * receiver is also waiting and items are left, pass the wake up on.
+ */
+static void ring_notify_get(os_ring_queue_t *q, uint64_t first, uint64_t last)
+{
+	__atomic_fetch_add(&q->get_seq, 1, __ATOMIC_SEQ_CST);
+	if(__atomic_load_n(&q->send_waiters, __ATOMIC_SEQ_CST) > 0)
+	{
+		uint64_t tail = __atomic_load_n(&q->tail, __ATOMIC_SEQ_CST);
+		if(tail >= first + q->size && tail <= last + q->size)
+			ring_futex_wake(&q->get_seq);
+	}
+
+	uint64_t head = __atomic_load_n(&q->head, __ATOMIC_SEQ_CST);
+	if(__atomic_load_n(&q->recv_waiters, __ATOMIC_SEQ_CST) > 0 &&
+	   __atomic_load_n(RING_CELL_SEQ(q, head), __ATOMIC_ACQUIRE) == head + 1)
+		ring_futex_wake(&q->put_seq);
+}
+
+/**
+ * Sleep while *addr == val or until the absolute CLOCK_MONOTONIC deadline
+ * @return 0 if woken (or *addr != val), ETIMEDOUT if the deadline expired
+ */
+static int ring_futex_wait(uint32_t *addr, uint32_t val, const struct timespec *deadline)
+{
+	long rc = syscall(SYS_futex, addr, FUTEX_WAIT_BITSET_PRIVATE, val, deadline, NULL, FUTEX_BITSET_MATCH_ANY);
+	if(rc == -1 && errno == ETIMEDOUT)
+		return ETIMEDOUT;
+	return 0;
+}
+
+/**
+ * Wake one thread sleeping on the @addr futex
+ */
+static void ring_futex_wake(uint32_t *addr)
+{
+	syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+/**
+ * Absolute CLOCK_MONOTONIC deadline @timeout ms from now
+ * @return 0 if OK, -1 on error
+ */
+static int ring_deadline(uint32_t timeout, struct timespec *deadline)
+{
+	if(clock_gettime(CLOCK_MONOTONIC, deadline))
+		return -1;
+
+	deadline->tv_sec += timeout / 1000;
+	deadline->tv_nsec += (long)(timeout % 1000) * 1000000;
+	if(deadline->tv_nsec >= 1000000000)
+	{
+		deadline->tv_sec++;
+		deadline->tv_nsec -= 1000000000;
+	}
+	return 0;
+}
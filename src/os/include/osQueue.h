@@ -14,6 +14,7 @@
 
 #ifdef LINUX
 	#include "pthread_queue.h"
+	#include "ring_queue.h"
 #else
     #include "FreeRTOS.h"
     #include "queue.h"
@@ -24,6 +25,17 @@ typedef void* osQueue;
 osQueue osQueueCreate(int length, size_t item_size);
 int osQueueSend(osQueue queues, void *value, uint32_t timeout);
 int osQueueReceive(osQueue queue, void *buf, uint32_t timeout);
+/**
+ * Wait up to @timeout for one item, then read all the queued items up to
+ * @max_items without blocking again.
+ * @param queue Queue
+ * @param buf Array of @max_items items of @item_size bytes
+ * @param item_size Size of each item, as given to osQueueCreate
+ * @param max_items Max number of items to read
+ * @param timeout Max time to wait for the first item
+ * @return Number of items read, 0 if timeout
+ */
+int osQueueReceiveMany(osQueue queue, void *buf, size_t item_size, int max_items, uint32_t timeout);
 //void os_queue_remove(csp_queue_handle_t queue);
 //int os_queue_enqueue(csp_queue_handle_t handle, void *value, uint32_t timeout);
 //int os_queue_enqueue_isr(csp_queue_handle_t handle, void * value, CSP_BASE_TYPE * task_woken);
@@ -19,11 +19,13 @@
     #include <features.h>
     #include <stdio.h>
     typedef pthread_t os_thread;
+    typedef pthread_t os_task_id;
 #else
     #include "FreeRTOSConfig.h"
     #include "FreeRTOS.h"
     #include "task.h"
     typedef portBASE_TYPE os_thread;
+    typedef void * os_task_id;      // Task handle
 #endif
 
 /**
@@ -52,4 +54,18 @@ int osCreateTask(void (*functionTask)(void *), char* name, unsigned short size,
  */
 void osTaskDelete(void *task_handle);
 
+/**
+ * Get the id of the calling task, to find it later with osTaskIsCurrent.
+ * In FreeRTOS requires INCLUDE_xTaskGetCurrentTaskHandle.
+ * @return Calling task id
+ */
+os_task_id osTaskGetCurrent(void);
+
+/**
+ * Check if @task is the calling task
+ * @param task Task id returned by osTaskGetCurrent
+ * @return 1 if @task is the calling task, 0 otherwise
+ */
+int osTaskIsCurrent(os_task_id task);
+
 #endif // _OS_THREAD_H_
@@ -0,0 +1,87 @@
+/**
+ * @file  ring_queue.h
+ * @author Carlos Gonzalez Cortes
+ * @date 2020
+ * @copyright GNU Public License.
+ *
+ * Bounded lock-free queue for Linux, an alternative to pthread_queue.
+ *
+ * Items are copied into a fixed ring of cells. Each cell carries a sequence
+ * number so producers (and consumers) claim a position with a single
+ * compare-and-swap and publish it with a release store, no lock is taken.
+ * The queue is built for many producers and one consumer, but consumers also
+ * claim positions with a CAS so a pool of readers (the executer free class)
+ * is still safe.
+ *
+ * Blocked threads sleep on a futex. A sender only issues the wake up syscall
+ * when a receiver is registered as waiting, that is, when the queue was seen
+ * empty. The same applies to senders blocked on a full queue.
+ */
+
+#ifndef _RING_QUEUE_H_
+#define _RING_QUEUE_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#define RING_QUEUE_CACHE_LINE 64
+
+typedef struct os_ring_queue_s {
+	uint64_t head __attribute__((aligned(RING_QUEUE_CACHE_LINE)));  ///< Next position to read
+	uint64_t tail __attribute__((aligned(RING_QUEUE_CACHE_LINE)));  ///< Next position to write
+	uint32_t put_seq __attribute__((aligned(RING_QUEUE_CACHE_LINE))); ///< Futex, bumped by each send
+	uint32_t recv_waiters;                                           ///< Receivers sleeping on put_seq
+	uint32_t get_seq __attribute__((aligned(RING_QUEUE_CACHE_LINE))); ///< Futex, bumped by each receive
+	uint32_t send_waiters;                                           ///< Senders sleeping on get_seq
+	int size;               ///< Max number of items
+	int item_size;          ///< Size of each item in bytes
+	size_t cell_size;       ///< Item size plus the cell sequence number, aligned
+	uint8_t *cells;
+} os_ring_queue_t;
+
+#define RING_QUEUE_ERROR 0
+#define RING_QUEUE_EMPTY 0
+#define RING_QUEUE_FULL 0
+#define RING_QUEUE_OK 1
+
+#define RING_QUEUE_FOREVER 0xffffffff   ///< Same value as portMAX_DELAY
+
+/**
+ * Create a queue
+ * @param length Max number of items, at least 2
+ * @param item_size Size of each item in bytes
+ * @return Queue or NULL if memory could not be allocated
+ */
+os_ring_queue_t * os_ring_queue_create(int length, size_t item_size);
+
+/**
+ * Copy one item to the back of the queue
+ * @param queue Queue
+ * @param value Pointer to the item to copy
+ * @param timeout Max time to wait in ms if the queue is full
+ * @return RING_QUEUE_OK or RING_QUEUE_FULL on timeout
+ */
+int os_ring_queue_send(os_ring_queue_t *queue, void *value, uint32_t timeout);
+
+/**
+ * Copy one item from the front of the queue
+ * @param queue Queue
+ * @param buf Pointer to store the item
+ * @param timeout Max time to wait in ms if the queue is empty
+ * @return RING_QUEUE_OK or RING_QUEUE_EMPTY on timeout
+ */
+int os_ring_queue_receive(os_ring_queue_t *queue, void *buf, uint32_t timeout);
+
+/**
+ * Wait for at least one item, then copy all the available items up to
+ * @max_items without blocking again.
+ * @param queue Queue
+ * @param buf Array of at least @max_items items
+ * @param max_items Max number of items to read
+ * @param timeout Max time to wait in ms for the first item
+ * @return Number of items read, 0 on timeout
+ */
+int os_ring_queue_receive_many(os_ring_queue_t *queue, void *buf, int max_items, uint32_t timeout);
+
+#endif
@@ -34,3 +34,6 @@ int osQueueReceive(osQueue queue, void * buf, uint32_t timeout){
     return os_pthread_queue_receive(queue, buf, timeout);
 }
 
+int osQueueReceiveMany(osQueue queue, void * buf, size_t item_size, int max_items, uint32_t timeout){
+    return os_pthread_queue_receive_many(queue, buf, max_items, timeout);
+}
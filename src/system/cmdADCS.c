@@ -28,18 +28,28 @@ static const char* tag = "cmdADCS";
 
 #define ADCS_PORT 7
 
+static int adcs_set_target_vectors(vector3_t *i_tar, vector3_t *omega_tar);
+
 void cmd_adcs_init(void)
 {
 //    cmd_add("adcs_point", adcs_point, "", 0);
-    cmd_add("adcs_quat", adcs_get_quaternion, "", 0);
-    cmd_add("adcs_omega", adcs_get_omega, "", 0);
-    cmd_add("adcs_mag", adcs_get_mag, "", 0);
-    cmd_add("adcs_do_control", adcs_control_torque, "%lf", 1);
-    cmd_add("adcs_mag_moment", adcs_mag_moment, "", 0);
-    cmd_add("adcs_set_target", adcs_set_target, "%lf %lf %lf %lf %lf %lf", 6);
-    cmd_add("adcs_set_to_nadir", adcs_target_nadir, "", 0);
-    cmd_add("adcs_detumbling_mag", adcs_detumbling_mag, "", 0);
-    cmd_add("adcs_send_attitude", adcs_send_attitude, "", 0);
+    cmd_add_class("adcs_quat", adcs_get_quaternion, "", 0, CMD_CLASS_ADCS);
+    cmd_add_class("adcs_omega", adcs_get_omega, "", 0, CMD_CLASS_ADCS);
+    cmd_add_class("adcs_mag", adcs_get_mag, "", 0, CMD_CLASS_ADCS);
+    cmd_add_typed("adcs_do_control", adcs_control_torque, "%lf", CMD_CLASS_ADCS);
+    cmd_add_class("adcs_mag_moment", adcs_mag_moment, "", 0, CMD_CLASS_ADCS);
+    cmd_add_typed("adcs_set_target", adcs_set_target, "%lf %lf %lf %lf %lf %lf", CMD_CLASS_ADCS);
+    cmd_add_class("adcs_set_to_nadir", adcs_target_nadir, "", 0, CMD_CLASS_ADCS);
+    cmd_add_class("adcs_detumbling_mag", adcs_detumbling_mag, "", 0, CMD_CLASS_ADCS);
+    cmd_add_class("adcs_send_attitude", adcs_send_attitude, "", 0, CMD_CLASS_ADCS);
+
+    // The control loop is time sensitive
+    cmd_set_prio("adcs_do_control", CMD_PRIO_HIGH);
+    cmd_set_prio("adcs_mag_moment", CMD_PRIO_HIGH);
+    // Actuation is shed by the admission rules under low battery
+    cmd_set_cost("adcs_do_control", CMD_COST_ADCS);
+    cmd_set_cost("adcs_mag_moment", CMD_COST_ADCS);
+    cmd_set_cost("adcs_detumbling_mag", CMD_COST_ADCS);
 }
 
 int adcs_point(char* fmt, char* params, int nparams)
@@ -50,7 +60,7 @@ int adcs_point(char* fmt, char* params, int nparams)
     memset(packet->data, 0, COM_FRAME_MAX_LEN);
 
     vector3_t r;
-    _get_sat_vector(&r, dat_ads_pos_x);
+    dat_get_group(dat_grp_ads_position, r.v);
 
     int len = snprintf(packet->data, COM_FRAME_MAX_LEN,
                        "adcs_point_to %lf %lf %lf", r.v0, r.v1, r.v2);
@@ -87,9 +97,9 @@ int adcs_get_quaternion(char* fmt, char* params, int nparams)
         rc = sscanf(in_buff, "%lf %lf %lf %lf", &q.q0, &q.q1, &q.q2, &q.q3);
         if(rc == 4)
         {
-            _set_sat_quaterion(&q, dat_ads_q0);
+            dat_set_group(dat_grp_ads_attitude, q.q);
             quaternion_t tmp;
-            _get_sat_quaterion(&tmp, dat_ads_q0);
+            dat_get_group(dat_grp_ads_attitude, tmp.q);
             LOGI(tag, "SAT_QUAT: %.04f, %.04f, %.04f, %.04f", tmp.q0, tmp.q1, tmp.q2, tmp.q3);
             free(out_buff);
             free(in_buff);
@@ -117,7 +127,7 @@ int adcs_get_omega(char* fmt, char* params, int nparams)
         omega.v0 = gyro_reading.gyro_x;
         omega.v1 = gyro_reading.gyro_y;
         omega.v2 = gyro_reading.gyro_z;
-        _set_sat_vector(&omega, dat_ads_omega_x);
+        dat_set_group(dat_grp_ads_omega, omega.v);
         return CMD_OK;
     }
     return CMD_ERROR;
@@ -138,7 +148,7 @@ int adcs_get_mag(char* fmt, char* params, int nparams)
         mag.v0 = hmc_reading.x;
         mag.v1 = hmc_reading.y;
         mag.v2 = hmc_reading.z;
-        _set_sat_vector(&mag, dat_ads_mag_x);
+        dat_set_group(dat_grp_ads_mag, mag.v);
         return CMD_OK;
     }
     return CMD_ERROR;
@@ -146,10 +156,10 @@ int adcs_get_mag(char* fmt, char* params, int nparams)
     return CMD_OK;
 }
 
-int adcs_control_torque(char* fmt, char* params, int nparams)
+int adcs_control_torque(cmd_args_t *args)
 {
     // GLOBALS
-    double ctrl_cycle;
+    double ctrl_cycle = args->arg[0].d;
     matrix3_t I_quat;
     mat_set_diag(&I_quat, 0.00, 0.00, 0.00);
     matrix3_t P_quat;
@@ -157,18 +167,15 @@ int adcs_control_torque(char* fmt, char* params, int nparams)
     matrix3_t P_omega;
     mat_set_diag(&P_omega, 0.003, 0.003, 0.003);
 
-    if(params == NULL || sscanf(params, fmt, &ctrl_cycle) != nparams)
-        return CMD_SYNTAX_ERROR;
-
     // PARAMETERS
     quaternion_t q_i2b_est; // Current quaternion. Read as from ADCS
     quaternion_t q_i2b_tar; // Target quaternion. Read as parameter
-    _get_sat_quaterion(&q_i2b_est, dat_ads_q0);
-    _get_sat_quaterion(&q_i2b_tar, dat_tgt_q0);
+    dat_get_group(dat_grp_ads_attitude, q_i2b_est.q);
+    dat_get_group(dat_grp_tgt_attitude, q_i2b_tar.q);
     vector3_t omega_b_est;  // Current GYRO. Read from ADCS
-    _get_sat_vector(&omega_b_est, dat_ads_omega_x);
+    dat_get_group(dat_grp_ads_omega, omega_b_est.v);
     vector3_t omega_b_tar;
-    _get_sat_vector(&omega_b_tar, dat_tgt_omega_x);
+    dat_get_group(dat_grp_tgt_omega, omega_b_tar.v);
 
 //    libra::Quaternion q_b2i_est = q_i2b_est_.conjugate(); //body frame to inertial frame
 //    libra::Quaternion q_i2b_now2tar = q_b2i_est * q_i2b_tar_;//q_i2b_tar_ = qi2b_est * qi2b_now2tar：クオータニオンによる2回転は積であらわされる。
@@ -257,11 +264,11 @@ int adcs_mag_moment(char* fmt, char* params, int nparams)
 
     // PARAMETERS
     vector3_t mag_earth_b_est;
-    _get_sat_vector(&mag_earth_b_est, dat_ads_mag_x);
+    dat_get_group(dat_grp_ads_mag, mag_earth_b_est.v);
     vector3_t omega_b_est;  // Current GYRO. Read from ADCS
-    _get_sat_vector(&omega_b_est, dat_ads_omega_x);
+    dat_get_group(dat_grp_ads_omega, omega_b_est.v);
     vector3_t omega_b_tar;
-    _get_sat_vector(&omega_b_tar, dat_tgt_omega_x);
+    dat_get_group(dat_grp_tgt_omega, omega_b_tar.v);
 
     select_mag_dir_torque.v[0] = fabs(omega_b_est.v[0]) < rw_lower_limit.v[0];
     select_mag_dir_torque.v[1] = fabs(omega_b_est.v[1]) < rw_lower_limit.v[1];
@@ -361,30 +368,42 @@ int adcs_mag_moment(char* fmt, char* params, int nparams)
     return CMD_OK;
 }
 
-int adcs_set_target(char* fmt, char* params, int nparams)
+int adcs_set_target(cmd_args_t *args)
 {
-    double rot;
     vector3_t i_tar;  // Target vector, intertial frame, read as parameter
+    vector3_t omega_tar;  // Target velocity vector, body frame, read as parameter
+    i_tar.v0 = args->arg[0].d; i_tar.v1 = args->arg[1].d; i_tar.v2 = args->arg[2].d;
+    omega_tar.v0 = args->arg[3].d; omega_tar.v1 = args->arg[4].d; omega_tar.v2 = args->arg[5].d;
+
+    return adcs_set_target_vectors(&i_tar, &omega_tar);
+}
+
+/**
+ * Set ADCS vector (Intertial frame) and velocity (body frame) targets. Used by
+ * adcs_set_target and other commands that calculate the targets.
+ * @param i_tar Target vector, inertial frame
+ * @param omega_tar Target velocity vector, body frame
+ * @return CMD_OK
+ */
+static int adcs_set_target_vectors(vector3_t *i_tar, vector3_t *omega_tar)
+{
+    double rot;
     vector3_t b_tar;
     vector3_t b_dir;  // Face to point to, body frame
     vector3_t b_lambda;
-    vector3_t omega_tar;  // Target velocity vector, body frame, read as parameter
     quaternion_t q_i2b_est;
     quaternion_t q_b2b_now2tar;
     quaternion_t q_i2b_tar; // Target quaternion, inertial to body frame. Calculate
 
-    if(params == NULL || sscanf(params, fmt, &i_tar.v0, &i_tar.v1, &i_tar.v2, &omega_tar.v0, &omega_tar.v1, &omega_tar.v2) != nparams)
-        return CMD_ERROR;
-//    int p = sscanf(params, fmt, &i_tar.v0, &i_tar.v1, &i_tar.v2, &omega_tar.v0, &omega_tar.v1, &omega_tar.v2);
-    LOGW(tag, fmt, i_tar.v0, i_tar.v1, i_tar.v2, omega_tar.v0, omega_tar.v1, omega_tar.v2);
+    LOGW(tag, "%lf %lf %lf %lf %lf %lf", i_tar->v0, i_tar->v1, i_tar->v2, omega_tar->v0, omega_tar->v1, omega_tar->v2);
     // Set Z+ [0, 0, 1] as the face to point to
     b_dir.v0 = 0.0; b_dir.v1 = 0.0; b_dir.v2 = 1.0;
     vec_normalize(&b_dir, NULL);
 
     // Get target vector in body frame
-    _get_sat_quaterion(&q_i2b_est, dat_ads_q0);
-    vec_normalize(&i_tar, NULL);
-    quat_frame_conv(&q_i2b_est, &i_tar, &b_tar);
+    dat_get_group(dat_grp_ads_attitude, q_i2b_est.q);
+    vec_normalize(i_tar, NULL);
+    quat_frame_conv(&q_i2b_est, i_tar, &b_tar);
     vec_normalize(&b_tar, NULL);
 
     // Get I2B target quaternion
@@ -395,12 +414,12 @@ int adcs_set_target(char* fmt, char* params, int nparams)
     quat_normalize(&q_b2b_now2tar, NULL);
     quat_mult(&q_i2b_est, &q_b2b_now2tar, &q_i2b_tar); //Calculate quaternion after rotation
 
-    _set_sat_quaterion(&q_i2b_tar, dat_tgt_q0);
-    _set_sat_vector(&omega_tar, dat_tgt_omega_x);
+    dat_set_group(dat_grp_tgt_attitude, q_i2b_tar.q);
+    dat_set_group(dat_grp_tgt_omega, omega_tar->v);
 
     //TODO: Remove this print
     quaternion_t _q;
-    _get_sat_quaterion(&_q, dat_tgt_q0);
+    dat_get_group(dat_grp_tgt_attitude, _q.q);
     LOGI(tag, "TGT QUAT: %lf %lf %lf %lf", _q.q0, _q.q1, _q.q2, _q.q3);
 
     return CMD_OK;
@@ -410,7 +429,7 @@ int adcs_target_nadir(char* fmt, char* params, int nparams)
 {
     // Get Nadir vector
     vector3_t i_tar;
-    _get_sat_vector(&i_tar, dat_ads_pos_x);
+    dat_get_group(dat_grp_ads_position, i_tar.v);
     vec_cons_mult(-1.0, &i_tar, NULL);
     vec_normalize(&i_tar, NULL);
 
@@ -422,23 +441,16 @@ int adcs_target_nadir(char* fmt, char* params, int nparams)
     omega_i_tar.v[2] = -0.00014131086334682821;
     vector3_t omega_b_tar;
     quaternion_t q_i2b_est;
-    _get_sat_quaterion(&q_i2b_est, dat_ads_q0);
+    dat_get_group(dat_grp_ads_attitude, q_i2b_est.q);
     quat_frame_conv(&q_i2b_est, &omega_i_tar, &omega_b_tar);
 
-    char *_fmt = "%lf %lf %lf %lf %lf %lf";
-    char _params[SCH_CMD_MAX_STR_PARAMS];
-    memset(_params, 0, SCH_CMD_MAX_STR_PARAMS);
-    snprintf(_params, SCH_CMD_MAX_STR_PARAMS, _fmt, i_tar.v0, i_tar.v1, i_tar.v2,
-             omega_b_tar.v0, omega_b_tar.v1, omega_b_tar.v2);
-    int ret = adcs_set_target(_fmt, _params, 6);
-
-    return ret;
+    return adcs_set_target_vectors(&i_tar, &omega_b_tar);
 }
 
 int adcs_detumbling_mag(char* fmt, char* params, int nparams)
 {
     vector3_t i_tar;
-    _get_sat_vector(&i_tar, dat_ads_pos_x);
+    dat_get_group(dat_grp_ads_position, i_tar.v);
     vec_cons_mult(-1.0, &i_tar, NULL);
     vec_normalize(&i_tar, NULL);
 
@@ -447,21 +459,14 @@ int adcs_detumbling_mag(char* fmt, char* params, int nparams)
     omega_b_tar.v[0] = 0.0;
     omega_b_tar.v[0] = 0.0;
 
-    char *_fmt = "%lf %lf %lf %lf %lf %lf";
-    char _params[SCH_CMD_MAX_STR_PARAMS];
-    memset(_params, 0, SCH_CMD_MAX_STR_PARAMS);
-    snprintf(_params, SCH_CMD_MAX_STR_PARAMS, _fmt, i_tar.v0, i_tar.v1, i_tar.v2,
-             omega_b_tar.v0, omega_b_tar.v1, omega_b_tar.v2);
-    int ret = adcs_set_target(_fmt, _params, 6);
-
-    return ret;
+    return adcs_set_target_vectors(&i_tar, &omega_b_tar);
 }
 
 int adcs_send_attitude(char* fmt, char* params, int nparams)
 {
     quaternion_t q_est, q_tgt;
-    _get_sat_quaterion(&q_est, dat_ads_q0);
-    _get_sat_quaterion(&q_tgt, dat_tgt_q0);
+    dat_get_group(dat_grp_ads_attitude, q_est.q);
+    dat_get_group(dat_grp_tgt_attitude, q_tgt.q);
 
     csp_packet_t *packet = csp_buffer_get(COM_FRAME_MAX_LEN);
     if(packet == NULL)
@@ -29,22 +29,22 @@ static void _com_config_find(char *param_name, int table, param_table_t **param)
 
 void cmd_com_init(void)
 {
-    cmd_add("com_ping", com_ping, "%d", 1);
-    cmd_add("com_send_rpt", com_send_rpt, "%d %s", 2);
-    cmd_add("com_send_cmd", com_send_cmd, "%d %n", 2);
-    cmd_add("com_send_tc", com_send_tc_frame, "%d %n", 2);
-    cmd_add("com_send_data", com_send_data, "%p", 1);
+    cmd_add_class("com_ping", com_ping, "%d", 1, CMD_CLASS_COM);
+    cmd_add_class("com_send_rpt", com_send_rpt, "%d %s", 2, CMD_CLASS_COM);
+    cmd_add_class("com_send_cmd", com_send_cmd, "%d %n", 2, CMD_CLASS_COM);
+    cmd_add_class("com_send_tc", com_send_tc_frame, "%d %n", 2, CMD_CLASS_COM);
+    cmd_add_class("com_send_data", com_send_data, "%p", 1, CMD_CLASS_COM);
     cmd_add("com_debug", com_debug, "", 0);
     cmd_add("com_set_node", com_set_node, "%d", 1);
     cmd_add("com_get_node", com_get_node, "", 0);
-    cmd_add("com_set_time_node", com_set_time_node, "%d", 1);
-    cmd_add("com_set_tle_node", com_set_tle_node, "%d %s", 2);
+    cmd_add_class("com_set_time_node", com_set_time_node, "%d", 1, CMD_CLASS_COM);
+    cmd_add_class("com_set_tle_node", com_set_tle_node, "%d %s", 2, CMD_CLASS_COM);
 #ifdef SCH_USE_NANOCOM
-    cmd_add("com_reset_wdt", com_reset_wdt, "%d", 1);
-    cmd_add("com_get_config", com_get_config, "%d %s", 2);
-    cmd_add("com_set_config", com_set_config, "%d %s %s", 3);
-    cmd_add("com_update_status", com_update_status_vars, "", 0);
-    cmd_add("com_set_beacon", com_set_beacon, "%d %d", 2);
+    cmd_add_class("com_reset_wdt", com_reset_wdt, "%d", 1, CMD_CLASS_COM);
+    cmd_add_class("com_get_config", com_get_config, "%d %s", 2, CMD_CLASS_COM);
+    cmd_add_class("com_set_config", com_set_config, "%d %s %s", 3, CMD_CLASS_COM);
+    cmd_add_class("com_update_status", com_update_status_vars, "", 0, CMD_CLASS_COM);
+    cmd_add_class("com_set_beacon", com_set_beacon, "%d %d", 2, CMD_CLASS_COM);
 #endif
 }
 
@@ -238,6 +238,14 @@ int _com_send_data(int node, void *data, size_t len, int type, int n_data, int n
     // Send one or more frames
     while(len > 0)
     {
+        // Stop if the command exceeded its budget
+        if(cmd_cancel_requested())
+        {
+            LOGW(tag, "Cancelled, %d bytes not sent", (int)len);
+            rc_send = 0;
+            break;
+        }
+
         // Create packet and frame
         csp_packet_t *packet = csp_buffer_get(sizeof(com_frame_t));
         packet->length = sizeof(com_frame_t);
@@ -294,6 +302,52 @@ void _ntoh32_buff(uint32_t *buff, int len)
         buff[i] = csp_ntoh32(buff[i]);
 }
 
+/**
+ * Swap the byte order of each field of @n consecutive payload structs
+ * @param to_network 1 for host to network, 0 for network to host
+ */
+static void _swap_payload_buff(uint8_t *buff, int payload, int n, int to_network)
+{
+    int nfields, i, j;
+    const dat_payload_field_t *fields = dat_get_payload_fields(payload, &nfields);
+    if(fields == NULL)
+        return;
+
+    for(i=0; i<n; i++)
+    {
+        uint8_t *sample = buff + i*data_map[payload].size;
+        for(j=0; j<nfields; j++)
+        {
+            uint8_t *value = sample + fields[j].offset;
+            if(fields[j].size == 2) {
+                uint16_t v; memcpy(&v, value, 2);
+                v = to_network ? csp_hton16(v) : csp_ntoh16(v);
+                memcpy(value, &v, 2);
+            }
+            else if(fields[j].size == 4) {
+                uint32_t v; memcpy(&v, value, 4);
+                v = to_network ? csp_hton32(v) : csp_ntoh32(v);
+                memcpy(value, &v, 4);
+            }
+            else if(fields[j].size == 8) {
+                uint64_t v; memcpy(&v, value, 8);
+                v = to_network ? csp_hton64(v) : csp_ntoh64(v);
+                memcpy(value, &v, 8);
+            }
+        }
+    }
+}
+
+void _hton_payload_buff(uint8_t *buff, int payload, int n)
+{
+    _swap_payload_buff(buff, payload, n, 1);
+}
+
+void _ntoh_payload_buff(uint8_t *buff, int payload, int n)
+{
+    _swap_payload_buff(buff, payload, n, 0);
+}
+
 int com_debug(char *fmt, char *params, int nparams)
 {
     LOGD(tag, "Route table");
@@ -30,12 +30,13 @@ void cmd_drp_init(void)
 {
     cmd_add("drp_ebf", drp_execute_before_flight, "%d", 1);
     cmd_add("drp_print_vars", drp_print_system_vars, "", 0);
-    cmd_add("drp_set_var", drp_update_sys_var_idx, "%d %f", 2);
-    cmd_add("drp_set_var_name", drp_update_sys_var_name, "%s %f", 2);
+    cmd_add_typed("drp_set_var", drp_update_sys_var_idx, "%d %f", CMD_CLASS_FREE);
+    cmd_add_typed("drp_set_var_name", drp_update_sys_var_name, "%s %f", CMD_CLASS_FREE);
     cmd_add("drp_get_var_name", drp_get_sys_var_name, "%s", 1);
-    cmd_add("drp_add_hrs_alive", drp_update_hours_alive, "%d", 1);
+    cmd_add_typed("drp_add_hrs_alive", drp_update_hours_alive, "%d", CMD_CLASS_FREE);
     cmd_add("drp_clear_gnd_wdt", drp_clear_gnd_wdt, "", 0);
     cmd_add("drp_set_deployed", drp_set_deployed, "%d", 1);
+    cmd_add("drp_scrub", drp_scrub_status_vars, "", 0);
 }
 
 int drp_execute_before_flight(char *fmt, char *params, int nparams)
@@ -51,13 +52,18 @@ int drp_execute_before_flight(char *fmt, char *params, int nparams)
             int index;
             int rc = 0;
             // Reset all status variables values to default values
+            dat_status_address_t addresses[dat_status_last_address];
+            value32_t values[dat_status_last_address];
             for(index=0; index < dat_status_last_address; index++)
             {
-                rc += dat_set_status_var(index, dat_get_status_var_def(index).value);
+                addresses[index] = (dat_status_address_t)index;
+                values[index] = dat_get_status_var_def(index).value;
             }
+            rc += dat_set_status_many(addresses, values, dat_status_last_address);
 
             // Update relevant status variables
             rc += dat_set_system_var(dat_rtc_date_time, (int) time(NULL));
+            rc += dat_flush();
 
             // Delete memory sections
             rc += dat_delete_memory_sections();
@@ -91,25 +97,21 @@ int drp_print_system_vars(char *fmt, char *params, int nparams)
     LOGD(tag, "Displaying system variables list");
     printf("idx, %-20s, value, type\n", "name");
     int i;
+    value32_t snapshot[dat_status_last_address];
+    dat_get_status_snapshot(snapshot);
     for(i=0; i<dat_status_last_var; i++)
     {
         dat_sys_var_t var = dat_status_list[i];
-        value32_t value = dat_get_status_var(var.address);
-        var.value = value;
+        var.value = snapshot[var.address];
         dat_print_system_var(&var);
     }
     return CMD_OK;
 }
 
-int drp_update_sys_var_idx(char *fmt, char *params, int nparams)
+int drp_update_sys_var_idx(cmd_args_t *args)
 {
-    int address;
-    float value;
-    if(params == NULL || sscanf(params, fmt, &address, &value) != nparams)
-    {
-        LOGE(tag, "Error parsing arguments!");
-        return CMD_SYNTAX_ERROR;
-    }
+    int address = args->arg[0].i;
+    float value = args->arg[1].f;
 
     dat_status_address_t var_address = (dat_status_address_t)address;
     if(var_address < dat_status_last_address)
@@ -144,29 +146,17 @@ int drp_update_sys_var_idx(char *fmt, char *params, int nparams)
     }
 }
 
-int drp_update_sys_var_name(char *fmt, char *params, int nparams)
+int drp_update_sys_var_name(cmd_args_t *args)
 {
-    char name[MAX_VAR_NAME];
-    float value;
-
-    if(params == NULL)
-    {
-        LOGE(tag, "Error parsing arguments!");
-        return CMD_SYNTAX_ERROR;
-    }
+    char *name = args->arg[0].s;
+    float value = args->arg[1].f;
 
-    if(strlen(&params[0]) > MAX_VAR_NAME)
+    if(strlen(name) > MAX_VAR_NAME)
     {
         LOGE(tag, "drp_update_sys_var_name used with invalid name: %s", name);
         return CMD_SYNTAX_ERROR;
     }
 
-    if(sscanf(params, fmt, name, &value) != nparams)
-    {
-        LOGE(tag, "Error parsing arguments!");
-        return CMD_SYNTAX_ERROR;
-    }
-
     // Get variable definition by name
     dat_sys_var_t variable_def = dat_get_status_var_def_name(name);
     if(variable_def.status == -1)
@@ -234,38 +224,25 @@ int drp_get_sys_var_name(char *fmt, char *params, int nparams)
     return CMD_OK;
 }
 
-int drp_update_hours_alive(char *fmt, char *params, int nparams)
+int drp_update_hours_alive(cmd_args_t *args)
 {
-    if(params == NULL)
-    {
-        LOGE(tag, "Parameter null");
-        return CMD_SYNTAX_ERROR;
-    }
-    int value;  // Value to add
+    int value = args->arg[0].i;  // Value to add
     int current;  // Current value to update
     int rc;
 
-    if(sscanf(params, fmt, &value) == nparams)
-    {
-        // Adds <value> to current hours alive
-        current = dat_get_system_var(dat_obc_hrs_alive);
-        current += value;
-        rc = dat_set_system_var(dat_obc_hrs_alive, current);
-
-        // Adds <value> to current hours without reset
-        current = dat_get_system_var(dat_obc_hrs_wo_reset);
-        current += value;
-        rc += dat_set_system_var(dat_obc_hrs_wo_reset, current);
-        if(rc == 0)
-            return CMD_OK;
-        else
-            return CMD_ERROR;
-    }
+    // Adds <value> to current hours alive
+    current = dat_get_system_var(dat_obc_hrs_alive);
+    current += value;
+    rc = dat_set_system_var(dat_obc_hrs_alive, current);
+
+    // Adds <value> to current hours without reset
+    current = dat_get_system_var(dat_obc_hrs_wo_reset);
+    current += value;
+    rc += dat_set_system_var(dat_obc_hrs_wo_reset, current);
+    if(rc == 0)
+        return CMD_OK;
     else
-    {
-        LOGW(tag, "drp_update_hours_alive used with invalid params: %s", params);
-        return CMD_SYNTAX_ERROR;
-    }
+        return CMD_ERROR;
 }
 
 int drp_clear_gnd_wdt(char *fmt, char *params, int nparams)
@@ -283,5 +260,29 @@ int drp_set_deployed(char *fmt, char *params, int nparams)
     }
 
     int rc = dat_set_system_var(dat_dep_deployed, deployed);
+    rc += dat_flush();
+    return rc == 0 ? CMD_OK : CMD_ERROR;
+}
+
+int drp_scrub_status_vars(char *fmt, char *params, int nparams)
+{
+    int repaired = dat_scrub_status_vars();
+    if(repaired < 0)
+        return CMD_ERROR;
+    if(repaired == 0)
+        return CMD_OK;
+
+    uint32_t upsets[dat_status_last_address];
+    dat_get_status_upsets(upsets);
+    LOGW(tag, "%d status variables repaired", repaired);
+    int i;
+    for(i = 0; i < dat_status_last_address; i++)
+    {
+        if(upsets[i] > 0)
+            LOGI(tag, "%s: %u upsets", dat_get_status_var_def(i).name, (unsigned int)upsets[i]);
+    }
+
+    uint32_t total = dat_get_system_var(dat_drp_tmr_repairs);
+    int rc = dat_set_system_var(dat_drp_tmr_repairs, total + repaired);
     return rc == 0 ? CMD_OK : CMD_ERROR;
 }
@@ -30,16 +30,17 @@ void cmd_eps_init(void)
     eps_set_timeout(1000);
 
     // Register commands
-    cmd_add("eps_hard_reset", eps_hard_reset, "", 0);
-    cmd_add("eps_get_hk", eps_get_hk, "", 0);
-    cmd_add("eps_get_config", eps_get_config, "", 0);
-    cmd_add("eps_set_heater", eps_set_heater, "%d %d", 2);
-    cmd_add("eps_set_output", eps_set_output, "%d %d", 2);
-    cmd_add("eps_set_output_all", eps_set_output_all, "%d", 1);
-    cmd_add("eps_set_vboost", eps_set_vboost, "%d", 1);
-    cmd_add("eps_set_mppt", eps_set_pptmode, "%d", 1);
-    cmd_add("eps_reset_wdt", eps_reset_wdt, "", 0);
-    cmd_add("eps_update_status", eps_update_status_vars, "", 0);
+    cmd_add_class("eps_hard_reset", eps_hard_reset, "", 0, CMD_CLASS_I2C);
+    cmd_add_class("eps_get_hk", eps_get_hk, "", 0, CMD_CLASS_I2C);
+    cmd_add_class("eps_get_config", eps_get_config, "", 0, CMD_CLASS_I2C);
+    cmd_add_class("eps_set_heater", eps_set_heater, "%d %d", 2, CMD_CLASS_I2C);
+    cmd_add_class("eps_set_output", eps_set_output, "%d %d", 2, CMD_CLASS_I2C);
+    cmd_add_class("eps_set_output_all", eps_set_output_all, "%d", 1, CMD_CLASS_I2C);
+    cmd_add_class("eps_set_vboost", eps_set_vboost, "%d", 1, CMD_CLASS_I2C);
+    cmd_add_class("eps_set_mppt", eps_set_pptmode, "%d", 1, CMD_CLASS_I2C);
+    cmd_add_class("eps_reset_wdt", eps_reset_wdt, "", 0, CMD_CLASS_I2C);
+    cmd_add_class("eps_update_status", eps_update_status_vars, "", 0, CMD_CLASS_I2C);
+    cmd_set_coalesce("eps_update_status", 1);
 #endif
 }
 
@@ -23,43 +23,32 @@ static const char* tag = "cmdFlightPlan";
 
 void cmd_fp_init(void)
 {
-    cmd_add("fp_set_cmd", fp_set, "%d %d %d %d %d %d %d %d %s %n", 10);
-    cmd_add("fp_set_cmd_unix", fp_set_unix, "%d %d %d %s %n ", 5);
-    cmd_add("fp_set_cmd_dt", fp_set_dt, "%d %d %d %s %n", 5);
+    cmd_add_typed("fp_set_cmd", fp_set, "%d %d %d %d %d %d %d %d %s %n", CMD_CLASS_FREE);
+    cmd_add_typed("fp_set_cmd_unix", fp_set_unix, "%d %d %d %s %n", CMD_CLASS_FREE);
+    cmd_add_typed("fp_set_cmd_dt", fp_set_dt, "%d %d %d %s %n", CMD_CLASS_FREE);
     cmd_add("fp_del_cmd", fp_delete, "%d %d %d %d %d %d", 6);
     cmd_add("fp_del_cmd_unix", fp_delete_unix, "%d", 1);
     cmd_add("fp_show", fp_show, "", 0);
     cmd_add("fp_reset", fp_reset,"", 0);
 }
 
-int fp_set(char *fmt, char *params, int nparams)
+int fp_set(cmd_args_t *args)
 {
     struct tm str_time;
     time_t unixtime;
-    int day, month, year, hour, min, sec;
-    int executions, period, next;
-    char command[SCH_CMD_MAX_STR_PARAMS];
-    char args[SCH_CMD_MAX_STR_PARAMS];
-    memset(command, 0, SCH_CMD_MAX_STR_PARAMS);
-    memset(args, 0, SCH_CMD_MAX_STR_PARAMS);
-
-    if(params == NULL || sscanf(params, fmt, &day, &month, &year, &hour, &min, &sec, &executions, &period, &command, &next) != nparams-1)
-    {
-        LOGW(tag, "fp_set_cmd used with invalid params: %s", params);
-        return CMD_SYNTAX_ERROR;
-    }
 
-    str_time.tm_mday = day;
-    str_time.tm_mon = month-1;
-    str_time.tm_year = year-1900;
-    str_time.tm_hour = hour;
-    str_time.tm_min = min;
-    str_time.tm_sec = sec;
+    str_time.tm_mday = args->arg[0].i;
+    str_time.tm_mon = args->arg[1].i-1;
+    str_time.tm_year = args->arg[2].i-1900;
+    str_time.tm_hour = args->arg[3].i;
+    str_time.tm_min = args->arg[4].i;
+    str_time.tm_sec = args->arg[5].i;
     str_time.tm_isdst = 0;
+    int executions = args->arg[6].i;
+    int period = args->arg[7].i;
 
     unixtime = mktime(&str_time);
-    strncpy(args, params+next, (size_t)SCH_CMD_MAX_STR_PARAMS);
-    int rc = dat_set_fp((int)unixtime, command, args, executions, period);
+    int rc = dat_set_fp((int)unixtime, args->arg[8].s, args->arg[9].s, executions, period);
 
     if (rc == 0)
         return CMD_OK;
@@ -67,23 +56,13 @@ int fp_set(char *fmt, char *params, int nparams)
         return CMD_ERROR;
 }
 
-int fp_set_unix(char *fmt, char *params, int nparams)
+int fp_set_unix(cmd_args_t *args)
 {
-    int unixtime;
-    int executions, periodical, next;
-    char command[SCH_CMD_MAX_STR_PARAMS];
-    char args[SCH_CMD_MAX_STR_PARAMS];
-    memset(command, 0, SCH_CMD_MAX_STR_PARAMS);
-    memset(args, 0, SCH_CMD_MAX_STR_PARAMS);
-
-    if(params == NULL || sscanf(params, fmt, &unixtime, &executions, &periodical, &command, &next) != nparams-1)
-    {
-        LOGW(tag, "fp_set_cmd used with invalid params: %s", params);
-        return CMD_SYNTAX_ERROR;
-    }
+    int unixtime = args->arg[0].i;
+    int executions = args->arg[1].i;
+    int periodical = args->arg[2].i;
 
-    strncpy(args, params+next, (size_t)SCH_CMD_MAX_STR_PARAMS);
-    int rc = dat_set_fp(unixtime, command, args, executions, periodical);
+    int rc = dat_set_fp(unixtime, args->arg[3].s, args->arg[4].s, executions, periodical);
 
     if (rc == 0)
         return CMD_OK;
@@ -92,23 +71,14 @@ int fp_set_unix(char *fmt, char *params, int nparams)
 
 }
 
-int fp_set_dt(char *fmt, char *params, int nparams)
+int fp_set_dt(cmd_args_t *args)
 {
-    int seconds, executions, periodical, next;
-    char command[SCH_CMD_MAX_STR_PARAMS];
-    char args[SCH_CMD_MAX_STR_PARAMS];
-    memset(command, 0, SCH_CMD_MAX_STR_PARAMS);
-    memset(args, 0, SCH_CMD_MAX_STR_PARAMS);
-
-    if(params == NULL || sscanf(params, fmt, &seconds, &executions, &periodical, &command, &next) != nparams-1)
-    {
-        LOGW(tag, "fp_set_cmd used with invalid params: %s", params);
-        return CMD_SYNTAX_ERROR;
-    }
+    int seconds = args->arg[0].i;
+    int executions = args->arg[1].i;
+    int periodical = args->arg[2].i;
 
     time_t current = dat_get_time();
-    strncpy(args, params+next, (size_t)SCH_CMD_MAX_STR_PARAMS);
-    int rc = dat_set_fp((int)current+seconds, command, args, executions, periodical);
+    int rc = dat_set_fp((int)current+seconds, args->arg[3].s, args->arg[4].s, executions, periodical);
 
     if (rc == 0)
         return CMD_OK;
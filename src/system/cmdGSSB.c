@@ -31,34 +31,36 @@ static uint16_t i2c_timeout_ms = 1000;  ///< I2C timeout
 
 void cmd_gssb_init(void)
 {
-    cmd_add("gssb_pwr", gssb_pwr, "%d %d", 2);
-    cmd_add("gssb_select", gssb_select_addr, "%i", 1);
-    cmd_add("gssb_scan", gssb_bus_scan, "%i %i", 2);
-    cmd_add("gssb_fss_get_sun", gssb_read_sunsensor, "", 0);
-    cmd_add("gssb_fss_get_temp", gssb_get_temp, "", 0);
-    cmd_add("gssb_fss_set_config", gssb_sunsensor_conf, "%d", 1);
-    cmd_add("gssb_fss_commit_config", gssb_sunsensor_conf_save, "", 0);
-    cmd_add("gssb_set_addr", gssb_set_i2c_addr, "%i", 1);
-    cmd_add("gssb_commit_addr", gssb_commit_i2c_addr, "", 0);
-    cmd_add("gssb_get_version", gssb_get_version, "", 0);
-    cmd_add("gssb_get_uuid", gssb_get_uuid, "", 0);
-    cmd_add("gssb_get_model", gssb_get_model, "", 0);
-    cmd_add("gssb_get_temp", gssb_interstage_temp, "", 0);
-    cmd_add("gssb_msp_get_temp", gssb_msp_outside_temp, "", 0);
-    cmd_add("gssb_msp_cal_temp", gssb_msp_outside_temp_calibrate, "%d %d", 2);
-    cmd_add("gssb_get_temp_int", gssb_internal_temp, "", 0);
-    cmd_add("gssb_burn", gssb_interstage_burn, "", 0);
-    cmd_add("gssb_get_sun", gssb_common_sun_voltage, "", 0);
-    cmd_add("gssb_get_burn_config", gssb_interstage_get_burn_settings, "", 0);
-    cmd_add("gssb_set_burn_config", gssb_interstage_set_burn_settings, "%d %d %d %d %d %d %d", 7);
-    cmd_add("gssb_arm_auto", gssb_interstage_arm, "%d", 1);
-    cmd_add("gssb_arm_manual", gssb_interstage_state, "%d", 1);
-    cmd_add("gssb_unlock_config", gssb_interstage_settings_unlock, "%d", 1);
-    cmd_add("gssb_reset", gssb_soft_reset, "", 0);
-    cmd_add("gssb_get_status", gssb_interstage_get_status, "", 0);
-    cmd_add("gssb_update_status", gssb_update_status, "", 0);
-    cmd_add("gssb_antenna_release", gssb_antenna_release, "%d %d %d %d", 4);
-
+    cmd_add_class("gssb_pwr", gssb_pwr, "%d %d", 2, CMD_CLASS_I2C);
+    cmd_add_class("gssb_select", gssb_select_addr, "%i", 1, CMD_CLASS_I2C);
+    cmd_add_class("gssb_scan", gssb_bus_scan, "%i %i", 2, CMD_CLASS_I2C);
+    cmd_add_class("gssb_fss_get_sun", gssb_read_sunsensor, "", 0, CMD_CLASS_I2C);
+    cmd_add_class("gssb_fss_get_temp", gssb_get_temp, "", 0, CMD_CLASS_I2C);
+    cmd_add_class("gssb_fss_set_config", gssb_sunsensor_conf, "%d", 1, CMD_CLASS_I2C);
+    cmd_add_class("gssb_fss_commit_config", gssb_sunsensor_conf_save, "", 0, CMD_CLASS_I2C);
+    cmd_add_class("gssb_set_addr", gssb_set_i2c_addr, "%i", 1, CMD_CLASS_I2C);
+    cmd_add_class("gssb_commit_addr", gssb_commit_i2c_addr, "", 0, CMD_CLASS_I2C);
+    cmd_add_class("gssb_get_version", gssb_get_version, "", 0, CMD_CLASS_I2C);
+    cmd_add_class("gssb_get_uuid", gssb_get_uuid, "", 0, CMD_CLASS_I2C);
+    cmd_add_class("gssb_get_model", gssb_get_model, "", 0, CMD_CLASS_I2C);
+    cmd_add_class("gssb_get_temp", gssb_interstage_temp, "", 0, CMD_CLASS_I2C);
+    cmd_add_class("gssb_msp_get_temp", gssb_msp_outside_temp, "", 0, CMD_CLASS_I2C);
+    cmd_add_class("gssb_msp_cal_temp", gssb_msp_outside_temp_calibrate, "%d %d", 2, CMD_CLASS_I2C);
+    cmd_add_class("gssb_get_temp_int", gssb_internal_temp, "", 0, CMD_CLASS_I2C);
+    cmd_add_class("gssb_burn", gssb_interstage_burn, "", 0, CMD_CLASS_I2C);
+    cmd_add_class("gssb_get_sun", gssb_common_sun_voltage, "", 0, CMD_CLASS_I2C);
+    cmd_add_class("gssb_get_burn_config", gssb_interstage_get_burn_settings, "", 0, CMD_CLASS_I2C);
+    cmd_add_class("gssb_set_burn_config", gssb_interstage_set_burn_settings, "%d %d %d %d %d %d %d", 7, CMD_CLASS_I2C);
+    cmd_add_class("gssb_arm_auto", gssb_interstage_arm, "%d", 1, CMD_CLASS_I2C);
+    cmd_add_class("gssb_arm_manual", gssb_interstage_state, "%d", 1, CMD_CLASS_I2C);
+    cmd_add_class("gssb_unlock_config", gssb_interstage_settings_unlock, "%d", 1, CMD_CLASS_I2C);
+    cmd_add_class("gssb_reset", gssb_soft_reset, "", 0, CMD_CLASS_I2C);
+    cmd_add_class("gssb_get_status", gssb_interstage_get_status, "", 0, CMD_CLASS_I2C);
+    cmd_add_class("gssb_update_status", gssb_update_status, "", 0, CMD_CLASS_I2C);
+    cmd_add_class("gssb_antenna_release", gssb_antenna_release, "%d %d %d %d", 4, CMD_CLASS_I2C);
+
+    // A release sequence takes repetitions * (on + off) seconds
+    cmd_set_budget("gssb_antenna_release", 60000);
 }
 
 int gssb_pwr(char *fmt, char *params, int nparams)
@@ -1021,6 +1023,7 @@ int gssb_update_status(char *fmt, char *params, int nparams)
     {
         LOGI(tag, "Antennas release status: %d", deploy_status);
         dat_set_system_var(dat_dep_ant_deployed, deploy_status);
+        dat_flush();
         return CMD_OK;
     }
     else
@@ -36,6 +36,9 @@ void cmd_obc_init(void)
     cmd_add("obc_debug", obc_debug, "%d", 1);
     cmd_add("obc_reset", obc_reset, "", 0);
     cmd_add("obc_get_mem", obc_get_os_memory, "", 0);
+    cmd_add_typed("obc_cmd_stats", obc_cmd_stats, "%d", CMD_CLASS_FREE);
+    cmd_add_typed("obc_set_rule", obc_set_rule, "%d %i %u %u %i", CMD_CLASS_FREE);
+    cmd_add_typed("obc_get_rules", obc_get_rules, "", CMD_CLASS_FREE);
     cmd_add("obc_set_time", obc_set_time,"%d",1);
     cmd_add("obc_get_time", obc_get_time, "%d", 1);
     cmd_add("obc_reset_wdt", obc_reset_wdt, "", 0);
@@ -49,6 +52,13 @@ void cmd_obc_init(void)
     cmd_add("mtt_set_duty", obc_set_pwm_duty, "%d %d", 2);
     cmd_add("mtt_set_freq", obc_set_pwm_freq, "%d %f", 2);
     cmd_add("mtt_set_pwr", obc_pwm_pwr, "%d", 1);
+
+    // The watchdog commands must not wait behind other commands
+    cmd_set_prio("obc_reset_wdt", CMD_PRIO_CRITICAL);
+    cmd_set_prio("obc_reset", CMD_PRIO_CRITICAL);
+    // Status updates are idempotent, identical pending requests are merged
+    cmd_set_coalesce("obc_update_status", 1);
+    cmd_set_coalesce("obc_prop_tle", 1);
 }
 
 int obc_ident(char* fmt, char* params, int nparams)
@@ -107,6 +117,8 @@ int obc_reset_wdt(char *fmt, char *params, int nparams)
 int obc_reset(char *fmt, char *params, int nparams)
 {
     printf("Resetting system NOW!!\n");
+    // Write the pending status variables changes
+    dat_flush();
 
     #ifdef LINUX
         if(params != NULL && strcmp(params, "reboot")==0)
@@ -152,6 +164,70 @@ int obc_get_os_memory(char *fmt, char *params, int nparams)
     #endif
 }
 
+int obc_cmd_stats(cmd_args_t *args)
+{
+    int reset = args->arg[0].i;
+    cmd_stats_t stats;
+    int i, j;
+
+    LOGR(tag, "%-24s %8s %6s %7s %10s %10s %10s %10s  %s", "name", "count", "fails",
+         "overrun", "wait_avg", "wait_max", "exec_avg", "exec_max",
+         "latency <10us <100us <1ms <10ms <100ms <1s <10s >=10s");
+    for(i = 0; i < cmd_index; i++)
+    {
+        if(cmd_stats_get(i, &stats) != CMD_OK || stats.count == 0)
+            continue;
+
+        char hist[CMD_STATS_BUCKETS*11+1];
+        int len = 0;
+        for(j = 0; j < CMD_STATS_BUCKETS; j++)
+            len += snprintf(hist+len, sizeof(hist)-len, " %u", (unsigned int)stats.hist[j]);
+
+        LOGR(tag, "%-24s %8u %6u %7u %10u %10u %10u %10u  %s", cmd_list[i].name,
+             (unsigned int)stats.count, (unsigned int)stats.fails, (unsigned int)stats.overruns,
+             (unsigned int)(stats.wait_total/stats.count), (unsigned int)stats.wait_max,
+             (unsigned int)(stats.exec_total/stats.count), (unsigned int)stats.exec_max, hist);
+    }
+
+    if(reset)
+        cmd_stats_reset();
+    return CMD_OK;
+}
+
+int obc_set_rule(cmd_args_t *args)
+{
+    cmd_rule_t rule;
+    int idx = args->arg[0].i;
+    rule.opmodes = (uint32_t)args->arg[1].i;
+    rule.vbatt_below = args->arg[2].u;
+    rule.depth_min = args->arg[3].u;
+    rule.costs = (uint32_t)args->arg[4].i;
+    rule.rejected = 0;
+
+    if(cmd_rules_set(idx, &rule) != CMD_OK)
+    {
+        LOGE(tag, "Invalid rule index %d", idx);
+        return CMD_SYNTAX_ERROR;
+    }
+    return CMD_OK;
+}
+
+int obc_get_rules(cmd_args_t *args)
+{
+    cmd_rule_t rule;
+    int i;
+
+    LOGR(tag, "%4s %10s %11s %9s %6s %8s", "rule", "opmodes", "vbatt_below", "depth_min", "costs", "rejected");
+    for(i = 0; i < CMD_RULES_MAX; i++)
+    {
+        cmd_rules_get(i, &rule);
+        LOGR(tag, "%4d 0x%08X %11u %9u 0x%04X %8u", i, (unsigned int)rule.opmodes,
+             (unsigned int)rule.vbatt_below, (unsigned int)rule.depth_min,
+             (unsigned int)rule.costs, (unsigned int)rule.rejected);
+    }
+    return CMD_OK;
+}
+
 int obc_set_time(char* fmt, char* params,int nparams)
 {
     int time_to_set;
@@ -401,29 +477,11 @@ int obc_update_status(char *fmt, char *params, int nparams)
     temp_3.f = gyro_temp;
     dat_set_system_var(dat_obc_temp_3, temp_3.i);
 
-    value acc_x;
-    acc_x.f = gyro_reading.gyro_x;
-    dat_set_system_var(dat_ads_omega_x, acc_x.i);
-
-    value acc_y;
-    acc_y.f = gyro_reading.gyro_y;
-    dat_set_system_var(dat_ads_omega_y, acc_y.i);
-
-    value acc_z;
-    acc_z.f = gyro_reading.gyro_z;
-    dat_set_system_var(dat_ads_omega_z, acc_z.i);
-
-    value mag_x;
-    mag_x.f = hmc_reading.x;
-    dat_set_system_var(dat_ads_mag_x, mag_x.i);
-
-    value mag_y;
-    mag_y.f = hmc_reading.y;
-    dat_set_system_var(dat_ads_mag_y, mag_y.i);
+    vector3_t omega = {{gyro_reading.gyro_x, gyro_reading.gyro_y, gyro_reading.gyro_z}};
+    dat_set_group(dat_grp_ads_omega, omega.v);
 
-    value mag_z;
-    mag_z.f = hmc_reading.z;
-    dat_set_system_var(dat_ads_mag_z, mag_z.i);
+    vector3_t mag = {{hmc_reading.x, hmc_reading.y, hmc_reading.z}};
+    dat_set_group(dat_grp_ads_mag, mag.v);
 
 #if LOG_LEVEL >= LOG_LVL_INFO
     LOGR(tag, "Temp1: %.1f, Temp2 %.1f, Gyro temp: %.2f", sensor1/10., sensor2/10., gyro_temp);
@@ -553,10 +611,7 @@ int obc_prop_tle(char *fmt, char *params, int nparams)
     if(tle.sgp4Error != 0)
         return CMD_ERROR;
 
-    value32_t pos[3] = {{.f=(float)r[0]},{.f=(float)r[1]}, {.f=(float)r[2]}};
-    dat_set_status_var(dat_ads_pos_x, pos[0]);
-    dat_set_status_var(dat_ads_pos_y, pos[1]);
-    dat_set_status_var(dat_ads_pos_z, pos[2]);
+    dat_set_group(dat_grp_ads_position, r);
     dat_set_system_var(dat_ads_tle_last, (int)ts);
 
     return CMD_OK;
@@ -28,16 +28,16 @@ static const char* tag2 = "cmdIstage";
 void cmd_rw_init(void)
 {
     /** RW COMMANDS **/
-    cmd_add("rw_get_speed", rw_get_speed, "", 0);
-    cmd_add("rw_get_current", rw_get_current, "", 0);
-    cmd_add("rw_set_speed", rw_set_speed, "%d %d", 2);
+    cmd_add_class("rw_get_speed", rw_get_speed, "", 0, CMD_CLASS_ADCS);
+    cmd_add_class("rw_get_current", rw_get_current, "", 0, CMD_CLASS_ADCS);
+    cmd_add_class("rw_set_speed", rw_set_speed, "%d %d", 2, CMD_CLASS_ADCS);
     /** UPPER ISTAGE COMMANDS **/
 #ifdef SCH_USE_ISTAGE2
-    cmd_add("is2_get_temp", istage2_get_temp, "", 0);
-    cmd_add("is2_get_state", istage2_get_state_panel, "%d", 1);
-    cmd_add("is2_deploy", istage2_deploy_panel, "%d", 1);
-    cmd_add("is2_set_deploy", istage2_set_deploy, "%d", 1);
-    cmd_add("is2_get_status", istage2_get_sensors_status, "", 0);
+    cmd_add_class("is2_get_temp", istage2_get_temp, "", 0, CMD_CLASS_I2C);
+    cmd_add_class("is2_get_state", istage2_get_state_panel, "%d", 1, CMD_CLASS_I2C);
+    cmd_add_class("is2_deploy", istage2_deploy_panel, "%d", 1, CMD_CLASS_I2C);
+    cmd_add_class("is2_set_deploy", istage2_set_deploy, "%d", 1, CMD_CLASS_I2C);
+    cmd_add_class("is2_get_status", istage2_get_sensors_status, "", 0, CMD_CLASS_I2C);
 #endif
 }
 
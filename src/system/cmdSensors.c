@@ -198,10 +198,12 @@ int take_sample(char *fmt, char *params, int nparams)
 
             // Pack status variables to a structure
             int i;
+            value32_t snapshot[dat_status_last_address];
             uint32_t status_buff[dat_status_last_var];
+            dat_get_status_snapshot(snapshot);
             for(i = 0; i<dat_status_last_var; i++)
             {
-                status_buff[i] = dat_get_status_var(dat_status_list[i].address).u;
+                status_buff[i] = snapshot[dat_status_list[i].address].u;
             }
 
             int index_sta = dat_get_system_var(data_map[sta_sensors].sys_index);
@@ -25,17 +25,45 @@ void cmd_tm_init(void)
 {
     cmd_add("tm_parse_status", tm_parse_status, "", 0);
     cmd_add("tm_parse_string", tm_parse_string, "", 0);
-    cmd_add("tm_send_status", tm_send_status, "%d", 1);
-    cmd_add("tm_send_var", tm_send_var, "%d %s", 2);
-    cmd_add("tm_get_last", tm_get_last, "%u", 1);
-    cmd_add("tm_get_single", tm_get_single, "%u %u", 2);
-    cmd_add("tm_send_last", tm_send_last, "%u %u", 2);
-    cmd_add("tm_send_all", tm_send_all, "%u %u", 2);
-    cmd_add("tm_send_from", tm_send_from, "%u %u %u", 3);
+    cmd_add_class("tm_send_status", tm_send_status, "%d", 1, CMD_CLASS_COM);
+    cmd_add_class("tm_send_var", tm_send_var, "%d %s", 2, CMD_CLASS_COM);
+    cmd_add_class("tm_get_last", tm_get_last, "%u", 1, CMD_CLASS_COM);
+    cmd_add_class("tm_get_single", tm_get_single, "%u %u", 2, CMD_CLASS_COM);
+    cmd_add_class("tm_send_last", tm_send_last, "%u %u", 2, CMD_CLASS_COM);
+    cmd_add_typed("tm_send_all", tm_send_all, "%u %u", CMD_CLASS_COM);
+    cmd_add_class("tm_send_from", tm_send_from, "%u %u %u", 3, CMD_CLASS_COM);
     cmd_add("tm_set_ack", tm_set_ack, "%u %u", 2);
-    cmd_add("tm_send_cmds", tm_send_cmds, "%d", 1);
+    cmd_add_class("tm_send_cmds", tm_send_cmds, "%d", 1, CMD_CLASS_COM);
+    cmd_add_typed("tm_send_cmd_stats", tm_send_cmd_stats, "%d", CMD_CLASS_COM);
+    cmd_add("tm_parse_cmd_stats", tm_parse_cmd_stats, "", 0);
+    cmd_add_typed("tm_send_groups", tm_send_groups, "%d", CMD_CLASS_COM);
+    cmd_add("tm_parse_groups", tm_parse_groups, "", 0);
 #ifdef LINUX
-    cmd_add("tm_send_file", tm_send_file, "%s %u", 2);
+    cmd_add_class("tm_send_file", tm_send_file, "%s %u", 2, CMD_CLASS_COM);
+#endif
+
+    // Bulk telemetry downlink can wait behind other commands
+    cmd_set_prio("tm_send_all", CMD_PRIO_LOW);
+    cmd_set_prio("tm_send_from", CMD_PRIO_LOW);
+    cmd_set_prio("tm_send_cmds", CMD_PRIO_LOW);
+    cmd_set_prio("tm_send_cmd_stats", CMD_PRIO_LOW);
+#ifdef LINUX
+    cmd_set_prio("tm_send_file", CMD_PRIO_LOW);
+#endif
+
+    // Bulk downlinks send several frames, they check cmd_cancel_requested
+    cmd_set_budget("tm_send_all", 60000);
+    cmd_set_budget("tm_send_from", 60000);
+#ifdef LINUX
+    cmd_set_budget("tm_send_file", 60000);
+#endif
+
+    // Shed by the admission rules under low battery or overload
+    cmd_set_cost("tm_send_all", CMD_COST_TM_BULK);
+    cmd_set_cost("tm_send_from", CMD_COST_TM_BULK);
+    cmd_set_cost("tm_send_last", CMD_COST_TM_BULK);
+#ifdef LINUX
+    cmd_set_cost("tm_send_file", CMD_COST_FILE);
 #endif
 }
 
@@ -50,11 +78,13 @@ int tm_send_status(char *fmt, char *params, int nparams)
 
     // Pack status variables to a structure
     int i;
+    value32_t snapshot[dat_status_last_address];
     dat_sys_var_short_t status_buff[dat_status_last_var];
+    dat_get_status_snapshot(snapshot);
     for(i = 0; i<dat_status_last_var; i++)
     {
         status_buff[i].address = csp_hton16(dat_status_list[i].address);
-        status_buff[i].value.u = csp_hton32(dat_get_status_var(dat_status_list[i].address).u);
+        status_buff[i].value.u = csp_hton32(snapshot[dat_status_list[i].address].u);
     }
 
     // Send telemetry
@@ -123,17 +153,18 @@ int tm_parse_string(char *fmt, char *params, int nparams)
 void send_tel_from_to(int from, int des, int payload, int dest_node)
 {
     int structs_per_frame = (COM_FRAME_MAX_LEN) / data_map[payload].size;
-    uint16_t payload_size = data_map[payload].size;
 
+    // Samples older than the first one kept were reclaimed (SCH_STORAGE_RING)
+    int first = dat_get_payload_first(payload);
+    if(from < first)
+        from = first;
     int n_samples = des-from;
     int n_frames = (n_samples)/structs_per_frame;
     if( (n_samples) % structs_per_frame != 0) {
         n_frames += 1;
     }
-
-    int index_pay = dat_get_system_var(data_map[payload].sys_index);
-//    int index_ack = dat_get_system_var(data_map[payload].sys_ack);
-//    int delay = index_pay - index_ack;
+    if(n_frames <= 0)
+        return;
 
     // New connection
     csp_conn_t *conn;
@@ -147,6 +178,12 @@ void send_tel_from_to(int from, int des, int payload, int dest_node)
     int i;
     for(i=0; i < n_frames; ++i) {
 
+        // Stop if the command exceeded its budget
+        if(cmd_cancel_requested()) {
+            LOGW(tag, "Cancelled after %d of %d frames", i, n_frames);
+            break;
+        }
+
         csp_packet_t *packet = csp_buffer_get(sizeof(com_frame_t));
         packet->length = sizeof(com_frame_t);
         memset(packet->data, 0, sizeof(com_frame_t));
@@ -154,26 +191,21 @@ void send_tel_from_to(int from, int des, int payload, int dest_node)
         frame->node = SCH_COMM_ADDRESS;
         frame->nframe = csp_hton16((uint16_t) i);
         frame->type = (uint8_t)(TM_TYPE_PAYLOAD + payload);
-        frame->ndata = csp_hton32((uint32_t)structs_per_frame);
-
-        int j;
-        for(j=0; j < structs_per_frame; ++j) {
-            if( (i*structs_per_frame) +j >= n_samples ) {
-                frame->ndata = csp_hton32((uint32_t) j);
-                break;
-            }
-
-            char buff[payload_size];
-            dat_get_recent_payload_sample(buff, payload, (n_samples+(index_pay-des)) - (i*structs_per_frame+j+1));
-            int mem_offset = (j * payload_size);
-            memcpy(frame->data.data8 + mem_offset, buff, payload_size);
-        }
 
-        int k;
-        for(k=0; k<sizeof(frame->data.data32); k++)
-            frame->data.data32[k] = csp_hton32(frame->data.data32[k]);
+        // Read all the samples of the frame at once
+        int j = n_samples - i*structs_per_frame;
+        if(j > structs_per_frame)
+            j = structs_per_frame;
+        j = dat_get_payload_range(payload, from + i*structs_per_frame, j, frame->data.data8);
+        if(j <= 0) {
+            LOGE(tag, "Unable to read samples from %d of payload %d", from + i*structs_per_frame, (int)payload);
+            csp_buffer_free(packet);
+            break;
+        }
+        frame->ndata = csp_hton32((uint32_t)j);
+        _hton_payload_buff(frame->data.data8, payload, j);
 
-        LOGI(tag, "Sending %d structs of payload %d", frame->ndata, (int)payload);
+        LOGI(tag, "Sending %d structs of payload %d", j, (int)payload);
         LOGI(tag, "Node    : %d", frame->node);
         LOGI(tag, "Frame   : %d", frame->nframe);
         LOGI(tag, "Type    : %d", frame->type);
@@ -306,31 +338,18 @@ int tm_send_last(char *fmt, char *params, int nparams)
     }
 }
 
-int tm_send_all(char *fmt, char *params, int nparams)
+int tm_send_all(cmd_args_t *args)
 {
-    if(params == NULL)
-    {
-        LOGE(tag, "params is null!");
-        return CMD_SYNTAX_ERROR;
-    }
-
-    uint32_t dest_node;
-    uint32_t payload;
-
-    if(nparams == sscanf(params, fmt, &payload, &dest_node)) {
+    uint32_t payload = args->arg[0].u;
+    uint32_t dest_node = args->arg[1].u;
 
-        if(payload >= last_sensor) {
-            return CMD_SYNTAX_ERROR;
-        }
-        int index_pay = dat_get_system_var(data_map[payload].sys_index);
-        int index_ack = dat_get_system_var(data_map[payload].sys_ack);
-        send_tel_from_to(index_ack, index_pay, payload, dest_node);
-        return CMD_OK;
-    }
-    else
-    {
+    if(payload >= last_sensor) {
         return CMD_SYNTAX_ERROR;
     }
+    int index_pay = dat_get_system_var(data_map[payload].sys_index);
+    int index_ack = dat_get_system_var(data_map[payload].sys_ack);
+    send_tel_from_to(index_ack, index_pay, payload, dest_node);
+    return CMD_OK;
 }
 
 int tm_send_from(char *fmt, char *params, int nparams)
@@ -430,6 +449,129 @@ int tm_send_cmds(char *fmt, char *params, int nparams)
     return _com_send_data(node, cmd_save_all(), strlen(cmd_save_all()), TM_TYPE_HELP, 1, 0);
 }
 
+int tm_send_cmd_stats(cmd_args_t *args)
+{
+    int node = args->arg[0].i;
+    int n_rec = COM_FRAME_MAX_LEN/sizeof(tm_cmd_stats_t);
+    tm_cmd_stats_t records[n_rec];
+    cmd_stats_t stats;
+    int i, j, n = 0, n_frame = 0, rc = CMD_OK;
+
+    for(i = 0; i < cmd_index; i++)
+    {
+        if(cmd_stats_get(i, &stats) != CMD_OK || stats.count == 0)
+            continue;
+
+        // Pack one record
+        tm_cmd_stats_t *rec = &records[n++];
+        rec->id = csp_hton16((uint16_t)i);
+        rec->count = csp_hton32(stats.count);
+        rec->fails = csp_hton32(stats.fails);
+        rec->wait_avg = csp_hton32((uint32_t)(stats.wait_total/stats.count));
+        rec->exec_avg = csp_hton32((uint32_t)(stats.exec_total/stats.count));
+        rec->exec_max = csp_hton32(stats.exec_max);
+        for(j = 0; j < CMD_STATS_BUCKETS; j++)
+            rec->hist[j] = csp_hton16(stats.hist[j] > UINT16_MAX ? UINT16_MAX : (uint16_t)stats.hist[j]);
+
+        // Send a frame each time the buffer is full
+        if(n == n_rec)
+        {
+            rc = _com_send_data(node, records, n*sizeof(tm_cmd_stats_t), TM_TYPE_CMD_STATS, n, n_frame++);
+            n = 0;
+            if(rc != CMD_OK)
+                return rc;
+        }
+    }
+
+    if(n > 0)
+        rc = _com_send_data(node, records, n*sizeof(tm_cmd_stats_t), TM_TYPE_CMD_STATS, n, n_frame);
+
+    return rc;
+}
+
+int tm_parse_cmd_stats(char *fmt, char *params, int nparams)
+{
+    if(params == NULL)
+        return CMD_SYNTAX_ERROR;
+
+    com_frame_t *frame = (com_frame_t *)params;
+    tm_cmd_stats_t *records = (tm_cmd_stats_t *)frame->data.data8;
+    int n_rec = COM_FRAME_MAX_LEN/sizeof(tm_cmd_stats_t);
+    int i, j;
+
+    for(i = 0; i < frame->ndata && i < n_rec; i++)
+    {
+        tm_cmd_stats_t *rec = &records[i];
+        char hist[CMD_STATS_BUCKETS*6+1];
+        int len = 0;
+        for(j = 0; j < CMD_STATS_BUCKETS; j++)
+            len += snprintf(hist+len, sizeof(hist)-len, " %u", (unsigned int)csp_ntoh16(rec->hist[j]));
+
+        char *name = cmd_get_name(csp_ntoh16(rec->id));
+        LOGR(tag, "%-24s %8u %6u %10u %10u %10u  %s", name == NULL ? "?" : name,
+             (unsigned int)csp_ntoh32(rec->count), (unsigned int)csp_ntoh32(rec->fails),
+             (unsigned int)csp_ntoh32(rec->wait_avg), (unsigned int)csp_ntoh32(rec->exec_avg),
+             (unsigned int)csp_ntoh32(rec->exec_max), hist);
+        free(name);
+    }
+
+    return CMD_OK;
+}
+
+int tm_send_groups(cmd_args_t *args)
+{
+    int node = args->arg[0].i;
+    dat_groups_t groups;
+    uint64_t values[TM_GROUPS_PER_FRAME];
+    int i, n, first, n_frame = 0, rc = CMD_OK;
+
+    dat_get_groups_snapshot(&groups);
+    const double *all = (const double *)&groups;
+
+    for(first = 0; first < DAT_GROUPS_LEN && rc == CMD_OK; first += n)
+    {
+        n = DAT_GROUPS_LEN - first < TM_GROUPS_PER_FRAME ? DAT_GROUPS_LEN - first : TM_GROUPS_PER_FRAME;
+        for(i = 0; i < n; i++)
+        {
+            uint64_t bits;
+            memcpy(&bits, &all[first + i], sizeof(bits));
+            values[i] = csp_hton64(bits);
+        }
+        rc = _com_send_data(node, values, n*sizeof(uint64_t), TM_TYPE_GROUPS, n, n_frame++);
+    }
+
+    return rc;
+}
+
+int tm_parse_groups(char *fmt, char *params, int nparams)
+{
+    if(params == NULL)
+        return CMD_SYNTAX_ERROR;
+
+    com_frame_t *frame = (com_frame_t *)params;
+    int first = frame->nframe * TM_GROUPS_PER_FRAME;
+    int group, i;
+
+    for(group = 0; group < dat_group_last_address; group++)
+    {
+        dat_group_def_t def = dat_get_group_def(group);
+        for(i = 0; i < def.size; i++)
+        {
+            int j = def.offset + i - first;
+            if(j < 0 || j >= frame->ndata || j >= TM_GROUPS_PER_FRAME)
+                continue;
+            uint64_t bits;
+            double value;
+            memcpy(&bits, frame->data.data8 + j*sizeof(uint64_t), sizeof(bits));
+            bits = csp_ntoh64(bits);
+            memcpy(&value, &bits, sizeof(value));
+            LOGR(tag, "%s[%d]: %.12g", def.name, i, value);
+        }
+    }
+
+    return CMD_OK;
+}
+
 #ifdef LINUX
 int tm_send_file(char *fmt, char *params, int nparams)
 {
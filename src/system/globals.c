@@ -18,10 +18,10 @@
  */
 
 #include "globals.h"
+#include "repoCommand.h"
 
-osQueue dispatcher_queue;         ///< Commands queue
-osQueue executer_cmd_queue;       ///< Executer commands queue
-osQueue executer_stat_queue;      ///< Executer result queue
+osQueue dispatcher_queue[CMD_PRIO_LAST]; ///< Dispatcher commands queues, one per priority level
+osQueue executer_cmd_queue[CMD_CLASS_LAST]; ///< Executer commands queues, one per command class
 osSemaphore repo_data_sem;        ///< Data repository mutex
 osSemaphore repo_data_fp_sem;     ///< Flight plan repository mutex
 osSemaphore repo_machine_sem;     ///< State status_machine repository mutex
@@ -69,12 +69,10 @@ int adcs_get_mag(char* fmt, char* params, int nparams);
 
 /**
  *
- * @param fmt Str. Parameters format "%lf"
- * @param params Str. Parameters as string: "<control cycle>"
- * @param nparams Int. Number of parameters 1
+ * @param args Typed parameters, format "%lf": "<control cycle>"
  * @return CMD_OK if executed correctly, CMD_ERROR in case of failures, or CMD_ERROR_SYNTAX in case of parameters errors
  */
-int adcs_control_torque(char* fmt, char* params, int nparams);
+int adcs_control_torque(cmd_args_t *args);
 
 /**
  *
@@ -87,12 +85,10 @@ int adcs_mag_moment(char* fmt, char* params, int nparams);
 
 /**
  * Set ADCS vector (Intertial frame) and velocity (body frame) targets
- * @param fmt "%lf lf lf lf lf lf"
- * @param params "<x y z> <wx wy wz>"
- * @param nparams 6
+ * @param args Typed parameters, format "%lf %lf %lf %lf %lf %lf": "<x y z> <wx wy wz>"
  * @return CMD_OK | CMD_ERROR | CMD_ERROR_SYNTAX
  */
-int adcs_set_target(char* fmt, char* params, int nparams);
+int adcs_set_target(cmd_args_t *args);
 
 /**
  * Set ADCS target to Nadir based on current quaternion and position
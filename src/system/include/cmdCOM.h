@@ -189,6 +189,28 @@ void _hton32_buff(uint32_t *buff, int len);
  */
 void _ntoh32_buff(uint32_t *buff, int len);
 
+/**
+ * Auxiliary function to convert an array of payload structs to network (big)
+ * endian. Each field is swapped according to its size in the payload schema
+ * (@see dat_get_payload_fields), so structs with 8, 16 or 64 bit fields are
+ * also supported. Modifies the passed array in-memory.
+ *
+ * @param buff Pointer to @n consecutive payload structs
+ * @param payload Payload id
+ * @param n Number of structs in buff
+ */
+void _hton_payload_buff(uint8_t *buff, int payload, int n);
+
+/**
+ * Auxiliary function to convert an array of payload structs to host endian.
+ * @see _hton_payload_buff
+ *
+ * @param buff Pointer to @n consecutive payload structs
+ * @param payload Payload id
+ * @param n Number of structs in buff
+ */
+void _ntoh_payload_buff(uint8_t *buff, int payload, int n);
+
 
 /**
  * Show CSP debug information, currently the route table and interfaces
@@ -54,9 +54,7 @@ int drp_print_system_vars(char *fmt, char *params, int nparams);
  * Update a system status variable by index (address)
  * Support int, uint and float parameters
  *
- * @param fmt Str. Parameters format "%d %f"
- * @param params Str. Parameters as string "<address> <value>"
- * @param nparams Int. Number of parameters 2
+ * @param args Typed parameters, format "%d %f": "<address> <value>"
  * @return  CMD_OK if executed correctly, CMD_ERROR in case of failures, or CMD_ERROR_SYNTAX in case of parameters errors
  *
  * @code
@@ -65,24 +63,22 @@ int drp_print_system_vars(char *fmt, char *params, int nparams);
  * drp_set_var 3 -4.25
  *
  * //From code
- * cmd_t cmd = cmd_get_str("drp_set_var");
- * cmd_add_params(&cmd, 1, 123)
- * cmd_send(&cmd)
+ * cmd_t *cmd = cmd_get_str("drp_set_var");
+ * cmd_add_params_var(cmd, 1, 123.0); // Floats must be passed as double
+ * cmd_send(cmd);
  *
- * cmd_t cmd = cmd_get_str("drp_set_var");
- * cmd_add_params(&cmd, 3, -4.25)
- * cmd_send(&cmd)
+ * cmd_t *cmd = cmd_get_str("drp_set_var");
+ * cmd_add_params_var(cmd, 3, -4.25);
+ * cmd_send(cmd);
  * @endcode
  */
-int drp_update_sys_var_idx(char *fmt, char *params, int nparams);
+int drp_update_sys_var_idx(cmd_args_t *args);
 
 /**
  * Update a system status variable by name
  * Support int, uint and float parameters
  *
- * @param fmt Str. Parameters format "%s %f"
- * @param params Str. Parameters as string "<name> <value>"
- * @param nparams Int. Number of parameters 2
+ * @param args Typed parameters, format "%s %f": "<name> <value>"
  * @return  CMD_OK if executed correctly, CMD_ERROR in case of failures, or CMD_ERROR_SYNTAX in case of parameters errors
  *
  *  * @code
@@ -91,17 +87,17 @@ int drp_update_sys_var_idx(char *fmt, char *params, int nparams);
  * drp_set_var_name tgt_omega_x -4.25
  *
  * //From code
- * cmd_t cmd = cmd_get_str("drp_set_var_name");
- * cmd_add_params(&cmd, "obc_op_mode", 123)
- * cmd_send(&cmd)
+ * cmd_t *cmd = cmd_get_str("drp_set_var_name");
+ * cmd_add_params_var(cmd, "obc_op_mode", 123.0); // Floats must be passed as double
+ * cmd_send(cmd);
  *
- * cmd_t cmd = cmd_get_str("drp_set_var_name");
- * cmd_add_params(&cmd, "tgt_omega_x", -4.25)
- * cmd_send(&cmd)
+ * cmd_t *cmd = cmd_get_str("drp_set_var_name");
+ * cmd_add_params_var(cmd, "tgt_omega_x", -4.25);
+ * cmd_send(cmd);
  * @endcode
  *
  */
-int drp_update_sys_var_name(char *fmt, char *params, int nparams);
+int drp_update_sys_var_name(cmd_args_t *args);
 
 /**
  * Print a system status variable value by name
@@ -117,12 +113,10 @@ int drp_get_sys_var_name(char *fmt, char *params, int nparams);
  * Update current hours alive and hours without reset counters adding <value>
  * hours.
  *
- * @param fmt Str. Parameters format "%d"
- * @param params Str. Parameters as string "<value>"
- * @param nparams Int. Number of parameters 1
+ * @param args Typed parameters, format "%d": "<value>"
  * @return  CMD_OK if executed correctly, CMD_ERROR in case of failures, or CMD_ERROR_SYNTAX in case of parameters errors
  */
-int drp_update_hours_alive(char *fmt, char *params, int nparams);
+int drp_update_hours_alive(cmd_args_t *args);
 
 /**
  * Clear the GND watchdog timer counter to prevent the system reset. This
@@ -150,4 +144,17 @@ int drp_clear_gnd_wdt(char *fmt, char *params, int nparams);
  */
 int drp_set_deployed(char *fmt, char *params, int nparams);
 
+/**
+ * Vote and repair the copies of all the status variables (tripled writing),
+ * see dat_scrub_status_vars. The number of repaired variables is added to
+ * `dat_drp_tmr_repairs` and the upsets per variable are logged. Executed
+ * periodically by the housekeeping task, see SCH_STORAGE_SCRUB_PERIOD.
+ *
+ * @param fmt Str. Parameters format ""
+ * @param params Str. Parameters as string ""
+ * @param nparams Int. Number of parameters 0
+ * @return  CMD_OK if executed correctly, CMD_ERROR in case of failures, or CMD_ERROR_SYNTAX in case of parameters errors
+ */
+int drp_scrub_status_vars(char *fmt, char *params, int nparams);
+
 #endif /* CMD_DRP_H */
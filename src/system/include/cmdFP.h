@@ -26,36 +26,30 @@ void cmd_fp_init(void);
 /**
  * Add a command to the flight plan by date and time
  *
- * @param fmt Str. Parameters format "%d %d %d %d %d %d %d %d %s %n"
- * @param params Str. Parameters as string
+ * @param args Typed parameters, format "%d %d %d %d %d %d %d %d %s %n":
  *  "<day> <month> <year> <hour> <min> <sec> <executions> <period> <command> [args]"
- * @param nparams Int. Number of parameters 10
  * @return  CMD_OK if executed correctly, CMD_ERROR in case of failures, or CMD_ERROR_SYNTAX in case of parameters errors
  */
-int fp_set(char *fmt, char *params, int nparams);
+int fp_set(cmd_args_t *args);
 
 /**
  * Add a command to the flight plan by unix time
  *
- * @param fmt Str. Parameters format "%d %d %d %s %n"
- * @param params Str. Parameters as string
+ * @param args Typed parameters, format "%d %d %d %s %n":
  *  "<unixtime> <executions> <period> <command> [args]"
- * @param nparams Int. Number of parameters 5
  * @return  CMD_OK if executed correctly, CMD_ERROR in case of failures, or CMD_ERROR_SYNTAX in case of parameters errors
  */
-int fp_set_unix(char *fmt, char *params, int nparams);
+int fp_set_unix(cmd_args_t *args);
 
 /**
  * Add a command to the flight plan to be executed <seconds> seconds after
  * current unix time.
  *
- * @param fmt Str. Parameters format "%d %d %d %s %n"
- * @param params Str. Parameters as string
+ * @param args Typed parameters, format "%d %d %d %s %n":
  *  "<seconds> <executions> <period>  <command> [args]"
- * @param nparams Int. Number of parameters 5
  * @return  CMD_OK if executed correctly, CMD_ERROR in case of failures, or CMD_ERROR_SYNTAX in case of parameters errors
  */
-int fp_set_dt(char *fmt, char *params, int nparams);
+int fp_set_dt(cmd_args_t *args);
 
 /**
  * Delete a command in the flight plan by the execution time
@@ -85,6 +85,42 @@ int obc_reset(char *fmt, char *params, int nparams);
  */
 int obc_get_os_memory(char *fmt, char *params, int nparams);
 
+/**
+ * Print the execution statistics of the commands executed at least once:
+ * number of executions, failures and budget overruns, time in the dispatcher
+ * queue, execution time (average and max, in microseconds) and the latency
+ * histogram.
+ * @see cmd_stats_t
+ *
+ * @param args Typed parameters, format "%d": reset the statistics after
+ * printing them (1) or not (0). Ex: "0"
+ * @return CMD_OK
+ */
+int obc_cmd_stats(cmd_args_t *args);
+
+/**
+ * Set a dispatcher admission rule. Commands of the rejected cost classes
+ * are not executed while all the rule conditions hold, a condition set to 0
+ * always holds. Set costs to 0 to disable the rule.
+ * @see cmd_rule_t, cmd_cost_t
+ *
+ * @param args Typed parameters, format "%d %i %u %u %i": rule index,
+ * operation modes mask (bit n for opmode n), battery voltage limit [mV],
+ * min queued commands and rejected cost classes mask.
+ * Ex: "0 0 7000 0 0x6" rejects bulk telemetry and files below 7 V
+ * @return CMD_OK or CMD_SYNTAX_ERROR if the index is not valid
+ */
+int obc_set_rule(cmd_args_t *args);
+
+/**
+ * Print the dispatcher admission rules and the number of commands rejected
+ * by each rule
+ *
+ * @param args Not used
+ * @return CMD_OK
+ */
+int obc_get_rules(cmd_args_t *args);
+
 /**
  * Set the system time only if is not running Linux
  *
@@ -21,9 +21,28 @@
 #define TM_TYPE_GENERIC 0
 #define TM_TYPE_STATUS  1
 #define TM_TYPE_HELP    2
+#define TM_TYPE_CMD_STATS 3
+#define TM_TYPE_GROUPS 4
 #define TM_TYPE_PAYLOAD 10
 #define TM_TYPE_FILE 100
 
+/**
+ * Commands statistics telemetry record (@see cmd_stats_t), in network byte
+ * order. Times are in microseconds and the histogram counters saturate.
+ */
+typedef struct __attribute__((__packed__)) tm_cmd_stats{
+    uint16_t id;                        ///< Command id
+    uint32_t count;                     ///< Number of executions
+    uint32_t fails;                     ///< Executions that did not return CMD_OK
+    uint32_t wait_avg;                  ///< Average time in the dispatcher queue
+    uint32_t exec_avg;                  ///< Average execution time
+    uint32_t exec_max;                  ///< Max execution time
+    uint16_t hist[CMD_STATS_BUCKETS];   ///< Latency histogram
+} tm_cmd_stats_t;
+
+///< Status groups values per telemetry frame (@see tm_send_groups)
+#define TM_GROUPS_PER_FRAME (COM_FRAME_MAX_LEN / sizeof(uint64_t))
+
 /**
  * Register TM commands
  */
@@ -95,12 +114,10 @@ int tm_send_last(char *fmt, char *params, int nparams);
 
 /**
  * Send all structs data stored as payload in multiple csp frames from last acknowledge.
- * @param fmt "%u %u"
- * @param params "<destination node> <payload>"
- * @param nparams 2
+ * @param args Typed parameters, format "%u %u": "<payload> <destination node>"
  * @return CMD_OK, CMD_ERROR, or CMD_ERROR_SYNTAX
  */
-int tm_send_all(char *fmt, char *params, int nparams);
+int tm_send_all(cmd_args_t *args);
 
 /**
  * Send k structs data stored as payload in multiple csp frames form last acknowledge.
@@ -132,6 +149,49 @@ int tm_get_single(char *fmt, char *params, int nparams);
 
 int tm_send_cmds(char *fmt, char *params, int nparms);
 
+/**
+ * Send the execution statistics of the commands executed at least once as
+ * tm_cmd_stats_t records, several records per frame. To parse the data
+ * @seealso tm_parse_cmd_stats
+ *
+ * @param args Typed parameters, format "%d": "<node>". Ex: "10"
+ * @return CMD_OK, CMD_ERROR, or CMD_ERROR_SYNTAX
+ */
+int tm_send_cmd_stats(cmd_args_t *args);
+
+/**
+ * Parses a commands statistics telemetry, @seealso tm_send_cmd_stats.
+ *
+ * @param fmt Str. Not used.
+ * @param param char *. Parameters as pointer to raw data. Receives a
+ * com_frame_t with tm_cmd_stats_t records
+ * @param nparams Int. Not used.
+ * @return CMD_OK, CMD_ERROR, or CMD_ERROR_SYNTAX
+ */
+int tm_parse_cmd_stats(char *fmt, char *params, int nparams);
+
+/**
+ * Send all the status groups (@see dat_groups_t), taken from the same update,
+ * at double precision. The dat_groups_t values are packed in network byte
+ * order and split in frames, frame n carries the values from n*TM_GROUPS_PER_FRAME.
+ * To parse the data @seealso tm_parse_groups
+ *
+ * @param args Typed parameters, format "%d": "<node>". Ex: "10"
+ * @return CMD_OK, CMD_ERROR, or CMD_ERROR_SYNTAX
+ */
+int tm_send_groups(cmd_args_t *args);
+
+/**
+ * Parses a status groups telemetry, @seealso tm_send_groups.
+ *
+ * @param fmt Str. Not used.
+ * @param param char *. Parameters as pointer to raw data. Receives a
+ * com_frame_t with dat_groups_t values
+ * @param nparams Int. Not used.
+ * @return CMD_OK, CMD_ERROR, or CMD_ERROR_SYNTAX
+ */
+int tm_parse_groups(char *fmt, char *params, int nparams);
+
 #ifdef LINUX
 
 /**
@@ -87,14 +87,23 @@
 #define SCH_COM_TX_DELAY_MS     3000               /// Delay (ms) between continuous transmissions
 
 /* Data repository settings */
-#define SCH_STORAGE_MODE        {{SCH_STORAGE}}    ///< Status repository location. (0) RAM, (1) Single external.
+#define SCH_STORAGE_MODE        {{SCH_STORAGE}}    ///< Status repository location. (0) RAM, (1) Single external (SQLite), (2) PostgreSQL, (3) Memory-mapped segment files.
 #define SCH_STORAGE_TRIPLE_WR   {{SCH_STORAGE_TRIPLE_WR}}   ///< Tripled writing enabled (0 | 1)
-#define SCH_STORAGE_FILE        "/tmp/suchai.db"   ///< File to store the database, only if @SCH_STORAGE_MODE is 1
+#define SCH_STORAGE_FILE        "/tmp/suchai.db"   ///< File to store the database, only if @SCH_STORAGE_MODE is 1, or the base name of the segment and checkpoint files if it is 3
 #define SCH_STORAGE_PGUSER      "{{SCH_STORAGE_PGUSER}}"
 #define SCH_STORAGE_PGPASS      "proyectosuchai2020"
 #define SCH_STORAGE_PGHOST      "localhost"
+#define SCH_STORAGE_FLUSH_MS    (1000)   ///< Max time to keep status variables changes in the RAM cache, 0 to write through, only if @SCH_STORAGE_MODE > 0 (@see dat_flush)
+#define SCH_STORAGE_SCRUB_PERIOD (60)   ///< Period in seconds to vote and repair all the status variables copies, 0 to disable, only if @SCH_STORAGE_TRIPLE_WR is 1 (@see dat_scrub_status_vars)
+#define SCH_STORAGE_PAYLOAD_BLOB (1)   ///< Payload samples layout, (1) packed struct in a BLOB keyed by (payload, index), (0) one table per payload with a column per field. Only if @SCH_STORAGE_MODE is 1
+#define SCH_STORAGE_TX_SAMPLES  (64)    ///< Max payload samples per transaction, 1 to commit each sample, only if @SCH_STORAGE_MODE is 1 (@see storage_commit)
+#define SCH_STORAGE_TX_MS       (1000)  ///< Max time to keep a payload samples transaction open, only if @SCH_STORAGE_MODE is 1
+#define SCH_STORAGE_WAL         (1)     ///< Use the SQLite write-ahead log journal (0 | 1), only if @SCH_STORAGE_MODE is 1
+#define SCH_STORAGE_SYNCHRONOUS "NORMAL" ///< SQLite synchronous pragma, OFF, NORMAL or FULL, only if @SCH_STORAGE_MODE is 1
+#define SCH_STORAGE_RING        (1)     ///< Payload retention when all its sections are used, (1) the oldest section is reclaimed for the new samples, (0) new samples are dropped. Only if @SCH_STORAGE_MODE is 0 or 3, or in flash
+#define SCH_STORAGE_SQL_RETENTION (0) ///< Keep only the last sections of each payload in the database too, the oldest samples are deleted (0 | 1). Only if @SCH_STORAGE_MODE is 1 or 2, the tables are unbounded by default
 
-#define SCH_SECTIONS_PER_PAYLOAD 10                 ///< Memory blocks for storing each payload type TODO: Make configurable per payload
+#define SCH_SECTIONS_PER_PAYLOAD 10                 ///< Default memory blocks (segment files if @SCH_STORAGE_MODE is 3) for storing each payload type, @see data_map_t
 #define SCH_SIZE_PER_SECTION 256*1024              ///< Size of each memory block in flash storage
 #define SCH_FLASH_INIT_MEMORY 0                    ///< Initial address in flash storage
 
@@ -126,5 +135,24 @@
 #define SCH_CMD_MAX_STR_PARAMS    (256)      ///< Limit for the parameters length
 #define SCH_CMD_MAX_STR_NAME      (256)      ///< Limit for the length of the name of a command
 #define SCH_CMD_MAX_STR_FORMAT    (128)      ///< Limit for the length of the format field of a command
+#define SCH_CMD_HASH_SIZE         (512)      ///< Size of the commands name index, power of 2 and >= 2*SCH_CMD_MAX_ENTRIES
+#define SCH_EXECUTER_WORKERS      (2)       ///< Number of executer tasks serving commands without serialization class
+#define SCH_EXECUTER_QUEUE_LEN    (5)       ///< Max number of commands waiting in each executer class queue
+#define SCH_DISPATCHER_QUEUE_LEN  (10)      ///< Max number of commands waiting in each dispatcher priority level
+#define SCH_DISPATCHER_AGING      (8)       ///< Dispatch a waiting priority level after being skipped this number of times
+#define SCH_DISPATCHER_RETRY_MS   (10)      ///< Period to retry the commands waiting for room in a full executer class queue
+#define SCH_OS_QUEUE_RING         (1)       ///< Linux osQueue backend, lock-free ring_queue (1) or pthread_queue (0)
+#define SCH_CMD_POOL_CMDS         (64)      ///< Number of commands (cmd_t) in the commands pool
+#define SCH_CMD_POOL_PARAMS_S     (48)      ///< Number of small (32 bytes) parameters buffers
+#define SCH_CMD_POOL_PARAMS_M     (8)       ///< Number of medium (com_frame_t size) parameters buffers
+#define SCH_CMD_POOL_PARAMS_L     (8)       ///< Number of large (SCH_CMD_MAX_STR_PARAMS or CMD_ARGS_MAX_LEN) parameters buffers
+#define SCH_CMD_POOL_HEAP         (0)       ///< Use the heap if the commands pools are exhausted (0 | 1)
+#define SCH_CMD_BUDGET_MS         (10000)   ///< Default max execution time of a command in ms, 0 for no limit (@see cmd_set_budget)
+#define SCH_CMD_BATCH_MAX         (16)      ///< Max number of commands sent as one batch by a telecommand or the flight plan
+#define SCH_CMD_HANDLES           (8)       ///< Number of completion handles to wait for commands results (@see cmd_send_async)
+#define SCH_CMD_COALESCE_MAX      (8)       ///< Max number of pending coalescible commands tracked by the dispatcher (@see cmd_set_coalesce)
+#define SCH_ADMISSION_VBATT_LOW   (7000)    ///< Default admission rule, shed expensive commands below this battery voltage [mV]
+#define SCH_ADMISSION_DEPTH       (20)      ///< Default admission rule, shed bulk commands with this number of commands queued
+#define SCH_ADMISSION_PERIOD_MS   (1000)    ///< Compile the admission rules with the current mode and battery voltage with this period
 
 #endif //SUCHAI_CONFIG_H
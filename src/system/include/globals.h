@@ -13,9 +13,8 @@
 #include "osQueue.h"
 #include "osSemphr.h"
 
-extern osQueue dispatcher_queue;         ///< Commands queue
-extern osQueue executer_cmd_queue;       ///< Executer commands queue
-extern osQueue executer_stat_queue;      ///< Executer result queue
+extern osQueue dispatcher_queue[];       ///< Dispatcher commands queues, one per priority level
+extern osQueue executer_cmd_queue[];     ///< Executer commands queues, one per command class
 extern osSemaphore repo_data_sem;        ///< Data repository mutex
 extern osSemaphore repo_data_fp_sem;     ///< Flight plan repository mutex
 extern osSemaphore repo_machine_sem;     ///< State status_machine repository mutex
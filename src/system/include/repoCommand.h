@@ -15,43 +15,44 @@
 
 #include "log_utils.h"
 #include "globals.h"
+#include "osDelay.h"
+#include "osThread.h"
 
-/* Add files with commands */
-#include "cmdOBC.h"
-#include "cmdDRP.h"
-#include "cmdConsole.h"
-#if SCH_FP_ENABLED
-#include "cmdFP.h"
-#endif
-#if SCH_COMM_ENABLE
-#include "cmdCOM.h"
-#include "cmdTM.h"
-#endif
-#ifdef SCH_USE_NANOPOWER
-#include "cmdEPS.h"
-#endif
-#if SCH_SEN_ENABLED
-#include "cmdSensors.h"
-#endif
-#ifdef SCH_USE_GSSB
-#include "cmdGSSB.h"
-#endif
-#if SCH_ADCS_ENABLED
-#include "cmdADCS.h"
-#endif
-#ifdef SCH_USE_RW
-#include "cmdRW.h"
-#endif
+/* Macros */
+/**
+ * Send command to execution using the dispatcher queue of the command priority
+ * level (must be initialized, @see dispatcher_init). Blocks if the queue is
+ * full
+ *
+ * @param cmd *cmd_type, pointer to command
+ */
+#define cmd_send(cmd) if(cmd != NULL){cmd_send_timeout(cmd, portMAX_DELAY);}
 
+/**
+ * Send command to execution without blocking. If the queue of the command
+ * priority level is full the command is not sent and the caller keeps the
+ * command, to retry later or to release it with cmd_free.
+ *
+ * @param cmd *cmd_type, pointer to command
+ * @return CMD_SEND_OK, CMD_SEND_FULL or CMD_SEND_ERROR
+ */
+#define cmd_try_send(cmd) cmd_send_timeout(cmd, 0)
 
-/* Macros */
 /**
- * Send command to execution using dispatcherQueue (must be initialized). Blocks
- * if the queue is full
+ * Send command to execution with an absolute deadline. If the command is still
+ * waiting in the dispatcher queue when the deadline passes it is dropped
+ * instead of executed. Blocks if the queue is full.
  *
  * @param cmd *cmd_type, pointer to command
+ * @param deadline portTick, osTaskGetTickCount value
+ *
+ * @code
+ *      // Useless after the next control period
+ *      cmd_t *cmd = cmd_get_str("adcs_do_control");
+ *      cmd_send_deadline(cmd, osTaskGetTickCount() + osDefineTime(period_ms));
+ * @endcode
  */
-#define cmd_send(cmd) if(cmd != NULL){osQueueSend(dispatcher_queue, &cmd, portMAX_DELAY);}
+#define cmd_send_deadline(cmd, deadline) if(cmd != NULL){cmd_set_deadline(cmd, deadline); cmd_send_timeout(cmd, portMAX_DELAY);}
 
 /* Command definitions */
 /**
@@ -61,11 +62,124 @@
 #define CMD_ERROR 0          ///< Command not executed as expected
 #define CMD_SYNTAX_ERROR -1  ///< Command parameters syntax error
 
+/**
+ * Define cmd_send_timeout return values
+ */
+#define CMD_SEND_OK 0        ///< Command queued to the dispatcher
+#define CMD_SEND_FULL -1     ///< Priority level queue full, command not queued (backpressure)
+#define CMD_SEND_ERROR -2    ///< Invalid command or dispatcher not initialized
+#define CMD_WAIT_TIMEOUT -3  ///< Command sent but not finished in time (@see cmd_send_wait)
+
 /**
  *  Defines the prototype of a command
  */
 typedef int (*cmdFunction)(char *fmt, char *params, int nparams);
 
+/**
+ * Typed parameters. The format string of a command is compiled once, when the
+ * command is registered, into a descriptor with the type of each argument.
+ * Parameters are then parsed only once (@see cmd_build_from_str) or filled
+ * directly (@see cmd_add_params_var) into a packed cmd_args_t structure.
+ * Supported conversions are "%d", "%i", "%u", "%ld", "%f", "%lf", "%s" and a
+ * trailing "%n" that takes the rest of the parameters string.
+ */
+#define CMD_MAX_ARGS (12)    ///< Max number of typed arguments of a command
+
+typedef enum cmd_arg_type{
+    CMD_ARG_INT = 0,            ///< "%d", int
+    CMD_ARG_XINT,               ///< "%i", int in decimal, octal or hex
+    CMD_ARG_UINT,               ///< "%u", unsigned int
+    CMD_ARG_LONG,               ///< "%ld", long
+    CMD_ARG_FLOAT,              ///< "%f", float
+    CMD_ARG_DOUBLE,             ///< "%lf", double
+    CMD_ARG_STR,                ///< "%s", a word
+    CMD_ARG_TAIL,               ///< "%n", the rest of the parameters (can be empty)
+    CMD_ARG_LAST                ///< Dummy element, the number of types
+} cmd_arg_type_t;
+
+/**
+ * Compiled parameters format
+ */
+typedef struct cmd_fmt_desc{
+    int8_t nargs;                   ///< Number of arguments, -1 if the format can not be typed
+    uint8_t type[CMD_MAX_ARGS];     ///< Type of each argument (cmd_arg_type_t)
+} cmd_fmt_desc_t;
+
+/**
+ * Value of a typed argument
+ */
+typedef union cmd_arg{
+    int i;                      ///< CMD_ARG_INT, CMD_ARG_XINT
+    unsigned int u;             ///< CMD_ARG_UINT
+    long l;                     ///< CMD_ARG_LONG
+    float f;                    ///< CMD_ARG_FLOAT
+    double d;                   ///< CMD_ARG_DOUBLE
+    char *s;                    ///< CMD_ARG_STR, CMD_ARG_TAIL
+} cmd_arg_t;
+
+/**
+ * Packed typed arguments. Strings are stored in the same block, after the last
+ * argument, so the structure must not be copied.
+ */
+typedef struct cmd_args{
+    int nargs;                  ///< Number of valid arguments
+    int len;                    ///< Size of the block in bytes
+    cmd_arg_t arg[];            ///< Arguments values
+} cmd_args_t;
+
+/**
+ * Max size of a cmd_args_t block
+ */
+#define CMD_ARGS_MAX_LEN (sizeof(cmd_args_t) + CMD_MAX_ARGS*sizeof(cmd_arg_t) + SCH_CMD_MAX_STR_PARAMS + CMD_MAX_ARGS)
+
+/**
+ * Defines the prototype of a command with typed parameters. The repository
+ * checks that all the arguments are present before calling the function.
+ */
+typedef int (*cmdArgsFunction)(cmd_args_t *args);
+
+/**
+ * Commands serialization classes. Commands of the same class are executed one
+ * at a time and in the same order they were dispatched, because they share a
+ * bus or a subsystem. Commands of different classes are executed concurrently.
+ * CMD_CLASS_FREE commands are served by a pool of SCH_EXECUTER_WORKERS tasks so
+ * they do not have ordering guarantees.
+ */
+typedef enum cmd_class{
+    CMD_CLASS_FREE = 0,         ///< No serialization required
+    CMD_CLASS_COM,              ///< Communications (CSP, TRX)
+    CMD_CLASS_I2C,              ///< EPS and I2C bus devices
+    CMD_CLASS_ADCS,             ///< ADCS sensors and actuators
+    CMD_CLASS_LAST              ///< Dummy element, the number of classes
+} cmd_class_t;
+
+/**
+ * Commands priority levels. The dispatcher serves the highest level with
+ * pending commands first, but a level that was skipped SCH_DISPATCHER_AGING
+ * times is served next to avoid starvation. Commands take the priority of
+ * their definition (@see cmd_set_prio), senders can change cmd->prio before
+ * sending the command.
+ */
+typedef enum cmd_prio{
+    CMD_PRIO_CRITICAL = 0,      ///< Watchdog and safety related commands
+    CMD_PRIO_HIGH,              ///< Time sensitive commands, ex. ADCS control
+    CMD_PRIO_NORMAL,            ///< Default priority
+    CMD_PRIO_LOW,               ///< Bulk commands, ex. telemetry downlink
+    CMD_PRIO_LAST               ///< Dummy element, the number of levels
+} cmd_prio_t;
+
+/**
+ * Commands cost classes, used by the admission rules to shed expensive
+ * commands under low battery or overload (@see cmd_rule_t). At most 8 classes.
+ */
+typedef enum cmd_cost{
+    CMD_COST_DEFAULT = 0,       ///< Cheap commands, never shed by the default rules
+    CMD_COST_TM_BULK,           ///< Bulk telemetry downlinks
+    CMD_COST_FILE,              ///< File transfers
+    CMD_COST_ADCS,              ///< ADCS control, sensors and actuators
+    CMD_COST_LAST               ///< Dummy element, the number of classes
+} cmd_cost_t;
+
 #define IF_PARSE_PARAMS(...) if(sscanf(params, fmt, ##__VA_ARGS) == nparams)
 
 /**
@@ -76,10 +190,36 @@ typedef struct cmd_type{
     int id;                     ///< Command id
     int nparams;                ///< Number of parameters
     char *fmt;                  ///< Format of parameters
-    char *params;               ///< List of parameters (use malloc)
-    cmdFunction function;       ///< Command function
+    char *params;               ///< List of parameters as string or raw data
+    cmd_args_t *args;           ///< Typed parameters, NULL if not parsed
+    const cmd_fmt_desc_t *desc; ///< Compiled format of parameters
+    cmdFunction function;       ///< Command function (legacy handler)
+    cmdArgsFunction function_args; ///< Command function (typed handler)
+    cmd_class_t cls;            ///< Serialization class
+    cmd_prio_t prio;            ///< Dispatcher priority level
+    portTick t_sent;            ///< Tick when sent to the dispatcher
+    portTick t_wait;            ///< Ticks waiting in the dispatcher queue, 0 if not dispatched
+    portTick deadline;          ///< Drop the command if not dispatched before this tick, 0 for no deadline
+    uint32_t budget;            ///< Max execution time in ms, 0 for no limit
+    int overrun;                ///< Budget exceeded while running, already reported by cmd_check_budgets
+    struct cmd_type *next;      ///< Next command of a batch, NULL if not in a batch (@see cmd_send_batch)
+    struct cmd_handle *handle;  ///< Completion handle, NULL if nobody waits for the result (@see cmd_send_async)
+    int coalesce;               ///< Identical pending commands can be merged (@see cmd_set_coalesce)
+    cmd_cost_t cost;            ///< Admission cost class
 } cmd_t;
 
+/**
+ * Completion handle of a command sent with cmd_send_async. Handles are taken
+ * from a fixed pool of SCH_CMD_HANDLES elements, the owner must release them
+ * with cmd_handle_release.
+ */
+typedef struct cmd_handle{
+    int state;                  ///< Handle state, internal
+    int result;                 ///< Command result, valid after cmd_handle_wait returns 1
+    portTick t_exec;            ///< Execution time in ticks, valid after cmd_handle_wait returns 1
+    osQueue done;               ///< Signaled when the command finishes
+} cmd_handle_t;
+
 /**
  * Structure to store the list of
  * available commands by name
@@ -88,9 +228,113 @@ typedef struct cmd_list_type{
     int nparams;                ///< Number of parameters
     char *fmt;                  ///< Format of parameters
     char *name;                 ///< Command name (use malloc)
-    cmdFunction function;       ///< Command function
+    cmd_fmt_desc_t desc;        ///< Compiled format of parameters
+    cmdFunction function;       ///< Command function (legacy handler)
+    cmdArgsFunction function_args; ///< Command function (typed handler)
+    cmd_class_t cls;            ///< Serialization class
+    cmd_prio_t prio;            ///< Default dispatcher priority level
+    uint32_t budget;            ///< Max execution time in ms, 0 for no limit
+    int coalesce;               ///< Identical pending commands can be merged
+    cmd_cost_t cost;            ///< Admission cost class
 } cmd_list_t;
 
+/**
+ * Commands pools usage. Commands (cmd_t) and their parameters are allocated
+ * from fixed size pools (@see SCH_CMD_POOL_CMDS) instead of the heap.
+ */
+typedef struct cmd_pool_stats{
+    int cmd_used;               ///< Commands currently allocated
+    int cmd_max;                ///< Max commands allocated at the same time
+    int cmd_fail;               ///< Commands allocations failed, pool exhausted
+    int par_used;               ///< Parameters buffers currently allocated
+    int par_max;                ///< Max parameters buffers allocated at the same time
+    int par_fail;               ///< Parameters allocations failed, pools exhausted
+} cmd_pool_stats_t;
+
+/**
+ * Number of buckets of the commands latency histogram. The buckets upper
+ * limits are 10us, 100us, 1ms, 10ms, 100ms, 1s, 10s and the last bucket
+ * counts the rest.
+ */
+#define CMD_STATS_BUCKETS (8)
+
+/**
+ * Execution statistics of a command. Times are in microseconds, measured with
+ * osTaskGetTickCount so the resolution is one tick. The latency is the time
+ * in the dispatcher queue plus the execution time.
+ */
+typedef struct cmd_stats{
+    uint32_t count;             ///< Number of executions
+    uint32_t fails;             ///< Executions that did not return CMD_OK
+    uint64_t wait_total;        ///< Total time in the dispatcher queue
+    uint32_t wait_max;          ///< Max time in the dispatcher queue
+    uint64_t exec_total;        ///< Total execution time
+    uint32_t exec_max;          ///< Max execution time
+    uint32_t overruns;          ///< Executions longer than the command budget
+    uint32_t hist[CMD_STATS_BUCKETS]; ///< Latency histogram
+} cmd_stats_t;
+
+/**
+ * Max number of admission rules
+ */
+#define CMD_RULES_MAX (8)
+
+/**
+ * Admission rule. A rule rejects the commands of the cost classes in @costs
+ * when all of its conditions hold. A condition set to 0 always holds.
+ */
+typedef struct cmd_rule{
+    uint32_t opmodes;           ///< Operation modes (bit n for dat_obc_opmode n) where the rule applies
+    uint32_t vbatt_below;       ///< Applies if the battery voltage is known and lower [mV]
+    uint32_t depth_min;         ///< Applies if at least this number of commands are queued
+    uint32_t costs;             ///< Rejected cost classes (bit n for cmd_cost_t n), 0 disables the rule
+    uint32_t rejected;          ///< Commands rejected by this rule
+} cmd_rule_t;
+
+/**
+ * Admission rules compiled for the current operation mode and battery
+ * voltage. Checking a command is then a mask test and one comparison with the
+ * queue depth (@see cmd_admit).
+ */
+typedef struct cmd_admission{
+    uint32_t mask;              ///< Cost classes rejected by at least one active rule
+    uint32_t depth[CMD_COST_LAST]; ///< Min queued commands to reject each cost class
+    int rule[CMD_COST_LAST];    ///< Rule that rejects each cost class
+} cmd_admission_t;
+
+/* Add files with commands. Included after the types definitions because
+ * commands headers use them */
+#include "cmdOBC.h"
+#include "cmdDRP.h"
+#include "cmdConsole.h"
+#if SCH_FP_ENABLED
+#include "cmdFP.h"
+#endif
+#if SCH_COMM_ENABLE
+#include "cmdCOM.h"
+#include "cmdTM.h"
+#endif
+#ifdef SCH_USE_NANOPOWER
+#include "cmdEPS.h"
+#endif
+#if SCH_SEN_ENABLED
+#include "cmdSensors.h"
+#endif
+#ifdef SCH_USE_GSSB
+#include "cmdGSSB.h"
+#endif
+#if SCH_ADCS_ENABLED
+#include "cmdADCS.h"
+#endif
+#ifdef SCH_USE_RW
+#include "cmdRW.h"
+#endif
+
+
+/* Global variables */
+extern cmd_list_t cmd_list[];   ///< Registered commands buffer
+extern int cmd_index;           ///< Number of registered commands
+
 /* Function definitions */
 
 /**
@@ -111,13 +355,264 @@ typedef struct cmd_list_type{
  */
 int cmd_add(char *name, cmdFunction function, char *fmt, int nparams);
 
+/**
+ * Registers a command in the system with a serialization class. Commands of
+ * the same class are executed in order, one at a time. @see cmd_class_t.
+ * cmd_add registers commands as CMD_CLASS_FREE.
+ *
+ * @param name Str. Command name
+ * @param function Pointer to command function
+ * @param fparams Str. defines format of parameters, separated by spaces
+ * @param nparam Int. number of parameters, according to @fparams
+ * @param cls cmd_class_t. Command serialization class
+ * @return Int. Length of command list in case of success or CMD_ERROR (-1) if
+ * an error occurred.
+ *
+ * @code
+ *      // Commands that use the TRX must not run concurrently
+ *      cmd_add_class("com_ping", com_ping, "%d", 1, CMD_CLASS_COM);
+ * @endcode
+ */
+int cmd_add_class(char *name, cmdFunction function, char *fmt, int nparams, cmd_class_t cls);
+
+/**
+ * Registers a command with typed parameters. The format is compiled once and
+ * the function receives the parsed arguments instead of the parameters
+ * string. The format must contain only the conversions listed in
+ * cmd_arg_type_t.
+ *
+ * @param name Str. Command name
+ * @param function Pointer to command function
+ * @param fmt Str. Defines format of parameters, separated by spaces
+ * @param cls cmd_class_t. Command serialization class
+ * @return Int. Length of command list in case of success or CMD_ERROR (-1) if
+ * an error occurred.
+ *
+ * @code
+ *      int foo(cmd_args_t *args)
+ *      {
+ *          printf("%d %s\n", args->arg[0].i, args->arg[1].s);
+ *          return CMD_OK;
+ *      }
+ *      cmd_add_typed("foo", foo, "%d %s", CMD_CLASS_FREE);
+ * @endcode
+ */
+int cmd_add_typed(char *name, cmdArgsFunction function, char *fmt, cmd_class_t cls);
+
+/**
+ * Set the default dispatcher priority level of a registered command. Must be
+ * called before cmd_repo_freeze. Commands are registered as CMD_PRIO_NORMAL.
+ *
+ * @param name Str. Command name
+ * @param prio cmd_prio_t. Priority level
+ * @return CMD_OK if the priority was set, CMD_ERROR otherwise
+ *
+ * @code
+ *      cmd_add("obc_reset_wdt", obc_reset_wdt, "", 0);
+ *      cmd_set_prio("obc_reset_wdt", CMD_PRIO_CRITICAL);
+ * @endcode
+ */
+int cmd_set_prio(char *name, cmd_prio_t prio);
+
+/**
+ * Set the execution time budget of a registered command. Must be called
+ * before cmd_repo_freeze. Commands are registered with SCH_CMD_BUDGET_MS.
+ * Commands running longer than their budget are counted as overruns and
+ * asked to stop (@see cmd_check_budgets, cmd_cancel_requested).
+ *
+ * @param name Str. Command name
+ * @param budget_ms Uint32. Max execution time in ms, 0 for no limit
+ * @return CMD_OK if the budget was set, CMD_ERROR otherwise
+ *
+ * @code
+ *      cmd_add("tm_send_all", tm_send_all, "%s %d", 2);
+ *      cmd_set_budget("tm_send_all", 60000);
+ * @endcode
+ */
+int cmd_set_budget(char *name, uint32_t budget_ms);
+
+/**
+ * Mark a registered command as coalescible. Must be called before
+ * cmd_repo_freeze. A coalescible command sent while an identical command (same
+ * name and parameters) is still pending, that is, queued but not yet running,
+ * is dropped and the pending one runs instead. Use it for idempotent
+ * commands, such as status updates, that can pile up when the executer falls
+ * behind. Commands sent with a completion handle or in a batch, and commands
+ * that would run later or at a lower priority than the pending one, are never
+ * coalesced. Parameters are compared as strings, so raw parameters
+ * (cmd_add_params_raw) are not supported.
+ *
+ * @param name Str. Command name
+ * @param coalesce Int. 1 to coalesce identical pending commands, 0 otherwise
+ * @return CMD_OK if the flag was set, CMD_ERROR otherwise
+ *
+ * @code
+ *      cmd_add("obc_update_status", obc_update_status, "", 0);
+ *      cmd_set_coalesce("obc_update_status", 1);
+ * @endcode
+ */
+int cmd_set_coalesce(char *name, int coalesce);
+
+/**
+ * Set the admission cost class of a registered command. Must be called before
+ * cmd_repo_freeze. Commands are registered as CMD_COST_DEFAULT.
+ *
+ * @param name Str. Command name
+ * @param cost cmd_cost_t. Cost class
+ * @return CMD_OK if the cost was set, CMD_ERROR otherwise
+ *
+ * @code
+ *      cmd_add_class("tm_send_file", tm_send_file, "%s %u", 2, CMD_CLASS_COM);
+ *      cmd_set_cost("tm_send_file", CMD_COST_FILE);
+ * @endcode
+ */
+int cmd_set_cost(char *name, cmd_cost_t cost);
+
+/**
+ * Compare the parameters of two commands. Typed arguments are compared by
+ * value, string parameters with strcmp, NULL parameters equal an empty string.
+ *
+ * @param a cmd_t *. Command
+ * @param b cmd_t *. Command
+ * @return 1 if both are the same command with the same parameters, 0 otherwise
+ */
+int cmd_params_equal(cmd_t *a, cmd_t *b);
+
+/**
+ * Called by the executer when a command starts running, so it is no longer
+ * pending and identical commands sent from now on are queued. Implemented by
+ * the dispatcher. @see cmd_set_coalesce
+ *
+ * @param cmd cmd_t *. Command
+ */
+void cmd_coalesce_done(cmd_t *cmd);
+
+/**
+ * Set the absolute deadline of a command. @see cmd_send_deadline
+ *
+ * @param cmd cmd_t *. Command
+ * @param deadline portTick. Tick count (osTaskGetTickCount) after which the
+ * command is not dispatched
+ */
+void cmd_set_deadline(cmd_t *cmd, portTick deadline);
+
+/**
+ * Check if the deadline of a command has passed. The comparison is safe
+ * against tick counter overflows for deadlines closer than half its range.
+ *
+ * @param cmd cmd_t *. Command
+ * @param now portTick. Current tick count
+ * @return 1 if the command has a deadline and it has passed, 0 otherwise
+ */
+int cmd_deadline_passed(cmd_t *cmd, portTick now);
+
+/**
+ * Send a command to the dispatcher queue of its priority level (cmd->prio),
+ * waiting up to @timeout if the queue is full. Implemented by the dispatcher
+ * (@see taskDispatcher.h). Use the cmd_send and cmd_try_send macros.
+ *
+ * @param cmd cmd_t *. Command to send. The dispatcher owns the command only if
+ * CMD_SEND_OK is returned
+ * @param timeout Max time to wait in ticks (portMAX_DELAY to wait forever)
+ * @return CMD_SEND_OK, CMD_SEND_FULL or CMD_SEND_ERROR
+ */
+int cmd_send_timeout(cmd_t *cmd, uint32_t timeout);
+
+/**
+ * Send several commands as one batch. The batch is queued with a single
+ * queue operation, in the dispatcher queue of the highest priority of its
+ * commands, so commands from other senders can not be interleaved. The
+ * commands are executed in the given order, one after the other, by the
+ * executer of the first command class. Commands of other classes in the
+ * batch are not serialized with their class (@see taskExecuter.h).
+ * Implemented by the dispatcher (@see taskDispatcher.h).
+ *
+ * @param cmds cmd_t **. Array of commands to send, NULL elements are skipped
+ * @param n Int. Number of elements in @cmds
+ * @param timeout Max time to wait in ticks if the queue is full (portMAX_DELAY
+ * to wait forever)
+ * @return CMD_SEND_OK, CMD_SEND_FULL or CMD_SEND_ERROR. The dispatcher owns the
+ * commands only if CMD_SEND_OK is returned
+ *
+ * @code
+ *      cmd_t *cmds[2];
+ *      cmds[0] = cmd_build_from_str("obc_set_time 1600000000");
+ *      cmds[1] = cmd_build_from_str("tm_send_status 10");
+ *      cmd_send_batch(cmds, 2, portMAX_DELAY);
+ * @endcode
+ */
+int cmd_send_batch(cmd_t **cmds, int n, uint32_t timeout);
+
+/**
+ * Send a command to execution and get a handle to wait for its result.
+ * Blocks if the queue is full. Implemented by the dispatcher.
+ *
+ * @param cmd cmd_t *. Command to send
+ * @return Completion handle, or NULL if the command was not sent because all
+ * the handles are in use (the caller keeps the command)
+ *
+ * @code
+ *      cmd_handle_t *h = cmd_send_async(cmd_get_str("eps_update_status"));
+ *      // ... do something else
+ *      if(h != NULL && cmd_handle_wait(h, 1000))
+ *          LOGI(tag, "Result %d", h->result);
+ *      cmd_handle_release(h);
+ * @endcode
+ */
+cmd_handle_t *cmd_send_async(cmd_t *cmd);
+
+/**
+ * Wait for the command of @handle to finish. Commands dropped by the
+ * dispatcher finish with CMD_ERROR.
+ *
+ * @param handle cmd_handle_t *. Handle returned by cmd_send_async
+ * @param timeout Max time to wait in ms (portMAX_DELAY to wait forever)
+ * @return 1 if the command finished, then handle->result and handle->t_exec
+ * are valid, 0 on timeout
+ */
+int cmd_handle_wait(cmd_handle_t *handle, uint32_t timeout);
+
+/**
+ * Return a handle to the pool. The handle can be released before the command
+ * finishes, then the result is discarded.
+ *
+ * @param handle cmd_handle_t *. Handle returned by cmd_send_async, can be NULL
+ */
+void cmd_handle_release(cmd_handle_t *handle);
+
+/**
+ * Set the result of the command of @handle and wake up the waiting task.
+ * Called by the executer (or the dispatcher if the command is dropped).
+ *
+ * @param handle cmd_handle_t *. Completion handle, can be NULL
+ * @param result Int. Command result
+ * @param t_exec portTick. Execution time in ticks
+ */
+void cmd_handle_complete(cmd_handle_t *handle, int result, portTick t_exec);
+
+/**
+ * Send a command to execution and wait for its result.
+ *
+ * @param cmd cmd_t *. Command to send
+ * @param timeout Max time to wait in ms (portMAX_DELAY to wait forever)
+ * @return The command result (CMD_OK, CMD_ERROR, CMD_SYNTAX_ERROR),
+ * CMD_SEND_ERROR if the command was not sent (it is released) or
+ * CMD_WAIT_TIMEOUT if it did not finish in time
+ *
+ * @code
+ *      if(cmd_send_wait(cmd_get_str("eps_update_status"), 1000) == CMD_OK)
+ *          vbatt = dat_get_system_var(dat_eps_vbatt);
+ * @endcode
+ */
+int cmd_send_wait(cmd_t *cmd, uint32_t timeout);
+
 /**
  * Create a new command by name
  *
  * @param name Str. Command name
  * @return cmd_t * Pointer to command structure already initialized. Null if
- *                 command does not exists. Use @cmd_free to free allocated
- *                 memory.
+ *                 command does not exists or the commands pool is exhausted.
+ *                 Use @cmd_free to free allocated memory.
  */
 cmd_t * cmd_get_str(char *name);
 
@@ -138,6 +633,17 @@ cmd_t * cmd_get_idx(int idx);
  */
 char * cmd_get_name(int idx);
 
+/**
+ * Copy the name of a command by id to a buffer, without allocating memory.
+ * The name is truncated to @len-1 characters.
+ *
+ * @param idx Int. Command index or id
+ * @param name Buffer to copy the name to
+ * @param len Size of @name
+ * @return CMD_OK if the command exists, CMD_ERROR otherwise
+ */
+int cmd_copy_name(int idx, char *name, size_t len);
+
 /**
  * Fills command parameters as raw data using memcpy.@len bytes will be copied
  * from @params to @cmd->params.
@@ -157,7 +663,8 @@ char * cmd_get_name(int idx);
 void cmd_add_params_raw(cmd_t *cmd, void *params, int len);
 
 /**
- * Fills command parameters as string
+ * Fills command parameters as string. Parameters of commands with typed
+ * handlers are parsed here, once.
  * @note does not check the parameters format or if the command requires param.
  *
  * @param cmd cmd_t. Command to fill parameters
@@ -176,7 +683,11 @@ void cmd_add_params_str(cmd_t *cmd, char *params);
 
 /**
  * Fills command parameters by variables using the registered parameters format.
- * @note variables are converted to string
+ * If the format can be typed the variables are stored directly as typed
+ * arguments, without converting them to string. Otherwise they are converted
+ * to string.
+ * @note "%f" arguments are read as double (default argument promotion) and
+ * "%n" arguments as char *.
  *
  * @param cmd cmd_t. Command to fill parameters
  * @param ... List of variables to fill as parameters
@@ -197,7 +708,8 @@ void cmd_add_params_var(cmd_t *cmd, ...);
 /**
  * Returns a new command with parameters form a string with the format:
  * <command> [parameters]. The [parameters] field is optional. Returns NULL if
- * the command is not found or in case of errors.
+ * the command is not found or in case of errors. Parameters of commands with
+ * typed handlers are parsed into cmd->args, otherwise they are kept as string.
  *
  * @param buff str. A null terminated string with the format <command> [parameters]
  * @return cmd_t. A new command (uses malloc) or NULL in case of errors.
@@ -211,10 +723,142 @@ void cmd_add_params_var(cmd_t *cmd, ...);
 cmd_t *cmd_build_from_str(char *buff);
 
 /**
- * Destroys a command and frees the allocated memory
+ * Executes a command. Typed handlers receive the parsed arguments and legacy
+ * handlers receive the parameters string. If a legacy command was filled with
+ * typed arguments they are converted to string first.
+ *
+ * @param cmd cmd_t *. Command to execute
+ * @return Command result: CMD_OK, CMD_ERROR or CMD_SYNTAX_ERROR
+ */
+int cmd_execute(cmd_t *cmd);
+
+/**
+ * Find the commands in execution that exceeded their budget and ask them to
+ * stop. Each execution is flagged only once. Call it periodically, ex. from
+ * the watchdog task.
+ *
+ * @param last_id Int *. Stores the id of the last flagged command, can be NULL
+ * @return Number of commands flagged in this call
+ */
+int cmd_check_budgets(int *last_id);
+
+/**
+ * Cooperative cancellation. Commands that may run for long, ex. loops sending
+ * several frames, should call this function periodically and return if it is
+ * true. Commands are not interrupted otherwise.
+ *
+ * @return 1 if the command executed by the calling task exceeded its budget,
+ * 0 otherwise
+ *
+ * @code
+ *      for(i = 0; i < n_frames; i++)
+ *      {
+ *          if(cmd_cancel_requested())
+ *              return CMD_ERROR;
+ *          send_frame(i);
+ *      }
+ * @endcode
+ */
+int cmd_cancel_requested(void);
+
+/**
+ * Set an admission rule. Rules can be changed at any time, they take effect
+ * the next time they are compiled (@see cmd_rules_compile).
+ *
+ * @param idx Int. Rule index, from 0 to CMD_RULES_MAX-1
+ * @param rule cmd_rule_t *. Rule conditions and rejected costs, the rejected
+ * counter is cleared
+ * @return CMD_OK or CMD_ERROR if the index is not valid
+ *
+ * @code
+ *      // Do not start file transfers below 7 V
+ *      cmd_rule_t rule = {0, 7000, 0, 1<<CMD_COST_FILE, 0};
+ *      cmd_rules_set(0, &rule);
+ * @endcode
+ */
+int cmd_rules_set(int idx, cmd_rule_t *rule);
+
+/**
+ * Get an admission rule and its rejected commands counter
+ *
+ * @param idx Int. Rule index, from 0 to CMD_RULES_MAX-1
+ * @param rule cmd_rule_t *. Structure to fill
+ * @return CMD_OK or CMD_ERROR if the index is not valid
+ */
+int cmd_rules_get(int idx, cmd_rule_t *rule);
+
+/**
+ * Compile the admission rules for an operation mode and battery voltage. Only
+ * the rules that apply are kept, for each cost class the lowest queue depth
+ * that rejects it.
+ *
+ * @param adm cmd_admission_t *. Compiled rules
+ * @param opmode Int. Operation mode (dat_obc_opmode)
+ * @param vbatt Int. Battery voltage [mV], 0 if unknown
+ */
+void cmd_rules_compile(cmd_admission_t *adm, int opmode, int vbatt);
+
+/**
+ * Check if a command is admitted by the compiled rules. Rejections are
+ * counted in the rule that rejected the command.
+ *
+ * @param adm cmd_admission_t *. Compiled rules
+ * @param cmd cmd_t *. Command
+ * @param depth Int. Number of commands queued
+ * @return -1 if admitted, otherwise the index of the rule that rejects it
+ */
+int cmd_admit(cmd_admission_t *adm, cmd_t *cmd, int depth);
+
+/**
+ * Compiles a parameters format string into a typed descriptor.
+ *
+ * @param fmt Str. Parameters format, ex. "%d %s"
+ * @param desc cmd_fmt_desc_t *. Descriptor to fill
+ * @return Int. Number of arguments or -1 if the format can not be typed.
+ */
+int cmd_fmt_compile(const char *fmt, cmd_fmt_desc_t *desc);
+
+/**
+ * Destroys a command and returns the command and its parameters to the pools.
+ * Commands created with cmd_get_str, cmd_get_idx or cmd_build_from_str must
+ * be released with this function, not with free.
  */
 void cmd_free(cmd_t *cmd);
 
+/**
+ * Get the commands pools usage counters since cmd_repo_init.
+ *
+ * @param stats cmd_pool_stats_t *. Structure to fill
+ */
+void cmd_pool_get_stats(cmd_pool_stats_t *stats);
+
+/**
+ * Add one execution of @cmd to the command statistics. The time waited in the
+ * dispatcher queue is taken from cmd->t_wait.
+ *
+ * @param cmd cmd_t *. Executed command
+ * @param exec_ticks portTick. Execution time in ticks
+ * @param result Int. Command result
+ * @return 1 if the execution exceeded the command budget and it was not
+ * reported before by cmd_check_budgets, 0 otherwise
+ */
+int cmd_stats_record(cmd_t *cmd, portTick exec_ticks, int result);
+
+/**
+ * Get the execution statistics of a command since cmd_repo_init or
+ * cmd_stats_reset.
+ *
+ * @param idx Int. Command index or id
+ * @param stats cmd_stats_t *. Structure to fill
+ * @return CMD_OK or CMD_ERROR if the index is not valid
+ */
+int cmd_stats_get(int idx, cmd_stats_t *stats);
+
+/**
+ * Clear the execution statistics of all commands
+ */
+void cmd_stats_reset(void);
+
 /**
 * Print the list of registered commands
 */
@@ -234,7 +878,26 @@ char *cmd_save_all(void);
 int cmd_repo_init(void);
 
 /**
- * Cleans the repo buffer. Frees allocated memories
+ * Freezes the command repository and builds a hash index over the commands
+ * names. Seeds are tried until a perfect hash (one probe per lookup) is found,
+ * otherwise the seed with the shortest probe sequence is used.
+ *
+ * After freezing, cmd_get_str, cmd_get_idx and cmd_get_name do not take
+ * repo_cmd_sem and are O(1), and cmd_add fails. Call it once all commands were
+ * registered and before creating the tasks that use the repository.
+ *
+ * @return CMD_OK if the index was built, CMD_ERROR otherwise
+ *
+ * @code
+ *      cmd_repo_init();
+ *      cmd_repo_freeze();
+ * @endcode
+ */
+int cmd_repo_freeze(void);
+
+/**
+ * Cleans the repo buffer. Frees allocated memories. Also unfreezes the
+ * repository.
  */
 void cmd_repo_close(void);
 
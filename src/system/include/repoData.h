@@ -28,8 +28,12 @@
 #include "math_utils.h"
 #include "data_storage.h"
 #include "osSemphr.h"
+#include "osQueue.h"
+#include "osDelay.h"
 #include "repoDataSchema.h"
 
+#define DAT_SUBS_MAX 8  ///< Max number of status variables subscriptions, see dat_subscribe_status_vars
+
 //TODO: Delete
 typedef union sensors_value{
     float f;
@@ -92,12 +96,69 @@ void dat_repo_init(void);
 /**
  * Performs a cleanup and closes repository resources.
  *
- * Closes the storage system (if permanent memory is being used).
+ * Writes the cached status variables (@see dat_flush) and closes the storage
+ * system (if permanent memory is being used).
  *
  * @see dat_repo_init
  */
 void dat_repo_close(void);
 
+/**
+ * Write the status variables changed since the last flush to the storage, in
+ * a single transaction.
+ *
+ * With permanent storage (SCH_STORAGE_MODE > 0) the status variables are kept
+ * in a RAM cache. Reads are served from the cache and writes are delayed until
+ * the oldest pending write is SCH_STORAGE_FLUSH_MS old, or until this function
+ * is called. Call it after writing critical variables, such as the deployment
+ * flags, and before a reset. Does nothing if the status variables are in RAM.
+ * Also commits the payload samples pending in the open batch (@see
+ * storage_commit).
+ *
+ * @return 0 if OK, -1 in case of error (the variables are written again in the
+ * next flush)
+ */
+int dat_flush(void);
+
+/**
+ * Vote all the status variables copies at once and repair the divergent ones
+ * (scrubbing). With tripled writing the copies are only compared when a
+ * variable is read, so a single event upset in a copy of a variable that is
+ * rarely read stays there until a second upset makes the vote fail. Scrub the
+ * repository periodically (@see SCH_STORAGE_SCRUB_PERIOD) to avoid it.
+ *
+ * Each 32-bit word gets the bitwise majority of its three copies. With
+ * permanent storage the pending changes are written first, then the whole
+ * repository is read with one query and the repaired copies are written in
+ * one transaction. Does nothing without tripled writing.
+ *
+ * @return Number of variables repaired, -1 in case of error
+ */
+int dat_scrub_status_vars(void);
+
+/**
+ * Get the number of upsets found by dat_scrub_status_vars for each status
+ * variable since the start, a variable with at least one divergent copy
+ * counts as one upset.
+ *
+ * @param upsets Array of dat_status_last_address counters
+ */
+void dat_get_status_upsets(uint32_t *upsets);
+
+/**
+ * Subscribe to the changes of a set of status variables. When a setter
+ * changes the value of one of them, a dat_sys_var_short_t with the address
+ * and the new value is sent to @queue. Setting a variable to its current value
+ * is not a change, it does not notify nor write the storage. Notifications
+ * are dropped (with a warning) if the queue is full, so setters never block.
+ *
+ * @param index Array of addresses of the variables of interest
+ * @param n Number of addresses
+ * @param queue Queue of dat_sys_var_short_t items
+ * @return 0 if OK, -1 if there are no free subscriptions (DAT_SUBS_MAX)
+ */
+int dat_subscribe_status_vars(dat_status_address_t *index, int n, osQueue queue);
+
 /**
  * Sets a status/config variable by index
  *
@@ -109,6 +170,29 @@ int dat_set_system_var(dat_status_address_t index, int value);
 int _dat_set_system_var(dat_status_address_t index, int value);
 int dat_set_status_var(dat_status_address_t index, value32_t value);
 
+/**
+ * Sets several status/config variables by index, taking the repository lock
+ * only once.
+ *
+ * @param index Array of indexes or addresses of the variables to set
+ * @param value Array of values to set
+ * @param n Number of variables
+ * @return 0 if OK, -1 in case of error
+ */
+int dat_set_status_many(dat_status_address_t *index, value32_t *value, int n);
+
+/**
+ * Sets @n consecutive status/config variables, such as the components of a
+ * quaternion, as one update. Readers of @c dat_get_status_vars see all the
+ * new values or none of them.
+ *
+ * @param index Index of the first variable
+ * @param value Array of @n values to set
+ * @param n Number of variables
+ * @return 0 if OK, -1 in case of error
+ */
+int dat_set_status_vars(dat_status_address_t index, value32_t *value, int n);
+
 
 /**
  * Sets a status/config variable by index by name
@@ -127,6 +211,14 @@ int dat_set_system_var_name(char *name, value32_t value);
  */
 int dat_get_system_var(dat_status_address_t index);
 int _dat_get_system_var(dat_status_address_t index);
+
+/**
+ * Function for testing the status variables cache.
+ *
+ * @return Number of status variables changed since the last flush, always 0
+ * if they are in RAM
+ */
+int _dat_get_dirty_vars(void);
 value32_t dat_get_status_var(dat_status_address_t index);
 
 /**
@@ -137,6 +229,28 @@ value32_t dat_get_status_var(dat_status_address_t index);
  */
 value32_t dat_get_status_var_name(char *name);
 
+/**
+ * Returns all the status/config variables at once, all from the same update,
+ * see @c dat_get_status_vars. With external storage, the variables not cached
+ * yet are read with a single query.
+ *
+ * @param out Array of dat_status_last_address values, indexed by address
+ * @return 0 if OK, -1 in case of error
+ */
+int dat_get_status_snapshot(value32_t *out);
+
+/**
+ * Returns @n consecutive status/config variables, all from the same update.
+ * In RAM mode readers do not take the repository lock (seqlock), they only
+ * wait if writers keep changing the repository.
+ *
+ * @param index Index of the first variable
+ * @param out Array of @n values
+ * @param n Number of variables
+ * @return 0 if OK, -1 in case of error
+ */
+int dat_get_status_vars(dat_status_address_t index, value32_t *out, int n);
+
 
 /**
  * Gets an executable command from the flight plan repo.
@@ -230,7 +344,9 @@ int dat_set_time(int new_time);
 int dat_show_time(int format);
 
 /**
- * Adds a data struct to they payload table.
+ * Adds a data struct to they payload table. If the oldest memory section of
+ * the payload is reclaimed (@see SCH_STORAGE_RING) and it had samples not yet
+ * acknowledged, the ack index is moved to the oldest sample kept.
  *
  * @param data Pointer to the struct to add
  * @param payload Payload id to store
@@ -258,7 +374,32 @@ int dat_get_payload_sample(void*data, int payload, int index);
 int dat_get_recent_payload_sample(void* data, int payload, int offset);
 
 /**
- * Deletes all memory sections in NOR FLASH.
+ * Gets @count consecutive data structs from the payload table, starting at
+ * index @from, with one storage access. Use it instead of a loop of
+ * @dat_get_payload_sample to read many samples.
+ *
+ * @param payload Payload id to get
+ * @param from Index of the first sample
+ * @param count Max number of samples to read
+ * @param out Array of at least @count structs to store the samples
+ * @return Number of consecutive samples read, up to the last sample stored,
+ * -1 if an error occurred
+ */
+int dat_get_payload_range(int payload, int from, int count, void *out);
+
+/**
+ * Gets the index of the oldest sample of a payload still stored. Samples are
+ * kept from this index up to the payload index (sys_index), the older ones
+ * were discarded to reclaim their memory section.
+ *
+ * @param payload Payload id
+ * @return Index of the oldest sample, 0 if none was discarded
+ */
+int dat_get_payload_first(int payload);
+
+/**
+ * Deletes all memory sections in NOR FLASH. The payloads index and ack
+ * index are set to 0.
  *
  * @return 0 if OK, -1 if an error occurred
  */
@@ -274,42 +415,50 @@ int dat_delete_memory_sections(void);
 int dat_print_payload_struct(void* data, unsigned int payload);
 
 /**
- * Helper function to get var results in payload struct
+ * Helper function to get one payload field value as string. Empty float
+ * samples (all bits set) are printed as 'nan'.
  *
- * @param tok_sym
- * @param tok_var
- * @param order
- * @param var_names
- * @param i
- * @return 0 if OK, -1 if and error occurred
+ * @param ret_string Buffer to store the string, at least 48 bytes
+ * @param field Field descriptor, @see dat_get_payload_fields
+ * @param data Pointer to the payload struct
  */
-int get_payloads_tokens(char** tok_sym, char** tok_var, char* order, char* var_names, int i);
+void get_value_string(char* ret_string, const dat_payload_field_t *field, const void* data);
 
 /**
- * Helper function to get value as string in payload struct
- *
- * @param ret_string
- * @param c_type
- * @param buff
+ * Read a status group (@see DAT_STATUS_GROUPS), all the values from the same
+ * update and at double precision. Does not take the lock unless a writer
+ * keeps updating the groups.
+ *
+ * @code
+ * quaternion_t q;
+ * dat_get_group(dat_grp_ads_attitude, q.q);
+ * @endcode
+ *
+ * @param group Group address
+ * @param value Array to store the group values, of the group size
+ * @return 0 if OK, -1 if the group does not exist
  */
-void get_value_string(char* ret_string, char* c_type, char* buff);
+int dat_get_group(dat_group_address_t group, double *value);
 
 /**
- *  Helper function to get size of variable in payload struct
- *
- * @param c_type
- * @return
+ * Write a status group, readers see all the new values or none. The float
+ * copy of the group in the status variables, if any, is also updated (and
+ * its subscribers notified). Setting one of these status variables directly
+ * updates the group value, at float precision.
+ *
+ * @param group Group address
+ * @param value Array of values, of the group size
+ * @return 0 if OK, -1 if the group does not exist or the float copy could not
+ * be written
  */
-int get_sizeof_type(char* c_type);
+int dat_set_group(dat_group_address_t group, const double *value);
 
 /**
- * Auxiliary function to read/set vectors and queaternions.
- * These functions only read/set 3 (vector) or 4 (quaternions)
- * variables starting from the given index.
+ * Read all the status groups from the same update
+ *
+ * @param groups Stores the groups values
+ * @return 0 if OK
  */
-void _get_sat_quaterion(quaternion_t *q,  dat_status_address_t index);
-void _set_sat_quaterion(quaternion_t *q,  dat_status_address_t index);
-void _get_sat_vector(vector3_t *r, dat_status_address_t index);
-void _set_sat_vector(vector3_t *r, dat_status_address_t index);
+int dat_get_groups_snapshot(dat_groups_t *groups);
 
 #endif // DATA_REPO_H
@@ -24,11 +24,131 @@ typedef struct __attribute__((packed)) fp_entry {
     int periodical;             ///< Period of time between executions
 } fp_entry_t;
 
+/**
+ * List of status variables with name, type and default value, the single
+ * source of the status variables definitions. The address of each variable
+ * (dat_<name> in dat_status_address_t) is its position in this list, so a
+ * duplicated entry does not compile. Types are u: uint, d/i: int, f: float.
+ * The order of this list is also the order of the sta_data payload fields,
+ * add new variables at the end.
+ *
+ * @code
+ * #define X(name, type, status, value) ...
+ * DAT_STATUS_VARS(X)
+ * @endcode
+ */
+#define DAT_STATUS_VARS(X) \
+    /* OBC: On board computer related variables */                                                                                      \
+    X(obc_opmode,           d, DAT_IS_CONFIG, -1)          /* General operation mode */                                                 \
+    X(obc_last_reset,       u, DAT_IS_STATUS, 0)           /* Last reset source */                                                      \
+    X(obc_hrs_alive,        u, DAT_IS_STATUS, 0)           /* Hours since first boot */                                                 \
+    X(obc_hrs_wo_reset,     u, DAT_IS_STATUS, 0)           /* Hours since last reset */                                                 \
+    X(obc_reset_counter,    u, DAT_IS_STATUS, 0)           /* Number of reset since first boot */                                       \
+    X(obc_sw_wdt,           u, DAT_IS_STATUS, 0)           /* Software watchdog timer counter */                                        \
+    X(obc_temp_1,           f, DAT_IS_STATUS, -1)          /* Temperature value of the first sensor */                                  \
+    X(obc_temp_2,           f, DAT_IS_STATUS, -1)          /* Temperature value of the second sensor */                                 \
+    X(obc_temp_3,           f, DAT_IS_STATUS, -1)          /* Temperature value of the gyroscope */                                     \
+    X(obc_executed_cmds,    u, DAT_IS_STATUS, 0)           /* Total number of executed commands */                                      \
+    X(obc_failed_cmds,      u, DAT_IS_STATUS, 0)           /* Total number of failed commands */                                        \
+    /* DEP: Deployment related variables */                                                                                             \
+    X(dep_deployed,         u, DAT_IS_STATUS, 2)           /* Was the satellite deployed? */                                            \
+    X(dep_ant_deployed,     u, DAT_IS_STATUS, 1)           /* Was the antenna deployed? */                                              \
+    X(dep_date_time,        u, DAT_IS_STATUS, 0)           /* Antenna deployment unix time */                                           \
+    /* RTC: Rtc related variables */                                                                                                    \
+    X(rtc_date_time,        d, DAT_IS_CONFIG, -1)          /* RTC current unix time */                                                  \
+    /* COM: Communications system variables */                                                                                          \
+    X(com_count_tm,         u, DAT_IS_STATUS, 0)           /* Number of Telemetries sent */                                             \
+    X(com_count_tc,         u, DAT_IS_STATUS, 0)           /* Number of received Telecommands */                                        \
+    X(com_last_tc,          u, DAT_IS_STATUS, 0)           /* Unix time of the last received Telecommand */                             \
+    X(com_freq,             u, DAT_IS_CONFIG, SCH_TX_FREQ) /* Communications frequency [Hz] */                                          \
+    X(com_tx_pwr,           u, DAT_IS_CONFIG, SCH_TX_PWR)  /* TX power (0: 25dBm, 1: 27dBm, 2: 28dBm, 3: 30dBm) */                      \
+    X(com_baud,             u, DAT_IS_CONFIG, SCH_TX_BAUD) /* Baudrate [bps] */                                                         \
+    X(com_mode,             u, DAT_IS_CONFIG, 0)           /* Framing mode (1: RAW, 2: ASM, 3: HDLC, 4: Viterbi, 5: GOLAY, 6: AX25) */  \
+    X(com_bcn_period,       u, DAT_IS_CONFIG, SCH_TX_BCN_PERIOD) /* Number of seconds between trx beacon packets */                     \
+    X(obc_bcn_offset,       u, DAT_IS_CONFIG, SCH_OBC_BCN_OFFSET) /* Number of seconds between obc beacon packets */                    \
+    /* FPL: Flight plan related variables */                                                                                            \
+    X(fpl_last,             u, DAT_IS_STATUS, 0)           /* Last executed flight plan (unix time) */                                  \
+    X(fpl_queue,            u, DAT_IS_STATUS, 0)           /* Flight plan queue length */                                               \
+    /* ADS: Altitude determination system */                                                                                            \
+    X(ads_omega_x,          f, DAT_IS_STATUS, -1)          /* Gyroscope acceleration value along the x axis */                          \
+    X(ads_omega_y,          f, DAT_IS_STATUS, -1)          /* Gyroscope acceleration value along the y axis */                          \
+    X(ads_omega_z,          f, DAT_IS_STATUS, -1)          /* Gyroscope acceleration value along the z axis */                          \
+    X(tgt_omega_x,          f, DAT_IS_CONFIG, 0)           /* Target acceleration value along the x axis */                             \
+    X(tgt_omega_y,          f, DAT_IS_CONFIG, 0)           /* Target acceleration value along the y axis */                             \
+    X(tgt_omega_z,          f, DAT_IS_CONFIG, 0)           /* Target acceleration value along the z axis */                             \
+    X(ads_mag_x,            f, DAT_IS_STATUS, -1)          /* Magnetometer value along the x axis */                                    \
+    X(ads_mag_y,            f, DAT_IS_STATUS, -1)          /* Magnetometer value along the y axis */                                    \
+    X(ads_mag_z,            f, DAT_IS_STATUS, -1)          /* Magnetometer value along the z axis */                                    \
+    X(ads_pos_x,            f, DAT_IS_STATUS, -1)          /* Satellite orbit position x (ECI) */                                       \
+    X(ads_pos_y,            f, DAT_IS_STATUS, -1)          /* Satellite orbit position y (ECI) */                                       \
+    X(ads_pos_z,            f, DAT_IS_STATUS, -1)          /* Satellite orbit position z (ECI) */                                       \
+    X(ads_tle_epoch,        u, DAT_IS_STATUS, 0)           /* Current TLE epoch, 0 if TLE is invalid */                                 \
+    X(ads_tle_last,         u, DAT_IS_STATUS, 0)           /* Las time position was propagated */                                       \
+    X(ads_q0,               f, DAT_IS_STATUS, -1)          /* Attitude quaternion (Inertial to body) */                                 \
+    X(ads_q1,               f, DAT_IS_STATUS, -1)          /* Attitude quaternion (Inertial to body) */                                 \
+    X(ads_q2,               f, DAT_IS_STATUS, -1)          /* Attitude quaternion (Inertial to body) */                                 \
+    X(ads_q3,               f, DAT_IS_STATUS, -1)          /* Attitude quaternion (Inertial to body) */                                 \
+    X(tgt_q0,               f, DAT_IS_CONFIG, 0)           /* Target quaternion (Inertial to body) */                                   \
+    X(tgt_q1,               f, DAT_IS_CONFIG, 0)           /* Target quaternion (Inertial to body) */                                   \
+    X(tgt_q2,               f, DAT_IS_CONFIG, 0)           /* Target quaternion (Inertial to body) */                                   \
+    X(tgt_q3,               f, DAT_IS_CONFIG, 0)           /* Target quaternion (Inertial to body) */                                   \
+    /* EPS: Energy power system */                                                                                                      \
+    X(eps_vbatt,            u, DAT_IS_STATUS, 0)           /* Voltage of the battery [mV] */                                            \
+    X(eps_cur_sun,          u, DAT_IS_STATUS, 0)           /* Current from boost converters [mA] */                                     \
+    X(eps_cur_sys,          u, DAT_IS_STATUS, 0)           /* Current from the battery [mA] */                                          \
+    X(eps_temp_bat0,        u, DAT_IS_STATUS, 0)           /* Battery temperature sensor */                                             \
+    /* Memory: Current payload memory addresses */                                                                                      \
+    X(drp_temp,             u, DAT_IS_STATUS, 0)           /* Temperature data index */                                                 \
+    X(drp_ads,              u, DAT_IS_STATUS, 0)           /* ADS data index */                                                         \
+    X(drp_eps,              u, DAT_IS_STATUS, 0)           /* EPS data index */                                                         \
+    X(drp_sta,              u, DAT_IS_STATUS, 0)           /* Status data index */                                                      \
+    X(drp_stt,              u, DAT_IS_STATUS, 0)           /* STT data index */                                                         \
+    X(drp_stt_exp_time,     u, DAT_IS_STATUS, 0)           /* STT data exposure time index */                                           \
+    /* Memory: Current send acknowledge data */                                                                                         \
+    X(drp_ack_temp,         u, DAT_IS_CONFIG, 0)           /* Temperature data acknowledge */                                           \
+    X(drp_ack_ads,          u, DAT_IS_CONFIG, 0)           /* ADS data index acknowledge */                                             \
+    X(drp_ack_eps,          u, DAT_IS_CONFIG, 0)           /* EPS data index acknowledge */                                             \
+    X(drp_ack_sta,          u, DAT_IS_CONFIG, 0)           /* Status data index acknowledge */                                          \
+    X(drp_ack_stt,          u, DAT_IS_CONFIG, 0)           /* STT data index acknowledge */                                             \
+    X(drp_ack_stt_exp_time, u, DAT_IS_CONFIG, 0)           /* STT data exposure time index acknowledge */                               \
+    /* Sample Machine: Current state of sample status_machine */                                                                        \
+    X(drp_mach_action,      u, DAT_IS_STATUS, 0)           /* Current action of sampling state machine */                               \
+    X(drp_mach_state,       u, DAT_IS_STATUS, 0)           /* Current state of sampling state machine */                                \
+    X(drp_mach_step,        d, DAT_IS_CONFIG, 0)           /* Step in seconds of sampling state machine */                              \
+    X(drp_mach_payloads,    u, DAT_IS_CONFIG, 0)           /* Binary data storing active payload being sampled */                       \
+    X(drp_mach_left,        u, DAT_IS_STATUS, 0)           /* Samples left for sampling state machine */                                \
+    /* CMD: Commands repository */                                                                                                      \
+    X(obc_cmd_pool_max,     u, DAT_IS_STATUS, 0)           /* Max commands allocated at the same time */                                \
+    X(obc_cmd_pool_fail,    u, DAT_IS_STATUS, 0)           /* Commands not created because the pool was exhausted */                    \
+    X(obc_par_pool_max,     u, DAT_IS_STATUS, 0)           /* Max parameters buffers allocated at the same time */                      \
+    X(obc_par_pool_fail,    u, DAT_IS_STATUS, 0)           /* Parameters not created because the pools were exhausted */                \
+    /* DIS: Dispatcher priority levels (in cmd_prio_t order) */                                                                         \
+    X(obc_queue_max_crit,   u, DAT_IS_STATUS, 0)           /* Max commands waiting in the critical priority level */                    \
+    X(obc_queue_max_high,   u, DAT_IS_STATUS, 0)           /* Max commands waiting in the high priority level */                        \
+    X(obc_queue_max_norm,   u, DAT_IS_STATUS, 0)           /* Max commands waiting in the normal priority level */                      \
+    X(obc_queue_max_low,    u, DAT_IS_STATUS, 0)           /* Max commands waiting in the low priority level */                         \
+    X(obc_queue_drop_crit,  u, DAT_IS_STATUS, 0)           /* Commands rejected by cmd_try_send, critical priority level full */        \
+    X(obc_queue_drop_high,  u, DAT_IS_STATUS, 0)           /* Commands rejected by cmd_try_send, high priority level full */            \
+    X(obc_queue_drop_norm,  u, DAT_IS_STATUS, 0)           /* Commands rejected by cmd_try_send, normal priority level full */          \
+    X(obc_queue_drop_low,   u, DAT_IS_STATUS, 0)           /* Commands rejected by cmd_try_send, low priority level full */             \
+    /* EXE: Commands deadlines and execution budgets */                                                                                 \
+    X(obc_cmd_expired,      u, DAT_IS_STATUS, 0)           /* Commands dropped because their deadline passed in the dispatcher queue */ \
+    X(obc_cmd_overruns,     u, DAT_IS_STATUS, 0)           /* Commands that exceeded their execution budget */                          \
+    X(obc_cmd_last_overrun, i, DAT_IS_STATUS, -1)          /* Id of the last command that exceeded its execution budget */              \
+    X(obc_cmd_coalesced,    u, DAT_IS_STATUS, 0)           /* Commands dropped because an identical command was pending */              \
+    X(obc_cmd_rejected,     u, DAT_IS_STATUS, 0)           /* Commands rejected by the admission rules */                               \
+    /* DRP: Status repository scrubbing */                                                                                              \
+    X(drp_tmr_repairs,      u, DAT_IS_STATUS, 0)           /* Status variables copies repaired by the scrub (tripled writing) */
+
+///< A dat_status_address_t constant from a DAT_STATUS_VARS entry
+#define DAT_STATUS_VAR_ENUM(name, type, status, value) dat_##name,
+
 /**
  * Enum constants for dynamically identifying system status fields at execution time.
  *
  * Also permits adding new status variables cheaply, by generalizing both the
- * dat_set_system_var and dat_get_system_var functions.
+ * dat_set_system_var and dat_get_system_var functions. The constants are
+ * generated from DAT_STATUS_VARS, add new variables there.
  *
  * The dat_status_last_address constant serves only for comparison when looping through all
  * system status values. For example:
@@ -45,97 +165,7 @@ typedef struct __attribute__((packed)) fp_entry {
  * @seealso dat_get_system_var
  */
 typedef enum dat_status_address_enum {
-    /// OBC: On board computer related variables.
-    dat_obc_opmode = 0,           ///< General operation mode
-    dat_obc_last_reset,           ///< Last reset source
-    dat_obc_hrs_alive,            ///< Hours since first boot
-    dat_obc_hrs_wo_reset,         ///< Hours since last reset
-    dat_obc_reset_counter,        ///< Number of reset since first boot
-    dat_obc_sw_wdt,               ///< Software watchdog timer counter
-    dat_obc_temp_1,               ///< Temperature value of the first sensor
-    dat_obc_temp_2,               ///< Temperature value of the second sensor
-    dat_obc_temp_3,               ///< Temperature value of the gyroscope
-    dat_obc_executed_cmds,        ///< Total number of executed commands
-    dat_obc_failed_cmds,          ///< Total number of failed commands
-
-    /// DEP: Deployment related variables.
-    dat_dep_deployed,             ///< Was the satellite deployed?
-    dat_dep_ant_deployed,         ///< Was the antenna deployed?
-    dat_dep_date_time,            ///< Antenna deployment unix time
-
-    /// RTC: Rtc related variables
-    dat_rtc_date_time,            ///< RTC current unix time
-
-    /// COM: Communications system variables.
-    dat_com_count_tm,             ///< Number of Telemetries sent
-    dat_com_count_tc,             ///< Number of received Telecommands
-    dat_com_last_tc,              ///< Unix time of the last received Telecommand
-    dat_com_freq,                 ///< Communications frequency [Hz]
-    dat_com_tx_pwr,               ///< TX power (0: 25dBm, 1: 27dBm, 2: 28dBm, 3: 30dBm)
-    dat_com_baud,                 ///< Baudrate [bps]
-    dat_com_mode,                 ///< Framing mode (1: RAW, 2: ASM, 3: HDLC, 4: Viterbi, 5: GOLAY, 6: AX25)
-    dat_com_bcn_period,           ///< Number of seconds between trx beacon packets
-    dat_obc_bcn_offset,           ///< Number of seconds between obc beacon packets
-
-    /// FPL: Flight plan related variables
-    dat_fpl_last,                 ///< Last executed flight plan (unix time)
-    dat_fpl_queue,                ///< Flight plan queue length
-
-    /// ADS: Altitude determination system
-    dat_ads_omega_x,              ///< Gyroscope acceleration value along the x axis
-    dat_ads_omega_y,              ///< Gyroscope acceleration value along the y axis
-    dat_ads_omega_z,              ///< Gyroscope acceleration value along the z axis
-    dat_tgt_omega_x,              ///< Target acceleration value along the x axis
-    dat_tgt_omega_y,              ///< Target acceleration value along the y axis
-    dat_tgt_omega_z,              ///< Target acceleration value along the z axis
-    dat_ads_mag_x,                ///< Magnetometer value along the x axis
-    dat_ads_mag_y,                ///< Magnetometer value along the y axis
-    dat_ads_mag_z,                ///< Magnetometer value along the z axis
-    dat_ads_pos_x,                ///< Satellite orbit position x (ECI)
-    dat_ads_pos_y,                ///< Satellite orbit position y (ECI)
-    dat_ads_pos_z,                ///< Satellite orbit position z (ECI)
-    dat_ads_tle_epoch,            ///< Current TLE epoch, 0 if TLE is invalid
-    dat_ads_tle_last,             ///< Las time position was propagated
-    dat_ads_q0,                   ///< Attitude quaternion (Inertial to body)
-    dat_ads_q1,                   ///< Attitude quaternion (Inertial to body)
-    dat_ads_q2,                   ///< Attitude quaternion (Inertial to body)
-    dat_ads_q3,                   ///< Attitude quaternion (Inertial to body)
-    dat_tgt_q0,                   ///< Target quaternion (Inertial to body)
-    dat_tgt_q1,                   ///< Target quaternion (Inertial to body)
-    dat_tgt_q2,                   ///< Target quaternion (Inertial to body)
-    dat_tgt_q3,                   ///< Target quaternion (Inertial to body)
-
-    /// EPS: Energy power system
-    dat_eps_vbatt,                ///< Voltage of the battery [mV]
-    dat_eps_cur_sun,              ///< Current from boost converters [mA]
-    dat_eps_cur_sys,              ///< Current from the battery [mA]
-    dat_eps_temp_bat0,            ///< Battery temperature sensor
-
-    /// Memory: Current payload memory addresses
-    dat_drp_temp,                 ///< Temperature data index
-    dat_drp_ads,                  ///< ADS data index
-    dat_drp_eps,                  ///< EPS data index
-    dat_drp_sta,                 ///< Status data index
-    dat_drp_stt,
-    dat_drp_stt_exp_time,
-
-    /// Memory: Current send acknowledge data
-    dat_drp_ack_temp,             ///< Temperature data acknowledge
-    dat_drp_ack_ads,              ///< ADS data index acknowledge
-    dat_drp_ack_eps,              ///< EPS data index acknowledge
-    dat_drp_ack_sta,             ///< Status data index acknowledge
-    dat_drp_ack_stt,
-    dat_drp_ack_stt_exp_time,
-
-    /// Sample Machine: Current state of sample status_machine
-    dat_drp_mach_action,          ///< Current action of sampling state machine
-    dat_drp_mach_state,           ///< Current state of sampling state machine
-    dat_drp_mach_step,            ///< Step in seconds of sampling state machine
-    dat_drp_mach_payloads,        ///< Binary data storing active payload being sampled
-    dat_drp_mach_left,            ///< Samples left for sampling state machine
-
-    /// Add a new status variables address here
-    //dat_custom,                 ///< Variable description
+    DAT_STATUS_VARS(DAT_STATUS_VAR_ENUM)
 
     /// LAST ELEMENT: DO NOT EDIT
     dat_status_last_address           ///< Dummy element, the amount of status variables
@@ -184,84 +214,87 @@ typedef struct __attribute__((packed)) dat_sys_var_short {
     value32_t value;    ///< Variable default value
 } dat_sys_var_short_t;
 
+#define DAT_TYPE_u 'u'
+#define DAT_TYPE_d 'd'
+#define DAT_TYPE_i 'i'
+#define DAT_TYPE_f 'f'
+#define DAT_FMT_u "%u"
+#define DAT_FMT_d "%d"
+#define DAT_FMT_i "%d"
+#define DAT_FMT_f "%f"
+
+///< A dat_sys_var_t initializer from a DAT_STATUS_VARS entry
+#define DAT_STATUS_VAR_DEF(name, type, status, value) {dat_##name, #name, DAT_TYPE_##type, status, {value}},
+///< A sta_data field name from a DAT_STATUS_VARS entry
+#define DAT_STATUS_VAR_NAME(name, type, status, value) " " #name
+///< A sta_data field format from a DAT_STATUS_VARS entry
+#define DAT_STATUS_VAR_FMT(name, type, status, value) " " DAT_FMT_##type
+
 /**
  * List of status variables with address, name, type and default values
  * This list is useful to decide how to store and send the status variables
  */
 static const dat_sys_var_t dat_status_list[] = {
-        {dat_obc_last_reset,    "obc_last_reset",    'u', DAT_IS_STATUS, 0},         ///< Last reset source
-        {dat_obc_hrs_alive,     "obc_hrs_alive",     'u', DAT_IS_STATUS, 0},          ///< Hours since first boot
-        {dat_obc_hrs_wo_reset,  "obc_hrs_wo_reset",  'u', DAT_IS_STATUS, 0},          ///< Hours since last reset
-        {dat_obc_reset_counter, "obc_reset_counter", 'u', DAT_IS_STATUS, 0},          ///< Number of reset since first boot
-        {dat_obc_sw_wdt,        "obc_sw_wdt",        'u', DAT_IS_STATUS, 0},          ///< Software watchdog timer counter
-        {dat_obc_temp_1,        "obc_temp_1",        'f', DAT_IS_STATUS, -1},         ///< Temperature value of the first sensor
-        {dat_obc_temp_2,        "obc_temp_2",        'f', DAT_IS_STATUS, -1},         ///< Temperature value of the second sensor
-        {dat_obc_temp_3,        "obc_temp_3",        'f', DAT_IS_STATUS, -1},         ///< Temperature value of the gyroscope
-        {dat_obc_executed_cmds, "obc_executed_cmds", 'u', DAT_IS_STATUS, 0},
-        {dat_obc_failed_cmds,   "obc_failed_cmds",   'u', DAT_IS_STATUS, 0},
-        {dat_dep_deployed,      "dep_deployed",      'u', DAT_IS_STATUS, 2},          ///< Was the satellite deployed?
-        {dat_dep_ant_deployed,  "dep_ant_deployed",  'u', DAT_IS_STATUS, 1},          ///< Was the antenna deployed?
-        {dat_dep_date_time,     "dep_date_time",     'u', DAT_IS_STATUS, 0},         ///< Antenna deployment unix time
-        {dat_com_count_tm,      "com_count_tm",      'u', DAT_IS_STATUS, 0},          ///< Number of Telemetries sent
-        {dat_com_count_tc,      "com_count_tc",      'u', DAT_IS_STATUS, 0},          ///< Number of received Telecommands
-        {dat_com_last_tc,       "com_last_tc",       'u', DAT_IS_STATUS, 0},         ///< Unix time of the last received Telecommand
-        {dat_fpl_last,          "fpl_last",          'u', DAT_IS_STATUS, 0},          ///< Last executed flight plan (unix time)
-        {dat_fpl_queue,         "fpl_queue",         'u', DAT_IS_STATUS, 0},          ///< Flight plan queue length
-        {dat_ads_omega_x,       "ads_omega_x",       'f', DAT_IS_STATUS, -1},         ///< Gyroscope acceleration value along the x axis
-        {dat_ads_omega_y,       "ads_omega_y",       'f', DAT_IS_STATUS, -1},         ///< Gyroscope acceleration value along the y axis
-        {dat_ads_omega_z,       "ads_omega_z",       'f', DAT_IS_STATUS, -1},         ///< Gyroscope acceleration value along the z axis
-        {dat_ads_mag_x,         "ads_mag_x",         'f', DAT_IS_STATUS, -1},         ///< Magnetometer value along the x axis
-        {dat_ads_mag_y,         "ads_mag_y",         'f', DAT_IS_STATUS, -1},         ///< Magnetometer value along the y axis
-        {dat_ads_mag_z,         "ads_mag_z",         'f', DAT_IS_STATUS, -1},         ///< Magnetometer value along the z axis
-        {dat_ads_pos_x,         "ads_pos_x",         'f', DAT_IS_STATUS, -1},         ///< Satellite orbit position x (ECI)
-        {dat_ads_pos_y,         "ads_pos_y",         'f', DAT_IS_STATUS, -1},         ///< Satellite orbit position y (ECI)
-        {dat_ads_pos_z,         "ads_pos_z",         'f', DAT_IS_STATUS, -1},         ///< Satellite orbit position z (ECI)
-        {dat_ads_tle_epoch,     "ads_tle_epoch",     'u', DAT_IS_STATUS, 0},         ///< Current TLE epoch, 0 if TLE is invalid
-        {dat_ads_tle_last,      "ads_tle_last",      'u', DAT_IS_STATUS, 0},         ///< Last time position was propagated
-        {dat_ads_q0,            "ads_q0",            'f', DAT_IS_STATUS, -1},         ///< Attitude quaternion (Inertial to body)
-        {dat_ads_q1,            "ads_q1",            'f', DAT_IS_STATUS, -1},         ///< Attitude quaternion (Inertial to body)
-        {dat_ads_q2,            "ads_q2",            'f', DAT_IS_STATUS, -1},         ///< Attitude quaternion (Inertial to body)
-        {dat_ads_q3,            "ads_q3",            'f', DAT_IS_STATUS, -1},         ///< Attitude quaternion (Inertial to body)
-        {dat_eps_vbatt,         "eps_vbatt",         'u', DAT_IS_STATUS, 0},         ///< Voltage of the battery [mV]
-        {dat_eps_cur_sun,       "eps_cur_sun",       'u', DAT_IS_STATUS, 0},         ///< Current from boost converters [mA]
-        {dat_eps_cur_sys,       "eps_cur_sys",       'u', DAT_IS_STATUS, 0},         ///< Current from the battery [mA]
-        {dat_eps_temp_bat0,     "eps_temp_bat0",     'u', DAT_IS_STATUS, 0},         ///< Battery temperature sensor
-        {dat_drp_temp,          "drp_temp",          'u', DAT_IS_STATUS, 0},          ///< Temperature data index
-        {dat_drp_ads,           "drp_ads",           'u', DAT_IS_STATUS, 0},          ///< ADS data index
-        {dat_drp_eps,           "drp_eps",           'u', DAT_IS_STATUS, 0},          ///< EPS data index
-        {dat_drp_sta,           "drp_sta",           'u', DAT_IS_STATUS, 0},          ///< Status data index
-        {dat_drp_stt,           "drp_stt",           'u', DAT_IS_STATUS, 0},          ///< STT data index
-        {dat_drp_stt_exp_time,  "drp_stt_exp_time",  'u', DAT_IS_STATUS, 0},          ///< STT data exposure time index
-        {dat_drp_mach_action,   "drp_mach_action",   'u', DAT_IS_STATUS, 0},          ///<
-        {dat_drp_mach_state,    "drp_mach_state",    'u', DAT_IS_STATUS, 0},          ///<
-        {dat_drp_mach_left,     "drp_mach_left",     'u', DAT_IS_STATUS, 0},          ///<
-        {dat_obc_opmode,        "obc_opmode",        'd', DAT_IS_CONFIG, -1},          ///< General operation mode
-        {dat_rtc_date_time,     "rtc_date_time",     'd', DAT_IS_CONFIG, -1},          ///< RTC current unix time
-        {dat_com_freq,          "com_freq",          'u', DAT_IS_CONFIG, SCH_TX_FREQ},        ///< Communications frequency [Hz]
-        {dat_com_tx_pwr,        "com_tx_pwr",        'u', DAT_IS_CONFIG, SCH_TX_PWR},         ///< TX power (0: 25dBm, 1: 27dBm, 2: 28dBm, 3: 30dBm)
-        {dat_com_baud,          "com_baud",          'u', DAT_IS_CONFIG, SCH_TX_BAUD},        ///< Baudrate [bps]
-        {dat_com_mode,          "com_mode",          'u', DAT_IS_CONFIG, 0},          ///< Framing mode (1: RAW, 2: ASM, 3: HDLC, 4: Viterbi, 5: GOLAY, 6: AX25)
-        {dat_com_bcn_period,    "com_bcn_period",    'u', DAT_IS_CONFIG, SCH_TX_BCN_PERIOD},  ///< Number of seconds between trx beacon packets
-        {dat_obc_bcn_offset,    "obc_bcn_offset",    'u', DAT_IS_CONFIG, SCH_OBC_BCN_OFFSET}, ///< Number of seconds between obc beacon packets
-        {dat_tgt_omega_x,       "tgt_omega_x",       'f', DAT_IS_CONFIG, 0},          ///< Target acceleration value along the x axis
-        {dat_tgt_omega_y,       "tgt_omega_y",       'f', DAT_IS_CONFIG, 0},          ///< Target acceleration value along the y axis
-        {dat_tgt_omega_z,       "tgt_omega_z",       'f', DAT_IS_CONFIG, 0},          ///< Target acceleration value along the z axis
-        {dat_tgt_q0,            "tgt_q0",            'f', DAT_IS_CONFIG, 0},          ///< Target quaternion (Inertial to body)
-        {dat_tgt_q1,            "tgt_q1",            'f', DAT_IS_CONFIG, 0},          ///< Target quaternion (Inertial to body)
-        {dat_tgt_q2,            "tgt_q2",            'f', DAT_IS_CONFIG, 0},          ///< Target quaternion (Inertial to body)
-        {dat_tgt_q3,            "tgt_q3",            'f', DAT_IS_CONFIG, 0},          ///< Target quaternion (Inertial to body)
-        {dat_drp_ack_temp,      "drp_ack_temp",      'u', DAT_IS_CONFIG, 0},          ///< Temperature data acknowledge
-        {dat_drp_ack_ads,       "drp_ack_ads",       'u', DAT_IS_CONFIG, 0},          ///< ADS data index acknowledge
-        {dat_drp_ack_eps,       "drp_ack_eps",       'u', DAT_IS_CONFIG, 0},          ///< EPS data index acknowledge
-        {dat_drp_ack_sta,       "drp_ack_sta",       'u', DAT_IS_CONFIG, 0},          ///< Status data index acknowledge
-        {dat_drp_ack_stt,       "drp_ack_stt",       'u', DAT_IS_CONFIG, 0},          ///< Stt data index acknowledge
-        {dat_drp_ack_stt_exp_time, "drp_ack_stt_exp_time",'u', DAT_IS_CONFIG, 0},     ///< Stt data exp time index acknowledge
-        {dat_drp_mach_step,     "drp_mach_step",     'd', DAT_IS_CONFIG, 0},          ///<
-        {dat_drp_mach_payloads, "drp_mach_payloads", 'u', DAT_IS_CONFIG, 0}           ///<
+    DAT_STATUS_VARS(DAT_STATUS_VAR_DEF)
 };
-///< The dat_status_last_var constant serves for looping through all status variables
 static const int dat_status_last_var = sizeof(dat_status_list) / sizeof(dat_status_list[0]);
 
+/**
+ * List of status groups, vectors, quaternions and small matrices (the ADCS
+ * state) kept at double precision and always read and written as a whole
+ * (@see dat_get_group). The size is the number of doubles. A group with a
+ * mirror also keeps a float copy in the @size status variables from the
+ * mirror address, for the status telemetry and the permanent storage. Add new
+ * groups at the end.
+ *
+ * @code
+ * #define X(name, size, mirror) ...
+ * DAT_STATUS_GROUPS(X)
+ * @endcode
+ */
+#define DAT_GROUP_NO_MIRROR (-1)
+#define DAT_STATUS_GROUPS(X) \
+    X(ads_attitude,     4,  dat_ads_q0)                           \
+    X(ads_omega,        3,  dat_ads_omega_x)                      \
+    X(ads_mag,          3,  dat_ads_mag_x)                        \
+    X(ads_position,     3,  dat_ads_pos_x)                        \
+    X(tgt_attitude,     4,  dat_tgt_q0)                           \
+    X(tgt_omega,        3,  dat_tgt_omega_x)                      \
+    X(ads_eskf_p,       36, DAT_GROUP_NO_MIRROR)
+
+///< A dat_group_address_t constant from a DAT_STATUS_GROUPS entry
+#define DAT_GROUP_ADDR(name, size, mirror) dat_grp_##name,
+///< A dat_groups_t member from a DAT_STATUS_GROUPS entry
+#define DAT_GROUP_MEMBER(name, size, mirror) double name[size];
+
+/**
+ * Status groups addresses, dat_grp_<name> for each DAT_STATUS_GROUPS entry
+ */
+typedef enum dat_group_address_enum {
+    DAT_STATUS_GROUPS(DAT_GROUP_ADDR)
+    dat_group_last_address          ///< Dummy element, the amount of status groups
+} dat_group_address_t;
+
+/**
+ * All the status groups values, contiguous and without padding. It is also
+ * the layout of the groups telemetry (@see tm_send_groups).
+ */
+typedef struct dat_groups_s {
+    DAT_STATUS_GROUPS(DAT_GROUP_MEMBER)
+} dat_groups_t;
+#define DAT_GROUPS_LEN (sizeof(dat_groups_t) / sizeof(double))    ///< Number of doubles of all the groups
+
+/**
+ * A status group definition
+ */
+typedef struct dat_group_def_s {
+    uint16_t address;   ///< Group address
+    const char *name;   ///< Group name
+    uint16_t offset;    ///< Position of the first value in dat_groups_t, in doubles
+    uint16_t size;      ///< Number of values (doubles)
+    int16_t mirror;     ///< Address of the first float copy, or DAT_GROUP_NO_MIRROR
+} dat_group_def_t;
+
 /**
  * Enum constants for dynamically identifying payload fields at execution time.
  *
@@ -363,46 +396,95 @@ typedef struct __attribute__((__packed__)) stt_exp_time_data{
 }stt_exp_time_data_t;
 
 /**
- * Data Map Struct for data schema definition.
+ * Data Map Struct for data schema definition. The data_order formats and the
+ * var_names are compiled once into dat_payload_field_t descriptors, @see
+ * dat_get_payload_fields. Each payload keeps its samples in @sections memory
+ * sections of SCH_SIZE_PER_SECTION bytes, once they are full the oldest one
+ * is reclaimed (@see SCH_STORAGE_RING). The SQL tables are not bounded by
+ * @sections unless SCH_STORAGE_SQL_RETENTION is set.
  */
 typedef struct __attribute__((__packed__)) map {
     char table[30];
     uint16_t  size;
+    uint16_t sections;      ///< Memory sections to keep the samples (retention)
     uint32_t sys_index;
     uint32_t sys_ack;
     char * data_order;
     char *  var_names;
 } data_map_t;
 
-static char status_var_string[] = "sat_index timestamp obc_last_reset obc_hrs_alive obc_hrs_wo_reset obc_reset_counter "
-                                  "obc_sw_wdt obc_temp_1 obc_temp_2 obc_temp_3 obc_executed_cmds obc_failed_cmds "
-                                  "dep_deployed dep_ant_deployed dep_date_time com_count_tm com_count_tc com_last_tc "
-                                  "fpl_last fpl_queue ads_omega_x ads_omega_y ads_omega_z ads_mag_x ads_mag_y ads_mag_z "
-                                  "ads_pos_x ads_pos_y ads_pos_z ads_tle_epoch ads_tle_last ads_q0 ads_q1 ads_q2 ads_q3"
-                                  " eps_vbatt eps_cur_sun eps_cur_sys eps_temp_bat0 drp_temp drp_ads drp_eps drp_sta drp_stt drp_stt_exp_time"
-                                  "drp_mach_action drp_mach_state drp_mach_left obc_opmode rtc_date_time com_freq "
-                                  "com_tx_pwr com_baud com_mode com_bcn_period obc_bcn_offset tgt_omega_x tgt_omega_y "
-                                  "tgt_omega_z tgt_q0 tgt_q1 tgt_q2 tgt_q3 drp_ack_temp drp_ack_ads drp_ack_eps "
-                                  "drp_ack_sta drp_ack_stt dr_ack_stt_exp_time drp_mach_step drp_mach_payloads";
-
-static char status_var_types[] = "%u %u %u %u %u %u %u %f %f %f %u %u %u %u %u %u %u %u %u %u %f %f %f %f %f %f %f %f "
-                                 "%f %u %u %f %f %f %f %u %u %u %u %u %u %u %u %u %u %u %u %i %i %u %u %u %u %u %u %u %u %f "
-                                 "%f %f %f %f %f %f %u %u %u %u %u %u %u %i %u";
+///< sta_data field names and formats, in dat_status_list order
+static char status_var_string[] = "sat_index timestamp" DAT_STATUS_VARS(DAT_STATUS_VAR_NAME);
+static char status_var_types[] = "%u %u" DAT_STATUS_VARS(DAT_STATUS_VAR_FMT);
 
 static data_map_t data_map[] = {
-{"temp_data",      (uint16_t) (sizeof(temp_data_t)),dat_drp_temp,dat_drp_ack_temp, "%u %u %f %f %f",                   "sat_index timestamp obc_temp_1 obc_temp_2 obc_temp_3"},
-{ "ads_data",      (uint16_t) (sizeof(ads_data_t)), dat_drp_ads, dat_drp_ack_ads,  "%u %u %f %f %f %f %f %f",          "sat_index timestamp acc_x acc_y acc_z mag_x mag_y mag_z"},
-{ "eps_data",      (uint16_t) (sizeof(eps_data_t)), dat_drp_eps, dat_drp_ack_eps,  "%u %u %u %u %u %d %d %d %d %d %d", "sat_index timestamp cursun cursys vbatt temp1 temp2 temp3 temp4 temp5 temp6"},
-{"sta_data",       (uint16_t) (sizeof(sta_data_t)), dat_drp_sta, dat_drp_ack_sta, status_var_types, status_var_string},
-{"stt_data",       (uint16_t) (sizeof(stt_data_t)), dat_drp_stt, dat_drp_ack_stt, "%u %u %f %f %f %d %f", "sat_index timestamp ra dec roll time exec_time"},
-{"stt_exp_time",   (uint16_t) (sizeof(stt_exp_time_data_t)), dat_drp_stt_exp_time, dat_drp_ack_stt_exp_time, "%u %u %d %d", "sat_index timestamp exp_time n_stars"}
+{"temp_data",      (uint16_t) (sizeof(temp_data_t)), SCH_SECTIONS_PER_PAYLOAD, dat_drp_temp,dat_drp_ack_temp, "%u %u %f %f %f",                   "sat_index timestamp obc_temp_1 obc_temp_2 obc_temp_3"},
+{ "ads_data",      (uint16_t) (sizeof(ads_data_t)), SCH_SECTIONS_PER_PAYLOAD, dat_drp_ads, dat_drp_ack_ads,  "%u %u %f %f %f %f %f %f",          "sat_index timestamp acc_x acc_y acc_z mag_x mag_y mag_z"},
+{ "eps_data",      (uint16_t) (sizeof(eps_data_t)), SCH_SECTIONS_PER_PAYLOAD, dat_drp_eps, dat_drp_ack_eps,  "%u %u %u %u %u %d %d %d %d %d %d", "sat_index timestamp cursun cursys vbatt temp1 temp2 temp3 temp4 temp5 temp6"},
+{"sta_data",       (uint16_t) (sizeof(sta_data_t)), SCH_SECTIONS_PER_PAYLOAD, dat_drp_sta, dat_drp_ack_sta, status_var_types, status_var_string},
+{"stt_data",       (uint16_t) (sizeof(stt_data_t)), SCH_SECTIONS_PER_PAYLOAD, dat_drp_stt, dat_drp_ack_stt, "%u %u %f %f %f %d %f", "sat_index timestamp ra dec roll time exec_time"},
+{"stt_exp_time",   (uint16_t) (sizeof(stt_exp_time_data_t)), SCH_SECTIONS_PER_PAYLOAD, dat_drp_stt_exp_time, dat_drp_ack_stt_exp_time, "%u %u %d %d", "sat_index timestamp exp_time n_stars"}
 };
 
+/**
+ * A payload field (a table column), compiled from a data_map entry. Fields
+ * are packed in the payload struct in the data_order order. Formats are %u,
+ * %d (or %i) and %f, with the length modifiers hh (8 bits), h (16 bits), ll
+ * (64 bits) for integers and l for double, e.g. "%hu" is an uint16_t.
+ */
+typedef struct dat_payload_field_s {
+    char name[MAX_VAR_NAME];    ///< Field (column) name
+    char type;                  ///< u: unsigned int, d: int, f: float or double
+    uint8_t size;               ///< Size in bytes
+    uint16_t offset;            ///< Byte offset in the payload struct
+} dat_payload_field_t;
+
 /** The repository's name */
 #define DAT_REPO_SYSTEM "dat_system"    ///< Status variables table name
 
 /**
- * Search and return a status variable definition from dat_status_list by index or by name
+ * Build the name index of the status variables definitions. Called by
+ * dat_repo_init, before tasks start, otherwise on the first search by name.
+ */
+void dat_status_var_def_init(void);
+
+/**
+ * Compile the data_map schemas into payload fields descriptors. Called by
+ * dat_repo_init, before tasks start, otherwise on the first use of the fields.
+ */
+void dat_payload_schema_init(void);
+
+/**
+ * Return the fields of a payload, in the payload struct order
+ * @param payload Payload id
+ * @param nfields Stores the number of fields
+ * @return Array of @nfields fields, NULL if the payload does not exist
+ */
+const dat_payload_field_t *dat_get_payload_fields(int payload, int *nfields);
+
+/**
+ * Read a payload field from a payload struct, as an integer or as a real
+ * number, whatever the field size
+ * @param field Field descriptor
+ * @param data Payload struct
+ * @return Field value
+ */
+int64_t dat_get_payload_field_int(const dat_payload_field_t *field, const void *data);
+double dat_get_payload_field_real(const dat_payload_field_t *field, const void *data);
+
+/**
+ * Write a payload field to a payload struct, from an integer or from a real
+ * number, truncated to the field size
+ * @param field Field descriptor
+ * @param data Payload struct
+ * @param value Field value
+ */
+void dat_set_payload_field_int(const dat_payload_field_t *field, void *data, int64_t value);
+void dat_set_payload_field_real(const dat_payload_field_t *field, void *data, double value);
+
+/**
+ * Return a status variable definition by index (direct access) or by name
+ * (hashed access)
  * @param address Variable index
  * @param name Variable name
  * @return dat_sys_var_t or 0 if not found.
@@ -416,4 +498,11 @@ dat_sys_var_t dat_get_status_var_def_name(char *name);
  */
 void dat_print_system_var(dat_sys_var_t *status);
 
+/**
+ * Return a status group definition
+ * @param address Group address
+ * @return dat_group_def_t, with size 0 if not found
+ */
+dat_group_def_t dat_get_group_def(dat_group_address_t address);
+
 #endif //REPO_DATA_SCHEMA_H
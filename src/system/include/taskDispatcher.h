@@ -8,6 +8,21 @@
  * This task implements the dispatcher. Reads commands from queue, determines
  * if the commands is executable, asks to command repository the function to
  * send to taskExecuter. It's an event driven task.
+ *
+ * Commands are queued in one queue per priority level (cmd_prio_t). The
+ * dispatcher serves the highest level with pending commands, but a level
+ * skipped SCH_DISPATCHER_AGING times is served next, so low priority commands
+ * are delayed but not starved. Commands whose deadline passed while waiting
+ * are dropped (@see cmd_send_deadline), as are coalescible commands sent
+ * while an identical one is pending (@see cmd_set_coalesce). Expensive
+ * commands are rejected by the admission rules under low battery, some
+ * operation modes or overload (@see check_if_executable). A batch of commands (@see
+ * cmd_send_batch) is queued and dispatched as a single element.
+ *
+ * The dispatcher never blocks on a full executer class queue: the command is
+ * held and retried every SCH_DISPATCHER_RETRY_MS, and a priority level whose
+ * next command belongs to that class waits for it. Other classes and levels
+ * are still dispatched.
  */
 
 #ifndef T_DISPATCHER_H
@@ -17,11 +32,49 @@
 #include "globals.h"
 
 #include "osQueue.h"
+#include "osSemphr.h"
 
 #include "repoCommand.h"
 #include "repoData.h"
 
+/**
+ * Dispatcher queues usage, by priority level
+ */
+typedef struct dispatcher_stats{
+    int depth[CMD_PRIO_LAST];   ///< Commands currently waiting, a batch counts as one
+    int max[CMD_PRIO_LAST];     ///< Max commands waiting at the same time, a batch counts as one
+    int sent[CMD_PRIO_LAST];    ///< Commands queued
+    int drop[CMD_PRIO_LAST];    ///< Commands rejected because the level was full
+    int expired;                ///< Commands dropped because their deadline passed
+    int coalesced;              ///< Commands dropped because an identical command was pending
+    int rejected;               ///< Commands rejected by the admission rules
+} dispatcher_stats_t;
+
+/**
+ * Creates the dispatcher priority queues and resources. Must be called before
+ * sending commands and creating the dispatcher task.
+ *
+ * @return 0 if OK, -1 in case of errors
+ */
+int dispatcher_init(void);
+
+/**
+ * Get the dispatcher queues usage counters since dispatcher_init.
+ *
+ * @param stats dispatcher_stats_t *. Structure to fill
+ */
+void dispatcher_get_stats(dispatcher_stats_t *stats);
+
 void taskDispatcher(void *param);
+
+/**
+ * Admission control. Checks the command cost class against the admission
+ * rules (@see cmd_rule_t), compiled every SCH_ADMISSION_PERIOD_MS with the
+ * current dat_obc_opmode and dat_eps_vbatt, and the number of queued commands.
+ *
+ * @param newCmd cmd_t *. Command to dispatch
+ * @return 1 if the command can be executed, 0 if it is rejected
+ */
 int check_if_executable(cmd_t *newCmd);
 
 #endif
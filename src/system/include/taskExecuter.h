@@ -6,8 +6,23 @@
  * @copyright GNU GPL v3
  *
  * This task implements the executer module. Waits a message from dispatcher to
- * obtain the function and parameter to execute. When the function ends, send a
- * message to dispatcher with the result of the execution
+ * obtain the function and parameter to execute. When the function ends, the
+ * result is reported asynchronously (the dispatcher does not wait for it).
+ *
+ * Several executer tasks run in parallel: a pool of SCH_EXECUTER_WORKERS tasks
+ * serves CMD_CLASS_FREE commands and one task serves each serialized class, so
+ * commands of the same class are executed in order, one at a time.
+ *
+ * A batch of commands (@see cmd_send_batch) is sent to the queue of its first
+ * command class and the task of that class runs all its commands, in order,
+ * without interleaving other commands. The other commands of the batch are
+ * not serialized with the commands of their own class, send them as a
+ * separate command or batch to keep that guarantee.
+ *
+ * Commands running longer than their budget (@see cmd_set_budget) are counted
+ * in the dat_obc_cmd_overruns status variable. Commands that are still running
+ * are found by the watchdog task (@see cmd_check_budgets) and asked to stop,
+ * cancellation is cooperative (@see cmd_cancel_requested).
  */
 
 #ifndef T_EXECUTER_H
@@ -18,9 +33,66 @@
 #include "log_utils.h"
 
 #include "osQueue.h"
+#include "osThread.h"
+#include "osSemphr.h"
 
 #include "repoCommand.h"
+#include "repoData.h"
+
+/**
+ * Total number of executer tasks: the free class pool plus one task for each
+ * serialized class.
+ */
+#define EXECUTER_N_TASKS (SCH_EXECUTER_WORKERS + CMD_CLASS_LAST - 1)
+
+/**
+ * Creates the executer queues (one per command class) and resources. Must be
+ * called before creating the dispatcher and executer tasks.
+ *
+ * @return 0 if OK, -1 in case of errors
+ */
+int executer_init(void);
+
+/**
+ * Creates EXECUTER_N_TASKS executer tasks.
+ *
+ * @param threads_id os_thread array with at least EXECUTER_N_TASKS elements
+ * @return 0 if OK, -1 if some task was not created
+ *
+ * @code
+ *      os_thread executers_id[EXECUTER_N_TASKS];
+ *      executer_init();
+ *      executer_create_tasks(executers_id);
+ * @endcode
+ */
+int executer_create_tasks(os_thread *threads_id);
 
+/**
+ * Executer task. Reads commands from the executer queue of its class and
+ * executes them.
+ *
+ * @param param Pointer to the cmd_class_t served by this task, NULL means
+ *              CMD_CLASS_FREE.
+ */
 void taskExecuter(void *param);
 
+/**
+ * Executer queue that serves a command, unknown classes are served as
+ * CMD_CLASS_FREE.
+ *
+ * @param cmd Command to execute
+ * @return Command class, index of executer_cmd_queue
+ */
+int executer_class(cmd_t *cmd);
+
+/**
+ * Update the budget overruns status variables. Called by the executer tasks
+ * when a command finishes over budget and by the watchdog task when it finds
+ * commands still running over budget.
+ *
+ * @param cmd_id Int. Id of the last command that exceeded its budget
+ * @param count Int. Number of new overruns
+ */
+void executer_report_overrun(int cmd_id, int count);
+
 #endif
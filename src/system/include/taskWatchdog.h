@@ -21,6 +21,7 @@
 
 #include "repoCommand.h"
 #include "repoData.h"
+#include "taskExecuter.h"
 
 void taskWatchdog(void *param);
 
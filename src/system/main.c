@@ -46,26 +46,22 @@ int main(void)
     /* Init software subsystems */
     log_init(LOG_LEVEL, -1);      // Logging system
     cmd_repo_init(); // Command repository initialization
+    cmd_repo_freeze(); // Build the commands index, no more commands can be added
     dat_repo_init(); // Update status repository
 
     /* Initializing shared Queues */
-    dispatcher_queue = osQueueCreate(25,sizeof(cmd_t *));
-    executer_stat_queue = osQueueCreate(1,sizeof(int));
-    executer_cmd_queue = osQueueCreate(1,sizeof(cmd_t *));
+    if(dispatcher_init() != 0) LOGE(tag, "Error creating dispatcher queues");
+    if(executer_init() != 0) LOGE(tag, "Error creating executer queues");
 
-    if(dispatcher_queue == 0) LOGE(tag, "Error creating dispatcher queue");
-    if(executer_stat_queue == 0) LOGE(tag, "Error creating executer stat queue");
-    if(executer_cmd_queue == 0) LOGE(tag, "Error creating executer cmd queue");
-
-    int n_threads = 4;
+    int n_threads = 3 + EXECUTER_N_TASKS;
     os_thread threads_id[n_threads];
 
     LOGI(tag, "Creating basic tasks...");
     /* Crating system task (the others are created inside taskInit) */
     int t_inv_ok = osCreateTask(taskDispatcher,"invoker", SCH_TASK_DIS_STACK, NULL, 3, &threads_id[1]);
-    int t_exe_ok = osCreateTask(taskExecuter, "receiver", SCH_TASK_EXE_STACK, NULL, 4, &threads_id[2]);
+    int t_exe_ok = executer_create_tasks(&threads_id[3]);
     int t_wdt_ok = osCreateTask(taskWatchdog, "watchdog", SCH_TASK_WDT_STACK, NULL, 2, &threads_id[0]);
-    int t_ini_ok = osCreateTask(taskInit, "init", SCH_TASK_INI_STACK, NULL, 3, &threads_id[3]);
+    int t_ini_ok = osCreateTask(taskInit, "init", SCH_TASK_INI_STACK, NULL, 3, &threads_id[2]);
 
     /* Check if the task were created */
     if(t_inv_ok != 0) LOGE(tag, "Task invoker not created!");
@@ -18,6 +18,8 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <ctype.h>
+
 #include "repoCommand.h"
 
 const static char *tag = "repoCmd";
@@ -26,9 +28,133 @@ const static char *tag = "repoCmd";
 cmd_list_t cmd_list[SCH_CMD_MAX_ENTRIES];
 int cmd_index = 0;
 char cmd_is_sorted = 1;
+char cmd_is_frozen = 0;
+
+/* Frozen name index, see cmd_repo_freeze */
+#define CMD_HASH_MAX_SEEDS 64
+static int16_t cmd_hash_table[SCH_CMD_HASH_SIZE];
+static uint32_t cmd_hash_seed = 0;
+static int cmd_hash_max_probe = 0;
+
+static int cmd_find_idx(char *name);
+static uint32_t cmd_hash_str(const char *name, uint32_t seed);
+static int cmd_hash_build(uint32_t seed);
+
+/* Commands and parameters pools, see cmd_pool_init */
+#define CMD_POOL_LEN_S  (32)                            ///< Small parameters
+#if SCH_COMM_ENABLE
+#define CMD_POOL_LEN_M  (sizeof(com_data_t) > sizeof(com_frame_t) ? \
+                         sizeof(com_data_t) : sizeof(com_frame_t))  ///< Fits a com_frame_t or com_data_t
+#else
+#define CMD_POOL_LEN_M  (208)                           ///< Medium parameters
+#endif
+#define CMD_POOL_LEN_L  (CMD_ARGS_MAX_LEN > SCH_CMD_MAX_STR_PARAMS + 1 ? \
+                         CMD_ARGS_MAX_LEN : SCH_CMD_MAX_STR_PARAMS + 1)  ///< Fits the longest parameters
+#define CMD_POOL_WORDS(n, len) ((n) * (((len) + 7) / 8))
+
+typedef enum cmd_pool_id{
+    CMD_POOL_CMD = 0,
+    CMD_POOL_PAR_S,
+    CMD_POOL_PAR_M,
+    CMD_POOL_PAR_L,
+    CMD_POOL_LAST
+} cmd_pool_id_t;
+
+typedef struct cmd_pool{
+    uint8_t *buff;              ///< Pool memory
+    size_t len;                 ///< Size of each block (multiple of 8 bytes)
+    int n_blocks;               ///< Number of blocks
+    void *free_list;            ///< Linked list of free blocks
+    int used;                   ///< Number of blocks in use
+} cmd_pool_t;
+
+static uint64_t cmd_pool_buff_cmd[CMD_POOL_WORDS(SCH_CMD_POOL_CMDS, sizeof(cmd_t))];
+static uint64_t cmd_pool_buff_s[CMD_POOL_WORDS(SCH_CMD_POOL_PARAMS_S, CMD_POOL_LEN_S)];
+static uint64_t cmd_pool_buff_m[CMD_POOL_WORDS(SCH_CMD_POOL_PARAMS_M, CMD_POOL_LEN_M)];
+static uint64_t cmd_pool_buff_l[CMD_POOL_WORDS(SCH_CMD_POOL_PARAMS_L, CMD_POOL_LEN_L)];
+static cmd_pool_t cmd_pools[CMD_POOL_LAST];
+static cmd_pool_stats_t cmd_pool_stats;
+static osSemaphore cmd_pool_sem;
+
+static void cmd_pool_init(void);
+static void *cmd_pool_alloc(cmd_pool_id_t first, size_t len);
+static void cmd_pool_free(void *ptr);
+
+/* Commands execution statistics, see cmd_stats_record */
+static cmd_stats_t cmd_stats[SCH_CMD_MAX_ENTRIES];
+static osSemaphore cmd_stats_sem;
+static portTick cmd_stats_tick_hz;       ///< Ticks per second
+static const uint32_t cmd_stats_limits[CMD_STATS_BUCKETS-1] = {10, 100, 1000, 10000, 100000, 1000000, 10000000};
+
+static uint32_t cmd_stats_ticks_to_us(portTick ticks);
+
+/* Commands in execution, see cmd_check_budgets. One slot per executer task,
+ * plus one for other callers of cmd_execute (ex. the console) */
+#define CMD_RUNNING_MAX (SCH_EXECUTER_WORKERS + CMD_CLASS_LAST)
+
+typedef struct cmd_running{
+    cmd_t *cmd;                 ///< Command in execution, NULL if the slot is free
+    os_task_id task;            ///< Task executing the command
+    portTick t_start;           ///< Tick when the execution started
+    portTick budget;            ///< Command budget in ticks
+    int flagged;                ///< Budget exceeded, cancellation requested
+} cmd_running_t;
+
+static cmd_running_t cmd_running[CMD_RUNNING_MAX];
+static osSemaphore cmd_running_sem;
+
+/* Admission rules, see cmd_rules_compile */
+static cmd_rule_t cmd_rules[CMD_RULES_MAX];
+static osSemaphore cmd_rules_sem;
+
+static int cmd_running_start(cmd_t *cmd);
+static void cmd_running_stop(int slot, cmd_t *cmd);
+static int cmd_execute_handler(cmd_t *cmd);
+
+static int cmd_add_entry(char *name, cmdFunction function, cmdArgsFunction function_args,
+                         char *fparams, int nparam, cmd_class_t cls);
+static int cmd_args_parse(const cmd_fmt_desc_t *desc, const char *params, cmd_args_t *args);
+static int cmd_args_fill(const cmd_fmt_desc_t *desc, cmd_args_t *args, va_list ap);
+static int cmd_args_to_str(const cmd_fmt_desc_t *desc, const cmd_args_t *args, char *buff, size_t len);
+static cmd_args_t *cmd_args_store(const cmd_fmt_desc_t *desc, const cmd_args_t *tmp);
 
 int cmd_add(char *name, cmdFunction function, char *fparams, int nparam)
 {
+    return cmd_add_class(name, function, fparams, nparam, CMD_CLASS_FREE);
+}
+
+int cmd_add_class(char *name, cmdFunction function, char *fparams, int nparam, cmd_class_t cls)
+{
+    return cmd_add_entry(name, function, NULL, fparams, nparam, cls);
+}
+
+int cmd_add_typed(char *name, cmdArgsFunction function, char *fparams, cmd_class_t cls)
+{
+    cmd_fmt_desc_t desc;
+    int nargs = cmd_fmt_compile(fparams, &desc);
+    if (nargs < 0)
+    {
+        LOGE(tag, "Unable to add cmd: %s. Invalid typed format: %s", name, fparams);
+        return -1;
+    }
+    return cmd_add_entry(name, NULL, function, fparams, nargs, cls);
+}
+
+static int cmd_add_entry(char *name, cmdFunction function, cmdArgsFunction function_args,
+                         char *fparams, int nparam, cmd_class_t cls)
+{
+    if (cls < CMD_CLASS_FREE || cls >= CMD_CLASS_LAST)
+    {
+        LOGW(tag, "Invalid class %d for cmd: %s. Using CMD_CLASS_FREE", cls, name);
+        cls = CMD_CLASS_FREE;
+    }
+
+    if (cmd_is_frozen)
+    {
+        LOGW(tag, "Unable to add cmd: %s. Repository is frozen", name);
+        return -1;
+    }
+
     if (cmd_index < SCH_CMD_MAX_ENTRIES)
     {
         // Create new command
@@ -38,9 +164,16 @@ int cmd_add(char *name, cmdFunction function, char *fparams, int nparam)
         cmd_new.fmt = (char *)malloc(sizeof(char)*(l_fparams+1));
         strncpy(cmd_new.fmt, fparams, l_fparams+1);
         cmd_new.function = function;
+        cmd_new.function_args = function_args;
+        cmd_fmt_compile(fparams, &cmd_new.desc);
         cmd_new.name = (char *)malloc(sizeof(char)*(l_name+1));
         strncpy(cmd_new.name, name, l_name+1);
         cmd_new.nparams = nparam;
+        cmd_new.cls = cls;
+        cmd_new.prio = CMD_PRIO_NORMAL;
+        cmd_new.budget = SCH_CMD_BUDGET_MS;
+        cmd_new.coalesce = 0;
+        cmd_new.cost = CMD_COST_DEFAULT;
 
         // Copy to command buffer
         osSemaphoreTake(&repo_cmd_sem, portMAX_DELAY);
@@ -63,24 +196,148 @@ int cmd_add(char *name, cmdFunction function, char *fparams, int nparam)
     }
 }
 
-cmd_t * cmd_get_str(char *name)
+int cmd_set_prio(char *name, cmd_prio_t prio)
 {
-    cmd_t *cmd_new = NULL;
+    if(prio < CMD_PRIO_CRITICAL || prio >= CMD_PRIO_LAST || cmd_is_frozen)
+    {
+        LOGW(tag, "Unable to set priority %d to cmd: %s", prio, name);
+        return CMD_ERROR;
+    }
 
-    //Find inside command buffer
-    int i, ok;
-    for(i=0; i<SCH_CMD_MAX_ENTRIES; i++)
+    int idx = cmd_find_idx(name);
+    if(idx < 0)
     {
-        osSemaphoreTake(&repo_cmd_sem, portMAX_DELAY);
-        ok = strcmp(name, cmd_list[i].name);
-        osSemaphoreGiven(&repo_cmd_sem);
+        LOGW(tag, "Command not found: %s", name);
+        return CMD_ERROR;
+    }
 
-        if(ok == 0)
+    osSemaphoreTake(&repo_cmd_sem, portMAX_DELAY);
+    cmd_list[idx].prio = prio;
+    osSemaphoreGiven(&repo_cmd_sem);
+    return CMD_OK;
+}
+
+int cmd_set_budget(char *name, uint32_t budget_ms)
+{
+    if(cmd_is_frozen)
+    {
+        LOGW(tag, "Unable to set budget %lu to cmd: %s", (unsigned long)budget_ms, name);
+        return CMD_ERROR;
+    }
+
+    int idx = cmd_find_idx(name);
+    if(idx < 0)
+    {
+        LOGW(tag, "Command not found: %s", name);
+        return CMD_ERROR;
+    }
+
+    osSemaphoreTake(&repo_cmd_sem, portMAX_DELAY);
+    cmd_list[idx].budget = budget_ms;
+    osSemaphoreGiven(&repo_cmd_sem);
+    return CMD_OK;
+}
+
+int cmd_set_coalesce(char *name, int coalesce)
+{
+    if(cmd_is_frozen)
+    {
+        LOGW(tag, "Unable to set coalesce %d to cmd: %s", coalesce, name);
+        return CMD_ERROR;
+    }
+
+    int idx = cmd_find_idx(name);
+    if(idx < 0)
+    {
+        LOGW(tag, "Command not found: %s", name);
+        return CMD_ERROR;
+    }
+
+    osSemaphoreTake(&repo_cmd_sem, portMAX_DELAY);
+    cmd_list[idx].coalesce = coalesce != 0;
+    osSemaphoreGiven(&repo_cmd_sem);
+    return CMD_OK;
+}
+
+int cmd_set_cost(char *name, cmd_cost_t cost)
+{
+    if(cost < CMD_COST_DEFAULT || cost >= CMD_COST_LAST || cmd_is_frozen)
+    {
+        LOGW(tag, "Unable to set cost %d to cmd: %s", cost, name);
+        return CMD_ERROR;
+    }
+
+    int idx = cmd_find_idx(name);
+    if(idx < 0)
+    {
+        LOGW(tag, "Command not found: %s", name);
+        return CMD_ERROR;
+    }
+
+    osSemaphoreTake(&repo_cmd_sem, portMAX_DELAY);
+    cmd_list[idx].cost = cost;
+    osSemaphoreGiven(&repo_cmd_sem);
+    return CMD_OK;
+}
+
+int cmd_params_equal(cmd_t *a, cmd_t *b)
+{
+    if(a == NULL || b == NULL || a->id != b->id)
+        return 0;
+
+    // Typed arguments, compared by value
+    if(a->args != NULL || b->args != NULL)
+    {
+        if(a->args == NULL || b->args == NULL || a->args->nargs != b->args->nargs)
+            return 0;
+
+        int i, eq = 1;
+        for(i=0; i<a->args->nargs && eq; i++)
         {
-            // Create the command by index
-            cmd_new = cmd_get_idx(i);
-            break;
+            cmd_arg_t *x = &a->args->arg[i];
+            cmd_arg_t *y = &b->args->arg[i];
+            switch(a->desc->type[i])
+            {
+                case CMD_ARG_UINT: eq = x->u == y->u; break;
+                case CMD_ARG_LONG: eq = x->l == y->l; break;
+                case CMD_ARG_FLOAT: eq = x->f == y->f; break;
+                case CMD_ARG_DOUBLE: eq = x->d == y->d; break;
+                case CMD_ARG_STR:
+                case CMD_ARG_TAIL: eq = strcmp(x->s, y->s) == 0; break;
+                default: eq = x->i == y->i; break;
+            }
         }
+        return eq;
+    }
+
+    const char *pa = a->params == NULL ? "" : a->params;
+    const char *pb = b->params == NULL ? "" : b->params;
+    return strcmp(pa, pb) == 0;
+}
+
+void cmd_set_deadline(cmd_t *cmd, portTick deadline)
+{
+    if(cmd != NULL)
+        cmd->deadline = deadline != 0 ? deadline : 1;  // 0 means no deadline
+}
+
+int cmd_deadline_passed(cmd_t *cmd, portTick now)
+{
+    if(cmd == NULL || cmd->deadline == 0)
+        return 0;
+    return (int32_t)(now - cmd->deadline) > 0;
+}
+
+cmd_t * cmd_get_str(char *name)
+{
+    cmd_t *cmd_new = NULL;
+
+    //Find inside command buffer
+    int idx = cmd_find_idx(name);
+    if(idx >= 0)
+    {
+        // Create the command by index
+        cmd_new = cmd_get_idx(idx);
     }
 
     if(cmd_new == NULL)
@@ -94,22 +351,49 @@ cmd_t * cmd_get_idx(int idx)
 {
     cmd_t *cmd_new = NULL;
 
-    if (idx < SCH_CMD_MAX_ENTRIES)
+    if (idx >= 0 && idx < SCH_CMD_MAX_ENTRIES)
     {
-        // Get found command
-        osSemaphoreTake(&repo_cmd_sem, portMAX_DELAY);
-        cmd_list_t cmd_found = cmd_list[idx];
-        osSemaphoreGiven(&repo_cmd_sem);
+        // Get found command. The list is immutable once frozen
+        cmd_list_t cmd_found;
+        if(cmd_is_frozen)
+        {
+            cmd_found = cmd_list[idx];
+        }
+        else
+        {
+            osSemaphoreTake(&repo_cmd_sem, portMAX_DELAY);
+            cmd_found = cmd_list[idx];
+            osSemaphoreGiven(&repo_cmd_sem);
+        }
 
         // Creates a new command
-        cmd_new = (cmd_t *)malloc(sizeof(cmd_t));
+        cmd_new = (cmd_t *)cmd_pool_alloc(CMD_POOL_CMD, sizeof(cmd_t));
+        if(cmd_new == NULL)
+        {
+            LOGE(tag, "Unable to create cmd %d. Commands pool exhausted", idx);
+            return NULL;
+        }
 
         // Fill parameters
         cmd_new->id = idx;
         cmd_new->fmt = cmd_found.fmt;
+        cmd_new->desc = &cmd_list[idx].desc;
         cmd_new->function = cmd_found.function;
+        cmd_new->function_args = cmd_found.function_args;
         cmd_new->nparams = cmd_found.nparams;
         cmd_new->params = NULL;
+        cmd_new->args = NULL;
+        cmd_new->cls = cmd_found.cls;
+        cmd_new->prio = cmd_found.prio;
+        cmd_new->t_sent = 0;
+        cmd_new->t_wait = 0;
+        cmd_new->deadline = 0;
+        cmd_new->budget = cmd_found.budget;
+        cmd_new->overrun = 0;
+        cmd_new->next = NULL;
+        cmd_new->handle = NULL;
+        cmd_new->coalesce = cmd_found.coalesce;
+        cmd_new->cost = cmd_found.cost;
     }
     else
     {
@@ -122,12 +406,20 @@ cmd_t * cmd_get_idx(int idx)
 char * cmd_get_name(int idx)
 {
     char *name = NULL;
-    if (idx < SCH_CMD_MAX_ENTRIES)
+    if (idx >= 0 && idx < SCH_CMD_MAX_ENTRIES)
     {
-        // Get found command
-        osSemaphoreTake(&repo_cmd_sem, portMAX_DELAY);
-        cmd_list_t cmd_found = cmd_list[idx];
-        osSemaphoreGiven(&repo_cmd_sem);
+        // Get found command. The list is immutable once frozen
+        cmd_list_t cmd_found;
+        if(cmd_is_frozen)
+        {
+            cmd_found = cmd_list[idx];
+        }
+        else
+        {
+            osSemaphoreTake(&repo_cmd_sem, portMAX_DELAY);
+            cmd_found = cmd_list[idx];
+            osSemaphoreGiven(&repo_cmd_sem);
+        }
 
         LOGV(tag, "Cmd name found: %s", cmd_found.name);
         name = (char *)malloc(strlen(cmd_found.name)+1);
@@ -148,19 +440,66 @@ char * cmd_get_name(int idx)
     return name;
 }
 
+int cmd_copy_name(int idx, char *name, size_t len)
+{
+    if(idx < 0 || idx >= SCH_CMD_MAX_ENTRIES || name == NULL || len == 0)
+    {
+        LOGW(tag, "Command index not found: %d", idx);
+        return CMD_ERROR;
+    }
+
+    // The list is immutable once frozen
+    int frozen = cmd_is_frozen;
+    if(!frozen)
+        osSemaphoreTake(&repo_cmd_sem, portMAX_DELAY);
+    char *found = cmd_list[idx].name;
+    if(found != NULL)
+    {
+        strncpy(name, found, len-1);
+        name[len-1] = '\0';
+    }
+    if(!frozen)
+        osSemaphoreGiven(&repo_cmd_sem);
+
+    return found != NULL ? CMD_OK : CMD_ERROR;
+}
+
 void cmd_add_params_raw(cmd_t *cmd, void *params, int len)
 {
     // Check pointers
     if(cmd != NULL && params != NULL)
     {
         LOGD(tag, "Copying %d bytes as parameters", len);
-        cmd->params = (char *)malloc((size_t)len);
+        cmd_pool_free(cmd->args);
+        cmd->args = NULL;
+        cmd_pool_free(cmd->params);
+        cmd->params = (char *)cmd_pool_alloc(CMD_POOL_PAR_S, (size_t)len);
+        if(cmd->params == NULL)
+        {
+            LOGE(tag, "Unable to copy %d bytes as parameters. Pool exhausted", len);
+            return;
+        }
         memcpy(cmd->params, params, (size_t)len);
     }
 }
 
 void cmd_add_params_str(cmd_t *cmd, char *params)
 {
+    // Typed handlers, parse the parameters only once
+    if(cmd != NULL && cmd->function_args != NULL)
+    {
+        uint64_t tmp[CMD_POOL_WORDS(1, CMD_ARGS_MAX_LEN)];
+        cmd_args_t *args = (cmd_args_t *)tmp;
+        if(cmd_args_parse(cmd->desc, params, args) != cmd->desc->nargs)
+            LOGW(tag, "Invalid parameters: %s (%d of %d)", params, args->nargs, cmd->desc->nargs);
+
+        cmd_pool_free(cmd->params);
+        cmd->params = NULL;
+        cmd_pool_free(cmd->args);
+        cmd->args = cmd_args_store(cmd->desc, args);
+        return;
+    }
+
     size_t len_param = strlen(params);
     if(len_param > SCH_CMD_MAX_STR_PARAMS)
     {
@@ -172,8 +511,17 @@ void cmd_add_params_str(cmd_t *cmd, char *params)
     // Check pointers
     if(cmd != NULL && len_param)
     {
-        cmd->params = (char *)malloc(sizeof(char)*(len_param+1));
-        strncpy(cmd->params, params, len_param+1);
+        cmd_pool_free(cmd->args);
+        cmd->args = NULL;
+        cmd_pool_free(cmd->params);
+        cmd->params = (char *)cmd_pool_alloc(CMD_POOL_PAR_S, sizeof(char)*(len_param+1));
+        if(cmd->params == NULL)
+        {
+            LOGE(tag, "Unable to copy parameters. Pool exhausted");
+            return;
+        }
+        strncpy(cmd->params, params, len_param);
+        cmd->params[len_param] = '\0';
     }
 }
 
@@ -184,9 +532,23 @@ void cmd_add_params_var(cmd_t *cmd, ...)
         va_list args;
         va_start(args, cmd);
 
+        if(cmd->desc->nargs >= 0)
+        {
+            // Fill typed arguments directly, no string conversion
+            uint64_t tmp[CMD_POOL_WORDS(1, CMD_ARGS_MAX_LEN)];
+            cmd_args_fill(cmd->desc, (cmd_args_t *)tmp, args);
+            va_end(args);
+
+            cmd_pool_free(cmd->params);
+            cmd->params = NULL;
+            cmd_pool_free(cmd->args);
+            cmd->args = cmd_args_store(cmd->desc, (cmd_args_t *)tmp);
+            return;
+        }
+
         //Parsing arguments to string
         char str_params[SCH_CMD_MAX_STR_PARAMS];
-        vsprintf(str_params, cmd->fmt, args);
+        vsnprintf(str_params, sizeof(str_params), cmd->fmt, args);
 
         va_end(args);
 
@@ -256,10 +618,271 @@ void cmd_free(cmd_t *cmd)
     {
         // Free the params if allocated, we don't need free cmd->fmt because
         // it has not been copied with malloc (see cmd_get_idx)
-        free(cmd->params);
+        cmd_pool_free(cmd->params);
+        cmd_pool_free(cmd->args);
         // Free the structure itself
-        free(cmd);
+        cmd_pool_free(cmd);
+    }
+}
+
+int cmd_execute(cmd_t *cmd)
+{
+    if(cmd == NULL)
+        return CMD_ERROR;
+
+    // Commands without budget are not tracked
+    if(cmd->budget == 0)
+        return cmd_execute_handler(cmd);
+
+    int slot = cmd_running_start(cmd);
+    int rc = cmd_execute_handler(cmd);
+    cmd_running_stop(slot, cmd);
+    return rc;
+}
+
+/**
+ * Call the command handler with the typed or string parameters
+ */
+static int cmd_execute_handler(cmd_t *cmd)
+{
+    // Typed handler, check that all the arguments are present
+    if(cmd->function_args != NULL)
+    {
+        cmd_args_t no_args = {0, sizeof(cmd_args_t)};
+        cmd_args_t *args = cmd->args;
+        if(args == NULL && cmd->desc->nargs == 0)
+            args = &no_args;
+
+        if(args == NULL || args->nargs != cmd->desc->nargs)
+        {
+            LOGW(tag, "Cmd %d used with invalid params (%d of %d)", cmd->id,
+                 args == NULL ? 0 : args->nargs, cmd->desc->nargs);
+            return CMD_SYNTAX_ERROR;
+        }
+        return cmd->function_args(args);
+    }
+
+    // Legacy handler filled with typed arguments, convert them to string
+    if(cmd->args != NULL)
+    {
+        char params[SCH_CMD_MAX_STR_PARAMS+1];
+        cmd_args_to_str(cmd->desc, cmd->args, params, sizeof(params));
+        return cmd->function(cmd->fmt, params, cmd->nparams);
+    }
+
+    return cmd->function(cmd->fmt, cmd->params, cmd->nparams);
+}
+
+int cmd_fmt_compile(const char *fmt, cmd_fmt_desc_t *desc)
+{
+    int n = 0;
+    memset(desc, 0, sizeof(cmd_fmt_desc_t));
+    desc->nargs = -1;
+    if(fmt == NULL)
+        return -1;
+
+    while(*fmt != '\0')
+    {
+        if(isspace((unsigned char)*fmt))
+        {
+            fmt++;
+            continue;
+        }
+
+        // Only conversions are supported and "%n" must be the last one
+        if(*fmt != '%' || n >= CMD_MAX_ARGS || (n > 0 && desc->type[n-1] == CMD_ARG_TAIL))
+            return -1;
+
+        int is_long = *(++fmt) == 'l';
+        if(is_long)
+            fmt++;
+
+        cmd_arg_type_t type;
+        switch(*fmt)
+        {
+            case 'd': type = is_long ? CMD_ARG_LONG : CMD_ARG_INT; break;
+            case 'f': type = is_long ? CMD_ARG_DOUBLE : CMD_ARG_FLOAT; break;
+            case 'i': type = CMD_ARG_XINT; break;
+            case 'u': type = CMD_ARG_UINT; break;
+            case 's': type = CMD_ARG_STR; break;
+            case 'n': type = CMD_ARG_TAIL; break;
+            default: return -1;
+        }
+        if(is_long && type != CMD_ARG_LONG && type != CMD_ARG_DOUBLE)
+            return -1;
+
+        desc->type[n++] = (uint8_t)type;
+        fmt++;
+    }
+
+    desc->nargs = (int8_t)n;
+    return n;
+}
+
+/**
+ * Parse a parameters string into typed arguments, with the same rules as
+ * sscanf. Parsing stops at the first invalid argument.
+ *
+ * @param desc Compiled parameters format
+ * @param params Parameters string
+ * @param args Buffer of CMD_ARGS_MAX_LEN bytes to store the arguments
+ * @return Number of arguments parsed
+ */
+static int cmd_args_parse(const cmd_fmt_desc_t *desc, const char *params, cmd_args_t *args)
+{
+    char *str = (char *)&args->arg[desc->nargs];
+    char *str_end = (char *)args + CMD_ARGS_MAX_LEN;
+    const char *p = params == NULL ? "" : params;
+    char *next;
+    int i;
+
+    for(i=0; i<desc->nargs; i++)
+    {
+        cmd_arg_t *arg = &args->arg[i];
+        int ok = 1;
+        while(isspace((unsigned char)*p))
+            p++;
+
+        switch(desc->type[i])
+        {
+            case CMD_ARG_INT: arg->i = (int)strtol(p, &next, 10); break;
+            case CMD_ARG_XINT: arg->i = (int)strtol(p, &next, 0); break;
+            case CMD_ARG_UINT: arg->u = (unsigned int)strtoul(p, &next, 10); break;
+            case CMD_ARG_LONG: arg->l = strtol(p, &next, 10); break;
+            case CMD_ARG_FLOAT: arg->f = strtof(p, &next); break;
+            case CMD_ARG_DOUBLE: arg->d = strtod(p, &next); break;
+            default:
+                // CMD_ARG_STR is a word, CMD_ARG_TAIL the rest of the string
+                next = (char *)p;
+                while(*next != '\0' && (desc->type[i] == CMD_ARG_TAIL || !isspace((unsigned char)*next)))
+                    next++;
+                if(str + (next - p) + 1 > str_end)
+                {
+                    ok = 0;
+                    break;
+                }
+                memcpy(str, p, (size_t)(next - p));
+                str[next - p] = '\0';
+                arg->s = str;
+                str += next - p + 1;
+                break;
+        }
+
+        if(!ok || (next == p && desc->type[i] != CMD_ARG_TAIL))
+            break;
+        p = next;
+    }
+
+    args->nargs = i;
+    args->len = (int)(str - (char *)args);
+    return i;
+}
+
+/**
+ * Fill typed arguments from a list of variables
+ *
+ * @param desc Compiled parameters format
+ * @param args Buffer of CMD_ARGS_MAX_LEN bytes to store the arguments
+ * @param ap List of variables
+ * @return Number of arguments filled
+ */
+static int cmd_args_fill(const cmd_fmt_desc_t *desc, cmd_args_t *args, va_list ap)
+{
+    char *str = (char *)&args->arg[desc->nargs];
+    char *str_end = (char *)args + CMD_ARGS_MAX_LEN;
+    int i;
+
+    for(i=0; i<desc->nargs; i++)
+    {
+        cmd_arg_t *arg = &args->arg[i];
+        switch(desc->type[i])
+        {
+            case CMD_ARG_INT:
+            case CMD_ARG_XINT: arg->i = va_arg(ap, int); break;
+            case CMD_ARG_UINT: arg->u = va_arg(ap, unsigned int); break;
+            case CMD_ARG_LONG: arg->l = va_arg(ap, long); break;
+            case CMD_ARG_FLOAT: arg->f = (float)va_arg(ap, double); break;
+            case CMD_ARG_DOUBLE: arg->d = va_arg(ap, double); break;
+            default:
+            {
+                // Strings are copied, truncated if required
+                const char *value = va_arg(ap, char *);
+                size_t len = value == NULL ? 0 : strlen(value);
+                if(str + len + 1 > str_end)
+                    len = (size_t)(str_end - str - 1);
+                memcpy(str, value == NULL ? "" : value, len);
+                str[len] = '\0';
+                arg->s = str;
+                str += len + 1;
+                break;
+            }
+        }
     }
+
+    args->nargs = i;
+    args->len = (int)(str - (char *)args);
+    return i;
+}
+
+/**
+ * Convert typed arguments to a parameters string, the inverse of
+ * cmd_args_parse. Used to call legacy handlers.
+ *
+ * @param desc Compiled parameters format
+ * @param args Arguments
+ * @param buff Buffer to store the string
+ * @param len Buffer size
+ * @return Length of the string
+ */
+static int cmd_args_to_str(const cmd_fmt_desc_t *desc, const cmd_args_t *args, char *buff, size_t len)
+{
+    int i, n = 0;
+    buff[0] = '\0';
+
+    for(i=0; i<args->nargs && n < (int)len; i++)
+    {
+        const cmd_arg_t *arg = &args->arg[i];
+        const char *sep = i == 0 ? "" : " ";
+        switch(desc->type[i])
+        {
+            case CMD_ARG_INT:
+            case CMD_ARG_XINT: n += snprintf(buff+n, len-n, "%s%d", sep, arg->i); break;
+            case CMD_ARG_UINT: n += snprintf(buff+n, len-n, "%s%u", sep, arg->u); break;
+            case CMD_ARG_LONG: n += snprintf(buff+n, len-n, "%s%ld", sep, arg->l); break;
+            case CMD_ARG_FLOAT: n += snprintf(buff+n, len-n, "%s%.9g", sep, arg->f); break;
+            case CMD_ARG_DOUBLE: n += snprintf(buff+n, len-n, "%s%.17g", sep, arg->d); break;
+            default: n += snprintf(buff+n, len-n, "%s%s", sep, arg->s); break;
+        }
+    }
+
+    return n < (int)len ? n : (int)len - 1;
+}
+
+/**
+ * Copy arguments from a temporary buffer to a block of the parameters pool
+ * of the exact size, and move the strings pointers to the new block.
+ *
+ * @param desc Compiled parameters format
+ * @param tmp Arguments in a temporary buffer
+ * @return Arguments in the pool, NULL if the pool is exhausted
+ */
+static cmd_args_t *cmd_args_store(const cmd_fmt_desc_t *desc, const cmd_args_t *tmp)
+{
+    int i;
+    cmd_args_t *args = (cmd_args_t *)cmd_pool_alloc(CMD_POOL_PAR_S, (size_t)tmp->len);
+    if(args == NULL)
+    {
+        LOGE(tag, "Unable to store %d bytes of arguments. Pool exhausted", tmp->len);
+        return NULL;
+    }
+
+    memcpy(args, tmp, (size_t)tmp->len);
+    for(i=0; i<args->nargs; i++)
+    {
+        if(desc->type[i] == CMD_ARG_STR || desc->type[i] == CMD_ARG_TAIL)
+            args->arg[i].s = (char *)args + (tmp->arg[i].s - (const char *)tmp);
+    }
+    return args;
 }
 
 //static void quicksort_by_name(cmd_list_t* commands, int start, int end)
@@ -355,6 +978,15 @@ int cmd_repo_init(void)
     // Init repository mutex
     osSemaphoreCreate(&repo_cmd_sem);
     cmd_index = 0;  // Reset registered command counter
+    cmd_is_frozen = 0;
+    cmd_pool_init();
+    osSemaphoreCreate(&cmd_stats_sem);
+    cmd_stats_tick_hz = osDefineTime(1000);
+    cmd_stats_reset();
+    osSemaphoreCreate(&cmd_running_sem);
+    memset(cmd_running, 0, sizeof(cmd_running));
+    osSemaphoreCreate(&cmd_rules_sem);
+    memset(cmd_rules, 0, sizeof(cmd_rules));
 
     // Init repos
     cmd_obc_init();
@@ -402,15 +1034,502 @@ int cmd_repo_init(void)
 void cmd_repo_close(void)
 {
     int i;
+    cmd_is_frozen = 0;
     for(i=0; i<SCH_CMD_MAX_ENTRIES; i++)
     {
         free(cmd_list[i].name);
         free(cmd_list[i].fmt);
+        cmd_list[i].name = NULL;
+        cmd_list[i].fmt = NULL;
     }
 
     cmd_index = 0;
 }
 
+int cmd_repo_freeze(void)
+{
+    if(cmd_is_frozen)
+        return CMD_OK;
+
+    osSemaphoreTake(&repo_cmd_sem, portMAX_DELAY);
+    {
+        // Search the seed with the shortest probe sequence. A max probe of
+        // zero means the hash is perfect for the current commands list
+        uint32_t seed, best_seed = 0;
+        int max_probe, best_probe = SCH_CMD_HASH_SIZE;
+        for(seed = 0; seed < CMD_HASH_MAX_SEEDS && best_probe > 0; seed++)
+        {
+            max_probe = cmd_hash_build(seed);
+            if(max_probe >= 0 && max_probe < best_probe)
+            {
+                best_probe = max_probe;
+                best_seed = seed;
+            }
+        }
+
+        if(best_probe >= SCH_CMD_HASH_SIZE)
+        {
+            osSemaphoreGiven(&repo_cmd_sem);
+            LOGE(tag, "Unable to build the commands index!");
+            return CMD_ERROR;
+        }
+
+        // Keep the table built with the best seed
+        if(best_seed != seed - 1)
+            cmd_hash_build(best_seed);
+
+        cmd_hash_seed = best_seed;
+        cmd_hash_max_probe = best_probe;
+        cmd_is_frozen = 1;
+    }
+    osSemaphoreGiven(&repo_cmd_sem);
+
+    LOGI(tag, "Commands index frozen (%d cmds, seed: %u, max probe: %d)",
+         cmd_index, cmd_hash_seed, cmd_hash_max_probe);
+    return CMD_OK;
+}
+
+/**
+ * Find a command index by name. If the repository is frozen uses the hash
+ * index (lock free), otherwise performs a linear search.
+ *
+ * @param name Str. Command name
+ * @return Command index or -1 if not found
+ */
+static int cmd_find_idx(char *name)
+{
+    int i, ok;
+
+    if(cmd_is_frozen)
+    {
+        uint32_t hash = cmd_hash_str(name, cmd_hash_seed);
+        for(i=0; i<=cmd_hash_max_probe; i++)
+        {
+            int16_t idx = cmd_hash_table[(hash + i) & (SCH_CMD_HASH_SIZE - 1)];
+            if(idx < 0)
+                break;
+            if(strcmp(name, cmd_list[idx].name) == 0)
+                return idx;
+        }
+        return -1;
+    }
+
+    for(i=0; i<SCH_CMD_MAX_ENTRIES; i++)
+    {
+        osSemaphoreTake(&repo_cmd_sem, portMAX_DELAY);
+        ok = cmd_list[i].name == NULL ? 1 : strcmp(name, cmd_list[i].name);
+        osSemaphoreGiven(&repo_cmd_sem);
+
+        if(ok == 0)
+            return i;
+    }
+    return -1;
+}
+
+/**
+ * FNV-1a hash of a string with a seed mixed into the offset basis
+ */
+static uint32_t cmd_hash_str(const char *name, uint32_t seed)
+{
+    uint32_t hash = 2166136261u ^ (seed * 0x9E3779B9u);
+    while(*name)
+    {
+        hash ^= (uint8_t)(*name++);
+        hash *= 16777619u;
+    }
+    // Mix high bits into the low bits used as table index
+    hash ^= hash >> 15;
+    return hash;
+}
+
+/**
+ * Fill the hash index with all the commands in cmd_list using linear probing.
+ * Repeated names (ex. "null") are only indexed once, pointing to the first
+ * occurrence as the linear search does.
+ *
+ * @param seed Hash seed
+ * @return The max probe distance, or -1 if the table is full
+ */
+static int cmd_hash_build(uint32_t seed)
+{
+    int i, probe, max_probe = 0;
+    for(i=0; i<SCH_CMD_HASH_SIZE; i++)
+        cmd_hash_table[i] = -1;
+
+    for(i=0; i<SCH_CMD_MAX_ENTRIES; i++)
+    {
+        if(cmd_list[i].name == NULL)
+            continue;
+
+        uint32_t hash = cmd_hash_str(cmd_list[i].name, seed);
+        for(probe=0; probe<SCH_CMD_HASH_SIZE; probe++)
+        {
+            int16_t *slot = &cmd_hash_table[(hash + probe) & (SCH_CMD_HASH_SIZE - 1)];
+            if(*slot < 0)
+            {
+                *slot = (int16_t)i;
+                break;
+            }
+            if(strcmp(cmd_list[*slot].name, cmd_list[i].name) == 0)
+                break;
+        }
+
+        if(probe >= SCH_CMD_HASH_SIZE)
+            return -1;
+        if(probe > max_probe)
+            max_probe = probe;
+    }
+
+    return max_probe;
+}
+
+void cmd_pool_get_stats(cmd_pool_stats_t *stats)
+{
+    osSemaphoreTake(&cmd_pool_sem, portMAX_DELAY);
+    *stats = cmd_pool_stats;
+    osSemaphoreGiven(&cmd_pool_sem);
+}
+
+int cmd_stats_record(cmd_t *cmd, portTick exec_ticks, int result)
+{
+    if(cmd == NULL || cmd->id < 0 || cmd->id >= SCH_CMD_MAX_ENTRIES)
+        return 0;
+
+    // Convert and find the bucket before taking the lock
+    uint32_t wait = cmd_stats_ticks_to_us(cmd->t_wait);
+    uint32_t exec = cmd_stats_ticks_to_us(exec_ticks);
+    uint32_t latency = wait + exec < wait ? UINT32_MAX : wait + exec;
+    int bucket = 0;
+    while(bucket < CMD_STATS_BUCKETS-1 && latency >= cmd_stats_limits[bucket])
+        bucket++;
+    int overrun = cmd->budget > 0 && (cmd->overrun || exec > cmd->budget*1000ULL);
+
+    osSemaphoreTake(&cmd_stats_sem, portMAX_DELAY);
+    cmd_stats_t *stats = &cmd_stats[cmd->id];
+    stats->count++;
+    if(result != CMD_OK)
+        stats->fails++;
+    stats->wait_total += wait;
+    if(wait > stats->wait_max)
+        stats->wait_max = wait;
+    stats->exec_total += exec;
+    if(exec > stats->exec_max)
+        stats->exec_max = exec;
+    if(overrun)
+        stats->overruns++;
+    stats->hist[bucket]++;
+    osSemaphoreGiven(&cmd_stats_sem);
+
+    return overrun && !cmd->overrun;
+}
+
+int cmd_stats_get(int idx, cmd_stats_t *stats)
+{
+    if(idx < 0 || idx >= SCH_CMD_MAX_ENTRIES || stats == NULL)
+        return CMD_ERROR;
+
+    osSemaphoreTake(&cmd_stats_sem, portMAX_DELAY);
+    *stats = cmd_stats[idx];
+    osSemaphoreGiven(&cmd_stats_sem);
+    return CMD_OK;
+}
+
+void cmd_stats_reset(void)
+{
+    osSemaphoreTake(&cmd_stats_sem, portMAX_DELAY);
+    memset(cmd_stats, 0, sizeof(cmd_stats));
+    osSemaphoreGiven(&cmd_stats_sem);
+}
+
+int cmd_rules_set(int idx, cmd_rule_t *rule)
+{
+    if(idx < 0 || idx >= CMD_RULES_MAX || rule == NULL)
+        return CMD_ERROR;
+
+    osSemaphoreTake(&cmd_rules_sem, portMAX_DELAY);
+    cmd_rules[idx] = *rule;
+    cmd_rules[idx].rejected = 0;
+    osSemaphoreGiven(&cmd_rules_sem);
+    return CMD_OK;
+}
+
+int cmd_rules_get(int idx, cmd_rule_t *rule)
+{
+    if(idx < 0 || idx >= CMD_RULES_MAX || rule == NULL)
+        return CMD_ERROR;
+
+    osSemaphoreTake(&cmd_rules_sem, portMAX_DELAY);
+    *rule = cmd_rules[idx];
+    osSemaphoreGiven(&cmd_rules_sem);
+    return CMD_OK;
+}
+
+void cmd_rules_compile(cmd_admission_t *adm, int opmode, int vbatt)
+{
+    int i, c;
+    adm->mask = 0;
+    for(c = 0; c < CMD_COST_LAST; c++)
+    {
+        adm->depth[c] = UINT32_MAX;
+        adm->rule[c] = -1;
+    }
+
+    osSemaphoreTake(&cmd_rules_sem, portMAX_DELAY);
+    for(i = 0; i < CMD_RULES_MAX; i++)
+    {
+        cmd_rule_t *rule = &cmd_rules[i];
+        if(rule->costs == 0)
+            continue;
+        // Operation modes out of the mask range only match "any opmode"
+        if(rule->opmodes != 0 && (opmode < 0 || opmode > 31 || !(rule->opmodes & (1u << opmode))))
+            continue;
+        // An unknown battery voltage (0) does not trigger low battery rules
+        if(rule->vbatt_below != 0 && (vbatt <= 0 || (uint32_t)vbatt >= rule->vbatt_below))
+            continue;
+
+        for(c = 0; c < CMD_COST_LAST; c++)
+        {
+            if((rule->costs & (1u << c)) && rule->depth_min < adm->depth[c])
+            {
+                adm->depth[c] = rule->depth_min;
+                adm->rule[c] = i;
+                adm->mask |= 1u << c;
+            }
+        }
+    }
+    osSemaphoreGiven(&cmd_rules_sem);
+}
+
+int cmd_admit(cmd_admission_t *adm, cmd_t *cmd, int depth)
+{
+    int cost = cmd->cost;
+    if(!(adm->mask & (1u << cost)) || (uint32_t)depth < adm->depth[cost])
+        return -1;
+
+    int rule = adm->rule[cost];
+    osSemaphoreTake(&cmd_rules_sem, portMAX_DELAY);
+    cmd_rules[rule].rejected++;
+    osSemaphoreGiven(&cmd_rules_sem);
+    return rule;
+}
+
+int cmd_check_budgets(int *last_id)
+{
+    portTick now = osTaskGetTickCount();
+    int i, n = 0;
+
+    osSemaphoreTake(&cmd_running_sem, portMAX_DELAY);
+    for(i = 0; i < CMD_RUNNING_MAX; i++)
+    {
+        cmd_running_t *running = &cmd_running[i];
+        if(running->cmd == NULL || running->flagged || now - running->t_start <= running->budget)
+            continue;
+
+        running->flagged = 1;
+        n++;
+        if(last_id != NULL)
+            *last_id = running->cmd->id;
+        LOGW(tag, "Cmd %d exceeded its budget of %lu ms, requesting cancellation",
+             running->cmd->id, (unsigned long)running->cmd->budget);
+    }
+    osSemaphoreGiven(&cmd_running_sem);
+
+    return n;
+}
+
+int cmd_cancel_requested(void)
+{
+    int i, cancel = 0;
+
+    osSemaphoreTake(&cmd_running_sem, portMAX_DELAY);
+    for(i = 0; i < CMD_RUNNING_MAX; i++)
+    {
+        if(cmd_running[i].cmd != NULL && osTaskIsCurrent(cmd_running[i].task))
+        {
+            cancel = cmd_running[i].flagged;
+            break;
+        }
+    }
+    osSemaphoreGiven(&cmd_running_sem);
+
+    return cancel;
+}
+
+/**
+ * Register a command in execution by the calling task
+ * @return Slot index, -1 if all the slots are in use (the command is not
+ * tracked)
+ */
+static int cmd_running_start(cmd_t *cmd)
+{
+    int i, slot = -1;
+
+    osSemaphoreTake(&cmd_running_sem, portMAX_DELAY);
+    for(i = 0; i < CMD_RUNNING_MAX && slot < 0; i++)
+    {
+        if(cmd_running[i].cmd == NULL)
+            slot = i;
+    }
+    if(slot >= 0)
+    {
+        cmd_running[slot].cmd = cmd;
+        cmd_running[slot].task = osTaskGetCurrent();
+        cmd_running[slot].t_start = osTaskGetTickCount();
+        cmd_running[slot].budget = osDefineTime(cmd->budget);
+        cmd_running[slot].flagged = 0;
+    }
+    osSemaphoreGiven(&cmd_running_sem);
+
+    return slot;
+}
+
+/**
+ * Release the slot of a finished command. Sets cmd->overrun if the command
+ * was flagged by cmd_check_budgets while running.
+ */
+static void cmd_running_stop(int slot, cmd_t *cmd)
+{
+    if(slot < 0)
+        return;
+
+    osSemaphoreTake(&cmd_running_sem, portMAX_DELAY);
+    cmd->overrun = cmd_running[slot].flagged;
+    cmd_running[slot].cmd = NULL;
+    osSemaphoreGiven(&cmd_running_sem);
+}
+
+/**
+ * Convert a number of ticks to microseconds, saturated to UINT32_MAX
+ */
+static uint32_t cmd_stats_ticks_to_us(portTick ticks)
+{
+    if(cmd_stats_tick_hz == 1000000)
+        return (uint32_t)ticks;
+
+    uint64_t us = (uint64_t)ticks * 1000000 / (cmd_stats_tick_hz > 0 ? cmd_stats_tick_hz : 1);
+    return us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+}
+
+/**
+ * Initializes the commands and parameters pools, all blocks are free. Any
+ * command allocated before calling this function is lost.
+ */
+static void cmd_pool_init(void)
+{
+    osSemaphoreCreate(&cmd_pool_sem);
+
+    cmd_pools[CMD_POOL_CMD] = (cmd_pool_t){(uint8_t *)cmd_pool_buff_cmd, CMD_POOL_WORDS(1, sizeof(cmd_t))*8, SCH_CMD_POOL_CMDS, NULL, 0};
+    cmd_pools[CMD_POOL_PAR_S] = (cmd_pool_t){(uint8_t *)cmd_pool_buff_s, CMD_POOL_WORDS(1, CMD_POOL_LEN_S)*8, SCH_CMD_POOL_PARAMS_S, NULL, 0};
+    cmd_pools[CMD_POOL_PAR_M] = (cmd_pool_t){(uint8_t *)cmd_pool_buff_m, CMD_POOL_WORDS(1, CMD_POOL_LEN_M)*8, SCH_CMD_POOL_PARAMS_M, NULL, 0};
+    cmd_pools[CMD_POOL_PAR_L] = (cmd_pool_t){(uint8_t *)cmd_pool_buff_l, CMD_POOL_WORDS(1, CMD_POOL_LEN_L)*8, SCH_CMD_POOL_PARAMS_L, NULL, 0};
+
+    // Link all the free blocks, the first bytes of a free block point to the
+    // next free block
+    int p, i;
+    for(p=0; p<CMD_POOL_LAST; p++)
+    {
+        cmd_pool_t *pool = &cmd_pools[p];
+        for(i=pool->n_blocks-1; i>=0; i--)
+        {
+            void *block = pool->buff + i*pool->len;
+            *(void **)block = pool->free_list;
+            pool->free_list = block;
+        }
+    }
+
+    memset(&cmd_pool_stats, 0, sizeof(cmd_pool_stats));
+}
+
+/**
+ * Get a free block of at least @len bytes. Starts looking in the @first pool
+ * and continues with the bigger pools. Parameters pools are sorted by size.
+ *
+ * @param first First pool to try
+ * @param len Size of the required block
+ * @return Pointer to the block or NULL if the pools are exhausted (only uses
+ * the heap if SCH_CMD_POOL_HEAP is set)
+ */
+static void *cmd_pool_alloc(cmd_pool_id_t first, size_t len)
+{
+    void *block = NULL;
+    int p, last = first == CMD_POOL_CMD ? CMD_POOL_CMD : CMD_POOL_LAST - 1;
+
+    osSemaphoreTake(&cmd_pool_sem, portMAX_DELAY);
+    for(p=first; p<=last && block == NULL; p++)
+    {
+        cmd_pool_t *pool = &cmd_pools[p];
+        if(pool->len < len || pool->free_list == NULL)
+            continue;
+
+        block = pool->free_list;
+        pool->free_list = *(void **)block;
+        pool->used++;
+
+        if(p == CMD_POOL_CMD)
+        {
+            cmd_pool_stats.cmd_used++;
+            if(cmd_pool_stats.cmd_used > cmd_pool_stats.cmd_max)
+                cmd_pool_stats.cmd_max = cmd_pool_stats.cmd_used;
+        }
+        else
+        {
+            cmd_pool_stats.par_used++;
+            if(cmd_pool_stats.par_used > cmd_pool_stats.par_max)
+                cmd_pool_stats.par_max = cmd_pool_stats.par_used;
+        }
+    }
+
+    if(block == NULL)
+    {
+        if(first == CMD_POOL_CMD)
+            cmd_pool_stats.cmd_fail++;
+        else
+            cmd_pool_stats.par_fail++;
+    }
+    osSemaphoreGiven(&cmd_pool_sem);
+
+#if SCH_CMD_POOL_HEAP
+    if(block == NULL)
+        block = malloc(len);
+#endif
+
+    return block;
+}
+
+/**
+ * Return a block to its pool. Blocks that do not belong to a pool were
+ * allocated in the heap.
+ *
+ * @param ptr Block to release, can be NULL.
+ */
+static void cmd_pool_free(void *ptr)
+{
+    int p;
+    if(ptr == NULL)
+        return;
+
+    for(p=0; p<CMD_POOL_LAST; p++)
+    {
+        cmd_pool_t *pool = &cmd_pools[p];
+        uint8_t *block = (uint8_t *)ptr;
+        if(block >= pool->buff && block < pool->buff + pool->n_blocks*pool->len)
+        {
+            osSemaphoreTake(&cmd_pool_sem, portMAX_DELAY);
+            *(void **)block = pool->free_list;
+            pool->free_list = block;
+            pool->used--;
+            if(p == CMD_POOL_CMD)
+                cmd_pool_stats.cmd_used--;
+            else
+                cmd_pool_stats.par_used--;
+            osSemaphoreGiven(&cmd_pool_sem);
+            return;
+        }
+    }
+
+    free(ptr);
+}
+
 int cmd_null(char *fparams, char *params, int nparam)
 {
     LOGD(tag, "cmd_null was used with params format: %s and params string: %s", fparams, params);
@@ -420,25 +1539,18 @@ int cmd_null(char *fparams, char *params, int nparam)
 int cmd_print(cmd_t* cmd)
 {
     LOGV(tag, "Command Name:%s\n",cmd_get_name(cmd->id));
-    LOGV(tag, "\tid: %d\n\tnparams: %d\n\tfmt: %s\n\tparams: %s\n\tfunction: %p\n", cmd->id, cmd->nparams, cmd->fmt, cmd->params, cmd->function);
+    LOGV(tag, "\tid: %d\n\tnparams: %d\n\tfmt: %s\n\tparams: %s\n\targs: %d\n\tfunction: %p\n", cmd->id, cmd->nparams, cmd->fmt, cmd->params,
+         cmd->args == NULL ? 0 : cmd->args->nargs, cmd->function_args != NULL ? (void *)cmd->function_args : (void *)cmd->function);
     return 0;
 }
 
 char* cmd_get_fmt(char* name)
 {
     char* format = malloc(sizeof(char)*30);
-    int i, ok;
-    for(i=0; i<SCH_CMD_MAX_ENTRIES; i++)
+    int idx = cmd_find_idx(name);
+    if(idx >= 0)
     {
-        osSemaphoreTake(&repo_cmd_sem, portMAX_DELAY);
-        ok = strcmp(name, cmd_list[i].name);
-        osSemaphoreGiven(&repo_cmd_sem);
-
-        if(ok == 0)
-        {
-            strcpy(format,cmd_list[i].fmt);
-            break;
-        }
+        strcpy(format,cmd_list[idx].fmt);
     }
     return format;
 }
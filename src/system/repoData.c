@@ -32,15 +32,99 @@ time_t sec = 0;
 #endif
 
 
+/*
+ * The RAM status variables and the status groups are read without the lock
+ * (seqlock). Writers still take repo_data_sem and make the sequence odd while
+ * they update the buffer, readers copy the values and retry if the sequence
+ * was odd or changed meanwhile. After DAT_SEQ_RETRIES tries (a writer was
+ * preempted in the middle of an update) readers wait on repo_data_sem instead.
+ */
+#define DAT_SEQ_RETRIES 16
+#ifdef __ATOMIC_ACQUIRE
+    #define DAT_LOAD(p, order) __atomic_load_n(p, __ATOMIC_##order)
+    #define DAT_STORE(p, v, order) __atomic_store_n(p, v, __ATOMIC_##order)
+    #define DAT_FENCE(order) __atomic_thread_fence(__ATOMIC_##order)
+#else
+    /* Compilers without the __atomic builtins (single core targets) */
+    #define DAT_LOAD(p, order) (*(volatile __typeof__(*(p)) *)(p))
+    #define DAT_STORE(p, v, order) (*(volatile __typeof__(*(p)) *)(p) = (v))
+    #define DAT_FENCE(order) __sync_synchronize()
+#endif
+static void _dat_seq_begin(uint32_t *seq);
+static void _dat_seq_end(uint32_t *seq);
+
 #if SCH_STORAGE_MODE == 0
     #if SCH_STORAGE_TRIPLE_WR == 1
         static value32_t DAT_SYSTEM_VAR_BUFF[dat_status_last_address * 3];
     #else
-        int DAT_SYSTEM_VAR_BUFF[dat_status_last_address];
+        static value32_t DAT_SYSTEM_VAR_BUFF[dat_status_last_address];
     #endif
     static fp_entry_t data_base [SCH_FP_MAX_ENTRIES];
+    static uint32_t dat_status_seq = 0;         ///< Seqlock of DAT_SYSTEM_VAR_BUFF
+
+    static void _dat_write_begin(void);
+    static void _dat_write_end(void);
+    static void _dat_write_ram(dat_status_address_t index, value32_t value, uint32_t *changed);
+    static int _dat_read_ram(dat_status_address_t index, value32_t *out, int n);
+#else
+    /* Write-behind cache of the status variables, see dat_flush */
+    #define DAT_CACHE_INVALID 0     ///< Not read from the storage yet
+    #define DAT_CACHE_CLEAN 1       ///< Same value as in the storage
+    #define DAT_CACHE_DIRTY 2       ///< Changed, not written to the storage yet
+    #if SCH_STORAGE_TRIPLE_WR == 1
+        #define DAT_CACHE_COPIES 3
+    #else
+        #define DAT_CACHE_COPIES 1
+    #endif
+    static value32_t dat_status_cache[dat_status_last_address];
+    static uint8_t dat_status_state[dat_status_last_address];
+    static int dat_status_dirty = 0;            ///< Number of dirty variables
+    static portTick dat_status_dirty_tick;      ///< Tick of the oldest dirty write
+    static int dat_flush_index[dat_status_last_address * DAT_CACHE_COPIES];
+    static int dat_flush_value[dat_status_last_address * DAT_CACHE_COPIES];
+    static int dat_load_value[dat_status_last_address * DAT_CACHE_COPIES];
+
+    static int _dat_flush(void);
+    static int _dat_flush_if_old(void);
+    static void _dat_cache_status_var(dat_status_address_t index, value32_t value, uint32_t *changed);
+    static value32_t _dat_load_status_var(dat_status_address_t index);
+    static int _dat_load_status_vars(dat_status_address_t first);
 #endif
 
+/* Status variables change subscriptions, see dat_subscribe_status_vars */
+#define DAT_SUBS_WORDS ((dat_status_last_address + 31) / 32)    ///< Words of an addresses bitmask
+typedef struct dat_subscription_s {
+    osQueue queue;                      ///< Queue of dat_sys_var_short_t changes
+    uint32_t mask[DAT_SUBS_WORDS];      ///< Addresses of interest
+} dat_subscription_t;
+static dat_subscription_t dat_subs[DAT_SUBS_MAX];
+static int dat_subs_n = 0;
+static uint32_t dat_subs_any[DAT_SUBS_WORDS];   ///< Addresses with at least one subscription
+
+static void _dat_notify(uint32_t *changed);
+static int _dat_write_status_vars(dat_status_address_t index, value32_t *value, int n, uint32_t *changed);
+
+/* Status groups, in RAM with any storage mode, see dat_get_group */
+static dat_groups_t dat_groups;
+static uint32_t dat_group_seq = 0;          ///< Seqlock of dat_groups
+
+static void _dat_init_groups(void);
+static void _dat_sync_groups(uint32_t *changed);
+static void _dat_read_groups(int offset, double *out, int n);
+
+static void _dat_payload_check_ack(int payload, int next);
+
+#if SCH_STORAGE_TRIPLE_WR == 1
+static int _dat_vote(value32_t value_1, value32_t value_2, value32_t value_3, value32_t *value);
+static value32_t _dat_vote_status_var(dat_status_address_t index, value32_t value_1, value32_t value_2, value32_t value_3);
+static int _dat_count_divergent(const uint32_t *__restrict__ copy_1, const uint32_t *__restrict__ copy_2,
+                                const uint32_t *__restrict__ copy_3, int n);
+static int _dat_vote_words(uint32_t *__restrict__ copy_1, uint32_t *__restrict__ copy_2,
+                           uint32_t *__restrict__ copy_3, uint32_t *__restrict__ upset, int n);
+static uint32_t dat_scrub_upset[dat_status_last_address];   ///< Variables repaired by the last scrub
+#endif
+static uint32_t dat_status_upsets[dat_status_last_address]; ///< Upsets found by the scrub, per variable
+
 dat_stmachine_t status_machine;
 
 void dat_repo_init(void)
@@ -49,6 +133,10 @@ void dat_repo_init(void)
     if(osSemaphoreCreate(&repo_data_sem) != OS_SEMAPHORE_OK)
         LOGE(tag, "Unable to create system status repository mutex");
 
+    // Init status variables names index and payloads fields
+    dat_status_var_def_init();
+    dat_payload_schema_init();
+
 
     LOGD(tag, "Initializing data repositories buffers...")
 #if (SCH_STORAGE_MODE == 0)
@@ -88,9 +176,29 @@ void dat_repo_init(void)
         rc = storage_table_repo_init(DAT_REPO_SYSTEM, 0);
         assertf(rc==0, tag, "Unable to create system variables repository");
 
+        //Status variables are read from the storage the first time they are used
+        memset(dat_status_state, DAT_CACHE_INVALID, sizeof(dat_status_state));
+        dat_status_dirty = 0;
+
         //Init payloads repo
         rc = storage_table_payload_init(0);
         assertf(rc==0, tag, "Unable to create payload repo");
+#if SCH_STORAGE_MODE == 3
+        //Payloads indexes follow the samples recovered from the segments,
+        //they may be ahead or behind the last status checkpoint
+        int payload;
+        for(payload = 0; payload < last_sensor; payload++)
+        {
+            int tail = storage_get_payload_tail(payload);
+            int index = dat_get_system_var(data_map[payload].sys_index);
+            if(tail >= 0 && tail != index)
+            {
+                LOGW(tag, "Payload %d index moved from %d to %d", payload, index, tail);
+                dat_set_system_var(data_map[payload].sys_index, tail);
+                _dat_payload_check_ack(payload, tail);
+            }
+        }
+#endif
 
         //Init system flight plan table
         int entries = dat_get_system_var(dat_fpl_queue);
@@ -99,12 +207,16 @@ void dat_repo_init(void)
         assertf(rc==0, tag, "Unable to create flight plan table");
     }
 #endif
+
+    //Status groups start from their float copies
+    _dat_init_groups();
 }
 
 void dat_repo_close(void)
 {
 #if SCH_STORAGE_MODE != 0
     {
+        dat_flush();
         storage_close();
     }
 #endif
@@ -126,11 +238,19 @@ int _dat_set_system_var(dat_status_address_t index, int value)
 
     //Uses internal memory
 #if SCH_STORAGE_MODE == 0
-    value32_t var = {.i=value};
-    DAT_SYSTEM_VAR_BUFF[index] = var;
+    _dat_write_begin();
+    DAT_STORE(&DAT_SYSTEM_VAR_BUFF[index].u, (uint32_t)value, RELAXED);
+    _dat_write_end();
     //Uses external memory
 #else
+    //Write the pending changes first, then read this variable (and its
+    //copies) again from the storage. If they could not be written, the
+    //pending change of this variable is replaced by this write
+    int var = index % dat_status_last_address;
+    if(_dat_flush() != 0 && dat_status_state[var] == DAT_CACHE_DIRTY)
+        dat_status_dirty--;
     rc = storage_repo_set_value_idx(index, value, DAT_REPO_SYSTEM);
+    dat_status_state[var] = DAT_CACHE_INVALID;
 #endif
 
     //Exit critical zone
@@ -151,23 +271,36 @@ int _dat_get_system_var(dat_status_address_t index)
 {
     value32_t value;
 
-    //Enter critical zone
-    osSemaphoreTake(&repo_data_sem, portMAX_DELAY);
-
-    //Use internal (volatile) memory
+    //Use internal (volatile) memory, one word is read atomically
 #if SCH_STORAGE_MODE == 0
-    value = DAT_SYSTEM_VAR_BUFF[index];
-    //Uses external (non-volatile) memory
+    value.u = DAT_LOAD(&DAT_SYSTEM_VAR_BUFF[index].u, ACQUIRE);
+    //Uses external (non-volatile) memory, with the pending changes written
 #else
+    osSemaphoreTake(&repo_data_sem, portMAX_DELAY);
+    _dat_flush();
     value.i = storage_repo_get_value_idx(index, DAT_REPO_SYSTEM);
-#endif
-
-    //Exit critical zone
     osSemaphoreGiven(&repo_data_sem);
+#endif
 
     return value.i;
 }
 
+/**
+ * Function for testing the status variables cache.
+ *
+ * @return Number of status variables changed since the last flush
+ */
+int _dat_get_dirty_vars(void)
+{
+    int dirty = 0;
+#if SCH_STORAGE_MODE > 0
+    osSemaphoreTake(&repo_data_sem, portMAX_DELAY);
+    dirty = dat_status_dirty;
+    osSemaphoreGiven(&repo_data_sem);
+#endif
+    return dirty;
+}
+
 ///< Compatibility function
 int dat_set_system_var(dat_status_address_t index, int value)
 {
@@ -179,27 +312,50 @@ int dat_set_system_var(dat_status_address_t index, int value)
 int dat_set_status_var(dat_status_address_t index, value32_t value)
 {
     int rc = 0;
+    uint32_t changed[DAT_SUBS_WORDS] = {0};
     //Enter critical zone
     osSemaphoreTake(&repo_data_sem, portMAX_DELAY);
 
     //Uses internal memory
 #if SCH_STORAGE_MODE == 0
-    DAT_SYSTEM_VAR_BUFF[index] = value;
-    //Uses tripled writing
-    #if SCH_STORAGE_TRIPLE_WR == 1
-        DAT_SYSTEM_VAR_BUFF[index + dat_status_last_address] = value;
-        DAT_SYSTEM_VAR_BUFF[index + dat_status_last_address * 2] = value;
-    #endif
-    //Uses external memory
+    _dat_write_begin();
+    _dat_write_ram(index, value, changed);
+    _dat_write_end();
+    //Uses external memory, through the cache
 #else
-    rc = storage_repo_set_value_idx(index, value.i, DAT_REPO_SYSTEM);
-    //Uses tripled writing
-    #if SCH_STORAGE_TRIPLE_WR == 1
-        int rc2 = storage_repo_set_value_idx(index + dat_status_last_address, value.i, DAT_REPO_SYSTEM);
-        int rc3 = storage_repo_set_value_idx(index + dat_status_last_address*2, value.i, DAT_REPO_SYSTEM);
-        rc = rc & rc2 & rc3;
-    #endif
+    _dat_cache_status_var(index, value, changed);
+    rc = _dat_flush_if_old();
+#endif
+    _dat_notify(changed);
+    _dat_sync_groups(changed);
+
+    //Exit critical zone
+    osSemaphoreGiven(&repo_data_sem);
+
+    return rc;
+}
+
+int dat_set_status_many(dat_status_address_t *index, value32_t *value, int n)
+{
+    int i, rc = 0;
+    uint32_t changed[DAT_SUBS_WORDS] = {0};
+    //Enter critical zone
+    osSemaphoreTake(&repo_data_sem, portMAX_DELAY);
+
+    //Uses internal memory, readers see all the values or none
+#if SCH_STORAGE_MODE == 0
+    _dat_write_begin();
+    for(i = 0; i < n; i++)
+        _dat_write_ram(index[i], value[i], changed);
+    _dat_write_end();
+    //Uses external memory, through the cache
+#else
+    for(i = 0; i < n; i++)
+        _dat_cache_status_var(index[i], value[i], changed);
+    rc = _dat_flush_if_old();
 #endif
+    _dat_notify(changed);
+    _dat_sync_groups(changed);
 
     //Exit critical zone
     osSemaphoreGiven(&repo_data_sem);
@@ -207,6 +363,195 @@ int dat_set_status_var(dat_status_address_t index, value32_t value)
     return rc;
 }
 
+int dat_set_status_vars(dat_status_address_t index, value32_t *value, int n)
+{
+    int rc;
+    uint32_t changed[DAT_SUBS_WORDS] = {0};
+    assert(index + n <= dat_status_last_address);
+
+    //Enter critical zone
+    osSemaphoreTake(&repo_data_sem, portMAX_DELAY);
+
+    rc = _dat_write_status_vars(index, value, n, changed);
+    _dat_notify(changed);
+    _dat_sync_groups(changed);
+
+    //Exit critical zone
+    osSemaphoreGiven(&repo_data_sem);
+
+    return rc;
+}
+
+/**
+ * Write @n consecutive variables, readers see all the values or none. Must be
+ * called with repo_data_sem taken.
+ *
+ * @param changed Addresses bitmask, the variables that changed are marked
+ * @return 0 if OK, -1 if the storage could not be written
+ */
+static int _dat_write_status_vars(dat_status_address_t index, value32_t *value, int n, uint32_t *changed)
+{
+    int i, rc = 0;
+    //Uses internal memory
+#if SCH_STORAGE_MODE == 0
+    _dat_write_begin();
+    for(i = 0; i < n; i++)
+        _dat_write_ram(index + i, value[i], changed);
+    _dat_write_end();
+    //Uses external memory, through the cache
+#else
+    for(i = 0; i < n; i++)
+        _dat_cache_status_var(index + i, value[i], changed);
+    rc = _dat_flush_if_old();
+#endif
+    return rc;
+}
+
+int dat_get_group(dat_group_address_t group, double *value)
+{
+    if(group >= dat_group_last_address)
+    {
+        LOGE(tag, "Status group not found! (%d)", group);
+        return -1;
+    }
+
+    dat_group_def_t def = dat_get_group_def(group);
+    _dat_read_groups(def.offset, value, def.size);
+    return 0;
+}
+
+int dat_get_groups_snapshot(dat_groups_t *groups)
+{
+    _dat_read_groups(0, (double *)groups, DAT_GROUPS_LEN);
+    return 0;
+}
+
+int dat_set_group(dat_group_address_t group, const double *value)
+{
+    int i, rc = 0;
+    uint32_t changed[DAT_SUBS_WORDS] = {0};
+    if(group >= dat_group_last_address)
+    {
+        LOGE(tag, "Status group not found! (%d)", group);
+        return -1;
+    }
+    dat_group_def_t def = dat_get_group_def(group);
+
+    //Enter critical zone
+    osSemaphoreTake(&repo_data_sem, portMAX_DELAY);
+
+    _dat_seq_begin(&dat_group_seq);
+    memcpy((double *)&dat_groups + def.offset, value, def.size * sizeof(double));
+    _dat_seq_end(&dat_group_seq);
+
+    //Update the float copy, in the same critical zone
+    if(def.mirror != DAT_GROUP_NO_MIRROR)
+    {
+        value32_t mirror[def.size];
+        for(i = 0; i < def.size; i++)
+            mirror[i].f = (float)value[i];
+        rc = _dat_write_status_vars(def.mirror, mirror, def.size, changed);
+        _dat_notify(changed);
+    }
+
+    //Exit critical zone
+    osSemaphoreGiven(&repo_data_sem);
+
+    return rc;
+}
+
+/**
+ * Set the groups values from their float copies, or to zero if they have
+ * none. Called by dat_repo_init, before tasks start.
+ */
+static void _dat_init_groups(void)
+{
+    int group, i;
+    memset(&dat_groups, 0, sizeof(dat_groups));
+    for(group = 0; group < dat_group_last_address; group++)
+    {
+        dat_group_def_t def = dat_get_group_def(group);
+        if(def.mirror == DAT_GROUP_NO_MIRROR)
+            continue;
+
+        value32_t mirror[def.size];
+        double *values = (double *)&dat_groups + def.offset;
+        dat_get_status_vars(def.mirror, mirror, def.size);
+        for(i = 0; i < def.size; i++)
+        {
+            assert(dat_get_status_var_def(def.mirror + i).type == 'f');
+            values[i] = (double)mirror[i].f;
+        }
+    }
+}
+
+/**
+ * Update the groups values whose float copy was changed by the status
+ * variables setters (e.g. drp_set_var), these values take the float value.
+ * Must be called with repo_data_sem taken.
+ *
+ * @param changed Bitmask of the addresses changed
+ */
+static void _dat_sync_groups(uint32_t *changed)
+{
+    int group, i, seq_taken = 0;
+    for(group = 0; group < dat_group_last_address; group++)
+    {
+        dat_group_def_t def = dat_get_group_def(group);
+        if(def.mirror == DAT_GROUP_NO_MIRROR)
+            continue;
+
+        double *values = (double *)&dat_groups + def.offset;
+        for(i = 0; i < def.size; i++)
+        {
+            int address = def.mirror + i;
+            if(!(changed[address / 32] & (1u << (address % 32))))
+                continue;
+            if(!seq_taken)
+            {
+                _dat_seq_begin(&dat_group_seq);
+                seq_taken = 1;
+            }
+#if SCH_STORAGE_MODE == 0
+            values[i] = (double)DAT_SYSTEM_VAR_BUFF[address].f;
+#else
+            values[i] = (double)dat_status_cache[address].f;
+#endif
+        }
+    }
+    if(seq_taken)
+        _dat_seq_end(&dat_group_seq);
+}
+
+/**
+ * Copy @n consecutive values of the status groups, all from the same update
+ *
+ * @param offset Position of the first value in dat_groups_t, in doubles
+ */
+static void _dat_read_groups(int offset, double *out, int n)
+{
+    int retry;
+    uint32_t seq;
+    const double *values = (const double *)&dat_groups + offset;
+    assert(offset + n <= DAT_GROUPS_LEN);
+
+    for(retry = 0; retry < DAT_SEQ_RETRIES; retry++)
+    {
+        seq = DAT_LOAD(&dat_group_seq, ACQUIRE);
+        if(seq & 1)
+            continue;
+        memcpy(out, values, n * sizeof(double));
+        DAT_FENCE(ACQUIRE);
+        if(DAT_LOAD(&dat_group_seq, RELAXED) == seq)
+            return;
+    }
+
+    //Wait for the writer to finish
+    osSemaphoreTake(&repo_data_sem, portMAX_DELAY);
+    memcpy(out, values, n * sizeof(double));
+    osSemaphoreGiven(&repo_data_sem);
+}
+
 int dat_set_status_var_name(char *name, value32_t value)
 {
     dat_sys_var_t var = dat_get_status_var_def_name(name);
@@ -225,48 +570,541 @@ int dat_get_system_var(dat_status_address_t index)
 value32_t dat_get_status_var(dat_status_address_t index)
 {
     value32_t value_1;
-#if SCH_STORAGE_TRIPLE_WR == 1
-    value32_t value_2;
-    value32_t value_3;
+
+#if SCH_STORAGE_MODE == 0
+    //Use internal (volatile) memory, without the lock
+    if(_dat_read_ram(index, &value_1, 1) != 0)
+        LOGE(tag, "Unable to get a correct value for index %d", index);
+#else
+    //Enter critical zone
+    osSemaphoreTake(&repo_data_sem, portMAX_DELAY);
+
+    //Uses external (non-volatile) memory only the first time
+    if(dat_status_state[index] == DAT_CACHE_INVALID)
+    {
+        dat_status_cache[index] = _dat_load_status_var(index);
+        dat_status_state[index] = DAT_CACHE_CLEAN;
+    }
+    value_1 = dat_status_cache[index];
+
+    //Exit critical zone
+    osSemaphoreGiven(&repo_data_sem);
+#endif
+    return value_1;
+}
+
+int dat_get_status_snapshot(value32_t *out)
+{
+    return dat_get_status_vars(0, out, dat_status_last_address);
+}
+
+int dat_get_status_vars(dat_status_address_t first, value32_t *out, int n)
+{
+    int rc = 0;
+    assert(first + n <= dat_status_last_address);
+
+    //Use internal (volatile) memory, without the lock
+#if SCH_STORAGE_MODE == 0
+    rc = _dat_read_ram(first, out, n);
+    if(rc != 0)
+    {
+        LOGE(tag, "Unable to get a correct value for %d variables from index %d", rc, first);
+        rc = -1;
+    }
+    //Uses external (non-volatile) memory, only for the variables not cached yet
+#else
+    int index;
+
+    //Enter critical zone
+    osSemaphoreTake(&repo_data_sem, portMAX_DELAY);
+
+    for(index = first; index < first + n; index++)
+    {
+        if(dat_status_state[index] == DAT_CACHE_INVALID)
+            break;
+    }
+
+    if(index < first + n)
+        rc = _dat_load_status_vars(index);
+    memcpy(out, &dat_status_cache[first], n * sizeof(value32_t));
+
+    //Exit critical zone
+    osSemaphoreGiven(&repo_data_sem);
 #endif
 
+    return rc;
+}
+
+int dat_subscribe_status_vars(dat_status_address_t *index, int n, osQueue queue)
+{
+    int i, rc = -1;
     //Enter critical zone
     osSemaphoreTake(&repo_data_sem, portMAX_DELAY);
 
-    //Use internal (volatile) memory
+    if(dat_subs_n < DAT_SUBS_MAX)
+    {
+        dat_subscription_t *sub = &dat_subs[dat_subs_n];
+        memset(sub->mask, 0, sizeof(sub->mask));
+        sub->queue = queue;
+        for(i = 0; i < n; i++)
+        {
+            assert(index[i] < dat_status_last_address);
+            sub->mask[index[i] / 32] |= 1u << (index[i] % 32);
+            dat_subs_any[index[i] / 32] |= 1u << (index[i] % 32);
+        }
+        dat_subs_n++;
+        rc = 0;
+    }
+
+    //Exit critical zone
+    osSemaphoreGiven(&repo_data_sem);
+
+    if(rc != 0)
+        LOGE(tag, "Unable to subscribe to status variables, max %d subscriptions", DAT_SUBS_MAX);
+    return rc;
+}
+
+/**
+ * Send the changed variables, with their new values, to the subscribed
+ * queues. Notifications are dropped if a queue is full, it never blocks.
+ * Must be called with repo_data_sem taken.
+ *
+ * @param changed Bitmask of the addresses changed
+ */
+static void _dat_notify(uint32_t *changed)
+{
+    int word, sub;
+    for(word = 0; word < DAT_SUBS_WORDS; word++)
+    {
+        uint32_t bits = changed[word] & dat_subs_any[word];
+        while(bits)
+        {
+            int bit = __builtin_ctz(bits);
+            bits &= bits - 1;
+            dat_sys_var_short_t change;
+            change.address = (uint16_t)(word * 32 + bit);
 #if SCH_STORAGE_MODE == 0
-    value_1 = DAT_SYSTEM_VAR_BUFF[index];
-    //Uses tripled writing
-    #if SCH_STORAGE_TRIPLE_WR == 1
-        value_2 = DAT_SYSTEM_VAR_BUFF[index + dat_status_last_address];
-        value_3 = DAT_SYSTEM_VAR_BUFF[index + dat_status_last_address * 2];
-    #endif
-    //Uses external (non-volatile) memory
+            change.value = DAT_SYSTEM_VAR_BUFF[change.address];
 #else
-    value_1.i = storage_repo_get_value_idx(index, DAT_REPO_SYSTEM);
-    //Uses tripled writing
-    #if SCH_STORAGE_TRIPLE_WR == 1
-        value_2.i = storage_repo_get_value_idx(index + dat_status_last_address, DAT_REPO_SYSTEM);
-        value_3.i = storage_repo_get_value_idx(index + dat_status_last_address * 2, DAT_REPO_SYSTEM);
-    #endif
+            change.value = dat_status_cache[change.address];
+#endif
+            for(sub = 0; sub < dat_subs_n; sub++)
+            {
+                if((dat_subs[sub].mask[word] & (1u << bit)) &&
+                   osQueueSend(dat_subs[sub].queue, &change, 0) != pdPASS)
+                    LOGW(tag, "Status variable %d change not notified, queue full", change.address);
+            }
+        }
+    }
+}
+
+int dat_flush(void)
+{
+    int rc = 0;
+#if SCH_STORAGE_MODE > 0
+    osSemaphoreTake(&repo_data_sem, portMAX_DELAY);
+    rc = _dat_flush();
+    if(storage_commit() != 0)
+        rc = -1;
+    osSemaphoreGiven(&repo_data_sem);
+#endif
+    return rc;
+}
+
+int dat_scrub_status_vars(void)
+{
+    int repaired = 0;
+#if SCH_STORAGE_TRIPLE_WR == 1
+    int index;
+    //Enter critical zone
+    osSemaphoreTake(&repo_data_sem, portMAX_DELAY);
+
+#if SCH_STORAGE_MODE == 0
+    uint32_t *copy_1 = (uint32_t *)DAT_SYSTEM_VAR_BUFF;
+    uint32_t *copy_2 = copy_1 + dat_status_last_address;
+    uint32_t *copy_3 = copy_2 + dat_status_last_address;
+    //Readers only retry if there is something to repair
+    if(_dat_count_divergent(copy_1, copy_2, copy_3, dat_status_last_address) > 0)
+    {
+        _dat_write_begin();
+        repaired = _dat_vote_words(copy_1, copy_2, copy_3, dat_scrub_upset, dat_status_last_address);
+        _dat_write_end();
+    }
+#else
+    uint32_t *copy_1 = (uint32_t *)dat_load_value;
+    uint32_t *copy_2 = copy_1 + dat_status_last_address;
+    uint32_t *copy_3 = copy_2 + dat_status_last_address;
+    //Vote the storage content, with the pending changes
+    if(_dat_flush() != 0 ||
+       storage_repo_get_values(dat_load_value, dat_status_last_address * 3, DAT_REPO_SYSTEM) != 0)
+        repaired = -1;
+    else if(_dat_count_divergent(copy_1, copy_2, copy_3, dat_status_last_address) > 0)
+    {
+        int n = 0;
+        repaired = _dat_vote_words(copy_1, copy_2, copy_3, dat_scrub_upset, dat_status_last_address);
+        for(index = 0; index < dat_status_last_address; index++)
+        {
+            if(!dat_scrub_upset[index])
+                continue;
+            dat_flush_index[n] = index;
+            dat_flush_index[n + 1] = index + dat_status_last_address;
+            dat_flush_index[n + 2] = index + dat_status_last_address * 2;
+            dat_flush_value[n] = dat_flush_value[n + 1] = dat_flush_value[n + 2] = dat_load_value[index];
+            dat_status_cache[index].u = copy_1[index];
+            dat_status_state[index] = DAT_CACHE_CLEAN;
+            n += 3;
+        }
+        if(storage_repo_set_values_idx(dat_flush_index, dat_flush_value, n, DAT_REPO_SYSTEM) != 0)
+        {
+            LOGE(tag, "Unable to write %d repaired status variables", repaired);
+            repaired = -1;
+        }
+    }
 #endif
 
+    if(repaired > 0)
+    {
+        for(index = 0; index < dat_status_last_address; index++)
+            dat_status_upsets[index] += dat_scrub_upset[index];
+    }
+
     //Exit critical zone
     osSemaphoreGiven(&repo_data_sem);
-    
-    // Compare values in tripled reading
+#endif
+    return repaired;
+}
+
+void dat_get_status_upsets(uint32_t *upsets)
+{
+    osSemaphoreTake(&repo_data_sem, portMAX_DELAY);
+    memcpy(upsets, dat_status_upsets, sizeof(dat_status_upsets));
+    osSemaphoreGiven(&repo_data_sem);
+}
+
+#if SCH_STORAGE_MODE > 0
+/**
+ * Write the dirty status variables (and their copies) to the storage in one
+ * transaction. Must be called with repo_data_sem taken.
+ *
+ * @return 0 if OK, -1 in case of error. The variables remain dirty on errors
+ */
+static int _dat_flush(void)
+{
+    if(dat_status_dirty == 0)
+        return 0;
+
+    int index, copy, n = 0;
+    for(index = 0; index < dat_status_last_address; index++)
+    {
+        if(dat_status_state[index] != DAT_CACHE_DIRTY)
+            continue;
+        for(copy = 0; copy < DAT_CACHE_COPIES; copy++)
+        {
+            dat_flush_index[n] = index + copy * dat_status_last_address;
+            dat_flush_value[n] = dat_status_cache[index].i;
+            n++;
+        }
+    }
+
+    if(storage_repo_set_values_idx(dat_flush_index, dat_flush_value, n, DAT_REPO_SYSTEM) != 0)
+    {
+        LOGE(tag, "Unable to write %d status variables", dat_status_dirty);
+        return -1;
+    }
+
+    for(index = 0; index < dat_status_last_address; index++)
+    {
+        if(dat_status_state[index] == DAT_CACHE_DIRTY)
+            dat_status_state[index] = DAT_CACHE_CLEAN;
+    }
+    dat_status_dirty = 0;
+    return 0;
+}
+
+/**
+ * Update a status variable in the cache and mark it dirty. Must be called with
+ * repo_data_sem taken.
+ *
+ * @param index Variable index
+ * @param value Variable value
+ */
+static void _dat_cache_status_var(dat_status_address_t index, value32_t value, uint32_t *changed)
+{
+    //Compare with the stored value, read once for all the variables not
+    //cached yet
+    if(dat_status_state[index] == DAT_CACHE_INVALID)
+        _dat_load_status_vars(index);
+    if(dat_status_state[index] != DAT_CACHE_INVALID && dat_status_cache[index].u == value.u)
+        return;
+
+    changed[index / 32] |= 1u << (index % 32);
+    dat_status_cache[index] = value;
+    if(dat_status_state[index] != DAT_CACHE_DIRTY)
+    {
+        if(dat_status_dirty == 0)
+            dat_status_dirty_tick = osTaskGetTickCount();
+        dat_status_state[index] = DAT_CACHE_DIRTY;
+        dat_status_dirty++;
+    }
+}
+
+/**
+ * Read the status variables not cached yet, from @first to the last one,
+ * with one query for the whole repository (and the copies). Must be called
+ * with repo_data_sem taken.
+ *
+ * @return 0 if OK, -1 in case of error
+ */
+static int _dat_load_status_vars(dat_status_address_t first)
+{
+    int index;
+    int rc = storage_repo_get_values(dat_load_value, dat_status_last_address * DAT_CACHE_COPIES, DAT_REPO_SYSTEM);
+    for(index = first; rc == 0 && index < dat_status_last_address; index++)
+    {
+        if(dat_status_state[index] != DAT_CACHE_INVALID)
+            continue;
+        value32_t value_1 = {.i = dat_load_value[index]};
 #if SCH_STORAGE_TRIPLE_WR == 1
+        value32_t value_2 = {.i = dat_load_value[index + dat_status_last_address]};
+        value32_t value_3 = {.i = dat_load_value[index + dat_status_last_address * 2]};
+        value_1 = _dat_vote_status_var(index, value_1, value_2, value_3);
+#endif
+        dat_status_cache[index] = value_1;
+        dat_status_state[index] = DAT_CACHE_CLEAN;
+    }
+    return rc;
+}
+
+/**
+ * Write the dirty status variables if the oldest change reached the
+ * durability window (@see SCH_STORAGE_FLUSH_MS). Must be called with
+ * repo_data_sem taken.
+ *
+ * @return 0 if OK, -1 in case of error
+ */
+static int _dat_flush_if_old(void)
+{
+    //Write through, or the oldest change reached the durability window
+    if(SCH_STORAGE_FLUSH_MS == 0 ||
+       osTaskGetTickCount() - dat_status_dirty_tick >= osDefineTime(SCH_STORAGE_FLUSH_MS))
+        return _dat_flush();
+    return 0;
+}
+
+/**
+ * Read a status variable from the storage, comparing its copies if tripled
+ * writing is enabled. Must be called with repo_data_sem taken.
+ *
+ * @param index Variable index
+ * @return Variable value
+ */
+static value32_t _dat_load_status_var(dat_status_address_t index)
+{
+    value32_t value_1;
+    value_1.i = storage_repo_get_value_idx(index, DAT_REPO_SYSTEM);
+
+#if SCH_STORAGE_TRIPLE_WR == 1
+    value32_t value_2;
+    value32_t value_3;
+    value_2.i = storage_repo_get_value_idx(index + dat_status_last_address, DAT_REPO_SYSTEM);
+    value_3.i = storage_repo_get_value_idx(index + dat_status_last_address * 2, DAT_REPO_SYSTEM);
+    value_1 = _dat_vote_status_var(index, value_1, value_2, value_3);
+#endif
+    return value_1;
+}
+#endif
+
+#if SCH_STORAGE_TRIPLE_WR == 1
+/**
+ * Compare a status variable value with its copies (tripled writing)
+ *
+ * @param index Variable index, for logging
+ * @return The value of the majority, or the first copy if all are different
+ */
+static value32_t _dat_vote_status_var(dat_status_address_t index, value32_t value_1, value32_t value_2, value32_t value_3)
+{
+    if(_dat_vote(value_1, value_2, value_3, &value_1) != 0)
+        LOGE(tag, "Unable to get a correct value for index %d", index);
+    return value_1;
+}
+
+/**
+ * Majority vote of a variable and its two copies, without logging.
+ *
+ * @param value Stores the value of the majority, or the first copy if all
+ * are different
+ * @return 0 if OK, -1 if all copies are different
+ */
+static int _dat_vote(value32_t value_1, value32_t value_2, value32_t value_3, value32_t *value)
+{
     //Compare value and its copies
     if (value_1.u == value_2.u || value_1.u == value_3.u)
-        return value_1;
+        *value = value_1;
     else if (value_2.u == value_3.u)
-        return value_2;
+        *value = value_2;
     else
-        LOGE(tag, "Unable to get a correct value for index %d", index);
+    {
+        *value = value_1;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Count the words that differ in any of their three copies. Branch free, so
+ * the compiler can vectorize it.
+ *
+ * @return Number of divergent words, 0 if all copies agree
+ */
+static int _dat_count_divergent(const uint32_t *__restrict__ copy_1, const uint32_t *__restrict__ copy_2,
+                                const uint32_t *__restrict__ copy_3, int n)
+{
+    int i, divergent = 0;
+    for(i = 0; i < n; i++)
+        divergent += ((copy_1[i] ^ copy_2[i]) | (copy_1[i] ^ copy_3[i])) != 0;
+    return divergent;
+}
+
+/**
+ * Bitwise majority vote of @n words and their two copies, the three copies
+ * are overwritten with the result. Unlike _dat_vote, a word still gets a
+ * value if each copy has a different bit flipped. Branch free, so the
+ * compiler can vectorize it.
+ *
+ * @param upset Array of @n flags, set to 1 for the words that diverged
+ * @return Number of words that diverged
+ */
+static int _dat_vote_words(uint32_t *__restrict__ copy_1, uint32_t *__restrict__ copy_2,
+                           uint32_t *__restrict__ copy_3, uint32_t *__restrict__ upset, int n)
+{
+    int i, repaired = 0;
+    for(i = 0; i < n; i++)
+    {
+        uint32_t a = copy_1[i], b = copy_2[i], c = copy_3[i];
+        uint32_t majority = (a & b) | (a & c) | (b & c);
+        upset[i] = ((a ^ b) | (a ^ c)) != 0;
+        repaired += upset[i];
+        copy_1[i] = copy_2[i] = copy_3[i] = majority;
+    }
+    return repaired;
+}
 #endif
-    return value_1;
+
+/**
+ * Start an update protected by the sequence @seq, readers will retry until
+ * @c _dat_seq_end. Must be called with repo_data_sem taken.
+ */
+static void _dat_seq_begin(uint32_t *seq)
+{
+    DAT_STORE(seq, *seq + 1, RELAXED);
+    DAT_FENCE(RELEASE);
+}
+
+/**
+ * Publish an update started with @c _dat_seq_begin
+ */
+static void _dat_seq_end(uint32_t *seq)
+{
+    DAT_STORE(seq, *seq + 1, RELEASE);
 }
 
+#if SCH_STORAGE_MODE == 0
+/**
+ * Start an update of the RAM repository, readers will retry until
+ * @c _dat_write_end. Must be called with repo_data_sem taken.
+ */
+static void _dat_write_begin(void)
+{
+    _dat_seq_begin(&dat_status_seq);
+}
+
+/**
+ * Publish an update of the RAM repository started with @c _dat_write_begin
+ */
+static void _dat_write_end(void)
+{
+    _dat_seq_end(&dat_status_seq);
+}
+
+/**
+ * Write a variable (and its copies) to the RAM repository, only if the value
+ * changed. Must be called between @c _dat_write_begin and @c _dat_write_end.
+ *
+ * @param changed Addresses bitmask, the variable is marked if it changed
+ */
+static void _dat_write_ram(dat_status_address_t index, value32_t value, uint32_t *changed)
+{
+    value32_t old = DAT_SYSTEM_VAR_BUFF[index];
+    //Uses tripled writing, also rewrite a damaged copy
+#if SCH_STORAGE_TRIPLE_WR == 1
+    value32_t old_2 = DAT_SYSTEM_VAR_BUFF[index + dat_status_last_address];
+    value32_t old_3 = DAT_SYSTEM_VAR_BUFF[index + dat_status_last_address * 2];
+    if(old.u == value.u && old_2.u == value.u && old_3.u == value.u)
+        return;
+    _dat_vote(old, old_2, old_3, &old);
+    DAT_STORE(&DAT_SYSTEM_VAR_BUFF[index + dat_status_last_address].u, value.u, RELAXED);
+    DAT_STORE(&DAT_SYSTEM_VAR_BUFF[index + dat_status_last_address * 2].u, value.u, RELAXED);
+#else
+    if(old.u == value.u)
+        return;
+#endif
+    DAT_STORE(&DAT_SYSTEM_VAR_BUFF[index].u, value.u, RELAXED);
+    if(old.u != value.u)
+        changed[index / 32] |= 1u << (index % 32);
+}
+
+/**
+ * Copy @n consecutive variables of the RAM repository, all from the same
+ * update, voting the copies with tripled writing.
+ *
+ * @return Number of variables without a majority, 0 if OK
+ */
+static int _dat_read_copy(dat_status_address_t index, value32_t *out, int n)
+{
+    int i, errors = 0;
+    for(i = 0; i < n; i++)
+    {
+        out[i].u = DAT_LOAD(&DAT_SYSTEM_VAR_BUFF[index + i].u, RELAXED);
+#if SCH_STORAGE_TRIPLE_WR == 1
+        value32_t value_2, value_3;
+        value_2.u = DAT_LOAD(&DAT_SYSTEM_VAR_BUFF[index + i + dat_status_last_address].u, RELAXED);
+        value_3.u = DAT_LOAD(&DAT_SYSTEM_VAR_BUFF[index + i + dat_status_last_address * 2].u, RELAXED);
+        errors -= _dat_vote(out[i], value_2, value_3, &out[i]);
+#endif
+    }
+    return errors;
+}
+
+/**
+ * Read @n consecutive variables of the RAM repository as one snapshot. The
+ * lock is only taken if writers keep changing the repository.
+ *
+ * @return Number of variables without a majority, 0 if OK
+ */
+static int _dat_read_ram(dat_status_address_t index, value32_t *out, int n)
+{
+    int retry, errors;
+    uint32_t seq;
+
+    for(retry = 0; retry < DAT_SEQ_RETRIES; retry++)
+    {
+        seq = DAT_LOAD(&dat_status_seq, ACQUIRE);
+        if(seq & 1)
+            continue;
+        errors = _dat_read_copy(index, out, n);
+        DAT_FENCE(ACQUIRE);
+        if(DAT_LOAD(&dat_status_seq, RELAXED) == seq)
+            return errors;
+    }
+
+    //Wait for the writer to finish
+    osSemaphoreTake(&repo_data_sem, portMAX_DELAY);
+    errors = _dat_read_copy(index, out, n);
+    osSemaphoreGiven(&repo_data_sem);
+    return errors;
+}
+#endif
+
 value32_t dat_get_status_var_name(char *name)
 {
     dat_sys_var_t var = dat_get_status_var_def_name(name);
@@ -545,6 +1383,26 @@ int dat_show_time(int format)
     return 0;
 }
 
+/**
+ * Move the ack index of a payload to the oldest sample still stored, if the
+ * samples not acknowledged were discarded to reclaim their memory section
+ *
+ * @param payload Payload id
+ * @param next Payload index, the next sample to write
+ */
+static void _dat_payload_check_ack(int payload, int next)
+{
+    int first = storage_get_payload_first(payload, next);
+    if(first <= 0)
+        return;
+    int ack = dat_get_system_var(data_map[payload].sys_ack);
+    if(ack < first)
+    {
+        LOGW(tag, "Payload %d samples %d to %d discarded before acknowledged", payload, ack, first - 1);
+        dat_set_system_var(data_map[payload].sys_ack, first);
+    }
+}
+
 int dat_add_payload_sample(void* data, int payload)
 {
     int ret;
@@ -567,6 +1425,7 @@ int dat_add_payload_sample(void* data, int payload)
     // Update address
     if (ret >= 0) {
         dat_set_system_var(data_map[payload].sys_index, index+1+ret);
+        _dat_payload_check_ack(payload, index+1+ret);
         return index+1+ret;
     } else {
         LOGE(tag, "Couldn't set data payload %d", payload);
@@ -578,6 +1437,12 @@ int dat_get_payload_sample(void*data, int payload, int index)
 {
     int ret;
 
+    if(index < dat_get_payload_first(payload))
+    {
+        LOGE(tag, "Payload %d sample %d was discarded", payload, index);
+        return -1;
+    }
+
     osSemaphoreTake(&repo_data_sem, portMAX_DELAY);
 
     ret = storage_get_payload_data(index, data, payload);
@@ -587,6 +1452,40 @@ int dat_get_payload_sample(void*data, int payload, int index)
 }
 
 
+int dat_get_payload_range(int payload, int from, int count, void *out)
+{
+    int ret;
+    if(payload < 0 || payload >= last_sensor || from < 0 || count < 0)
+    {
+        LOGE(tag, "Invalid range %d, %d of payload %d", from, count, payload);
+        return -1;
+    }
+
+    // Only the samples stored so far, and not discarded
+    int index = dat_get_system_var(data_map[payload].sys_index);
+    if(from < storage_get_payload_first(payload, index))
+    {
+        LOGW(tag, "Payload %d samples from %d were discarded", payload, from);
+        return 0;
+    }
+    if(count > index - from)
+        count = index - from > 0 ? index - from : 0;
+
+    osSemaphoreTake(&repo_data_sem, portMAX_DELAY);
+    ret = storage_get_payload_range(from, count, out, payload);
+    osSemaphoreGiven(&repo_data_sem);
+
+    return ret;
+}
+
+int dat_get_payload_first(int payload)
+{
+    if(payload < 0 || payload >= last_sensor)
+        return -1;
+    int index = dat_get_system_var(data_map[payload].sys_index);
+    return storage_get_payload_first(payload, index);
+}
+
 int dat_get_recent_payload_sample(void* data, int payload, int offset)
 {
     int ret;
@@ -599,7 +1498,7 @@ int dat_get_recent_payload_sample(void* data, int payload, int offset)
 //FIXME: Is this conditional required?
 //FIXME: Use STORAGE_MODE
 #if defined(LINUX) || defined(NANOMIND)
-    if(index-1-offset >= 0) {
+    if(index-1-offset >= storage_get_payload_first(payload, index)) {
         ret = storage_get_payload_data(index-1-offset, data, payload);
     }
     else {
@@ -622,6 +1521,7 @@ int dat_delete_memory_sections(void)
     {
         // Lock is acquired inside the function
         dat_set_system_var(data_map[i].sys_index, 0);
+        dat_set_system_var(data_map[i].sys_ack, 0);
     }
 
     //Enter critical zone
@@ -642,112 +1542,40 @@ int dat_delete_memory_sections(void)
 }
 
 
-int get_payloads_tokens(char** tok_sym, char** tok_var, char* order, char* var_names, int i)
+void get_value_string(char* ret_string, const dat_payload_field_t *field, const void* data)
 {
-    const char s[2] = " ";
-    tok_sym[0] = strtok(order, s);
-
-    int j=0;
-    while(tok_sym[j] != NULL) {
-        j++;
-        tok_sym[j] = strtok(NULL, s);
-    }
-
-    tok_var[0] = strtok(var_names, s);
-
-    j=0;
-    while(tok_var[j] != NULL) {
-        j++;
-        tok_var[j] = strtok(NULL, s);
-    }
-    return j;
-}
-
-void get_value_string(char* ret_string, char* c_type, char* buff)
-{
-    if(strcmp(c_type, "%f") == 0) {
-        if (*((int *)buff) == -1) {
+    if(field->type == 'f') {
+        int32_t bits = 0;
+        if(field->size == sizeof(float))
+            memcpy(&bits, (const uint8_t *)data + field->offset, sizeof(bits));
+        if (bits == -1) {
             sprintf(ret_string, " 'nan'");
         } else {
-            sprintf(ret_string, " %f", *((float*)buff));
+            sprintf(ret_string, " %f", dat_get_payload_field_real(field, data));
         }
     }
-    else if(strcmp(c_type, "%d") == 0) {
-        sprintf(ret_string, " %d", *((int*)buff));
-    }
-    else if(strcmp(c_type, "%u") == 0) {
-        sprintf(ret_string, " %u", *((unsigned int*)buff));
-    } else if(strcmp(c_type, "%i") == 0) {
-        sprintf(ret_string," %i", *((int*)buff));
-    }
-}
-
-int get_sizeof_type(char* c_type)
-{
-    if(strcmp(c_type, "%f") == 0) {
-        return sizeof(float);
-    }
-    else if(strcmp(c_type, "%d") == 0) {
-        return sizeof(int);
-    } else if(strcmp(c_type, "%u") == 0) {
-        return sizeof(int);
-    } else if(strcmp(c_type, "%i") == 0) {
-        return sizeof(int);
+    else if(field->type == 'd') {
+        sprintf(ret_string, " %lld", (long long)dat_get_payload_field_int(field, data));
     }
     else {
-        return -1;
+        sprintf(ret_string, " %llu", (unsigned long long)dat_get_payload_field_int(field, data));
     }
 }
 
 int dat_print_payload_struct(void* data, unsigned int payload)
 {
-    //FIXME: Buffers allocated in stack with magical numbers! Use defined values
-    //FIXME: Use malloc to allocate large buffers, here 1280  bytes allocated!
-    //FIXME: Task stack size: 5*256 = 1280 bytes!
-
-    char* tok_sym[300];
-    char* tok_var[300];
-//    char** tok_sym = (char**)malloc(300);
-//    char** tok_var = (char**)malloc(300);
-    char *order = (char *)malloc(300);
-    strcpy(order, data_map[payload].data_order);
-    char *var_names = (char *)malloc(1000);
-    strcpy(var_names, data_map[payload].var_names);
-    int nparams = get_payloads_tokens(tok_sym, tok_var, order, var_names, (int)payload);
-
-    char *values = (char *)malloc(1000);
-    char *names = (char *)malloc(1000);
-    strcpy(names, "");
-    strcpy(values, "");
-
-    int j;
-    for(j=0; j < nparams; ++j) {
-        int param_size = get_sizeof_type(tok_sym[j]);
-        char buff[param_size];
-        memcpy(buff, data+(j*param_size), param_size);
-
-        char name[20];
-        sprintf(name, " %s", tok_var[j]);
-        strcat(names, name);
-
-        char val[20];
-        get_value_string(val, tok_sym[j], buff);
-        strcat(values, val);
-
-        if(j != nparams-1){
-            strcat(names, ",");
-            strcat(values, ",");
-        }
-    }
-    strcat(names, ":");
-    printf( "%s %s\n", names, values);
+    int nfields, j;
+    const dat_payload_field_t *fields = dat_get_payload_fields((int)payload, &nfields);
+    if(fields == NULL)
+        return -1;
 
-    free(order);
-    free(var_names);
-    free(values);
-    free(names);
-//    free(tok_sym);
-//    free(tok_var);
+    for(j=0; j < nfields; ++j)
+        printf(" %s%s", fields[j].name, j != nfields-1 ? "," : ": ");
+    for(j=0; j < nfields; ++j) {
+        char val[48];
+        get_value_string(val, &fields[j], data);
+        printf("%s%s", val, j != nfields-1 ? "," : "\n");
+    }
 
     return 0;
 }
@@ -772,50 +1600,4 @@ int dat_stmachine_is_sensor_active(int payload, int active_payloads, int n_paylo
         return 0;
     }
     return ( (active_payloads & (1 << payload)) != 0 );
-}
-
-void _get_sat_quaterion(quaternion_t *q,  dat_status_address_t index)
-{
-    assert(index+4 < dat_status_last_address);
-    int i;
-    for(i=0; i<4; i++)
-    {
-        value32_t v = dat_get_status_var(index+i);
-        q->q[i] = (double)v.f;
-    }
-}
-
-void _set_sat_quaterion(quaternion_t *q,  dat_status_address_t index)
-{
-    assert(index+4 < dat_status_last_address);
-    int i;
-    for(i=0; i<4; i++)
-    {
-        value32_t v;
-        v.f = (float)q->q[i];
-        dat_set_status_var(index + i, v);
-    }
-}
-
-void _get_sat_vector(vector3_t *r, dat_status_address_t index)
-{
-    assert(index+3 < dat_status_last_address);
-    int i;
-    for(i=0; i<3; i++)
-    {
-        value32_t v= dat_get_status_var(index+i);
-        r->v[i] = (double)v.f;
-    }
-}
-
-void _set_sat_vector(vector3_t *r, dat_status_address_t index)
-{
-    assert(index+3 < dat_status_last_address);
-    int i;
-    for(i=0; i<3; i++)
-    {
-        value32_t v;
-        v.f = (float)r->v[i];
-        dat_set_status_var(index + i, v);
-    }
 }
\ No newline at end of file
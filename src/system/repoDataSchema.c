@@ -7,22 +7,81 @@
  * This file initilize some structs needed for data schema.
  */
 
+#include <stddef.h>
 #include "repoDataSchema.h"
 static const char *tag = "repoDataSchema";
 
+///< A dat_status_table entry from a DAT_STATUS_VARS entry
+#define DAT_STATUS_VAR_ADDR(name, type, status, value) [dat_##name] = DAT_STATUS_VAR_DEF(name, type, status, value)
+
+/**
+ * Status variables definitions indexed by address, built by the compiler from
+ * DAT_STATUS_VARS
+ */
+static const dat_sys_var_t dat_status_table[dat_status_last_address] = {
+    DAT_STATUS_VARS(DAT_STATUS_VAR_ADDR)
+};
+
+///< A dat_group_table entry from a DAT_STATUS_GROUPS entry
+#define DAT_GROUP_DEF(name, size, mirror) \
+    [dat_grp_##name] = {dat_grp_##name, #name, offsetof(dat_groups_t, name) / sizeof(double), size, mirror},
+
+/**
+ * Status groups definitions indexed by address, built from DAT_STATUS_GROUPS
+ */
+static const dat_group_def_t dat_group_table[dat_group_last_address] = {
+    DAT_STATUS_GROUPS(DAT_GROUP_DEF)
+};
+
+/**
+ * Name to address index, open addressing with linear probing. Slots store the
+ * address + 1, 0 if empty. The size is a power of 2 at least twice the number
+ * of variables so probes are short.
+ */
+#define DAT_STATUS_HASH_SIZE 256
+static uint8_t dat_status_hash[DAT_STATUS_HASH_SIZE];
+static int dat_status_hash_ready = 0;
+typedef char dat_status_hash_check_t[2*dat_status_last_address <= DAT_STATUS_HASH_SIZE && dat_status_last_address < 255 ? 1 : -1];
+
+/**
+ * FNV-1a hash of a variable name
+ */
+static uint32_t _dat_hash_name(const char *name)
+{
+    uint32_t hash = 2166136261u;
+    while(*name)
+    {
+        hash ^= (uint8_t)*name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void dat_status_var_def_init(void)
+{
+    int address;
+    uint32_t slot;
+
+    if(dat_status_hash_ready)
+        return;
+
+    memset(dat_status_hash, 0, sizeof(dat_status_hash));
+    for(address = 0; address < dat_status_last_address; address++)
+    {
+        slot = _dat_hash_name(dat_status_table[address].name) & (DAT_STATUS_HASH_SIZE - 1);
+        while(dat_status_hash[slot] != 0)
+            slot = (slot + 1) & (DAT_STATUS_HASH_SIZE - 1);
+        dat_status_hash[slot] = (uint8_t)(address + 1);
+    }
+    dat_status_hash_ready = 1;
+}
+
 dat_sys_var_t dat_get_status_var_def(dat_status_address_t address)
 {
     dat_sys_var_t var = {0};
-    int i;
 
     if(address < dat_status_last_address)
-    {
-        for (i = 0; i < dat_status_last_var; i++)
-        {
-            if (dat_status_list[i].address == address)
-                return dat_status_list[i];
-        }
-    }
+        return dat_status_table[address];
 
     LOGE(tag, "Status var not found! (%d)", address);
     return var;
@@ -32,14 +91,18 @@ dat_sys_var_t dat_get_status_var_def_name(char *name)
 {
     dat_sys_var_t var;
     var.status = -1;
-    int i;
+    uint32_t slot;
 
     if(name != NULL)
     {
-        for (i = 0; i < dat_status_last_var; i++)
+        dat_status_var_def_init();
+        slot = _dat_hash_name(name) & (DAT_STATUS_HASH_SIZE - 1);
+        while(dat_status_hash[slot] != 0)
         {
-            if (strcmp(dat_status_list[i].name, name) == 0)
-                return dat_status_list[i];
+            const dat_sys_var_t *def = &dat_status_table[dat_status_hash[slot] - 1];
+            if(strcmp(def->name, name) == 0)
+                return *def;
+            slot = (slot + 1) & (DAT_STATUS_HASH_SIZE - 1);
         }
     }
 
@@ -66,3 +129,187 @@ void dat_print_system_var(dat_sys_var_t *status)
     }
 }
 
+dat_group_def_t dat_get_group_def(dat_group_address_t address)
+{
+    dat_group_def_t group = {0};
+
+    if(address < dat_group_last_address)
+        return dat_group_table[address];
+
+    LOGE(tag, "Status group not found! (%d)", address);
+    return group;
+}
+
+/**
+ * Payload fields compiled from data_map, the fields of a payload are
+ * contiguous. The pool fits the sta_data fields plus the other payloads.
+ */
+#define DAT_PAYLOAD_FIELDS_MAX (dat_status_last_address + 64)
+static dat_payload_field_t dat_payload_fields[DAT_PAYLOAD_FIELDS_MAX];
+static uint16_t dat_payload_first[last_sensor];     ///< First field of each payload
+static uint16_t dat_payload_nfields[last_sensor];   ///< Number of fields of each payload
+static int dat_payload_schema_ready = 0;
+
+/**
+ * Parse a field format, "%[hh|h|l|ll](u|d|i|f)"
+ * @return 0 if OK, -1 if the format is not supported
+ */
+static int _dat_parse_field_format(const char *format, dat_payload_field_t *field)
+{
+    int length = 0;     // Number of 'h' (negative) or 'l' (positive)
+    if(*format++ != '%')
+        return -1;
+    for(; *format == 'h'; format++)
+        length--;
+    for(; *format == 'l'; format++)
+        length++;
+
+    switch(*format)
+    {
+        case 'u':
+        case 'd':
+        case 'i':
+            field->type = *format == 'u' ? 'u' : 'd';
+            if(length == -2) field->size = 1;
+            else if(length == -1) field->size = 2;
+            else if(length == 0) field->size = 4;
+            else if(length == 2) field->size = 8;
+            else return -1;
+            break;
+        case 'f':
+            field->type = 'f';
+            if(length == 0) field->size = 4;
+            else if(length == 1) field->size = 8;
+            else return -1;
+            break;
+        default:
+            return -1;
+    }
+    return format[1] == '\0' ? 0 : -1;
+}
+
+void dat_payload_schema_init(void)
+{
+    int payload, n = 0;
+
+    if(dat_payload_schema_ready)
+        return;
+
+    for(payload = 0; payload < last_sensor; payload++)
+    {
+        char order[strlen(data_map[payload].data_order) + 1];
+        char names[strlen(data_map[payload].var_names) + 1];
+        char *order_save, *names_save;
+        strcpy(order, data_map[payload].data_order);
+        strcpy(names, data_map[payload].var_names);
+
+        int offset = 0;
+        dat_payload_first[payload] = (uint16_t)n;
+        char *format = strtok_r(order, " ", &order_save);
+        char *name = strtok_r(names, " ", &names_save);
+        while(format != NULL && name != NULL && n < DAT_PAYLOAD_FIELDS_MAX)
+        {
+            dat_payload_field_t *field = &dat_payload_fields[n++];
+            if(_dat_parse_field_format(format, field) != 0)
+            {
+                LOGE(tag, "Payload %s field %s format %s not supported", data_map[payload].table, name, format);
+                field->type = 'u';
+                field->size = 4;
+            }
+            strncpy(field->name, name, MAX_VAR_NAME - 1);
+            field->name[MAX_VAR_NAME - 1] = '\0';
+            field->offset = (uint16_t)offset;
+            offset += field->size;
+            format = strtok_r(NULL, " ", &order_save);
+            name = strtok_r(NULL, " ", &names_save);
+        }
+        dat_payload_nfields[payload] = (uint16_t)(n - dat_payload_first[payload]);
+
+        if(format != NULL || name != NULL || offset != data_map[payload].size)
+            LOGE(tag, "Payload %s schema does not match its struct (%d fields, %d of %d bytes)",
+                 data_map[payload].table, dat_payload_nfields[payload], offset, data_map[payload].size);
+    }
+    dat_payload_schema_ready = 1;
+}
+
+const dat_payload_field_t *dat_get_payload_fields(int payload, int *nfields)
+{
+    if(payload < 0 || payload >= last_sensor)
+    {
+        LOGE(tag, "Payload not found! (%d)", payload);
+        *nfields = 0;
+        return NULL;
+    }
+
+    dat_payload_schema_init();
+    *nfields = dat_payload_nfields[payload];
+    return &dat_payload_fields[dat_payload_first[payload]];
+}
+
+int64_t dat_get_payload_field_int(const dat_payload_field_t *field, const void *data)
+{
+    const uint8_t *buff = (const uint8_t *)data + field->offset;
+    if(field->type == 'f')
+        return (int64_t)dat_get_payload_field_real(field, data);
+
+    union {uint8_t u8; int8_t i8; uint16_t u16; int16_t i16; uint32_t u32; int32_t i32; int64_t i64;} v;
+    memcpy(&v, buff, field->size);
+    switch(field->size)
+    {
+        case 1: return field->type == 'u' ? (int64_t)v.u8 : (int64_t)v.i8;
+        case 2: return field->type == 'u' ? (int64_t)v.u16 : (int64_t)v.i16;
+        case 4: return field->type == 'u' ? (int64_t)v.u32 : (int64_t)v.i32;
+        default: return v.i64;
+    }
+}
+
+double dat_get_payload_field_real(const dat_payload_field_t *field, const void *data)
+{
+    const uint8_t *buff = (const uint8_t *)data + field->offset;
+    if(field->type != 'f')
+        return (double)dat_get_payload_field_int(field, data);
+    if(field->size == sizeof(float))
+    {
+        float value;
+        memcpy(&value, buff, sizeof(value));
+        return (double)value;
+    }
+    double value;
+    memcpy(&value, buff, sizeof(value));
+    return value;
+}
+
+void dat_set_payload_field_int(const dat_payload_field_t *field, void *data, int64_t value)
+{
+    uint8_t *buff = (uint8_t *)data + field->offset;
+    if(field->type == 'f')
+    {
+        dat_set_payload_field_real(field, data, (double)value);
+        return;
+    }
+    switch(field->size)
+    {
+        case 1: { uint8_t v = (uint8_t)value; memcpy(buff, &v, 1); break; }
+        case 2: { uint16_t v = (uint16_t)value; memcpy(buff, &v, 2); break; }
+        case 4: { uint32_t v = (uint32_t)value; memcpy(buff, &v, 4); break; }
+        default: memcpy(buff, &value, 8);
+    }
+}
+
+void dat_set_payload_field_real(const dat_payload_field_t *field, void *data, double value)
+{
+    uint8_t *buff = (uint8_t *)data + field->offset;
+    if(field->type != 'f')
+    {
+        dat_set_payload_field_int(field, data, (int64_t)value);
+        return;
+    }
+    if(field->size == sizeof(float))
+    {
+        float v = (float)value;
+        memcpy(buff, &v, sizeof(v));
+    }
+    else
+        memcpy(buff, &value, sizeof(value));
+}
+
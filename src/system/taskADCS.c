@@ -55,6 +55,7 @@ void taskADCS(void *param)
 
     double P[6][6];
     _mat_set_diag((double*)P, 1.0,6, 6);
+    dat_set_group(dat_grp_ads_eskf_p, (double*)P);
 
     while(1)
     {
@@ -76,7 +77,7 @@ void taskADCS(void *param)
                 cmd_send(cmd_tle_prop);
 
                 vector3_t r;
-                _get_sat_vector(&r, dat_ads_pos_x);
+                dat_get_group(dat_grp_ads_position, r.v);
 
 
                 // Update magnetic
@@ -87,10 +88,10 @@ void taskADCS(void *param)
                 vector3_t mag_i = {6723.12366721, 10229.07189747, 15710.68799647};
 
                 quaternion_t q_est;
-                _get_sat_quaterion(&q_est, dat_ads_q0);
+                dat_get_group(dat_grp_ads_attitude, q_est.q);
 
                 vector3_t w;
-                _get_sat_vector(&w, dat_ads_omega_x);
+                dat_get_group(dat_grp_ads_omega, w.v);
 
                 // Calculate sun direction
                 uint32_t curr_time = (uint32_t) time(NULL);
@@ -106,8 +107,8 @@ void taskADCS(void *param)
 
                 // TODO: call function separately with its own mesuerement freq
 //                eskf_update_mag(mag_sensor, mag_i, P, &R, &q_est, &w);
-                _set_sat_quaterion(&q_est, dat_ads_q0);
-                _set_sat_vector(&w, dat_ads_omega_x);
+                dat_set_group(dat_grp_ads_attitude, q_est.q);
+                dat_set_group(dat_grp_ads_omega, w.v);
             }
         }
 
@@ -118,16 +119,18 @@ void taskADCS(void *param)
          */
         if ((elapsed_msec % _adcs_ctrl_period) == 0)
         {
+            // Control commands are useless after the next control period
+            portTick ctrl_deadline = osTaskGetTickCount() + osDefineTime(_adcs_ctrl_period);
             cmd_t *cmd_tle_prop = cmd_get_str("obc_prop_tle");
             cmd_add_params_str(cmd_tle_prop, "0");
-            cmd_send(cmd_tle_prop);
+            cmd_send_deadline(cmd_tle_prop, ctrl_deadline);
             // Update attitude
             cmd_t *cmd_stt = cmd_get_str("adcs_quat");
-            cmd_send(cmd_stt);
+            cmd_send_deadline(cmd_stt, ctrl_deadline);
             cmd_t *cmd_acc = cmd_get_str("adcs_acc");
-            cmd_send(cmd_acc);
+            cmd_send_deadline(cmd_acc, ctrl_deadline);
             cmd_t *cmd_mag = cmd_get_str("adcs_mag");
-            cmd_send(cmd_mag);
+            cmd_send_deadline(cmd_mag, ctrl_deadline);
             // Set target attitude
             //cmd_t *cmd_point = cmd_get_str("sim_adcs_set_target");
             //cmd_add_params_var(cmd_point, 1.0, 1.0, 1.0, 0.01, 0.01, 0.01);
@@ -145,7 +148,7 @@ void taskADCS(void *param)
             {
                 cmd_point = cmd_get_str("adcs_detumbling_mag");
             }
-            cmd_send(cmd_point);
+            cmd_send_deadline(cmd_point, ctrl_deadline);
             // Do control loop
             cmd_t *cmd_ctrl;
             if(mode == DAT_OBC_OPMODE_DETUMB_MAG)
@@ -154,12 +157,12 @@ void taskADCS(void *param)
             } else
             {
                 cmd_ctrl = cmd_get_str("adcs_do_control");
-                cmd_add_params_var(cmd_ctrl, _adcs_ctrl_period * 1000);
+                cmd_add_params_var(cmd_ctrl, (double)_adcs_ctrl_period * 1000);
             }
-            cmd_send(cmd_ctrl);
+            cmd_send_deadline(cmd_ctrl, ctrl_deadline);
             // Send telemetry to ADCS subsystem
             cmd_t *cmd_att = cmd_get_str("adcs_send_attitude");
-            cmd_send(cmd_att);
+            cmd_send_deadline(cmd_att, ctrl_deadline);
         }
 
         /* 1 hours actions */
@@ -182,20 +185,21 @@ void eskf_predict_state(double* P, double dt)
     vector3_t w;
     vector3_t wb = {0.0, 0.0, 0.0};
     vector3_t diffw;
-    _get_sat_quaterion(&q, dat_ads_q0);
-    _get_sat_vector(&w, dat_ads_omega_x);
+    dat_get_group(dat_grp_ads_attitude, q.q);
+    dat_get_group(dat_grp_ads_omega, w.v);
 
     quaternion_t q_est;
     vec_cons_mult(-1.0, &wb, NULL);
     vec_sum(w, wb, &diffw);
     eskf_integrate(q, diffw, dt, &q_est);
-    _set_sat_quaterion(&q_est, dat_ads_q0);
-//    _set_sat_vector(&w, dat_ads_omega_x);
+    dat_set_group(dat_grp_ads_attitude, q_est.q);
+//    dat_set_group(dat_grp_ads_omega, w.v);
 
     // Predict Error
     double Q[6][6];
     _mat_set_diag(Q, 1.0,6, 6);
     eskf_compute_error(diffw, dt, P, Q);
+    dat_set_group(dat_grp_ads_eskf_p, P);
 }
 
 void calc_magnetic_model(double decyear, double latrad, double lonrad, double altm, double* mag) {
@@ -152,6 +152,9 @@ void taskCommunications(void *param)
  *
  *      "help;send_cmd 10 help;ping 1;print_vars"
  *
+ * The commands of a frame are sent as one batch (@see cmd_send_batch) so they
+ * are executed in order, one after the other.
+ *
  * @param packet A csp buffer containing a null terminated string with the
  *               format <command> [parameters];<command> [parameters];...
  */
@@ -162,19 +165,33 @@ static void com_receive_tc(csp_packet_t *packet)
 
     // Search for the first ";" separated command
     char *cmd_str;
+    cmd_t *batch[SCH_CMD_BATCH_MAX];
+    int n_cmds = 0;
     cmd_str = strtok((char *)(packet->data), ";");
 
     while(cmd_str != NULL)
     {
-        // Parse and send command for execution
+        // Parse the command and add it to the batch
         LOGI(tag, "TC: %s", cmd_str);
         cmd_t *new_cmd = cmd_build_from_str(cmd_str);
         if (new_cmd != NULL)
-            cmd_send(new_cmd);
+            batch[n_cmds++] = new_cmd;
+
+        // Long telecommands are sent in several batches
+        if(n_cmds == SCH_CMD_BATCH_MAX)
+        {
+            cmd_send_batch(batch, n_cmds, portMAX_DELAY);
+            n_cmds = 0;
+        }
 
         // Search for the next ";" separated command
         cmd_str = strtok(NULL, ";");
     }
+
+    // Send all the commands for execution, in order and without interleaving
+    // commands from other tasks
+    if(n_cmds > 0)
+        cmd_send_batch(batch, n_cmds, portMAX_DELAY);
 }
 
 /**
@@ -224,6 +241,18 @@ static void com_receive_tm(csp_packet_t *packet)
         cmd_add_params_raw(cmd_parse_tm, frame, sizeof(com_frame_t));
         cmd_send(cmd_parse_tm);
     }
+    else if(frame->type == TM_TYPE_CMD_STATS)
+    {
+        cmd_parse_tm = cmd_get_str("tm_parse_cmd_stats");
+        cmd_add_params_raw(cmd_parse_tm, frame, sizeof(com_frame_t));
+        cmd_send(cmd_parse_tm);
+    }
+    else if(frame->type == TM_TYPE_GROUPS)
+    {
+        cmd_parse_tm = cmd_get_str("tm_parse_groups");
+        cmd_add_params_raw(cmd_parse_tm, frame, sizeof(com_frame_t));
+        cmd_send(cmd_parse_tm);
+    }
     else if(frame->type >= TM_TYPE_PAYLOAD && frame->type < TM_TYPE_PAYLOAD+last_sensor)
     {
         int payload = frame->type - TM_TYPE_PAYLOAD; // Payload type
@@ -233,9 +262,8 @@ static void com_receive_tm(csp_packet_t *packet)
         //FIXME: Use a command to add payloads to database
         //Save ndata payload samples to data storage
 
-        _ntoh32_buff(frame->data.data32, sizeof(frame->data.data8)/ sizeof(uint32_t));
-
         assert(frame->ndata*data_map[payload].size <= COM_FRAME_MAX_LEN);
+        _ntoh_payload_buff(frame->data.data8, payload, frame->ndata);
         for(j=0; j < frame->ndata; j++)
         {
             delay = j*data_map[payload].size; // Select next struct
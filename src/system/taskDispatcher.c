@@ -19,52 +19,691 @@
  */
 
 #include "taskDispatcher.h"
+#include "taskExecuter.h"
 
 static const char *tag = "Dispatcher";
 
+static osQueue dispatcher_ready_queue;                ///< One token per queued command
+static osSemaphore dispatcher_stat_sem;               ///< Guards the counters
+static dispatcher_stats_t dispatcher_stats;
+static int dispatcher_skipped[CMD_PRIO_LAST];         ///< Times a pending level was skipped
+static int dispatcher_ready = 0;
+
+/* Commands completion handles, see cmd_send_async */
+#define CMD_HANDLE_FREE 0           ///< In the pool
+#define CMD_HANDLE_PENDING 1        ///< Command sent, owner waiting or not
+#define CMD_HANDLE_DONE 2           ///< Command finished, result not released
+#define CMD_HANDLE_ABANDONED 3      ///< Released by the owner before the command finished
+
+static cmd_handle_t dispatcher_handles[SCH_CMD_HANDLES];
+static osSemaphore dispatcher_handle_sem;             ///< Guards the handles state
+
+/* Admission rules compiled for the current mode and battery, see check_if_executable */
+static cmd_admission_t dispatcher_admission;
+static portTick dispatcher_admission_tick;
+static int dispatcher_admission_ready = 0;
+
+/* Coalescible commands queued but not yet running, see cmd_set_coalesce */
+static cmd_t *dispatcher_pending[SCH_CMD_COALESCE_MAX];
+static osSemaphore dispatcher_pending_sem;            ///< Guards the pending commands
+
+/* Commands waiting for room in a full executer class queue, dispatcher task only */
+static cmd_t *dispatcher_held[CMD_CLASS_LAST];        ///< Checked command (or batch) of each class, sent when its queue has room
+static cmd_t *dispatcher_stalled[CMD_PRIO_LAST];      ///< Command read from each level while its class was held, the level waits for it
+
+static int dispatcher_select(void);
+static void dispatcher_dispatch(cmd_t *cmd, int cls);
+static int dispatcher_release_held(void);
+static int dispatcher_enqueue(cmd_t *cmd, int prio, int count, uint32_t timeout);
+static int dispatcher_coalesce(cmd_t *cmd);
+static cmd_t *dispatcher_check(cmd_t *cmd, portTick now);
+static void dispatcher_update_pool_status(void);
+static void dispatcher_update_queue_status(void);
+
+int dispatcher_init(void)
+{
+    int prio, rc = 0;
+    for(prio = 0; prio < CMD_PRIO_LAST; prio++)
+    {
+        dispatcher_queue[prio] = osQueueCreate(SCH_DISPATCHER_QUEUE_LEN, sizeof(cmd_t *));
+        if(dispatcher_queue[prio] == 0)
+        {
+            LOGE(tag, "Error creating dispatcher queue %d", prio);
+            rc = -1;
+        }
+    }
+
+    // Can hold a token for every queued command, so it never blocks
+    dispatcher_ready_queue = osQueueCreate(SCH_DISPATCHER_QUEUE_LEN*CMD_PRIO_LAST, sizeof(uint8_t));
+    if(dispatcher_ready_queue == 0)
+    {
+        LOGE(tag, "Error creating dispatcher ready queue");
+        rc = -1;
+    }
+
+    if(osSemaphoreCreate(&dispatcher_stat_sem) != OS_SEMAPHORE_OK)
+    {
+        LOGE(tag, "Error creating dispatcher stat semaphore");
+        rc = -1;
+    }
+
+    // Queues can not be deleted, so the handles are created once
+    if(osSemaphoreCreate(&dispatcher_handle_sem) != OS_SEMAPHORE_OK)
+    {
+        LOGE(tag, "Error creating dispatcher handles semaphore");
+        rc = -1;
+    }
+    if(osSemaphoreCreate(&dispatcher_pending_sem) != OS_SEMAPHORE_OK)
+    {
+        LOGE(tag, "Error creating dispatcher pending semaphore");
+        rc = -1;
+    }
+    memset(dispatcher_pending, 0, sizeof(dispatcher_pending));
+
+    int i;
+    for(i = 0; i < SCH_CMD_HANDLES; i++)
+    {
+        dispatcher_handles[i].state = CMD_HANDLE_FREE;
+        dispatcher_handles[i].done = osQueueCreate(1, sizeof(uint8_t));
+        if(dispatcher_handles[i].done == 0)
+        {
+            LOGE(tag, "Error creating command handle %d", i);
+            rc = -1;
+        }
+    }
+
+    // Default admission rules, can be changed by telecommand (obc_set_rule)
+    uint32_t bulk = (1u << CMD_COST_TM_BULK) | (1u << CMD_COST_FILE);
+    cmd_rule_t low_batt = {0, SCH_ADMISSION_VBATT_LOW, 0, bulk | (1u << CMD_COST_ADCS), 0};
+    cmd_rule_t fail_mode = {1u << DAT_OBC_OPMODE_FAIL, 0, 0, bulk, 0};
+    cmd_rule_t overload = {0, 0, SCH_ADMISSION_DEPTH, bulk, 0};
+    cmd_rules_set(0, &low_batt);
+    cmd_rules_set(1, &fail_mode);
+    cmd_rules_set(2, &overload);
+    dispatcher_admission_ready = 0;
+
+    memset(&dispatcher_stats, 0, sizeof(dispatcher_stats));
+    memset(dispatcher_skipped, 0, sizeof(dispatcher_skipped));
+    dispatcher_ready = rc == 0;
+    return rc;
+}
+
+int cmd_send_timeout(cmd_t *cmd, uint32_t timeout)
+{
+    if(cmd == NULL || !dispatcher_ready)
+        return CMD_SEND_ERROR;
+
+    int prio = cmd->prio;
+    if(prio < CMD_PRIO_CRITICAL || prio >= CMD_PRIO_LAST)
+        prio = cmd->prio = CMD_PRIO_NORMAL;
+
+    cmd->next = NULL;
+    if(cmd->coalesce && cmd->handle == NULL)
+    {
+        // An identical command will run, this one is not needed
+        int slot = dispatcher_coalesce(cmd);
+        if(slot < 0)
+            return CMD_SEND_OK;
+
+        int rc = dispatcher_enqueue(cmd, prio, 1, timeout);
+        if(rc != CMD_SEND_OK)
+            cmd_coalesce_done(cmd);
+        return rc;
+    }
+
+    return dispatcher_enqueue(cmd, prio, 1, timeout);
+}
+
+int cmd_send_batch(cmd_t **cmds, int n, uint32_t timeout)
+{
+    if(cmds == NULL || !dispatcher_ready)
+        return CMD_SEND_ERROR;
+
+    // Link the commands in order, the batch takes the highest priority
+    cmd_t *head = NULL, *tail = NULL;
+    int i, count = 0, prio = CMD_PRIO_LAST;
+    for(i = 0; i < n; i++)
+    {
+        cmd_t *cmd = cmds[i];
+        if(cmd == NULL)
+            continue;
+        if(cmd->prio >= CMD_PRIO_CRITICAL && cmd->prio < prio)
+            prio = cmd->prio;
+        cmd->next = NULL;
+        if(tail == NULL)
+            head = cmd;
+        else
+            tail->next = cmd;
+        tail = cmd;
+        count++;
+    }
+
+    if(head == NULL)
+        return CMD_SEND_ERROR;
+    if(prio == CMD_PRIO_LAST)
+        prio = CMD_PRIO_NORMAL;
+
+    int rc = dispatcher_enqueue(head, prio, count, timeout);
+    if(rc != CMD_SEND_OK)
+    {
+        // The caller keeps the commands, unlink them
+        for(i = 0; i < n; i++)
+        {
+            if(cmds[i] != NULL)
+                cmds[i]->next = NULL;
+        }
+    }
+    return rc;
+}
+
+cmd_handle_t *cmd_send_async(cmd_t *cmd)
+{
+    if(cmd == NULL || !dispatcher_ready)
+        return NULL;
+
+    cmd_handle_t *handle = NULL;
+    int i;
+    osSemaphoreTake(&dispatcher_handle_sem, portMAX_DELAY);
+    for(i = 0; i < SCH_CMD_HANDLES && handle == NULL; i++)
+    {
+        if(dispatcher_handles[i].state == CMD_HANDLE_FREE)
+        {
+            handle = &dispatcher_handles[i];
+            handle->state = CMD_HANDLE_PENDING;
+        }
+    }
+    osSemaphoreGiven(&dispatcher_handle_sem);
+
+    if(handle == NULL)
+    {
+        LOGW(tag, "Cmd: %X not sent, no completion handles available", cmd->id);
+        return NULL;
+    }
+
+    handle->result = CMD_ERROR;
+    handle->t_exec = 0;
+    cmd->handle = handle;
+    if(cmd_send_timeout(cmd, portMAX_DELAY) != CMD_SEND_OK)
+    {
+        cmd->handle = NULL;
+        osSemaphoreTake(&dispatcher_handle_sem, portMAX_DELAY);
+        handle->state = CMD_HANDLE_FREE;
+        osSemaphoreGiven(&dispatcher_handle_sem);
+        return NULL;
+    }
+    return handle;
+}
+
+int cmd_handle_wait(cmd_handle_t *handle, uint32_t timeout)
+{
+    if(handle == NULL)
+        return 0;
+
+    osSemaphoreTake(&dispatcher_handle_sem, portMAX_DELAY);
+    int state = handle->state;
+    osSemaphoreGiven(&dispatcher_handle_sem);
+    if(state == CMD_HANDLE_DONE)
+        return 1;
+    if(state != CMD_HANDLE_PENDING)
+        return 0;
+
+    // The token is consumed, the DONE state keeps the handle completed
+    uint8_t token;
+    return osQueueReceive(handle->done, &token, timeout) == pdPASS;
+}
+
+void cmd_handle_release(cmd_handle_t *handle)
+{
+    if(handle == NULL)
+        return;
+
+    uint8_t token;
+    osSemaphoreTake(&dispatcher_handle_sem, portMAX_DELAY);
+    if(handle->state == CMD_HANDLE_PENDING)
+    {
+        // The executer returns the handle to the pool when the command ends
+        handle->state = CMD_HANDLE_ABANDONED;
+    }
+    else if(handle->state == CMD_HANDLE_DONE)
+    {
+        // Discard the token if the owner did not wait for it
+        osQueueReceive(handle->done, &token, 0);
+        handle->state = CMD_HANDLE_FREE;
+    }
+    osSemaphoreGiven(&dispatcher_handle_sem);
+}
+
+void cmd_handle_complete(cmd_handle_t *handle, int result, portTick t_exec)
+{
+    if(handle == NULL)
+        return;
+
+    uint8_t token = 1;
+    osSemaphoreTake(&dispatcher_handle_sem, portMAX_DELAY);
+    if(handle->state == CMD_HANDLE_PENDING)
+    {
+        handle->result = result;
+        handle->t_exec = t_exec;
+        handle->state = CMD_HANDLE_DONE;
+        osQueueSend(handle->done, &token, 0);
+    }
+    else if(handle->state == CMD_HANDLE_ABANDONED)
+    {
+        handle->state = CMD_HANDLE_FREE;
+    }
+    osSemaphoreGiven(&dispatcher_handle_sem);
+}
+
+int cmd_send_wait(cmd_t *cmd, uint32_t timeout)
+{
+    cmd_handle_t *handle = cmd_send_async(cmd);
+    if(handle == NULL)
+    {
+        cmd_free(cmd);
+        return CMD_SEND_ERROR;
+    }
+
+    int rc = cmd_handle_wait(handle, timeout) ? handle->result : CMD_WAIT_TIMEOUT;
+    cmd_handle_release(handle);
+    return rc;
+}
+
+void cmd_coalesce_done(cmd_t *cmd)
+{
+    if(cmd == NULL || !cmd->coalesce)
+        return;
+
+    int i;
+    osSemaphoreTake(&dispatcher_pending_sem, portMAX_DELAY);
+    for(i = 0; i < SCH_CMD_COALESCE_MAX; i++)
+    {
+        if(dispatcher_pending[i] == cmd)
+        {
+            dispatcher_pending[i] = NULL;
+            break;
+        }
+    }
+    osSemaphoreGiven(&dispatcher_pending_sem);
+}
+
+/**
+ * Look for a pending command identical to @cmd. The pending command can take
+ * the place of @cmd if it runs before and with the same or higher priority,
+ * then @cmd is released. Otherwise @cmd is added to the pending commands, if
+ * there is room.
+ *
+ * @param cmd Coalescible command to send
+ * @return -1 if @cmd was coalesced and released, 0 if it must be queued
+ */
+static int dispatcher_coalesce(cmd_t *cmd)
+{
+    int i, free_slot = -1, coalesced = 0;
+
+    osSemaphoreTake(&dispatcher_pending_sem, portMAX_DELAY);
+    for(i = 0; i < SCH_CMD_COALESCE_MAX && !coalesced; i++)
+    {
+        cmd_t *pending = dispatcher_pending[i];
+        if(pending == NULL)
+        {
+            if(free_slot < 0)
+                free_slot = i;
+        }
+        else if(pending->prio <= cmd->prio && cmd_params_equal(pending, cmd))
+        {
+            // A pending command with an earlier deadline may be dropped
+            coalesced = pending->deadline == 0 ||
+                (cmd->deadline != 0 && (int32_t)(cmd->deadline - pending->deadline) >= 0);
+        }
+    }
+    if(!coalesced && free_slot >= 0)
+        dispatcher_pending[free_slot] = cmd;
+    osSemaphoreGiven(&dispatcher_pending_sem);
+
+    if(!coalesced)
+        return 0;
+
+    LOGD(tag, "Cmd: %X coalesced with a pending command", cmd->id);
+    osSemaphoreTake(&dispatcher_stat_sem, portMAX_DELAY);
+    dispatcher_stats.coalesced++;
+    osSemaphoreGiven(&dispatcher_stat_sem);
+    cmd_free(cmd);
+    return -1;
+}
+
+/**
+ * Queue a command, or a batch of @count linked commands, in the @prio level
+ * queue and wake up the dispatcher.
+ *
+ * @return CMD_SEND_OK or CMD_SEND_FULL
+ */
+static int dispatcher_enqueue(cmd_t *cmd, int prio, int count, uint32_t timeout)
+{
+    cmd_t *next;
+    portTick now = osTaskGetTickCount();
+    for(next = cmd; next != NULL; next = next->next)
+        next->t_sent = now;
+
+    if(osQueueSend(dispatcher_queue[prio], &cmd, timeout) != pdPASS)
+    {
+        osSemaphoreTake(&dispatcher_stat_sem, portMAX_DELAY);
+        dispatcher_stats.drop[prio] += count;
+        osSemaphoreGiven(&dispatcher_stat_sem);
+        return CMD_SEND_FULL;
+    }
+
+    osSemaphoreTake(&dispatcher_stat_sem, portMAX_DELAY);
+    dispatcher_stats.sent[prio] += count;
+    dispatcher_stats.depth[prio]++;
+    if(dispatcher_stats.depth[prio] > dispatcher_stats.max[prio])
+        dispatcher_stats.max[prio] = dispatcher_stats.depth[prio];
+    osSemaphoreGiven(&dispatcher_stat_sem);
+
+    // Wake up the dispatcher after the command is accounted
+    uint8_t token = (uint8_t)prio;
+    osQueueSend(dispatcher_ready_queue, &token, portMAX_DELAY);
+    return CMD_SEND_OK;
+}
+
+void dispatcher_get_stats(dispatcher_stats_t *stats)
+{
+    osSemaphoreTake(&dispatcher_stat_sem, portMAX_DELAY);
+    *stats = dispatcher_stats;
+    osSemaphoreGiven(&dispatcher_stat_sem);
+}
+
 void taskDispatcher(void *param)
 {
 	LOGI(tag, "Started");
 
     int status; /* Status of cmd reading operation */
+    int waiting = 0; /* Commands announced by a token but not read yet */
+    uint8_t token;
 
     cmd_t *new_cmd = NULL; /* The new cmd read */
-    int cmd_result;
 
     while(1)
     {
-        /* Read new_cmd from Queue - Blocking */
-        status = osQueueReceive(dispatcher_queue, &new_cmd, portMAX_DELAY);
+        /* Retry the commands held for a full executer class queue */
+        int held = dispatcher_release_held();
+
+        /* Wait until a command is queued, or until the held commands can be
+         * retried, if no level can be served now */
+        int prio = waiting > 0 ? dispatcher_select() : -1;
+        if(prio < 0)
+        {
+            status = osQueueReceive(dispatcher_ready_queue, &token,
+                                    held > 0 ? SCH_DISPATCHER_RETRY_MS : portMAX_DELAY);
+            if(status == pdPASS)
+                waiting++;
+            continue;
+        }
+        waiting--;
+
+        /* Read new_cmd from the selected priority level queue */
+        status = osQueueReceive(dispatcher_queue[prio], &new_cmd, 0);
 
         if(status == pdPASS)
         {
-            /* Check if command is executable */
-            if (check_if_executable(new_cmd))
-            {
-
-                /* Send the command to executer Queue - BLOCKING */
-                int executed_cmds = dat_get_system_var(dat_obc_executed_cmds); //Count executed commands
-                executed_cmds = executed_cmds + 1; //Add last command executed to count
-                dat_set_system_var(dat_obc_executed_cmds, executed_cmds); //Set new count
-                osQueueSend(executer_cmd_queue, &new_cmd, portMAX_DELAY);
-                LOGD(tag, "Cmd: %X, Param: %p, Orig: %X", new_cmd->id, &(new_cmd->params), -1);
-
-                /* Get the result from Executer Stat Queue - BLOCKING */
-                osQueueReceive(executer_stat_queue, &cmd_result, portMAX_DELAY);
-                if (cmd_result != CMD_OK)
-                {
-                    int failed_cmds = dat_get_system_var(dat_obc_failed_cmds);
-                    failed_cmds = failed_cmds + 1;
-                    dat_set_system_var(dat_obc_failed_cmds, failed_cmds);
-                }
-
-
-            }
+            /* The command (or the batch) runs in the executer of its first
+             * command class. If a command of that class is still held, this
+             * level waits for it, so the class order is kept and the other
+             * classes and levels go on */
+            int cls = executer_class(new_cmd);
+            if(dispatcher_held[cls] != NULL)
+                dispatcher_stalled[prio] = new_cmd;
+            else
+                dispatcher_dispatch(new_cmd, cls);
+
+            dispatcher_update_pool_status();
+            dispatcher_update_queue_status();
+        }
+        else
+        {
+            LOGE(tag, "Priority level %d queue empty", prio);
+        }
+    }
+}
+
+/**
+ * Check the commands of a batch and send the executable ones to the executer
+ * queue of @cls, without blocking. If the queue is full they are held until
+ * it has room (@see dispatcher_release_held). The result is reported by the
+ * executer, so do not wait for it.
+ *
+ * @param cmd Command, or first command of a batch, read from a priority queue
+ * @param cls Executer class of the first command
+ */
+static void dispatcher_dispatch(cmd_t *cmd, int cls)
+{
+    portTick now = osTaskGetTickCount();
+
+    /* Check each command of the batch, dropped commands are removed */
+    cmd_t *head = NULL, *tail = NULL, *next;
+    while(cmd != NULL)
+    {
+        next = cmd->next;
+        cmd->next = NULL;
+        if(dispatcher_check(cmd, now) != NULL)
+        {
+            if(tail == NULL)
+                head = cmd;
+            else
+                tail->next = cmd;
+            tail = cmd;
+        }
+        cmd = next;
+    }
+
+    if(head != NULL)
+    {
+        LOGD(tag, "Cmd: %X, Param: %p, Class: %d, Batch: %d", head->id, &(head->params), cls, head->next != NULL);
+        if(osQueueSend(executer_cmd_queue[cls], &head, 0) != pdPASS)
+        {
+            LOGD(tag, "Executer class %d queue full, cmd: %X held", cls, head->id);
+            dispatcher_held[cls] = head;
+        }
+    }
+}
+
+/**
+ * Send the held commands to their executer class queue if it has room now,
+ * then dispatch the commands of the stalled levels whose class is not held
+ * anymore, from the highest priority.
+ *
+ * @return Number of commands still held or stalled
+ */
+static int dispatcher_release_held(void)
+{
+    int cls, prio, n = 0;
+    for(cls = 0; cls < CMD_CLASS_LAST; cls++)
+    {
+        if(dispatcher_held[cls] != NULL &&
+           osQueueSend(executer_cmd_queue[cls], &dispatcher_held[cls], 0) == pdPASS)
+            dispatcher_held[cls] = NULL;
+    }
+
+    for(prio = 0; prio < CMD_PRIO_LAST; prio++)
+    {
+        cmd_t *cmd = dispatcher_stalled[prio];
+        if(cmd != NULL && dispatcher_held[executer_class(cmd)] == NULL)
+        {
+            dispatcher_stalled[prio] = NULL;
+            dispatcher_dispatch(cmd, executer_class(cmd));
         }
     }
+
+    for(cls = 0; cls < CMD_CLASS_LAST; cls++)
+        n += dispatcher_held[cls] != NULL;
+    for(prio = 0; prio < CMD_PRIO_LAST; prio++)
+        n += dispatcher_stalled[prio] != NULL;
+    return n;
+}
+
+/**
+ * Check if a dispatched command can be executed. Commands that waited beyond
+ * their deadline or that are not executable are returned to the pool.
+ *
+ * @param cmd Command read from the priority queue, not linked to a batch
+ * @param now Current tick
+ * @return The command, or NULL if it was dropped
+ */
+static cmd_t *dispatcher_check(cmd_t *cmd, portTick now)
+{
+    cmd->t_wait = now - cmd->t_sent;
+
+    /* Drop the command if it waited beyond its deadline */
+    if(cmd_deadline_passed(cmd, now))
+    {
+        LOGW(tag, "Cmd: %X expired in the dispatcher queue", cmd->id);
+        osSemaphoreTake(&dispatcher_stat_sem, portMAX_DELAY);
+        dispatcher_stats.expired++;
+        osSemaphoreGiven(&dispatcher_stat_sem);
+        cmd_coalesce_done(cmd);
+        cmd_handle_complete(cmd->handle, CMD_ERROR, 0);
+        cmd_free(cmd);
+        return NULL;
+    }
+
+    /* Check if command is executable */
+    if(!check_if_executable(cmd))
+    {
+        /* Return the rejected command to the pool */
+        cmd_coalesce_done(cmd);
+        cmd_handle_complete(cmd->handle, CMD_ERROR, 0);
+        cmd_free(cmd);
+        return NULL;
+    }
+
+    int executed_cmds = dat_get_system_var(dat_obc_executed_cmds); //Count executed commands
+    executed_cmds = executed_cmds + 1; //Add last command executed to count
+    dat_set_system_var(dat_obc_executed_cmds, executed_cmds); //Set new count
+    return cmd;
+}
+
+/**
+ * Select the priority level to serve next. The highest level with pending
+ * commands is selected, unless a pending level was skipped
+ * SCH_DISPATCHER_AGING times. Stalled levels (@see dispatcher_release_held)
+ * are not served. The selected level depth is decreased, other pending levels
+ * are aged.
+ *
+ * @return Priority level with at least one command waiting, -1 if there is
+ * none that can be served
+ */
+static int dispatcher_select(void)
+{
+    int prio, selected = -1;
+
+    osSemaphoreTake(&dispatcher_stat_sem, portMAX_DELAY);
+    for(prio = 0; prio < CMD_PRIO_LAST && selected < 0; prio++)
+    {
+        if(dispatcher_stats.depth[prio] > 0 && dispatcher_stalled[prio] == NULL &&
+           dispatcher_skipped[prio] >= SCH_DISPATCHER_AGING)
+            selected = prio;
+    }
+    for(prio = 0; prio < CMD_PRIO_LAST && selected < 0; prio++)
+    {
+        if(dispatcher_stats.depth[prio] > 0 && dispatcher_stalled[prio] == NULL)
+            selected = prio;
+    }
+
+    if(selected >= 0)
+    {
+        for(prio = 0; prio < CMD_PRIO_LAST; prio++)
+        {
+            if(prio != selected && dispatcher_stats.depth[prio] > 0 && dispatcher_stalled[prio] == NULL)
+                dispatcher_skipped[prio]++;
+        }
+        dispatcher_skipped[selected] = 0;
+        dispatcher_stats.depth[selected]--;
+    }
+    osSemaphoreGiven(&dispatcher_stat_sem);
+
+    return selected;
+}
+
+/**
+ * Copy the dispatcher queues counters to the status repository, only the
+ * changed values are written.
+ */
+static void dispatcher_update_queue_status(void)
+{
+    static dispatcher_stats_t last;
+    static int first = 1;
+    dispatcher_stats_t stats;
+    int prio;
+
+    dispatcher_get_stats(&stats);
+    for(prio = 0; prio < CMD_PRIO_LAST; prio++)
+    {
+        if(first || stats.max[prio] != last.max[prio])
+            dat_set_system_var(dat_obc_queue_max_crit + prio, stats.max[prio]);
+        if(first || stats.drop[prio] != last.drop[prio])
+            dat_set_system_var(dat_obc_queue_drop_crit + prio, stats.drop[prio]);
+    }
+    if(first || stats.expired != last.expired)
+        dat_set_system_var(dat_obc_cmd_expired, stats.expired);
+    if(first || stats.coalesced != last.coalesced)
+        dat_set_system_var(dat_obc_cmd_coalesced, stats.coalesced);
+    if(first || stats.rejected != last.rejected)
+        dat_set_system_var(dat_obc_cmd_rejected, stats.rejected);
+
+    last = stats;
+    first = 0;
+}
+
+/**
+ * Copy the commands pools usage counters to the status repository, only
+ * the changed values are written.
+ */
+static void dispatcher_update_pool_status(void)
+{
+    static cmd_pool_stats_t last = {-1, -1, -1, -1, -1, -1};
+    cmd_pool_stats_t stats;
+    cmd_pool_get_stats(&stats);
+
+    if(stats.cmd_max != last.cmd_max)
+        dat_set_system_var(dat_obc_cmd_pool_max, stats.cmd_max);
+    if(stats.cmd_fail != last.cmd_fail)
+        dat_set_system_var(dat_obc_cmd_pool_fail, stats.cmd_fail);
+    if(stats.par_max != last.par_max)
+        dat_set_system_var(dat_obc_par_pool_max, stats.par_max);
+    if(stats.par_fail != last.par_fail)
+        dat_set_system_var(dat_obc_par_pool_fail, stats.par_fail);
+
+    last = stats;
 }
 
 int check_if_executable(cmd_t *new_cmd)
 {
-    return 1;
+    // The mode and the battery voltage change slowly, do not read them for
+    // every command
+    portTick now = osTaskGetTickCount();
+    if(!dispatcher_admission_ready || now - dispatcher_admission_tick >= osDefineTime(SCH_ADMISSION_PERIOD_MS))
+    {
+        cmd_rules_compile(&dispatcher_admission, dat_get_system_var(dat_obc_opmode),
+                          dat_get_system_var(dat_eps_vbatt));
+        dispatcher_admission_tick = now;
+        dispatcher_admission_ready = 1;
+    }
+
+    // Most commands are not affected by any rule
+    if(!(dispatcher_admission.mask & (1u << new_cmd->cost)))
+        return 1;
+
+    int prio, depth = 0;
+    osSemaphoreTake(&dispatcher_stat_sem, portMAX_DELAY);
+    for(prio = 0; prio < CMD_PRIO_LAST; prio++)
+        depth += dispatcher_stats.depth[prio];
+    osSemaphoreGiven(&dispatcher_stat_sem);
+
+    int rule = cmd_admit(&dispatcher_admission, new_cmd, depth);
+    if(rule < 0)
+        return 1;
+
+    LOGW(tag, "Cmd: %X rejected by admission rule %d", new_cmd->id, rule);
+    osSemaphoreTake(&dispatcher_stat_sem, portMAX_DELAY);
+    dispatcher_stats.rejected++;
+    osSemaphoreGiven(&dispatcher_stat_sem);
+    return 0;
 }
@@ -22,36 +22,150 @@
 
 static const char *tag = "Executer";
 
+static cmd_class_t executer_task_class[EXECUTER_N_TASKS]; ///< Class served by each task
+static osSemaphore executer_stat_sem;                     ///< Guards the results counters
+
+static int executer_run(cmd_t *cmd);
+static void executer_report(int cmd_stat);
+
+int executer_init(void)
+{
+    int cls, rc = 0;
+    for(cls = 0; cls < CMD_CLASS_LAST; cls++)
+    {
+        executer_cmd_queue[cls] = osQueueCreate(SCH_EXECUTER_QUEUE_LEN, sizeof(cmd_t *));
+        if(executer_cmd_queue[cls] == 0)
+        {
+            LOGE(tag, "Error creating executer cmd queue %d", cls);
+            rc = -1;
+        }
+    }
+
+    if(osSemaphoreCreate(&executer_stat_sem) != OS_SEMAPHORE_OK)
+    {
+        LOGE(tag, "Error creating executer stat semaphore");
+        rc = -1;
+    }
+
+    return rc;
+}
+
+int executer_create_tasks(os_thread *threads_id)
+{
+    int i, rc = 0;
+    char name[16];
+
+    for(i = 0; i < EXECUTER_N_TASKS; i++)
+    {
+        // The first SCH_EXECUTER_WORKERS tasks serve the free class, then
+        // add one (and only one) task for each serialized class
+        executer_task_class[i] = i < SCH_EXECUTER_WORKERS ? CMD_CLASS_FREE :
+                                 (cmd_class_t)(i - SCH_EXECUTER_WORKERS + 1);
+        snprintf(name, sizeof(name), "executer_%d", i);
+        if(osCreateTask(taskExecuter, name, SCH_TASK_EXE_STACK,
+                        &executer_task_class[i], 4, &threads_id[i]) != 0)
+        {
+            LOGE(tag, "Task %s not created!", name);
+            rc = -1;
+        }
+    }
+
+    return rc;
+}
+
 void taskExecuter(void *param)
 {
-    LOGI(tag, "Started");
+    cmd_class_t cls = param == NULL ? CMD_CLASS_FREE : *(cmd_class_t *)param;
+    LOGI(tag, "Started (class %d)", cls);
 
     cmd_t *run_cmd = NULL;
+    cmd_t *next_cmd = NULL;
     int cmd_stat, queue_stat;
         
     while(1)
     {
         /* Read the CMD that Dispatcher sent - BLOCKING */
-        queue_stat = osQueueReceive(executer_cmd_queue, &run_cmd, portMAX_DELAY);
+        queue_stat = osQueueReceive(executer_cmd_queue[cls], &run_cmd, portMAX_DELAY);
 
         if(queue_stat == pdPASS)
         {
-            if(log_lvl >= LOG_LVL_INFO)
+            /* Execute the command, or all the commands of a batch in order */
+            while(run_cmd != NULL)
             {
-                char *cmd_name = cmd_get_name(run_cmd->id);
-                LOGI(tag, "Running the command: %s...", cmd_name);
-                free(cmd_name);
+                next_cmd = run_cmd->next;
+                cmd_stat = executer_run(run_cmd);
+                run_cmd = next_cmd;
+
+                /* Report the result, the dispatcher does not wait for it */
+                executer_report(cmd_stat);
             }
+        }
+    }
+}
 
-            /* Execute the command */
-            cmd_stat = run_cmd->function(run_cmd->fmt, run_cmd->params, run_cmd->nparams);
-            cmd_free(run_cmd);
-            run_cmd = NULL;
+int executer_class(cmd_t *cmd)
+{
+    return cmd->cls > CMD_CLASS_FREE && cmd->cls < CMD_CLASS_LAST ? cmd->cls : CMD_CLASS_FREE;
+}
 
-            LOGI(tag, "Command result: %d", cmd_stat);
+/**
+ * Execute a command and release it
+ *
+ * @param cmd Command to execute
+ * @return Command result
+ */
+static int executer_run(cmd_t *cmd)
+{
+    int cmd_stat;
 
-            /* Send the result to Dispatcher - BLOCKING */
-            osQueueSend(executer_stat_queue, &cmd_stat, portMAX_DELAY);
-        }
+    if(log_lvl >= LOG_LVL_INFO)
+    {
+        char cmd_name[SCH_CMD_MAX_STR_NAME];
+        if(cmd_copy_name(cmd->id, cmd_name, sizeof(cmd_name)) != CMD_OK)
+            strcpy(cmd_name, "?");
+        LOGI(tag, "Running the command: %s...", cmd_name);
     }
+
+    // Not pending anymore, identical commands sent from now on are queued
+    cmd_coalesce_done(cmd);
+
+    portTick t_start = osTaskGetTickCount();
+    cmd_stat = cmd_execute(cmd);
+    portTick t_exec = osTaskGetTickCount() - t_start;
+
+    if(cmd_stats_record(cmd, t_exec, cmd_stat))
+        executer_report_overrun(cmd->id, 1);
+    cmd_handle_complete(cmd->handle, cmd_stat, t_exec);
+    cmd_free(cmd);
+
+    LOGI(tag, "Command result: %d", cmd_stat);
+    return cmd_stat;
+}
+
+/**
+ * Update the commands results counters. Several executer tasks can finish at
+ * the same time so the read-modify-write is guarded by executer_stat_sem.
+ * @param cmd_stat Command result
+ */
+static void executer_report(int cmd_stat)
+{
+    if(cmd_stat == CMD_OK)
+        return;
+
+    osSemaphoreTake(&executer_stat_sem, portMAX_DELAY);
+    int failed_cmds = dat_get_system_var(dat_obc_failed_cmds);
+    dat_set_system_var(dat_obc_failed_cmds, failed_cmds + 1);
+    osSemaphoreGiven(&executer_stat_sem);
+}
+
+void executer_report_overrun(int cmd_id, int count)
+{
+    if(count <= 0)
+        return;
+
+    osSemaphoreTake(&executer_stat_sem, portMAX_DELAY);
+    int overruns = dat_get_system_var(dat_obc_cmd_overruns);
+    dat_set_system_var(dat_obc_cmd_overruns, overruns + count);
+    dat_set_system_var(dat_obc_cmd_last_overrun, cmd_id);
+    osSemaphoreGiven(&executer_stat_sem);
 }
@@ -35,33 +35,57 @@ void taskFlightPlan(void *param)
     portTick xLastWakeTime = osTaskGetTickCount();
 
     time_t elapsed_sec;   // Seconds counter
+    time_t last_sec = dat_get_time();   // Last second checked
+    cmd_t *batch[SCH_CMD_BATCH_MAX];
+    int n_cmds;
 
     while(1)
     {
         osTaskDelayUntil(&xLastWakeTime, delay_ms); //Suspend task
-        // Get next command in the flight plan, if any
         elapsed_sec = dat_get_time();
-        int rc = dat_get_fp((int)elapsed_sec, command, args, &executions, &period);
-        if(rc == -1)
-            continue;
 
-        LOGI(tag, "Command: %s", command);
-        LOGI(tag, "Arguments: %s", args);
-        LOGI(tag, "Executions: %d", executions);
-        LOGI(tag, "Period: %d", period);
+        /* Check every second since the last check, the task can be delayed
+         * (ex. blocked sending commands). Up to SCH_CMD_BATCH_MAX seconds are
+         * checked, if the time was set backwards only the current second */
+        time_t first_sec = last_sec + 1;
+        if(first_sec > elapsed_sec)
+            first_sec = elapsed_sec;
+        else if(elapsed_sec - first_sec >= SCH_CMD_BATCH_MAX)
+            first_sec = elapsed_sec - SCH_CMD_BATCH_MAX + 1;
+        last_sec = elapsed_sec;
 
-        // Send the command for N execution
-        dat_set_system_var(dat_fpl_last, (int) elapsed_sec);
+        // Get the commands in the flight plan, if any
+        n_cmds = 0;
+        time_t t;
+        for(t = first_sec; t <= elapsed_sec; t++)
+        {
+            int rc = dat_get_fp((int)t, command, args, &executions, &period);
+            if(rc == -1)
+                continue;
+
+            LOGI(tag, "Command: %s", command);
+            LOGI(tag, "Arguments: %s", args);
+            LOGI(tag, "Executions: %d", executions);
+            LOGI(tag, "Period: %d", period);
+
+            dat_set_system_var(dat_fpl_last, (int) t);
 
-        /*If command has to be executed again, set it in flight plan for next execution*/
-        if (period>0 && executions>1) {
-            dat_set_fp((int)elapsed_sec + period, command, args, executions - 1, period);
+            /*If command has to be executed again, set it in flight plan for next execution*/
+            if (period>0 && executions>1) {
+                dat_set_fp((int)t + period, command, args, executions - 1, period);
+            }
+
+            /*If command has to be executed*/
+            cmd_t *new_cmd = cmd_get_str(command);
+            if(new_cmd == NULL)
+                continue;
+            cmd_add_params_str(new_cmd, args);
+            batch[n_cmds++] = new_cmd;
         }
 
-        /*If command has to be executed*/
-        cmd_t *new_cmd = cmd_get_str(command);
-        cmd_add_params_str(new_cmd, args);
-        cmd_send(new_cmd);
+        // Send the commands for execution, in the flight plan order
+        if(n_cmds > 0)
+            cmd_send_batch(batch, n_cmds, portMAX_DELAY);
 
         /*for(i=0; i < executions; i++)
         {
@@ -70,4 +94,4 @@ void taskFlightPlan(void *param)
             cmd_send(new_cmd);
         }*/
     }
-}
\ No newline at end of file
+}
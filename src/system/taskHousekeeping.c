@@ -33,9 +33,18 @@ void taskHousekeeping(void *param)
     unsigned int _01min_check = 1*60;       //05[m] condition
     unsigned int _05min_check = 5*60;       //05[m] condition
     unsigned int _1hour_check = 60*60;      //01[h] condition
-    /*Get OBC beacon period*/
-    int obc_bcn_period = dat_get_system_var(dat_com_bcn_period);
-    int last_obc_bcn_period = obc_bcn_period;
+    unsigned int _scrub_check = SCH_STORAGE_SCRUB_PERIOD;   //Status variables copies scrub period, 0 to disable
+    /*Get OBC beacon period, then follow its changes (or poll it)*/
+    dat_sys_var_short_t change;
+    dat_status_address_t hk_vars[] = {dat_com_bcn_period};
+    osQueue hk_vars_queue = osQueueCreate(4, sizeof(dat_sys_var_short_t));
+    if(hk_vars_queue == 0 || dat_subscribe_status_vars(hk_vars, 1, hk_vars_queue) != 0)
+    {
+        LOGE(tag, "Unable to subscribe to the beacon period, polling it");
+        hk_vars_queue = 0;
+    }
+    int curr_obc_beacon_period = dat_get_system_var(dat_com_bcn_period);
+    int obc_bcn_period = curr_obc_beacon_period;
 
     portTick xLastWakeTime = osTaskGetTickCount();
 
@@ -45,14 +54,34 @@ void taskHousekeeping(void *param)
         elapsed_sec += delay_ms / 1000; //Update seconds counts
 
         /* 1 second actions */
+        // Also writes the status variables changes older than
+        // SCH_STORAGE_FLUSH_MS, without closing the payload samples batch
         dat_set_system_var(dat_rtc_date_time, (int) time(NULL));
 
+        /* Repair the status variables copies (tripled writing) */
+        if(SCH_STORAGE_TRIPLE_WR == 1 && _scrub_check > 0 && (elapsed_sec % _scrub_check) == 0)
+        {
+            cmd_t *cmd_scrub = cmd_get_str("drp_scrub");
+            cmd_send(cmd_scrub);
+        }
+
         /* Send OBC beacon */
-        int curr_obc_beacon_period = dat_get_system_var(dat_com_bcn_period);
-        if(curr_obc_beacon_period != last_obc_bcn_period)
+        if(hk_vars_queue == 0)
         {
-            obc_bcn_period = curr_obc_beacon_period;
-            last_obc_bcn_period = curr_obc_beacon_period;
+            int bcn_period = dat_get_system_var(dat_com_bcn_period);
+            if(bcn_period != curr_obc_beacon_period)
+            {
+                obc_bcn_period = bcn_period;
+                curr_obc_beacon_period = bcn_period;
+            }
+        }
+        else
+        {
+            while(osQueueReceive(hk_vars_queue, &change, 0) == pdPASS)
+            {
+                obc_bcn_period = change.value.i;
+                curr_obc_beacon_period = change.value.i;
+            }
         }
 
         obc_bcn_period --;
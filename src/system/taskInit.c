@@ -84,6 +84,7 @@ void taskInit(void *param)
             //TODO CANCEL
         }
         dat_set_system_var(dat_dep_deployed, 1);
+        dat_flush(); // Must survive a reset
     }
 
     deployed = dat_get_system_var(dat_dep_deployed);
@@ -92,8 +93,9 @@ void taskInit(void *param)
     {
         LOGI(tag, "ANTENNA DEPLOYMENT");
         cmd_t *eps_update_status_cmd = cmd_get_str("eps_update_status");
-        cmd_send(eps_update_status_cmd);
-        osDelay(500);
+        rc = cmd_send_wait(eps_update_status_cmd, 2000);
+        if(rc != CMD_OK)
+            LOGW(tag, "EPS status not updated (%d)", rc);
         int vbat_mV = dat_get_system_var(dat_eps_vbatt);
 
         // Deploy antenna
@@ -103,7 +105,8 @@ void taskInit(void *param)
 
         //Update antenna deployment status
         cmd_t *cmd_dep = cmd_get_str("gssb_update_status");
-        cmd_send(cmd_dep);
+        rc = cmd_send_wait(cmd_dep, 2000);
+        LOGI(tag, "Antenna deployed: %d (%d)", dat_get_system_var(dat_dep_ant_deployed), rc);
     }
 
     LOGI(tag, "Restore TRX Inhibit to: %d seconds", 0);
@@ -236,8 +239,10 @@ int init_setup_trx(void) {
         cmd_send(trx_cmd);
     }
     // Set TX_PWR
+    char tx_pwr[12];
+    snprintf(tx_pwr, sizeof(tx_pwr), "%d", dat_get_status_var(dat_com_tx_pwr).i);
     trx_cmd = cmd_get_str("com_set_config");
-    cmd_add_params_var(trx_cmd, 0, "tx_pwr", dat_get_status_var(dat_com_tx_pwr).i);
+    cmd_add_params_var(trx_cmd, 0, "tx_pwr", tx_pwr);
     cmd_send(trx_cmd);
     if(log_lvl >= LOG_LVL_DEBUG)
     {
@@ -323,30 +328,26 @@ int init_antenna_deploy(void)
     LOGD(tag, "\tAntenna deployment...")
     //Turn on gssb and update antenna deployment status
     cmd_t *cmd_dep;
+    int rc;
     cmd_dep = cmd_get_str("gssb_pwr");
     cmd_add_params_str(cmd_dep, "1 1");
-    cmd_send(cmd_dep);
+    rc = cmd_send_wait(cmd_dep, 2000);
+    if(rc != CMD_OK)
+        LOGW(tag, "\tGSSB power on failed (%d)", rc);
 
     cmd_dep = cmd_get_str("gssb_update_status");
     cmd_send(cmd_dep);
 
-    //Try to deploy antennas if necessary
-    //      istage 1. On: 2s, off: 1s, rep: 5
-    cmd_dep = cmd_get_str("gssb_antenna_release");
-    cmd_add_params_var(cmd_dep, 16, 2, 1, 5);
-    cmd_send(cmd_dep);
-    //      istage 2. On: 2s, off: 1s, rep: 5
-    cmd_dep = cmd_get_str("gssb_antenna_release");
-    cmd_add_params_var(cmd_dep, 17, 2, 1, 5);
-    cmd_send(cmd_dep);
-    //      istage 3. On: 2s, off: 1s, rep: 5
-    cmd_dep = cmd_get_str("gssb_antenna_release");
-    cmd_add_params_var(cmd_dep, 18, 2, 1, 5);
-    cmd_send(cmd_dep);
-    //      istage 4. On: 2s, off: 1s, rep: 5
-    cmd_dep = cmd_get_str("gssb_antenna_release");
-    cmd_add_params_var(cmd_dep, 19, 2, 1, 5);
-    cmd_send(cmd_dep);
+    //Try to deploy antennas if necessary, wait for each stage to finish
+    int istage;
+    for(istage = 16; istage <= 19; istage++)
+    {
+        //      istage 1-4 (address 16-19). On: 2s, off: 1s, rep: 5
+        cmd_dep = cmd_get_str("gssb_antenna_release");
+        cmd_add_params_var(cmd_dep, istage, 2, 1, 5);
+        rc = cmd_send_wait(cmd_dep, 30000);
+        LOGI(tag, "\tIstage %d release result: %d", istage, rc);
+    }
 
     return 0;
 }
@@ -60,6 +60,9 @@ void taskSensors(void *param)
     }
 
     int elapsed_sec = 0;
+    dat_status_address_t mach_vars[] = {dat_drp_mach_action, dat_drp_mach_state, dat_drp_mach_step,
+                                         dat_drp_mach_payloads, dat_drp_mach_left};
+    value32_t mach_values[5];
 
     while(1)
     {
@@ -102,7 +105,12 @@ void taskSensors(void *param)
                         char cmd_args[20];
                         sprintf(cmd_args, " %d", i);
                         cmd_add_params_str(cmd_get, cmd_args);
-                        cmd_send(cmd_get);
+                        // Periodic samples are skipped if the dispatcher is busy
+                        if(cmd_try_send(cmd_get) != CMD_SEND_OK)
+                        {
+                            LOGW(tag, "Dispatcher busy, sample %d skipped", i);
+                            cmd_free(cmd_get);
+                        }
                     }
                 }
                 if (status_machine.samples_left != -1) {
@@ -113,17 +121,13 @@ void taskSensors(void *param)
             }
         }
 
-        action = (int) status_machine.action;
-        state = (int) status_machine.state;
-        step = (int) status_machine.step;
-        active_payloads = (int) status_machine.active_payloads;
-        samples_left = (int) status_machine.samples_left;
-
-        dat_set_system_var(dat_drp_mach_action, action);
-        dat_set_system_var(dat_drp_mach_state, state);
-        dat_set_system_var(dat_drp_mach_step, step);
-        dat_set_system_var(dat_drp_mach_payloads, active_payloads);
-        dat_set_system_var(dat_drp_mach_left, samples_left);
+        // Save the machine status, only the changed values are written
+        mach_values[0].i = (int) status_machine.action;
+        mach_values[1].i = (int) status_machine.state;
+        mach_values[2].i = (int) status_machine.step;
+        mach_values[3].i = (int) status_machine.active_payloads;
+        mach_values[4].i = (int) status_machine.samples_left;
+        dat_set_status_many(mach_vars, mach_values, 5);
         elapsed_sec += 1;
     }
 }
@@ -30,15 +30,65 @@ void taskWatchdog(void *param)
     unsigned int max_gnd_wdt = SCH_MAX_GND_WDT_TIMER; // Seconds to send "reset" command
     unsigned int elapsed_obc_timer = 0; // OBC timer counter
     unsigned int elapsed_sw_timer = 0; // Software timer counter
+    unsigned int saved_sw_timer = 0;   // Last software timer value saved by this task
+    unsigned int save_period = 10;     // Seconds between software timer saves
+    int cleared = 0;                   // The software timer was cleared by a gnd command
     portTick xLastWakeTime = osTaskGetTickCount();
-    
+
+    // Keep the software timer counter, follow its changes to know when a gnd
+    // command clears it (or poll it if the subscription is not available)
+    dat_sys_var_short_t change;
+    dat_status_address_t wdt_vars[] = {dat_obc_sw_wdt};
+    osQueue wdt_vars_queue = osQueueCreate(4, sizeof(dat_sys_var_short_t));
+    if(wdt_vars_queue == 0 || dat_subscribe_status_vars(wdt_vars, 1, wdt_vars_queue) != 0)
+    {
+        LOGE(tag, "Unable to subscribe to the software timer, polling it");
+        wdt_vars_queue = 0;
+    }
+    elapsed_sw_timer = (unsigned int)dat_get_system_var(dat_obc_sw_wdt);
+    saved_sw_timer = elapsed_sw_timer;
+
     while(1)
     {
         // Sleep task to count seconds
         osTaskDelayUntil(&xLastWakeTime, delay_ms);
         elapsed_obc_timer++; // Increase timer to reset the obc wdt
-        elapsed_sw_timer = (unsigned  int)dat_get_system_var(dat_obc_sw_wdt) + 1; //Increase software timer counter. Should be cleared by a gnd command
-        dat_set_system_var(dat_obc_sw_wdt, (int) elapsed_sw_timer); // Save increased software timer
+
+        // A value other than the last one saved here was set by a gnd command.
+        // The notifications are in order, so a clear set just before our own
+        // save is still found ahead of it
+        if(wdt_vars_queue == 0)
+        {
+            unsigned int sw_timer = (unsigned int)dat_get_system_var(dat_obc_sw_wdt);
+            if(sw_timer != saved_sw_timer)
+            {
+                elapsed_sw_timer = sw_timer;
+                cleared = 1;
+            }
+        }
+        else
+        {
+            while(osQueueReceive(wdt_vars_queue, &change, 0) == pdPASS)
+            {
+                if(change.value.u != saved_sw_timer)
+                {
+                    elapsed_sw_timer = change.value.u;
+                    cleared = 1;
+                }
+            }
+        }
+
+        elapsed_sw_timer++; //Increase software timer counter. Should be cleared by a gnd command
+
+        // Save the software timer every few seconds, before a reset, and as
+        // soon as it is cleared, so the stored value is not the cleared one
+        // anymore and the next gnd clear is a change again
+        if(cleared || (elapsed_sw_timer % save_period) == 0 || elapsed_sw_timer > max_gnd_wdt)
+        {
+            cleared = 0;
+            saved_sw_timer = elapsed_sw_timer;
+            dat_set_system_var(dat_obc_sw_wdt, (int) saved_sw_timer);
+        }
 
         // Periodically reset the OBC watchdog
         if(elapsed_obc_timer > max_obc_wdt)
@@ -48,6 +98,11 @@ void taskWatchdog(void *param)
             cmd_send(rst_wdt);
         }
 
+        // Ask commands running over budget to stop
+        int overrun_id = -1;
+        int overruns = cmd_check_budgets(&overrun_id);
+        executer_report_overrun(overrun_id, overruns);
+
         // If nobody clears elapsed_gnd_timer, then reset the OBC
         if(elapsed_sw_timer > max_gnd_wdt)
         {
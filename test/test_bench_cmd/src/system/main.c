@@ -0,0 +1,120 @@
+/*                                 SUCHAI
+ *                      NANOSATELLITE FLIGHT SOFTWARE
+ *
+ *      Copyright 2020, Carlos Gonzalez Cortes, carlgonz@uchile.cl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Micro-benchmark of the command repository lookup. Compares the linear
+ * search (as cmd_get_str did before cmd_repo_freeze) with the frozen hash
+ * index as the number of registered commands grows.
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#include "repoCommand.h"
+
+#define BENCH_ROUNDS 2000
+
+static const char *tag = "bench_cmd";
+
+/**
+ * Linear lookup, takes the repository mutex for every compared slot
+ */
+static cmd_t *cmd_get_str_linear(char *name)
+{
+    int i, ok;
+    for(i=0; i<SCH_CMD_MAX_ENTRIES; i++)
+    {
+        osSemaphoreTake(&repo_cmd_sem, portMAX_DELAY);
+        ok = strcmp(name, cmd_list[i].name);
+        osSemaphoreGiven(&repo_cmd_sem);
+
+        if(ok == 0)
+            return cmd_get_idx(i);
+    }
+    return NULL;
+}
+
+/**
+ * Reset the repository with @n_cmds dummy commands and fill the remaining
+ * slots with null commands, as cmd_repo_init does.
+ */
+static void bench_setup(int n_cmds)
+{
+    char name[SCH_CMD_MAX_STR_NAME];
+    int i;
+
+    cmd_repo_close();
+    for(i=0; i<n_cmds; i++)
+    {
+        snprintf(name, sizeof(name), "bench_cmd_%03d", i);
+        cmd_add(name, cmd_null, "%d", 1);
+    }
+    while(cmd_add("null", cmd_null, "", 0) < SCH_CMD_MAX_ENTRIES);
+    cmd_index = n_cmds;
+}
+
+/**
+ * Lookup all the registered commands BENCH_ROUNDS times
+ * @return Mean time per lookup in nanoseconds
+ */
+static double bench_lookup(int n_cmds, cmd_t *(*lookup)(char *))
+{
+    char name[SCH_CMD_MAX_STR_NAME];
+    struct timespec start, end;
+    int i, j;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(j=0; j<BENCH_ROUNDS; j++)
+    {
+        for(i=0; i<n_cmds; i++)
+        {
+            snprintf(name, sizeof(name), "bench_cmd_%03d", i);
+            cmd_t *cmd = lookup(name);
+            assertf(cmd != NULL && cmd->id == i, tag, "Lookup failed: %s", name);
+            cmd_free(cmd);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double elapsed = (end.tv_sec - start.tv_sec)*1e9 + (end.tv_nsec - start.tv_nsec);
+    return elapsed/((double)BENCH_ROUNDS*n_cmds);
+}
+
+int main(void)
+{
+    int sizes[] = {8, 16, 32, 64, 128, SCH_CMD_MAX_ENTRIES-1};
+    int n_sizes = sizeof(sizes)/sizeof(sizes[0]);
+    int i;
+
+    log_init(LOG_LVL_NONE, -1);
+    cmd_repo_init();
+
+    printf("%8s %14s %14s %8s\n", "n_cmds", "linear (ns)", "frozen (ns)", "speedup");
+    for(i=0; i<n_sizes; i++)
+    {
+        bench_setup(sizes[i]);
+        double t_linear = bench_lookup(sizes[i], cmd_get_str_linear);
+        cmd_repo_freeze();
+        double t_frozen = bench_lookup(sizes[i], cmd_get_str);
+        printf("%8d %14.1f %14.1f %8.1f\n", sizes[i], t_linear, t_frozen, t_linear/t_frozen);
+    }
+
+    cmd_repo_close();
+    return 0;
+}
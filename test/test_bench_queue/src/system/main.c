@@ -0,0 +1,175 @@
+/*                                 SUCHAI
+ *                      NANOSATELLITE FLIGHT SOFTWARE
+ *
+ *      Copyright 2020, Carlos Gonzalez Cortes, carlgonz@uchile.cl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Micro-benchmark of the Linux queue backends. Several producers send
+ * pointer sized items (as the dispatcher queue does with cmd_t *) to a single
+ * consumer, comparing pthread_queue with ring_queue, reading one item at a
+ * time and in batches. The consumer also checks that the items of each
+ * producer arrive in order.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "pthread_queue.h"
+#include "ring_queue.h"
+
+#define BENCH_QUEUE_LEN 64
+#define BENCH_ITEMS 200000      ///< Items sent by each producer
+#define BENCH_BATCH 16
+#define BENCH_MAX_PRODUCERS 8
+#define BENCH_FOREVER 0xffffffff
+
+typedef struct bench_backend_s {
+    const char *name;
+    void *(*create)(int length, size_t item_size);
+    int (*send)(void *queue, void *value, uint32_t timeout);
+    int (*receive)(void *queue, void *buf, uint32_t timeout);
+    int (*receive_many)(void *queue, void *buf, int max_items, uint32_t timeout);
+    int batch;
+} bench_backend_t;
+
+typedef struct bench_producer_s {
+    const bench_backend_t *backend;
+    void *queue;
+    uintptr_t id;
+} bench_producer_t;
+
+/* Wrappers with a common signature for both backends */
+static void *pq_create(int length, size_t item_size) { return os_pthread_queue_create(length, item_size); }
+static int pq_send(void *q, void *value, uint32_t timeout) { return os_pthread_queue_send(q, value, timeout); }
+static int pq_receive(void *q, void *buf, uint32_t timeout) { return os_pthread_queue_receive(q, buf, timeout); }
+static int pq_receive_many(void *q, void *buf, int max_items, uint32_t timeout) { return os_pthread_queue_receive_many(q, buf, max_items, timeout); }
+static void *rq_create(int length, size_t item_size) { return os_ring_queue_create(length, item_size); }
+static int rq_send(void *q, void *value, uint32_t timeout) { return os_ring_queue_send(q, value, timeout); }
+static int rq_receive(void *q, void *buf, uint32_t timeout) { return os_ring_queue_receive(q, buf, timeout); }
+static int rq_receive_many(void *q, void *buf, int max_items, uint32_t timeout) { return os_ring_queue_receive_many(q, buf, max_items, timeout); }
+
+static bench_backend_t backends[] = {
+    {"pthread", pq_create, pq_send, pq_receive, pq_receive_many, 1},
+    {"pthread_many", pq_create, pq_send, pq_receive, pq_receive_many, BENCH_BATCH},
+    {"ring", rq_create, rq_send, rq_receive, rq_receive_many, 1},
+    {"ring_many", rq_create, rq_send, rq_receive, rq_receive_many, BENCH_BATCH},
+};
+
+/**
+ * Producer task, items encode the producer id in the upper bits and a
+ * sequence number in the lower bits.
+ */
+static void *bench_producer(void *param)
+{
+    bench_producer_t *p = (bench_producer_t *)param;
+    uintptr_t i;
+    for(i = 1; i <= BENCH_ITEMS; i++)
+    {
+        void *item = (void *)((p->id << 24) | i);
+        p->backend->send(p->queue, &item, BENCH_FOREVER);
+    }
+    return NULL;
+}
+
+/**
+ * Run @n_producers producers against one consumer
+ * @return Throughput in millions of items per second, -1 if an item was
+ * received out of order
+ */
+static double bench_run(const bench_backend_t *backend, int n_producers)
+{
+    pthread_t threads[BENCH_MAX_PRODUCERS];
+    bench_producer_t producers[BENCH_MAX_PRODUCERS];
+    uintptr_t last[BENCH_MAX_PRODUCERS] = {0};
+    void *items[BENCH_BATCH];
+    struct timespec start, end;
+    long total = (long)n_producers * BENCH_ITEMS;
+    long received = 0;
+    int i, n, ok = 1;
+
+    void *queue = backend->create(BENCH_QUEUE_LEN, sizeof(void *));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(i = 0; i < n_producers; i++)
+    {
+        producers[i].backend = backend;
+        producers[i].queue = queue;
+        producers[i].id = (uintptr_t)i;
+        pthread_create(&threads[i], NULL, bench_producer, &producers[i]);
+    }
+
+    while(received < total)
+    {
+        if(backend->batch > 1)
+            n = backend->receive_many(queue, items, backend->batch, BENCH_FOREVER);
+        else
+            n = backend->receive(queue, items, BENCH_FOREVER);
+
+        for(i = 0; i < n; i++)
+        {
+            uintptr_t id = (uintptr_t)items[i] >> 24;
+            uintptr_t seq = (uintptr_t)items[i] & 0xFFFFFF;
+            ok &= (id < (uintptr_t)n_producers && seq == last[id] + 1);
+            if(id < (uintptr_t)n_producers)
+                last[id] = seq;
+        }
+        received += n;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    for(i = 0; i < n_producers; i++)
+        pthread_join(threads[i], NULL);
+
+    // Queues are not meant to be destroyed in the flight software
+    if(!ok)
+        return -1;
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec)*1e-9;
+    return total/elapsed/1e6;
+}
+
+int main(void)
+{
+    int n_backends = sizeof(backends)/sizeof(backends[0]);
+    int n, b, rc = 0;
+
+    printf("Throughput in Mitems/s, queue length %d, %d items per producer\n", BENCH_QUEUE_LEN, BENCH_ITEMS);
+    printf("%10s", "producers");
+    for(b = 0; b < n_backends; b++)
+        printf(" %13s", backends[b].name);
+    printf("\n");
+
+    for(n = 1; n <= BENCH_MAX_PRODUCERS; n++)
+    {
+        printf("%10d", n);
+        for(b = 0; b < n_backends; b++)
+        {
+            double mops = bench_run(&backends[b], n);
+            if(mops < 0)
+            {
+                printf(" %13s", "ORDER ERROR");
+                rc = 1;
+            }
+            else
+                printf(" %13.2f", mops);
+            fflush(stdout);
+        }
+        printf("\n");
+    }
+
+    return rc;
+}
@@ -0,0 +1,181 @@
+/*                                 SUCHAI
+ *                      NANOSATELLITE FLIGHT SOFTWARE
+ *
+ *      Copyright 2020, Carlos Gonzalez Cortes, carlgonz@uchile.cl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Contention benchmark of the RAM status repository. Several readers and
+ * writers share the attitude quaternion, comparing the locked reads (the
+ * repository lock taken for each component, as before the seqlock) with the
+ * lock-free group reads of dat_get_status_vars. Writers store quaternions
+ * with the four components equal, so readers also count torn reads.
+ *
+ * Configure with SCH_STORAGE_MODE 0 (configure.py --st_mode 0).
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "repoData.h"
+
+#if SCH_STORAGE_MODE != 0
+#error "Status repository benchmark requires SCH_STORAGE_MODE 0 (RAM)"
+#endif
+
+#define BENCH_SECONDS 1.0
+#define BENCH_MAX_READERS 4
+#define BENCH_MAX_WRITERS 2
+
+typedef struct bench_backend_s {
+    const char *name;
+    void (*get)(value32_t *q);
+    void (*set)(value32_t *q);
+} bench_backend_t;
+
+typedef struct bench_thread_s {
+    const bench_backend_t *backend;
+    long ops;
+    long torn;
+} bench_thread_t;
+
+static volatile int bench_running = 0;
+
+/* Locked backend, one variable at a time */
+static void locked_get(value32_t *q)
+{
+    int i;
+    for(i = 0; i < 4; i++)
+    {
+        osSemaphoreTake(&repo_data_sem, portMAX_DELAY);
+        q[i].u = (uint32_t)_dat_get_system_var(dat_ads_q0 + i);
+        osSemaphoreGiven(&repo_data_sem);
+    }
+}
+
+static void locked_set(value32_t *q)
+{
+    int i;
+    for(i = 0; i < 4; i++)
+        dat_set_status_var(dat_ads_q0 + i, q[i]);
+}
+
+/* Lock-free backend, the whole quaternion as one snapshot */
+static void seqlock_get(value32_t *q) { dat_get_status_vars(dat_ads_q0, q, 4); }
+static void seqlock_set(value32_t *q) { dat_set_status_vars(dat_ads_q0, q, 4); }
+
+static bench_backend_t backends[] = {
+    {"locked", locked_get, locked_set},
+    {"seqlock", seqlock_get, seqlock_set},
+};
+
+static void *bench_reader(void *param)
+{
+    bench_thread_t *t = (bench_thread_t *)param;
+    value32_t q[4];
+    while(bench_running)
+    {
+        t->backend->get(q);
+        if(q[0].u != q[1].u || q[0].u != q[2].u || q[0].u != q[3].u)
+            t->torn++;
+        t->ops++;
+    }
+    return NULL;
+}
+
+static void *bench_writer(void *param)
+{
+    bench_thread_t *t = (bench_thread_t *)param;
+    value32_t q[4];
+    while(bench_running)
+    {
+        q[0].f = q[1].f = q[2].f = q[3].f = (float)t->ops;
+        t->backend->set(q);
+        t->ops++;
+    }
+    return NULL;
+}
+
+/**
+ * Run @n_readers readers and @n_writers writers for BENCH_SECONDS
+ * @param result Array of 3 results: reads/s, writes/s, torn reads
+ */
+static void bench_run(const bench_backend_t *backend, int n_readers, int n_writers, double *result)
+{
+    pthread_t threads[BENCH_MAX_READERS + BENCH_MAX_WRITERS];
+    bench_thread_t params[BENCH_MAX_READERS + BENCH_MAX_WRITERS] = {{0}};
+    struct timespec delay = {(time_t)BENCH_SECONDS, (long)((BENCH_SECONDS - (time_t)BENCH_SECONDS) * 1e9)};
+    value32_t q[4] = {{0}};
+    int i, n = n_readers + n_writers;
+
+    // Start from a whole quaternion, locked writers can leave a torn one
+    dat_set_status_vars(dat_ads_q0, q, 4);
+
+    bench_running = 1;
+    for(i = 0; i < n; i++)
+    {
+        params[i].backend = backend;
+        pthread_create(&threads[i], NULL, i < n_readers ? bench_reader : bench_writer, &params[i]);
+    }
+    nanosleep(&delay, NULL);
+    bench_running = 0;
+
+    result[0] = result[1] = result[2] = 0;
+    for(i = 0; i < n; i++)
+    {
+        pthread_join(threads[i], NULL);
+        result[i < n_readers ? 0 : 1] += params[i].ops / BENCH_SECONDS;
+        result[2] += params[i].torn;
+    }
+}
+
+int main(void)
+{
+    int n_backends = sizeof(backends)/sizeof(backends[0]);
+    int r, w, b, rc = 0;
+    double result[3];
+
+    log_init(LOG_LVL_NONE, -1);
+    dat_repo_init();
+
+    printf("Quaternion reads and writes in Mops/s, %.1f s each\n", BENCH_SECONDS);
+    printf("%8s %8s", "readers", "writers");
+    for(b = 0; b < n_backends; b++)
+        printf(" %10s %10s %10s", backends[b].name, "writes", "torn");
+    printf("\n");
+
+    for(w = 1; w <= BENCH_MAX_WRITERS; w++)
+    {
+        for(r = 1; r <= BENCH_MAX_READERS; r++)
+        {
+            printf("%8d %8d", r, w);
+            for(b = 0; b < n_backends; b++)
+            {
+                bench_run(&backends[b], r, w, result);
+                printf(" %10.2f %10.2f %10.0f", result[0]/1e6, result[1]/1e6, result[2]);
+                fflush(stdout);
+                // Group reads must never see a half written quaternion
+                if(b > 0 && result[2] > 0)
+                    rc = 1;
+            }
+            printf("\n");
+        }
+    }
+
+    dat_repo_close();
+    return rc;
+}
@@ -0,0 +1,323 @@
+/*                                 SUCHAI
+ *                      NANOSATELLITE FLIGHT SOFTWARE
+ *
+ *      Copyright 2020, Carlos Gonzalez Cortes, carlgonz@uchile.cl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * Micro-benchmark of the SQLite storage backend. Compares ad-hoc SQL (the
+ * text is built and prepared on every call, as data_storage.c did before the
+ * statement cache) with the cached prepared statements of the storage API,
+ * for status variables get/set and payload insert/read. Both use in-memory
+ * databases, so the numbers measure the SQL layer and not the disk.
+ *
+ * The payload stream test measures the sustained insert rate on files: the
+ * ad-hoc backend commits each sample with the default journal, the storage
+ * API uses the configured layout, batches and journal mode (see
+ * SCH_STORAGE_PAYLOAD_BLOB, SCH_STORAGE_TX_SAMPLES and SCH_STORAGE_WAL).
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "data_storage.h"
+
+#define BENCH_OPS 20000
+#define BENCH_DB ":memory:"
+#define BENCH_STREAM_OPS 2000
+#define BENCH_STREAM_DB "/tmp/bench_storage_stream.db"
+#define BENCH_STREAM_ADHOC_DB "/tmp/bench_storage_stream_adhoc.db"
+
+static const char *tag = "bench_storage";
+static sqlite3 *adhoc_db = NULL;
+
+/* Ad-hoc SQL versions of the storage functions, they parse the payload
+ * schema strings on every call as data_storage.c did before the field
+ * descriptors */
+static int adhoc_payload_tokens(char** tok_sym, char** tok_var, char* order, char* var_names)
+{
+    int j = 0;
+    tok_sym[0] = strtok(order, " ");
+    while(tok_sym[j] != NULL)
+        tok_sym[++j] = strtok(NULL, " ");
+
+    j = 0;
+    tok_var[0] = strtok(var_names, " ");
+    while(tok_var[j] != NULL)
+        tok_var[++j] = strtok(NULL, " ");
+    return j;
+}
+
+static void adhoc_value_string(char* ret_string, char* c_type, char* buff)
+{
+    if(strcmp(c_type, "%f") == 0)
+        sprintf(ret_string, " %f", *((float*)buff));
+    else if(strcmp(c_type, "%u") == 0)
+        sprintf(ret_string, " %u", *((unsigned int*)buff));
+    else
+        sprintf(ret_string, " %d", *((int*)buff));
+}
+
+static void adhoc_sqlite_value(char* c_type, void* buff, sqlite3_stmt* stmt, int j)
+{
+    if(strcmp(c_type, "%f") == 0) {
+        float val = (float)sqlite3_column_double(stmt, j);
+        memcpy(buff, &val, sizeof(float));
+    }
+    else {
+        int val = sqlite3_column_int(stmt, j);
+        memcpy(buff, &val, sizeof(int));
+    }
+}
+
+static int adhoc_get_value_idx(int index, char *table)
+{
+    int value = -1;
+    sqlite3_stmt* stmt = NULL;
+    char *sql = sqlite3_mprintf("SELECT value FROM %s WHERE idx=\"%d\";", table, index);
+    if(sqlite3_prepare_v2(adhoc_db, sql, -1, &stmt, 0) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW)
+        value = sqlite3_column_int(stmt, 0);
+    sqlite3_finalize(stmt);
+    sqlite3_free(sql);
+    return value;
+}
+
+static int adhoc_set_value_idx(int index, int value, char *table)
+{
+    char *sql = sqlite3_mprintf("INSERT OR REPLACE INTO %s (idx, name, value) "
+                                "VALUES (%d, (SELECT name FROM %s WHERE idx = \"%d\"), %d);",
+                                table, index, table, index, value);
+    int rc = sqlite3_exec(adhoc_db, sql, 0, 0, 0);
+    sqlite3_free(sql);
+    return rc == SQLITE_OK ? 0 : -1;
+}
+
+static int adhoc_set_payload_data(int index, void* data, int payload)
+{
+    char* tok_sym[300];
+    char* tok_var[300];
+    char order[300];
+    char var_names[1000];
+    char names[1000];
+    char values[1000];
+    char insert_row[2000];
+    strcpy(order, data_map[payload].data_order);
+    strcpy(var_names, data_map[payload].var_names);
+    int nparams = adhoc_payload_tokens(tok_sym, tok_var, order, var_names);
+
+    strcpy(names, "(id, tstz,");
+    sprintf(values, "(%d, current_timestamp,", index);
+    int j;
+    for(j=0; j < nparams; ++j)
+    {
+        char name[24], val[24];
+        sprintf(name, " %s%s", tok_var[j], j != nparams-1 ? "," : ")");
+        strcat(names, name);
+        adhoc_value_string(val, tok_sym[j], (char *)data+(j*4));
+        strcat(values, val);
+        strcat(values, j != nparams-1 ? "," : ")");
+    }
+    sprintf(insert_row, "INSERT INTO %s %s VALUES %s", data_map[payload].table, names, values);
+    return sqlite3_exec(adhoc_db, insert_row, 0, 0, 0) == SQLITE_OK ? 0 : -1;
+}
+
+static int adhoc_get_payload_data(int index, void* data, int payload)
+{
+    char* tok_sym[300];
+    char* tok_var[300];
+    char order[300];
+    char var_names[1000];
+    char names[1000];
+    char get_value[2000];
+    strcpy(order, data_map[payload].data_order);
+    strcpy(var_names, data_map[payload].var_names);
+    int nparams = adhoc_payload_tokens(tok_sym, tok_var, order, var_names);
+
+    strcpy(names, "");
+    int j;
+    for(j=0; j < nparams; ++j)
+    {
+        strcat(names, " ");
+        strcat(names, tok_var[j]);
+        if(j != nparams-1)
+            strcat(names, ",");
+    }
+    sprintf(get_value, "SELECT %s FROM %s WHERE id=%d LIMIT 1", names, data_map[payload].table, index);
+
+    sqlite3_stmt* stmt = NULL;
+    int rc = sqlite3_prepare_v2(adhoc_db, get_value, -1, &stmt, 0);
+    if(rc == SQLITE_OK && (rc = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        for(j=0; j < nparams; ++j)
+            adhoc_sqlite_value(tok_sym[j], (char *)data+(j*4), stmt, j);
+    }
+    sqlite3_finalize(stmt);
+    return rc == SQLITE_ROW ? 0 : -1;
+}
+
+static void adhoc_open(const char *file)
+{
+    sqlite3_open(file, &adhoc_db);
+    sqlite3_exec(adhoc_db, "CREATE TABLE dat_system(idx INTEGER PRIMARY KEY, name TEXT UNIQUE, value INT);", 0, 0, 0);
+    sqlite3_exec(adhoc_db, "CREATE TABLE temp_data(id INTEGER, tstz TIMESTAMPTZ, sat_index BIGINT, timestamp BIGINT, "
+                           "obc_temp_1 REAL, obc_temp_2 REAL, obc_temp_3 REAL);", 0, 0, 0);
+}
+
+static void bench_unlink(const char *file)
+{
+    char name[64];
+    unlink(file);
+    snprintf(name, sizeof(name), "%s-wal", file);
+    unlink(name);
+    snprintf(name, sizeof(name), "%s-shm", file);
+    unlink(name);
+    snprintf(name, sizeof(name), "%s-journal", file);
+    unlink(name);
+}
+
+/* Storage API with the same signature as the ad-hoc versions */
+typedef struct bench_backend_s {
+    const char *name;
+    int (*get_value)(int index, char *table);
+    int (*set_value)(int index, int value, char *table);
+    int (*set_payload)(int index, void* data, int payload);
+    int (*get_payload)(int index, void* data, int payload);
+} bench_backend_t;
+
+static bench_backend_t backends[] = {
+    {"ad-hoc", adhoc_get_value_idx, adhoc_set_value_idx, adhoc_set_payload_data, adhoc_get_payload_data},
+    {"cached", storage_repo_get_value_idx, storage_repo_set_value_idx, storage_set_payload_data, storage_get_payload_data},
+};
+
+static double bench_elapsed(struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec)*1e-9;
+}
+
+/**
+ * Run the four operations BENCH_OPS times, checking the values read
+ * @param ops_s Array of 4 results in operations per second
+ * @return 0 if OK, -1 if a value read is wrong
+ */
+static int bench_run(const bench_backend_t *backend, double *ops_s)
+{
+    struct timespec start;
+    temp_data_t sample = {0, 0, 1.5, 2.5, 3.5};
+    temp_data_t read;
+    int i, ok = 1;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(i = 0; i < BENCH_OPS; i++)
+        backend->set_value(i % dat_status_last_address, i, DAT_REPO_SYSTEM);
+    ops_s[0] = BENCH_OPS/bench_elapsed(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(i = 0; i < BENCH_OPS; i++)
+        ok &= backend->get_value(i % dat_status_last_address, DAT_REPO_SYSTEM) >= BENCH_OPS - dat_status_last_address;
+    ops_s[1] = BENCH_OPS/bench_elapsed(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(i = 0; i < BENCH_OPS; i++)
+    {
+        sample.index = sample.timestamp = i;
+        backend->set_payload(i, &sample, temp_sensors);
+    }
+    ops_s[2] = BENCH_OPS/bench_elapsed(&start);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(i = 0; i < BENCH_OPS; i++)
+    {
+        ok &= backend->get_payload(i, &read, temp_sensors) == 0;
+        ok &= read.timestamp == (uint32_t)i && read.obc_temp_3 == sample.obc_temp_3;
+    }
+    ops_s[3] = BENCH_OPS/bench_elapsed(&start);
+
+    return ok ? 0 : -1;
+}
+
+/**
+ * Insert BENCH_STREAM_OPS payload samples, including the commit of the last
+ * batch
+ * @return Samples per second
+ */
+static double bench_stream(const bench_backend_t *backend)
+{
+    struct timespec start;
+    temp_data_t sample = {0, 0, 1.5, 2.5, 3.5};
+    int i;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(i = 0; i < BENCH_STREAM_OPS; i++)
+    {
+        sample.index = sample.timestamp = i;
+        backend->set_payload(i, &sample, temp_sensors);
+    }
+    storage_commit();
+    return BENCH_STREAM_OPS/bench_elapsed(&start);
+}
+
+int main(void)
+{
+    const char *ops[] = {"status set", "status get", "payload insert", "payload read"};
+    double results[2][4];
+    int i, rc = 0;
+
+    log_init(LOG_LVL_NONE, -1);
+
+    // The cached backend uses the storage API database
+    rc |= storage_init(BENCH_DB);
+    rc |= storage_table_repo_init(DAT_REPO_SYSTEM, 0);
+    rc |= storage_table_payload_init(0);
+
+    // The ad-hoc backend uses its own database, with the same tables
+    adhoc_open(BENCH_DB);
+    assertf(rc == 0, tag, "Unable to init the storage");
+
+    for(i = 0; i < 2; i++)
+    {
+        if(bench_run(&backends[i], results[i]) != 0)
+        {
+            printf("%s: wrong values read\n", backends[i].name);
+            rc = 1;
+        }
+    }
+
+    printf("Operations per second, %d operations each\n", BENCH_OPS);
+    printf("%16s %12s %12s %8s\n", "operation", backends[0].name, backends[1].name, "speedup");
+    for(i = 0; i < 4; i++)
+        printf("%16s %12.0f %12.0f %8.1f\n", ops[i], results[0][i], results[1][i], results[1][i]/results[0][i]);
+
+    // Sustained payload insert rate, on files so the journal syncs count
+    double stream[2];
+    sqlite3_close(adhoc_db);
+    storage_close();
+    bench_unlink(BENCH_STREAM_ADHOC_DB);
+    bench_unlink(BENCH_STREAM_DB);
+    adhoc_open(BENCH_STREAM_ADHOC_DB);
+    rc |= storage_init(BENCH_STREAM_DB) | storage_table_payload_init(0);
+    for(i = 0; i < 2; i++)
+        stream[i] = bench_stream(&backends[i]);
+    printf("%16s %12.0f %12.0f %8.1f\n", "payload stream", stream[0], stream[1], stream[1]/stream[0]);
+
+    sqlite3_close(adhoc_db);
+    storage_close();
+    bench_unlink(BENCH_STREAM_ADHOC_DB);
+    bench_unlink(BENCH_STREAM_DB);
+    return rc;
+}
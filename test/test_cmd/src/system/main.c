@@ -43,16 +43,17 @@ int main(void)
     LOGI(tag, "Creating tasks...");
 
     /* Initializing shared Queues */
-    dispatcher_queue = osQueueCreate(25,sizeof(cmd_t *));
-    executer_cmd_queue = osQueueCreate(1,sizeof(cmd_t *));
-    executer_stat_queue = osQueueCreate(1,sizeof(int));
+    dispatcher_init();
+    executer_init();
 
     int n_threads = 3;
     os_thread threads_id[n_threads];
+    os_thread executers_id[EXECUTER_N_TASKS];
 
     /* Crating system task (the others are created inside taskDeployment) */
     osCreateTask(taskDispatcher,"dispatcher", 2*configMINIMAL_STACK_SIZE,NULL,3, &threads_id[0]);
-    osCreateTask(taskExecuter, "executer", 5*configMINIMAL_STACK_SIZE, NULL, 4, &threads_id[1]);
+    executer_create_tasks(executers_id);
+    threads_id[1] = executers_id[0];
 
     osCreateTask(taskTest, "test", 2*configMINIMAL_STACK_SIZE, "TEST1", 2, &threads_id[2]);
 
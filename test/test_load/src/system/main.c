@@ -42,23 +42,20 @@ int main(void)
     dat_repo_init(); // Update status repository
 
     /* Initializing shared Queues */
-    dispatcher_queue = osQueueCreate(10,sizeof(cmd_t *));
-    if(dispatcher_queue == 0)
-        LOGE(tag, "Error creating dispatcher queue");
-    executer_stat_queue = osQueueCreate(1,sizeof(int));
-    if(executer_stat_queue == 0)
-        LOGE(tag, "Error creating executer stat queue");
-    executer_cmd_queue = osQueueCreate(1,sizeof(cmd_t *));
-    if(executer_cmd_queue == 0)
-        LOGE(tag, "Error creating executer cmd queue");
+    if(dispatcher_init() != 0)
+        LOGE(tag, "Error creating dispatcher queues");
+    if(executer_init() != 0)
+        LOGE(tag, "Error creating executer queues");
 
     int n_threads = 4;
     os_thread threads_id[n_threads];
+    os_thread executers_id[EXECUTER_N_TASKS];
 
     LOGI(tag, "Creating basic tasks...");
     /* Crating system task (the others are created inside taskDeployment) */
     osCreateTask(taskDispatcher,"dispatcher", 2*configMINIMAL_STACK_SIZE,NULL,3, &threads_id[0]);
-    osCreateTask(taskExecuter, "executer", 5*configMINIMAL_STACK_SIZE, NULL, 4, &threads_id[1]);
+    executer_create_tasks(executers_id);
+    threads_id[1] = executers_id[0];
 
     osCreateTask(taskTest, "test1", 2*configMINIMAL_STACK_SIZE, "TEST 1", 2, &threads_id[2]);
     osCreateTask(taskTest, "test2", 2*configMINIMAL_STACK_SIZE, "TEST 2", 2, &threads_id[2]);
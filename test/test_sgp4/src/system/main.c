@@ -18,23 +18,20 @@ int main(void)
     dat_repo_init(); // Update status repository
 
     /* Initializing shared Queues */
-    dispatcher_queue = osQueueCreate(25,sizeof(cmd_t *));
-    if(dispatcher_queue == 0)
-        LOGE(tag, "Error creating dispatcher queue");
-    executer_stat_queue = osQueueCreate(1,sizeof(int));
-    if(executer_stat_queue == 0)
-        LOGE(tag, "Error creating executer stat queue");
-    executer_cmd_queue = osQueueCreate(1,sizeof(cmd_t *));
-    if(executer_cmd_queue == 0)
-        LOGE(tag, "Error creating executer cmd queue");
+    if(dispatcher_init() != 0)
+        LOGE(tag, "Error creating dispatcher queues");
+    if(executer_init() != 0)
+        LOGE(tag, "Error creating executer queues");
 
     int n_threads = 3;
     os_thread threads_id[n_threads];
+    os_thread executers_id[EXECUTER_N_TASKS];
 
     LOGI(tag, "Creating basic tasks...");
     /* Crating system task (the others are created inside taskInit) */
     int t_inv_ok = osCreateTask(taskDispatcher,"invoker", SCH_TASK_DIS_STACK, NULL, 3, &threads_id[0]);
-    int t_exe_ok = osCreateTask(taskExecuter, "receiver", SCH_TASK_EXE_STACK, NULL, 4, &threads_id[1]);
+    int t_exe_ok = executer_create_tasks(executers_id);
+    threads_id[1] = executers_id[0];
 //    int t_ini_ok = osCreateTask(taskInit, "init", SCH_TASK_INI_STACK, NULL, 3, &threads_id[3]);
     int t_test_ok = osCreateTask(taskTest, "test", SCH_TASK_DEF_STACK, "../data.csv", 2, &threads_id[2]);
 
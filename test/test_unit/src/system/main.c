@@ -23,13 +23,22 @@
  */
 
 #include <string.h>
+#include <stddef.h>
+#include <pthread.h>
 #include "CUnit/Basic.h"
 #include "math_utils.h"
 #include "repoCommand.h"
 #include "data_storage.h"
+#include "taskDispatcher.h"
+#include "taskExecuter.h"
 
 
 /** SUIT 2: Command repository **/
+#if SCH_COMM_ENABLE
+#define CMD_POOL_TEST_RAW_LEN sizeof(com_data_t) ///< Largest frame sent as raw parameters
+#else
+#define CMD_POOL_TEST_RAW_LEN 200
+#endif
 /* The suite initialization function.
  * Initializes
  */
@@ -60,7 +69,7 @@ void testParseCommands(void)
     name = cmd_get_name(cmd->id);
     CU_ASSERT_STRING_EQUAL("obc_get_mem", name)
     CU_ASSERT_PTR_NULL(cmd->params);
-    free(cmd); free(name);
+    cmd_free(cmd); free(name);
 
     // Case 2: command with parameters; command do not req. parameters.
     cmd = cmd_build_from_str("obc_get_mem foo");
@@ -68,7 +77,7 @@ void testParseCommands(void)
     name = cmd_get_name(cmd->id);
     CU_ASSERT_STRING_EQUAL("obc_get_mem", name)
     CU_ASSERT_STRING_EQUAL("foo", cmd->params);
-    free(cmd); free(name);
+    cmd_free(cmd); free(name);
 
     // Case 3: command with parameters; command require parameters.
     cmd = cmd_build_from_str("obc_debug 1");
@@ -76,7 +85,7 @@ void testParseCommands(void)
     name = cmd_get_name(cmd->id);
     CU_ASSERT_STRING_EQUAL("obc_debug", name)
     CU_ASSERT_STRING_EQUAL("1", cmd->params);
-    free(cmd); free(name);
+    cmd_free(cmd); free(name);
 
     // Case 4: command without parameters; command require parameters.
     cmd = cmd_build_from_str("obc_debug");
@@ -84,22 +93,381 @@ void testParseCommands(void)
     name = cmd_get_name(cmd->id);
     CU_ASSERT_STRING_EQUAL("obc_debug", name)
     CU_ASSERT_PTR_NULL(cmd->params);
-    free(cmd); free(name);
+    cmd_free(cmd); free(name);
 
     // Case 5: not valid command
     cmd = cmd_build_from_str("invalid_command");
     CU_ASSERT_PTR_NULL(cmd);
-    free(cmd);
+    cmd_free(cmd);
 
     // Case 6: empty command
     cmd = cmd_build_from_str("\0");
     CU_ASSERT_PTR_NULL(cmd);
-    free(cmd);
+    cmd_free(cmd);
 
     // Case 7: \n or \cr command
     cmd = cmd_build_from_str("\r\n");
     CU_ASSERT_PTR_NULL(cmd);
-    free(cmd);
+    cmd_free(cmd);
+}
+
+// Test of typed parameters
+static char test_legacy_params[SCH_CMD_MAX_STR_PARAMS];
+static int test_legacy(char *fmt, char *params, int nparams)
+{
+    memset(test_legacy_params, 0, sizeof(test_legacy_params));
+    strncpy(test_legacy_params, params == NULL ? "" : params, sizeof(test_legacy_params)-1);
+    return CMD_OK;
+}
+
+static int test_typed(cmd_args_t *args)
+{
+    return args->arg[0].i == 1 && strcmp(args->arg[2].s, "foo") == 0 ? CMD_OK : CMD_ERROR;
+}
+
+void testTypedCommands(void)
+{
+    cmd_fmt_desc_t desc;
+    cmd_t *cmd;
+
+    // Case 1: compile parameters formats
+    CU_ASSERT_EQUAL(3, cmd_fmt_compile("%d %lf %s", &desc));
+    CU_ASSERT_EQUAL(CMD_ARG_DOUBLE, desc.type[1]);
+    CU_ASSERT_EQUAL(0, cmd_fmt_compile("", &desc));
+    CU_ASSERT_EQUAL(-1, cmd_fmt_compile("%p", &desc));
+    CU_ASSERT_EQUAL(-1, cmd_fmt_compile("%n %d", &desc));
+
+    CU_ASSERT(cmd_add_typed("test_typed", test_typed, "%d %f %s %n", CMD_CLASS_FREE) > 0);
+    CU_ASSERT(cmd_add("test_legacy", test_legacy, "%d %lf %s", 3) > 0);
+    CU_ASSERT_EQUAL(-1, cmd_add_typed("test_invalid", test_typed, "%p", CMD_CLASS_FREE));
+
+    // Case 2: typed parameters are parsed once from string
+    cmd = cmd_build_from_str("test_typed 1 -4.25 foo bar  baz");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(cmd);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(cmd->args);
+    CU_ASSERT_PTR_NULL(cmd->params);
+    CU_ASSERT_EQUAL(4, cmd->args->nargs);
+    CU_ASSERT_EQUAL(1, cmd->args->arg[0].i);
+    CU_ASSERT_DOUBLE_EQUAL(-4.25, cmd->args->arg[1].f, 1e-6);
+    CU_ASSERT_STRING_EQUAL("foo", cmd->args->arg[2].s);
+    CU_ASSERT_STRING_EQUAL("bar  baz", cmd->args->arg[3].s);
+    CU_ASSERT_EQUAL(CMD_OK, cmd_execute(cmd));
+    cmd_free(cmd);
+
+    // Case 3: invalid or missing parameters are a syntax error
+    cmd = cmd_build_from_str("test_typed 1 abc");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(cmd);
+    CU_ASSERT_EQUAL(1, cmd->args->nargs);
+    CU_ASSERT_EQUAL(CMD_SYNTAX_ERROR, cmd_execute(cmd));
+    cmd_free(cmd);
+
+    // Case 4: typed parameters are filled directly
+    cmd = cmd_get_str("test_typed");
+    cmd_add_params_var(cmd, 1, 2.5, "foo", "");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(cmd->args);
+    CU_ASSERT_EQUAL(4, cmd->args->nargs);
+    CU_ASSERT_DOUBLE_EQUAL(2.5, cmd->args->arg[1].f, 1e-6);
+    CU_ASSERT_EQUAL(CMD_OK, cmd_execute(cmd));
+    cmd_free(cmd);
+
+    // Case 5: legacy handlers receive the parameters as string
+    cmd = cmd_get_str("test_legacy");
+    cmd_add_params_var(cmd, -7, 0.5, "foo");
+    CU_ASSERT_EQUAL(CMD_OK, cmd_execute(cmd));
+    CU_ASSERT_STRING_EQUAL("-7 0.5 foo", test_legacy_params);
+    cmd_free(cmd);
+
+    cmd = cmd_build_from_str("test_legacy 1 2 bar");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(cmd);
+    CU_ASSERT_STRING_EQUAL("1 2 bar", cmd->params);
+    CU_ASSERT_EQUAL(CMD_OK, cmd_execute(cmd));
+    CU_ASSERT_STRING_EQUAL("1 2 bar", test_legacy_params);
+    cmd_free(cmd);
+}
+
+// Test of commands lookup after cmd_repo_freeze
+void testFrozenCommands(void)
+{
+    cmd_t *cmd;
+    char *name;
+    int i;
+
+    CU_ASSERT_EQUAL(CMD_OK, cmd_repo_freeze());
+
+    // Case 1: every registered command is found by name with the same id
+    for(i=0; i<cmd_index; i++)
+    {
+        name = cmd_get_name(i);
+        cmd = cmd_get_str(name);
+        CU_ASSERT_PTR_NOT_NULL_FATAL(cmd);
+        CU_ASSERT_EQUAL(i, cmd->id);
+        cmd_free(cmd); free(name);
+    }
+
+    // Case 2: parse commands using the index
+    cmd = cmd_build_from_str("obc_debug 1");
+    CU_ASSERT_PTR_NOT_NULL(cmd);
+    name = cmd_get_name(cmd->id);
+    CU_ASSERT_STRING_EQUAL("obc_debug", name)
+    cmd_free(cmd); free(name);
+
+    // Case 3: not valid command
+    cmd = cmd_get_str("invalid_command");
+    CU_ASSERT_PTR_NULL(cmd);
+
+    // Case 4: not valid index
+    CU_ASSERT_PTR_NULL(cmd_get_idx(-1));
+    CU_ASSERT_PTR_NULL(cmd_get_name(SCH_CMD_MAX_ENTRIES));
+
+    // Case 5: commands can not be added to a frozen repository
+    CU_ASSERT_EQUAL(-1, cmd_add("invalid_command", cmd_null, "", 0));
+}
+
+// Test of commands and parameters pools
+void testCommandsPool(void)
+{
+    cmd_t *cmds[SCH_CMD_POOL_CMDS];
+    cmd_pool_stats_t stats_0, stats;
+    int i;
+
+    cmd_pool_get_stats(&stats_0);
+    CU_ASSERT_EQUAL(0, stats_0.cmd_used);
+    CU_ASSERT_EQUAL(0, stats_0.par_used);
+
+    // Case 1: allocate all commands with small and large parameters
+    for(i=0; i<SCH_CMD_POOL_CMDS; i++)
+    {
+        cmds[i] = cmd_get_str("obc_debug");
+        CU_ASSERT_PTR_NOT_NULL_FATAL(cmds[i]);
+        cmd_add_params_str(cmds[i], i%8 ? "1" : "123456789012345678901234567890123456789");
+    }
+    cmd_pool_get_stats(&stats);
+    CU_ASSERT_EQUAL(SCH_CMD_POOL_CMDS, stats.cmd_used);
+    CU_ASSERT_EQUAL(SCH_CMD_POOL_CMDS, stats.cmd_max);
+    CU_ASSERT_STRING_EQUAL("1", cmds[1]->params);
+    CU_ASSERT_STRING_EQUAL("123456789012345678901234567890123456789", cmds[0]->params);
+
+    // Case 2: the pool is exhausted
+    cmd_t *cmd = cmd_get_str("obc_debug");
+#if !SCH_CMD_POOL_HEAP
+    CU_ASSERT_PTR_NULL(cmd);
+#endif
+    cmd_free(cmd);
+    cmd_pool_get_stats(&stats);
+    CU_ASSERT_EQUAL(stats_0.cmd_fail + 1, stats.cmd_fail);
+
+    // Case 3: all blocks are returned to the pools
+    for(i=0; i<SCH_CMD_POOL_CMDS; i++)
+        cmd_free(cmds[i]);
+    cmd_pool_get_stats(&stats);
+    CU_ASSERT_EQUAL(0, stats.cmd_used);
+    CU_ASSERT_EQUAL(0, stats.par_used);
+    CU_ASSERT_EQUAL(SCH_CMD_POOL_CMDS, stats.cmd_max);
+
+    // Case 4: raw parameters use a bigger buffer if required
+    char data[CMD_POOL_TEST_RAW_LEN];
+    memset(data, 0xAA, sizeof(data));
+    cmd = cmd_get_str("obc_debug");
+    cmd_add_params_raw(cmd, data, sizeof(data));
+    CU_ASSERT_PTR_NOT_NULL_FATAL(cmd->params);
+    CU_ASSERT_EQUAL(0, memcmp(data, cmd->params, sizeof(data)));
+    cmd_free(cmd);
+}
+
+void testCommandsStats(void)
+{
+    cmd_stats_t stats;
+
+    cmd_stats_reset();
+    cmd_t *cmd = cmd_get_str("obc_debug");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(cmd);
+
+    // Case 1: Linux ticks are microseconds, 50us queued + 500us running
+    cmd->t_wait = 50;
+    cmd_stats_record(cmd, 500, CMD_OK);
+    // Case 2: a failed command, not dispatched, running 20ms
+    cmd->t_wait = 0;
+    cmd_stats_record(cmd, 20000, CMD_ERROR);
+
+    CU_ASSERT_EQUAL(CMD_OK, cmd_stats_get(cmd->id, &stats));
+    CU_ASSERT_EQUAL(2, stats.count);
+    CU_ASSERT_EQUAL(1, stats.fails);
+    CU_ASSERT_EQUAL(50, stats.wait_total);
+    CU_ASSERT_EQUAL(50, stats.wait_max);
+    CU_ASSERT_EQUAL(20500, stats.exec_total);
+    CU_ASSERT_EQUAL(20000, stats.exec_max);
+    CU_ASSERT_EQUAL(1, stats.hist[2]);  // < 1ms
+    CU_ASSERT_EQUAL(1, stats.hist[4]);  // < 100ms
+    CU_ASSERT_EQUAL(0, stats.hist[0]);
+
+    // Case 3: invalid index and reset
+    CU_ASSERT_EQUAL(CMD_ERROR, cmd_stats_get(-1, &stats));
+    cmd_stats_reset();
+    cmd_stats_get(cmd->id, &stats);
+    CU_ASSERT_EQUAL(0, stats.count);
+    cmd_free(cmd);
+}
+
+// Command that runs over its budget, checks the cancellation request
+static int budget_flagged, budget_last_id, budget_cancel;
+static int cmd_over_budget(char *fmt, char *params, int nparams)
+{
+    osDelay(5);
+    budget_flagged = cmd_check_budgets(&budget_last_id);
+    budget_cancel = cmd_cancel_requested();
+    return budget_cancel ? CMD_ERROR : CMD_OK;
+}
+
+// Test of commands deadlines and budgets
+void testCommandsBudget(void)
+{
+    cmd_stats_t stats;
+    cmd_t *cmd = cmd_get_str("obc_debug");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(cmd);
+    CU_ASSERT_EQUAL(SCH_CMD_BUDGET_MS, cmd->budget);
+
+    // Case 1: no deadline, deadlines in the past and in the future
+    CU_ASSERT_EQUAL(0, cmd->deadline);
+    CU_ASSERT_EQUAL(0, cmd_deadline_passed(cmd, 1000));
+    cmd_set_deadline(cmd, 1000);
+    CU_ASSERT_EQUAL(0, cmd_deadline_passed(cmd, 999));
+    CU_ASSERT_EQUAL(0, cmd_deadline_passed(cmd, 1000));
+    CU_ASSERT_EQUAL(1, cmd_deadline_passed(cmd, 1001));
+    // Case 2: the tick counter overflows before the deadline
+    cmd_set_deadline(cmd, 10);
+    CU_ASSERT_EQUAL(0, cmd_deadline_passed(cmd, (portTick)-10));
+    CU_ASSERT_EQUAL(1, cmd_deadline_passed(cmd, 11));
+    // Case 3: deadline 0 is stored as 1, not as "no deadline"
+    cmd_set_deadline(cmd, 0);
+    CU_ASSERT_EQUAL(1, cmd_deadline_passed(cmd, 2));
+
+    // Case 4: overruns counted by cmd_stats_record, 1ms budget
+    cmd_stats_reset();
+    cmd->budget = 1;
+    CU_ASSERT_EQUAL(0, cmd_stats_record(cmd, 500, CMD_OK));
+    CU_ASSERT_EQUAL(1, cmd_stats_record(cmd, 2000, CMD_OK));
+    cmd->budget = 0;
+    CU_ASSERT_EQUAL(0, cmd_stats_record(cmd, 2000, CMD_OK));
+    cmd_stats_get(cmd->id, &stats);
+    CU_ASSERT_EQUAL(1, stats.overruns);
+
+    // Case 5: running over budget, flagged once and asked to stop
+    cmd->budget = 1;
+    cmd->function = cmd_over_budget;
+    cmd->function_args = NULL;
+    budget_last_id = -1;
+    CU_ASSERT_EQUAL(CMD_ERROR, cmd_execute(cmd));
+    CU_ASSERT_EQUAL(1, budget_flagged);
+    CU_ASSERT_EQUAL(cmd->id, budget_last_id);
+    CU_ASSERT_EQUAL(1, budget_cancel);
+    CU_ASSERT_EQUAL(1, cmd->overrun);
+    CU_ASSERT_EQUAL(0, cmd_check_budgets(NULL));
+    CU_ASSERT_EQUAL(0, cmd_cancel_requested());
+    // Already reported, counted in the statistics only
+    CU_ASSERT_EQUAL(0, cmd_stats_record(cmd, 6000, CMD_ERROR));
+    cmd_stats_get(cmd->id, &stats);
+    CU_ASSERT_EQUAL(2, stats.overruns);
+
+    cmd_stats_reset();
+    cmd_free(cmd);
+}
+
+// Test of coalescible commands parameters comparison
+void testCommandsCoalesce(void)
+{
+    cmd_t *a, *b;
+
+    // Case 1: legacy parameters compared as strings, NULL equals ""
+    a = cmd_build_from_str("obc_debug 1");
+    b = cmd_build_from_str("obc_debug 1");
+    CU_ASSERT_EQUAL(1, cmd_params_equal(a, b));
+    cmd_add_params_str(b, "2");
+    CU_ASSERT_EQUAL(0, cmd_params_equal(a, b));
+    cmd_free(a); cmd_free(b);
+    a = cmd_get_str("obc_get_mem");
+    b = cmd_build_from_str("obc_get_mem");
+    CU_ASSERT_EQUAL(1, cmd_params_equal(a, b));
+    cmd_free(b);
+
+    // Case 2: different commands never match
+    b = cmd_build_from_str("obc_debug");
+    CU_ASSERT_EQUAL(0, cmd_params_equal(a, b));
+    CU_ASSERT_EQUAL(0, cmd_params_equal(a, NULL));
+    cmd_free(a); cmd_free(b);
+
+    // Case 3: typed arguments compared by value, strings by content
+    a = cmd_build_from_str("test_typed 1 -4.25 foo bar");
+    b = cmd_build_from_str("test_typed 1 -4.25 foo bar");
+    CU_ASSERT_EQUAL(1, cmd_params_equal(a, b));
+    cmd_free(b);
+    b = cmd_build_from_str("test_typed 1 -4.25 foo baz");
+    CU_ASSERT_EQUAL(0, cmd_params_equal(a, b));
+    cmd_free(b);
+    b = cmd_build_from_str("test_typed 1 -4.5 foo bar");
+    CU_ASSERT_EQUAL(0, cmd_params_equal(a, b));
+    cmd_free(a); cmd_free(b);
+
+    // Case 4: the flag is set at registration, not after the freeze
+    CU_ASSERT_EQUAL(CMD_ERROR, cmd_set_coalesce("obc_debug", 1));
+    a = cmd_get_str("obc_debug");
+    CU_ASSERT_EQUAL(0, a->coalesce);
+    cmd_free(a);
+}
+
+// Test of the admission rules
+void testCommandsAdmission(void)
+{
+    cmd_admission_t adm;
+    cmd_rule_t rule;
+    cmd_t *cmd = cmd_get_str("obc_debug");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(cmd);
+    CU_ASSERT_EQUAL(CMD_COST_DEFAULT, cmd->cost);
+
+    cmd_rule_t low_batt = {0, 7000, 0, (1u << CMD_COST_FILE) | (1u << CMD_COST_ADCS), 0};
+    cmd_rule_t mode = {1u << 2, 0, 0, 1u << CMD_COST_TM_BULK, 0};
+    cmd_rule_t overload = {0, 0, 10, (1u << CMD_COST_TM_BULK) | (1u << CMD_COST_FILE), 0};
+    CU_ASSERT_EQUAL(CMD_OK, cmd_rules_set(0, &low_batt));
+    CU_ASSERT_EQUAL(CMD_OK, cmd_rules_set(1, &mode));
+    CU_ASSERT_EQUAL(CMD_OK, cmd_rules_set(2, &overload));
+    CU_ASSERT_EQUAL(CMD_ERROR, cmd_rules_set(CMD_RULES_MAX, &mode));
+
+    // Case 1: default cost commands are always admitted
+    cmd_rules_compile(&adm, 2, 6000);
+    CU_ASSERT_EQUAL(-1, cmd_admit(&adm, cmd, 100));
+
+    // Case 2: low battery, an unknown voltage (0) does not trigger the rule
+    cmd->cost = CMD_COST_FILE;
+    CU_ASSERT_EQUAL(0, cmd_admit(&adm, cmd, 0));
+    cmd_rules_compile(&adm, 0, 0);
+    CU_ASSERT_EQUAL(-1, cmd_admit(&adm, cmd, 0));
+    cmd_rules_compile(&adm, 0, 7000);
+    CU_ASSERT_EQUAL(-1, cmd_admit(&adm, cmd, 0));
+
+    // Case 3: operation mode, out of range modes only match "any mode"
+    cmd->cost = CMD_COST_TM_BULK;
+    cmd_rules_compile(&adm, 2, 8000);
+    CU_ASSERT_EQUAL(1, cmd_admit(&adm, cmd, 0));
+    cmd_rules_compile(&adm, -1, 8000);
+    CU_ASSERT_EQUAL(-1, cmd_admit(&adm, cmd, 9));
+
+    // Case 4: queue depth
+    CU_ASSERT_EQUAL(2, cmd_admit(&adm, cmd, 10));
+    cmd->cost = CMD_COST_ADCS;
+    CU_ASSERT_EQUAL(-1, cmd_admit(&adm, cmd, 10));
+
+    // Case 5: rejections are counted per rule, disabled rules do nothing
+    cmd_rules_get(0, &rule);
+    CU_ASSERT_EQUAL(1, rule.rejected);
+    cmd_rules_get(2, &rule);
+    CU_ASSERT_EQUAL(1, rule.rejected);
+    memset(&rule, 0, sizeof(rule));
+    cmd_rules_set(0, &rule);
+    cmd_rules_set(1, &rule);
+    cmd_rules_set(2, &rule);
+    cmd_rules_compile(&adm, 2, 6000);
+    CU_ASSERT_EQUAL(0, adm.mask);
+
+    cmd_free(cmd);
 }
 
 /** SUIT 1: Flight Plan **/
@@ -374,6 +742,358 @@ void test_payload_data(void)
         CU_ASSERT_EQUAL(data_eps.temp5, int_test+i);
         CU_ASSERT_EQUAL(data_eps.temp6, int_test+i);
     }
+
+    // Read the N samples at once, asking for more than available
+    temp_data_t data_range[n_test+1];
+    rc = dat_get_payload_range(temp_sensors, 0, n_test+1, data_range);
+    CU_ASSERT_EQUAL(rc, n_test);
+    for(i=0; i<n_test; i++)
+    {
+        CU_ASSERT_EQUAL(data_range[i].timestamp, time_test+i);
+        CU_ASSERT_DOUBLE_EQUAL(data_range[i].obc_temp_3, float_test+i, 1e-6);
+    }
+    rc = dat_get_payload_range(temp_sensors, n_test-2, 2, data_range);
+    CU_ASSERT_EQUAL(rc, 2);
+    CU_ASSERT_EQUAL(data_range[1].timestamp, time_test+n_test-1);
+}
+
+// The SQL tables only keep the last sections with SCH_STORAGE_SQL_RETENTION
+#if SCH_STORAGE_MODE == 1 || SCH_STORAGE_MODE == 2
+    #define TEST_PAYLOAD_RETENTION (SCH_STORAGE_SQL_RETENTION == 1)
+#else
+    #define TEST_PAYLOAD_RETENTION (SCH_STORAGE_RING == 1)
+#endif
+
+#if TEST_PAYLOAD_RETENTION
+void test_payload_retention(void)
+{
+    init_suite_repodata();
+
+    int rc, i;
+    int n_test = 10;
+    // Samples per section, the segment records also keep the index and crc
+#if SCH_STORAGE_MODE == 3
+    int len = SCH_SIZE_PER_SECTION/((data_map[temp_sensors].size + 2*sizeof(uint32_t) + 3) & ~3);
+#else
+    int len = SCH_SIZE_PER_SECTION/data_map[temp_sensors].size;
+#endif
+    // Start at the end of the last section, the next samples reuse the first
+    int reused = data_map[temp_sensors].sections*len;
+    int start = reused - n_test/2;
+    dat_set_system_var(dat_drp_temp, start);
+    dat_set_system_var(dat_drp_ack_temp, 0);
+
+    for(i=0; i<n_test; i++)
+    {
+        temp_data_t data_temp;
+        data_temp.timestamp = (uint32_t)i;
+        data_temp.index = (uint32_t)(start+i);
+        data_temp.obc_temp_1 = (float)i;
+        data_temp.obc_temp_2 = (float)i;
+        data_temp.obc_temp_3 = (float)i;
+        rc = dat_add_payload_sample(&data_temp, temp_sensors);
+        CU_ASSERT_EQUAL(rc, start+i+1);
+
+        // Nothing is reclaimed until the first section is reused
+        if(start+i+1 == reused)
+        {
+            CU_ASSERT_EQUAL(dat_get_payload_first(temp_sensors), 0);
+            CU_ASSERT_EQUAL(dat_get_system_var(dat_drp_ack_temp), 0);
+        }
+    }
+
+    // The first section was reclaimed, the ack index follows it
+    int first = dat_get_payload_first(temp_sensors);
+    CU_ASSERT_EQUAL(first, len);
+    CU_ASSERT_EQUAL(dat_get_system_var(dat_drp_ack_temp), len);
+
+    temp_data_t data_temp;
+    rc = dat_get_payload_sample(&data_temp, temp_sensors, first-1);
+    CU_ASSERT_EQUAL(rc, -1);
+    rc = dat_get_payload_sample(&data_temp, temp_sensors, reused);
+    CU_ASSERT_EQUAL(rc, 0);
+    CU_ASSERT_EQUAL(data_temp.index, reused);
+    rc = dat_get_recent_payload_sample(&data_temp, temp_sensors, 0);
+    CU_ASSERT_EQUAL(rc, 0);
+    CU_ASSERT_EQUAL(data_temp.timestamp, n_test-1);
+
+    temp_data_t data_range[n_test];
+    rc = dat_get_payload_range(temp_sensors, start, n_test, data_range);
+    CU_ASSERT_EQUAL(rc, n_test);
+    for(i=0; i<n_test; i++)
+        CU_ASSERT_EQUAL(data_range[i].index, start+i);
+
+    dat_delete_memory_sections();
+    CU_ASSERT_EQUAL(dat_get_system_var(dat_drp_temp), 0);
+    CU_ASSERT_EQUAL(dat_get_system_var(dat_drp_ack_temp), 0);
+}
+#endif
+
+// Only the permanent storage keeps the status variables in a write-behind cache
+#define TEST_STATUS_CACHE (SCH_STORAGE_MODE > 0 && SCH_STORAGE_FLUSH_MS > 0)
+
+#if TEST_STATUS_CACHE
+void test_status_cache(void)
+{
+    dat_status_address_t var_1 = dat_rtc_date_time, var_2 = dat_obc_executed_cmds;
+    int value = dat_get_system_var(var_1) + 1;
+    CU_ASSERT_EQUAL(0, dat_flush());
+    CU_ASSERT_EQUAL(0, _dat_get_dirty_vars());
+
+    // A change is read back from the cache before it is written
+    CU_ASSERT_EQUAL(0, dat_set_system_var(var_1, value));
+    CU_ASSERT_EQUAL(1, _dat_get_dirty_vars());
+    CU_ASSERT_EQUAL(value, dat_get_system_var(var_1));
+    CU_ASSERT_NOT_EQUAL(value, storage_repo_get_value_idx(var_1, DAT_REPO_SYSTEM));
+
+    // It is in the storage after the flush
+    CU_ASSERT_EQUAL(0, dat_flush());
+    CU_ASSERT_EQUAL(0, _dat_get_dirty_vars());
+    CU_ASSERT_EQUAL(value, storage_repo_get_value_idx(var_1, DAT_REPO_SYSTEM));
+
+#if SCH_STORAGE_MODE == 1
+    // Another connection locks the database, so the flush fails and the
+    // changes are kept
+    char db_file[sizeof(SCH_STORAGE_FILE) + 10];
+    sprintf(db_file, "%s.%u.db", SCH_STORAGE_FILE, SCH_COMM_ADDRESS);
+    sqlite3 *lock;
+    CU_ASSERT_EQUAL_FATAL(SQLITE_OK, sqlite3_open(db_file, &lock));
+    CU_ASSERT_EQUAL_FATAL(SQLITE_OK, sqlite3_exec(lock, "BEGIN EXCLUSIVE;", 0, 0, 0));
+
+    int value_2 = dat_get_system_var(var_2) + 1;
+    dat_set_system_var(var_1, value + 1);
+    dat_set_system_var(var_2, value_2);
+    CU_ASSERT_EQUAL(-1, dat_flush());
+    CU_ASSERT_EQUAL(2, _dat_get_dirty_vars());
+    CU_ASSERT_EQUAL(value + 1, dat_get_system_var(var_1));
+
+    // A raw write replaces the pending change of its variable
+    _dat_set_system_var(var_1, value + 2);
+    CU_ASSERT_EQUAL(1, _dat_get_dirty_vars());
+
+    // The other change is written once the storage is available
+    sqlite3_exec(lock, "ROLLBACK;", 0, 0, 0);
+    sqlite3_close(lock);
+    CU_ASSERT_EQUAL(0, dat_flush());
+    CU_ASSERT_EQUAL(0, _dat_get_dirty_vars());
+    CU_ASSERT_EQUAL(value_2, storage_repo_get_value_idx(var_2, DAT_REPO_SYSTEM));
+#endif
+}
+#endif
+
+void test_status_subscribe(void)
+{
+    int i, rc;
+    dat_sys_var_short_t change;
+    dat_status_address_t vars[2] = {dat_obc_hrs_alive, dat_obc_hrs_wo_reset};
+    dat_status_address_t many[3] = {dat_obc_hrs_alive, dat_obc_hrs_wo_reset, dat_obc_reset_counter};
+    value32_t values[3];
+    osQueue queue = osQueueCreate(4, sizeof(dat_sys_var_short_t));
+    CU_ASSERT_FATAL(queue != 0);
+
+    dat_set_system_var(dat_obc_hrs_alive, 10);
+    dat_set_system_var(dat_obc_hrs_wo_reset, 20);
+    CU_ASSERT_EQUAL(0, dat_subscribe_status_vars(vars, 2, queue));
+
+    // A change is notified with its new value
+    dat_set_system_var(dat_obc_hrs_alive, 11);
+    CU_ASSERT_EQUAL(pdPASS, osQueueReceive(queue, &change, 0));
+    CU_ASSERT_EQUAL(dat_obc_hrs_alive, change.address);
+    CU_ASSERT_EQUAL(11, change.value.u);
+    CU_ASSERT_NOT_EQUAL(pdPASS, osQueueReceive(queue, &change, 0));
+
+    // Setting the current value, or other variables, is not notified
+    dat_set_system_var(dat_obc_hrs_alive, 11);
+    dat_set_system_var(dat_obc_reset_counter, dat_get_system_var(dat_obc_reset_counter) + 1);
+    CU_ASSERT_NOT_EQUAL(pdPASS, osQueueReceive(queue, &change, 0));
+
+    // Only the variables that changed in a multiple set are notified
+    values[0].u = 11;
+    values[1].u = 21;
+    values[2].u = 30;
+    dat_set_status_many(many, values, 3);
+    CU_ASSERT_EQUAL(pdPASS, osQueueReceive(queue, &change, 0));
+    CU_ASSERT_EQUAL(dat_obc_hrs_wo_reset, change.address);
+    CU_ASSERT_EQUAL(21, change.value.u);
+    CU_ASSERT_NOT_EQUAL(pdPASS, osQueueReceive(queue, &change, 0));
+
+    // Up to DAT_SUBS_MAX subscriptions, the others are not notified
+    for(i = 1; i < DAT_SUBS_MAX; i++)
+        CU_ASSERT_EQUAL(0, dat_subscribe_status_vars(NULL, 0, queue));
+    rc = dat_subscribe_status_vars(vars, 1, queue);
+    CU_ASSERT_EQUAL(-1, rc);
+    dat_set_system_var(dat_obc_hrs_alive, 12);
+    CU_ASSERT_EQUAL(pdPASS, osQueueReceive(queue, &change, 0));
+    CU_ASSERT_EQUAL(12, change.value.u);
+    CU_ASSERT_NOT_EQUAL(pdPASS, osQueueReceive(queue, &change, 0));
+}
+
+void test_status_scrub(void)
+{
+#if SCH_STORAGE_TRIPLE_WR == 1
+    int copy;
+    dat_status_address_t var = dat_dep_date_time;
+    uint32_t before[dat_status_last_address], after[dat_status_last_address];
+
+    // Repair the copies left divergent by the previous tests
+    CU_ASSERT(dat_scrub_status_vars() >= 0);
+    CU_ASSERT_EQUAL(0, dat_scrub_status_vars());
+    dat_set_system_var(var, 1234);
+
+    // Corrupt one copy at a time, the majority repairs it
+    for(copy = 0; copy < 3; copy++)
+    {
+        dat_get_status_upsets(before);
+        _dat_set_system_var(var + dat_status_last_address * copy, 4321);
+        CU_ASSERT_EQUAL(1, dat_scrub_status_vars());
+        CU_ASSERT_EQUAL(1234, _dat_get_system_var(var));
+        CU_ASSERT_EQUAL(1234, _dat_get_system_var(var + dat_status_last_address));
+        CU_ASSERT_EQUAL(1234, _dat_get_system_var(var + dat_status_last_address * 2));
+        CU_ASSERT_EQUAL(1234, dat_get_system_var(var));
+        dat_get_status_upsets(after);
+        CU_ASSERT_EQUAL(before[var] + 1, after[var]);
+        CU_ASSERT_EQUAL(0, dat_scrub_status_vars());
+    }
+#else
+    CU_ASSERT_EQUAL(0, dat_scrub_status_vars());
+#endif
+}
+
+void test_status_groups(void)
+{
+    int i;
+    double omega[3] = {0.1, -2.5, 1e-3};
+    double out[3];
+    value32_t mirror[3];
+
+    // The group keeps the doubles, the mirror their float value
+    CU_ASSERT_EQUAL(0, dat_set_group(dat_grp_ads_omega, omega));
+    CU_ASSERT_EQUAL(0, dat_get_group(dat_grp_ads_omega, out));
+    dat_get_status_vars(dat_ads_omega_x, mirror, 3);
+    for(i = 0; i < 3; i++)
+    {
+        CU_ASSERT_EQUAL(omega[i], out[i]);
+        CU_ASSERT_EQUAL((float)omega[i], mirror[i].f);
+        CU_ASSERT_EQUAL((float)omega[i], dat_get_status_var(dat_ads_omega_x + i).f);
+    }
+
+    // Setting a mirror variable updates only that member of the group
+    value32_t y;
+    y.f = 4.0f;
+    dat_set_status_var(dat_ads_omega_y, y);
+    CU_ASSERT_EQUAL(0, dat_get_group(dat_grp_ads_omega, out));
+    CU_ASSERT_EQUAL(omega[0], out[0]);
+    CU_ASSERT_EQUAL(4.0, out[1]);
+    CU_ASSERT_EQUAL(omega[2], out[2]);
+
+    // Unknown groups are rejected
+    CU_ASSERT_EQUAL(-1, dat_set_group(dat_group_last_address, omega));
+    CU_ASSERT_EQUAL(-1, dat_get_group(dat_group_last_address, out));
+}
+
+/* Writers keep the four attitude components equal, with the status variables
+ * and with the group. Readers count the reads with different components */
+#define TEST_TORN_THREADS 2
+#define TEST_TORN_MS 500
+static volatile int test_torn_running;
+
+static void *test_torn_writer(void *param)
+{
+    int i, j, id = *(int *)param;
+    value32_t q[4];
+    double g[4];
+    for(i = 0; test_torn_running; i++)
+    {
+        float v = (float)(id*1000000 + i%1000000);
+        for(j = 0; j < 4; j++)
+        {
+            q[j].f = v;
+            g[j] = v;
+        }
+        if(i % 2)
+            dat_set_group(dat_grp_ads_attitude, g);
+        else
+            dat_set_status_vars(dat_ads_q0, q, 4);
+    }
+    return NULL;
+}
+
+static void *test_torn_reader(void *param)
+{
+    long *count = (long *)param;    // Reads and torn reads
+    value32_t q[4];
+    double g[4];
+    while(test_torn_running)
+    {
+        dat_get_status_vars(dat_ads_q0, q, 4);
+        if(q[0].u != q[1].u || q[0].u != q[2].u || q[0].u != q[3].u)
+            count[1]++;
+        dat_get_group(dat_grp_ads_attitude, g);
+        if(g[0] != g[1] || g[0] != g[2] || g[0] != g[3])
+            count[1]++;
+        count[0]++;
+    }
+    return NULL;
+}
+
+void test_status_torn_reads(void)
+{
+    int i;
+    int ids[TEST_TORN_THREADS];
+    long counts[TEST_TORN_THREADS][2] = {{0}};
+    pthread_t writers[TEST_TORN_THREADS], readers[TEST_TORN_THREADS];
+
+    double g[4] = {0, 0, 0, 0};
+    dat_set_group(dat_grp_ads_attitude, g);
+
+    test_torn_running = 1;
+    for(i = 0; i < TEST_TORN_THREADS; i++)
+    {
+        ids[i] = i;
+        CU_ASSERT_EQUAL(0, pthread_create(&readers[i], NULL, test_torn_reader, counts[i]));
+        CU_ASSERT_EQUAL(0, pthread_create(&writers[i], NULL, test_torn_writer, &ids[i]));
+    }
+    osDelay(TEST_TORN_MS);
+    test_torn_running = 0;
+    for(i = 0; i < TEST_TORN_THREADS; i++)
+    {
+        pthread_join(writers[i], NULL);
+        pthread_join(readers[i], NULL);
+        CU_ASSERT(counts[i][0] > 0);
+        CU_ASSERT_EQUAL(0, counts[i][1]);
+    }
+}
+
+void test_payload_schema(void)
+{
+    int payload, j, nfields;
+    for(payload=0; payload<last_sensor; payload++)
+    {
+        // Fields are contiguous and cover the whole struct
+        const dat_payload_field_t *fields = dat_get_payload_fields(payload, &nfields);
+        CU_ASSERT_PTR_NOT_NULL_FATAL(fields);
+        CU_ASSERT(nfields > 0);
+        int offset = 0;
+        for(j=0; j<nfields; j++)
+        {
+            CU_ASSERT_EQUAL(fields[j].offset, offset);
+            offset += fields[j].size;
+        }
+        CU_ASSERT_EQUAL(offset, data_map[payload].size);
+    }
+
+    // Fields values are accessed by offset
+    const dat_payload_field_t *temp_fields = dat_get_payload_fields(temp_sensors, &nfields);
+    CU_ASSERT_EQUAL(nfields, 5);
+    CU_ASSERT_STRING_EQUAL(temp_fields[2].name, "obc_temp_1");
+    CU_ASSERT_EQUAL(temp_fields[2].type, 'f');
+    CU_ASSERT_EQUAL(temp_fields[2].offset, offsetof(temp_data_t, obc_temp_1));
+
+    temp_data_t data;
+    memset(&data, 0, sizeof(data));
+    dat_set_payload_field_real(&temp_fields[4], &data, 2.5);
+    CU_ASSERT_DOUBLE_EQUAL(data.obc_temp_3, 2.5, 1e-6);
+    CU_ASSERT_DOUBLE_EQUAL(dat_get_payload_field_real(&temp_fields[4], &data), 2.5, 1e-6);
 }
 
 
@@ -505,6 +1225,370 @@ void testMatrices(void)
     check_values((double*)resv.v, (double*)Av.v, 3);
 }
 
+/** SUIT 6: Executer **/
+#define TEST_EXE_MAX (3*SCH_EXECUTER_WORKERS + SCH_EXECUTER_QUEUE_LEN + SCH_DISPATCHER_QUEUE_LEN + 8)
+static osSemaphore test_exe_sem;
+static int test_exe_order[TEST_EXE_MAX];   ///< Executed test commands ids
+static volatile int test_exe_n;            ///< Number of executed test commands
+static volatile int test_exe_busy;         ///< Keeps test_com_busy running
+
+static int test_exe_record(char *fmt, char *params, int nparams)
+{
+    int id;
+    if(params == NULL || sscanf(params, fmt, &id) != nparams)
+        return CMD_SYNTAX_ERROR;
+
+    osSemaphoreTake(&test_exe_sem, portMAX_DELAY);
+    if(test_exe_n < TEST_EXE_MAX)
+        test_exe_order[test_exe_n++] = id;
+    osSemaphoreGiven(&test_exe_sem);
+    return CMD_OK;
+}
+
+static int test_exe_busy_wait(char *fmt, char *params, int nparams)
+{
+    while(test_exe_busy)
+        osDelay(1);
+    return CMD_OK;
+}
+
+static cmd_t *test_exe_cmd(char *name, int id)
+{
+    cmd_t *cmd = cmd_get_str(name);
+    cmd_add_params_var(cmd, id);
+    return cmd;
+}
+
+/* Position of a test command in the execution order, -1 if not executed */
+static int test_exe_pos(int id)
+{
+    int i;
+    for(i = 0; i < test_exe_n; i++)
+    {
+        if(test_exe_order[i] == id)
+            return i;
+    }
+    return -1;
+}
+
+/* Keep the COM executer busy and fill its queue with test commands from @id,
+ * so the dispatcher holds the next COM command. Returns the number of test
+ * commands sent */
+static int test_exe_hold_com(int id)
+{
+    int i, n = SCH_EXECUTER_QUEUE_LEN + 1;
+    test_exe_busy = 1;
+    cmd_send_timeout(cmd_get_str("test_com_busy"), portMAX_DELAY);
+    osDelay(100);
+    for(i = 0; i < n; i++)
+        cmd_send_timeout(test_exe_cmd("test_com", id + i), portMAX_DELAY);
+    osDelay(100);
+    return n;
+}
+
+/* Send a test command to the @prio level */
+static int test_exe_send(char *name, int prio, int id)
+{
+    cmd_t *cmd = test_exe_cmd(name, id);
+    cmd->prio = prio;
+    return cmd_send_timeout(cmd, portMAX_DELAY);
+}
+
+/* Wait until @n test commands were executed, at most one second */
+static int test_exe_wait(int n)
+{
+    int i;
+    for(i = 0; i < 100 && test_exe_n < n; i++)
+        osDelay(10);
+    return test_exe_n;
+}
+
+/* The suite initialization function.
+ * Starts the dispatcher and the executer tasks with some test commands
+ */
+int init_suite_executer(void)
+{
+    static os_thread dispatcher_id;
+    static os_thread executers_id[EXECUTER_N_TASKS];
+
+    cmd_repo_init();
+    cmd_add_class("test_free", test_exe_record, "%d", 1, CMD_CLASS_FREE);
+    cmd_add_class("test_com", test_exe_record, "%d", 1, CMD_CLASS_COM);
+    cmd_add_class("test_com_busy", test_exe_busy_wait, "", 0, CMD_CLASS_COM);
+    cmd_add_class("test_i2c", test_exe_record, "%d", 1, CMD_CLASS_I2C);
+    if(cmd_repo_freeze() != CMD_OK)
+        return -1;
+    dat_repo_init();
+
+    if(osSemaphoreCreate(&test_exe_sem) != OS_SEMAPHORE_OK ||
+       dispatcher_init() != 0 || executer_init() != 0)
+        return -1;
+    if(osCreateTask(taskDispatcher, "dispatcher", SCH_TASK_DIS_STACK, NULL, 3, &dispatcher_id) != 0 ||
+       executer_create_tasks(executers_id) != 0)
+        return -1;
+    return 0;
+}
+
+/* The suite cleanup function.
+ * Returns zero on success, non-zero otherwise.
+ */
+int clean_suite_executer(void)
+{
+    return 0;
+}
+
+// Test of batches with commands of several classes
+void testExecuterBatchOrder(void)
+{
+    int i;
+    cmd_t *batch[3];
+    test_exe_n = 0;
+    test_exe_busy = 1;
+
+    // Keep the COM executer busy, the next COM command waits in its queue
+    CU_ASSERT_EQUAL(CMD_SEND_OK, cmd_send_timeout(cmd_get_str("test_com_busy"), portMAX_DELAY));
+    CU_ASSERT_EQUAL(CMD_SEND_OK, cmd_send_timeout(test_exe_cmd("test_com", 1), portMAX_DELAY));
+    osDelay(100);
+
+    // One batch per free worker, each one runs whole in the free pool, its
+    // COM command does not wait for the busy class
+    for(i = 0; i < SCH_EXECUTER_WORKERS; i++)
+    {
+        batch[0] = test_exe_cmd("test_free", 10 + i);
+        batch[1] = test_exe_cmd("test_com", 20 + i);
+        batch[2] = test_exe_cmd("test_free", 30 + i);
+        CU_ASSERT_EQUAL(CMD_SEND_OK, cmd_send_batch(batch, 3, portMAX_DELAY));
+    }
+    int n = 3*SCH_EXECUTER_WORKERS;
+    CU_ASSERT_EQUAL(n, test_exe_wait(n));
+    for(i = 0; i < SCH_EXECUTER_WORKERS; i++)
+    {
+        CU_ASSERT(test_exe_pos(10 + i) < test_exe_pos(20 + i));
+        CU_ASSERT(test_exe_pos(20 + i) < test_exe_pos(30 + i));
+    }
+
+    // Free commands are not blocked by the busy class
+    CU_ASSERT_EQUAL(CMD_SEND_OK, cmd_send_timeout(test_exe_cmd("test_free", 2), portMAX_DELAY));
+    CU_ASSERT_EQUAL(n + 1, test_exe_wait(n + 1));
+    CU_ASSERT_EQUAL(2, test_exe_order[n]);
+    CU_ASSERT_EQUAL(-1, test_exe_pos(1));
+
+    // The queued COM command runs when the class is released
+    test_exe_busy = 0;
+    CU_ASSERT_EQUAL(n + 2, test_exe_wait(n + 2));
+    CU_ASSERT_EQUAL(1, test_exe_order[n + 1]);
+}
+
+// Test of a full executer class queue
+void testDispatcherFullClass(void)
+{
+    int i;
+    int n = SCH_EXECUTER_QUEUE_LEN + 2;
+    test_exe_n = 0;
+    test_exe_busy = 1;
+
+    // Keep the COM executer busy and fill its queue, the dispatcher holds the
+    // next COM commands
+    CU_ASSERT_EQUAL(CMD_SEND_OK, cmd_send_timeout(cmd_get_str("test_com_busy"), portMAX_DELAY));
+    osDelay(100);
+    for(i = 0; i < n; i++)
+        CU_ASSERT_EQUAL(CMD_SEND_OK, cmd_send_timeout(test_exe_cmd("test_com", 40 + i), portMAX_DELAY));
+
+    // Other levels are still dispatched, this level waits for the class
+    CU_ASSERT_EQUAL(CMD_SEND_OK, cmd_send_timeout(test_exe_cmd("test_free", 3), portMAX_DELAY));
+    cmd_t *high = test_exe_cmd("test_free", 4);
+    high->prio = CMD_PRIO_HIGH;
+    CU_ASSERT_EQUAL(CMD_SEND_OK, cmd_send_timeout(high, portMAX_DELAY));
+    CU_ASSERT_EQUAL(1, test_exe_wait(1));
+    CU_ASSERT_EQUAL(4, test_exe_order[0]);
+    osDelay(100);
+    CU_ASSERT_EQUAL(-1, test_exe_pos(3));
+
+    // The class commands run in order when the class is released
+    test_exe_busy = 0;
+    CU_ASSERT_EQUAL(n + 2, test_exe_wait(n + 2));
+    CU_ASSERT(test_exe_pos(3) > 0);
+    for(i = 1; i < n; i++)
+        CU_ASSERT(test_exe_pos(40 + i - 1) < test_exe_pos(40 + i));
+}
+
+void testDispatcherPriority(void)
+{
+    int prio, n;
+    test_exe_n = 0;
+
+    // A COM command in each level waits for the held COM class, so the next
+    // commands wait in the dispatcher levels. They are sent from the lowest
+    // priority, and run in a serialized class in the order they are dispatched
+    n = test_exe_hold_com(100);
+    for(prio = CMD_PRIO_LAST - 1; prio >= 0; prio--)
+        CU_ASSERT_EQUAL(CMD_SEND_OK, test_exe_send("test_com", prio, 110 + prio));
+    osDelay(100);
+    for(prio = CMD_PRIO_LAST - 1; prio >= 0; prio--)
+        CU_ASSERT_EQUAL(CMD_SEND_OK, test_exe_send("test_i2c", prio, 1 + prio));
+    osDelay(100);
+    CU_ASSERT_EQUAL(0, test_exe_n);
+
+    // The highest priority level is dispatched first
+    test_exe_busy = 0;
+    n += 2*CMD_PRIO_LAST;
+    CU_ASSERT_EQUAL(n, test_exe_wait(n));
+    for(prio = 1; prio < CMD_PRIO_LAST; prio++)
+        CU_ASSERT(test_exe_pos(prio) < test_exe_pos(1 + prio));
+}
+
+void testDispatcherAging(void)
+{
+    int i, n, before = 0;
+    int n_high = SCH_DISPATCHER_AGING + 1;
+    test_exe_n = 0;
+
+    // A low priority command waits behind more high priority commands than
+    // the aging limit, all of them in the same serialized class
+    n = test_exe_hold_com(100);
+    CU_ASSERT_EQUAL(CMD_SEND_OK, test_exe_send("test_com", CMD_PRIO_LOW, 120));
+    CU_ASSERT_EQUAL(CMD_SEND_OK, test_exe_send("test_com", CMD_PRIO_HIGH, 121));
+    osDelay(100);
+    CU_ASSERT_EQUAL(CMD_SEND_OK, test_exe_send("test_i2c", CMD_PRIO_LOW, 0));
+    for(i = 1; i <= n_high; i++)
+        CU_ASSERT_EQUAL(CMD_SEND_OK, test_exe_send("test_i2c", CMD_PRIO_HIGH, i));
+    osDelay(100);
+
+    // The low priority level is promoted after being skipped
+    // SCH_DISPATCHER_AGING times
+    test_exe_busy = 0;
+    n += 2 + 1 + n_high;
+    CU_ASSERT_EQUAL(n, test_exe_wait(n));
+    for(i = 1; i <= n_high; i++)
+        before += test_exe_pos(i) < test_exe_pos(0);
+    CU_ASSERT_EQUAL(SCH_DISPATCHER_AGING, before);
+}
+
+void testDispatcherTrySend(void)
+{
+    int i, n, rc = CMD_SEND_OK;
+    dispatcher_stats_t stats_0, stats_1;
+    test_exe_n = 0;
+
+    CU_ASSERT_EQUAL(CMD_SEND_ERROR, cmd_try_send(NULL));
+
+    // Fill the low priority level while it waits for the held COM class
+    n = test_exe_hold_com(100);
+    CU_ASSERT_EQUAL(CMD_SEND_OK, test_exe_send("test_com", CMD_PRIO_LOW, 120));
+    osDelay(100);
+    dispatcher_get_stats(&stats_0);
+
+    cmd_t *cmd = NULL;
+    for(i = 0; i <= SCH_DISPATCHER_QUEUE_LEN && rc == CMD_SEND_OK; i++)
+    {
+        cmd = test_exe_cmd("test_free", 1 + i);
+        cmd->prio = CMD_PRIO_LOW;
+        rc = cmd_try_send(cmd);
+    }
+
+    // The last command is not queued nor waited for, the caller keeps it
+    CU_ASSERT_EQUAL(CMD_SEND_FULL, rc);
+    CU_ASSERT_EQUAL(SCH_DISPATCHER_QUEUE_LEN + 1, i);
+    dispatcher_get_stats(&stats_1);
+    CU_ASSERT_EQUAL(stats_0.drop[CMD_PRIO_LOW] + 1, stats_1.drop[CMD_PRIO_LOW]);
+    CU_ASSERT_EQUAL(stats_0.sent[CMD_PRIO_LOW] + SCH_DISPATCHER_QUEUE_LEN, stats_1.sent[CMD_PRIO_LOW]);
+    CU_ASSERT_EQUAL(SCH_DISPATCHER_QUEUE_LEN, stats_1.depth[CMD_PRIO_LOW]);
+
+    // Other levels still accept commands
+    CU_ASSERT_EQUAL(CMD_SEND_OK, test_exe_send("test_free", CMD_PRIO_HIGH, 100 + n + 1));
+    CU_ASSERT_EQUAL(1, test_exe_wait(1));
+
+    // It can be sent again once the level has room
+    test_exe_busy = 0;
+    n += 2 + SCH_DISPATCHER_QUEUE_LEN;
+    CU_ASSERT_EQUAL(n, test_exe_wait(n));
+    CU_ASSERT_EQUAL(CMD_SEND_OK, cmd_try_send(cmd));
+    CU_ASSERT_EQUAL(n + 1, test_exe_wait(n + 1));
+    CU_ASSERT_EQUAL(SCH_DISPATCHER_QUEUE_LEN + 1, test_exe_order[n]);
+}
+
+void testDispatcherHandles(void)
+{
+    int i;
+    cmd_handle_t *handles[SCH_CMD_HANDLES];
+    test_exe_n = 0;
+
+    // The handle carries the command result
+    cmd_handle_t *handle = cmd_send_async(test_exe_cmd("test_free", 1));
+    CU_ASSERT_PTR_NOT_NULL_FATAL(handle);
+    CU_ASSERT_EQUAL(1, cmd_handle_wait(handle, 1000));
+    CU_ASSERT_EQUAL(CMD_OK, handle->result);
+    CU_ASSERT_EQUAL(1, cmd_handle_wait(handle, 0));
+    cmd_handle_release(handle);
+    handle = cmd_send_async(cmd_get_str("test_free"));
+    CU_ASSERT_EQUAL(1, cmd_handle_wait(handle, 1000));
+    CU_ASSERT_EQUAL(CMD_SYNTAX_ERROR, handle->result);
+    cmd_handle_release(handle);
+
+    // Timeout while the class is busy, then release the handle before the
+    // command finishes. The result is discarded
+    test_exe_busy = 1;
+    CU_ASSERT_EQUAL(CMD_SEND_OK, cmd_send_timeout(cmd_get_str("test_com_busy"), portMAX_DELAY));
+    handle = cmd_send_async(test_exe_cmd("test_com", 2));
+    CU_ASSERT_PTR_NOT_NULL_FATAL(handle);
+    CU_ASSERT_EQUAL(0, cmd_handle_wait(handle, 50));
+    cmd_handle_release(handle);
+
+    // A command dropped by the dispatcher finishes with CMD_ERROR
+    cmd_t *cmd = test_exe_cmd("test_com", 3);
+    cmd_set_deadline(cmd, osTaskGetTickCount() - 1);
+    handle = cmd_send_async(cmd);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(handle);
+
+    test_exe_busy = 0;
+    CU_ASSERT_EQUAL(1, cmd_handle_wait(handle, 1000));
+    CU_ASSERT_EQUAL(CMD_ERROR, handle->result);
+    cmd_handle_release(handle);
+    CU_ASSERT_EQUAL(2, test_exe_wait(2));
+    CU_ASSERT_EQUAL(-1, test_exe_pos(3));
+
+    // All the handles were returned to the pool, also the abandoned one
+    test_exe_busy = 1;
+    CU_ASSERT_EQUAL(CMD_SEND_OK, cmd_send_timeout(cmd_get_str("test_com_busy"), portMAX_DELAY));
+    for(i = 0; i < SCH_CMD_HANDLES; i++)
+    {
+        handles[i] = cmd_send_async(test_exe_cmd("test_com", 10 + i));
+        CU_ASSERT_PTR_NOT_NULL(handles[i]);
+    }
+    cmd = test_exe_cmd("test_com", 4);
+    CU_ASSERT_PTR_NULL(cmd_send_async(cmd));
+    cmd_free(cmd);
+
+    test_exe_busy = 0;
+    for(i = 0; i < SCH_CMD_HANDLES; i++)
+    {
+        CU_ASSERT_EQUAL(1, cmd_handle_wait(handles[i], 1000));
+        CU_ASSERT_EQUAL(CMD_OK, handles[i]->result);
+        cmd_handle_release(handles[i]);
+    }
+    CU_ASSERT_EQUAL(2 + SCH_CMD_HANDLES, test_exe_wait(2 + SCH_CMD_HANDLES));
+}
+
+void testDispatcherSendWait(void)
+{
+    test_exe_n = 0;
+
+    CU_ASSERT_EQUAL(CMD_OK, cmd_send_wait(test_exe_cmd("test_free", 1), 1000));
+    CU_ASSERT_EQUAL(1, test_exe_n);
+    CU_ASSERT_EQUAL(CMD_SYNTAX_ERROR, cmd_send_wait(cmd_get_str("test_free"), 1000));
+    CU_ASSERT_EQUAL(CMD_SEND_ERROR, cmd_send_wait(NULL, 1000));
+
+    // The command still runs after the timeout
+    test_exe_busy = 1;
+    CU_ASSERT_EQUAL(CMD_SEND_OK, cmd_send_timeout(cmd_get_str("test_com_busy"), portMAX_DELAY));
+    CU_ASSERT_EQUAL(CMD_WAIT_TIMEOUT, cmd_send_wait(test_exe_cmd("test_com", 2), 50));
+    CU_ASSERT_EQUAL(-1, test_exe_pos(2));
+    test_exe_busy = 0;
+    CU_ASSERT_EQUAL(2, test_exe_wait(2));
+    CU_ASSERT_EQUAL(CMD_OK, cmd_send_wait(test_exe_cmd("test_com", 3), 1000));
+    CU_ASSERT_EQUAL(3, test_exe_order[2]);
+}
+
 /* The main() function for setting up and running the tests.
  * Returns a CUE_SUCCESS on successful running, another
  * CUnit error code on failure.
@@ -543,7 +1627,14 @@ int main()
     }
 
     /* add the tests to the suite */
-    if ((NULL == CU_add_test(pSuite, "test of cmd_build_from_str()", testParseCommands))){
+    if ((NULL == CU_add_test(pSuite, "test of cmd_build_from_str()", testParseCommands)) ||
+            (NULL == CU_add_test(pSuite, "test of typed parameters", testTypedCommands)) ||
+            (NULL == CU_add_test(pSuite, "test of cmd_repo_freeze()", testFrozenCommands)) ||
+            (NULL == CU_add_test(pSuite, "test of commands pool", testCommandsPool)) ||
+            (NULL == CU_add_test(pSuite, "test of commands statistics", testCommandsStats)) ||
+            (NULL == CU_add_test(pSuite, "test of commands deadlines and budgets", testCommandsBudget)) ||
+            (NULL == CU_add_test(pSuite, "test of coalescible commands", testCommandsCoalesce)) ||
+            (NULL == CU_add_test(pSuite, "test of admission rules", testCommandsAdmission))){
         CU_cleanup_registry();
         return CU_get_error();
     }
@@ -561,7 +1652,18 @@ int main()
     if ((NULL == CU_add_test(pSuite, "test of drp_test_system_vars", test_system_vars)) ||
             (NULL == CU_add_test(pSuite, "test of dat_set_system_var", test_set_system_vars_fault_tolerant)) ||
             (NULL == CU_add_test(pSuite, "test of dat_get_system_var", test_get_system_vars_fault_tolerant)) ||
-            (NULL == CU_add_test(pSuite, "test of payload storage", test_payload_data)))
+            (NULL == CU_add_test(pSuite, "test of payload storage", test_payload_data)) ||
+#if TEST_PAYLOAD_RETENTION
+            (NULL == CU_add_test(pSuite, "test of payload retention", test_payload_retention)) ||
+#endif
+#if TEST_STATUS_CACHE
+            (NULL == CU_add_test(pSuite, "test of status variables cache", test_status_cache)) ||
+#endif
+            (NULL == CU_add_test(pSuite, "test of status subscriptions", test_status_subscribe)) ||
+            (NULL == CU_add_test(pSuite, "test of dat_scrub_status_vars", test_status_scrub)) ||
+            (NULL == CU_add_test(pSuite, "test of status groups", test_status_groups)) ||
+            (NULL == CU_add_test(pSuite, "test of status torn reads", test_status_torn_reads)) ||
+            (NULL == CU_add_test(pSuite, "test of payload schema", test_payload_schema)))
     {
         CU_cleanup_registry();
         return CU_get_error();
@@ -597,6 +1699,27 @@ int main()
         return CU_get_error();
     }
 
+    /**
+    * SUITE 6: Executer tasks
+    */
+    pSuite = CU_add_suite("Suite executer", init_suite_executer, clean_suite_executer);
+    if (NULL == pSuite) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    /* add the tests to the suite */
+    if ((NULL == CU_add_test(pSuite, "test of batches order", testExecuterBatchOrder)) ||
+            (NULL == CU_add_test(pSuite, "test of a full class queue", testDispatcherFullClass)) ||
+            (NULL == CU_add_test(pSuite, "test of priority levels order", testDispatcherPriority)) ||
+            (NULL == CU_add_test(pSuite, "test of priority levels aging", testDispatcherAging)) ||
+            (NULL == CU_add_test(pSuite, "test of cmd_try_send()", testDispatcherTrySend)) ||
+            (NULL == CU_add_test(pSuite, "test of completion handles", testDispatcherHandles)) ||
+            (NULL == CU_add_test(pSuite, "test of cmd_send_wait()", testDispatcherSendWait))){
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
 
     /* Run all tests using the CUnit Basic interface */
     CU_basic_set_mode(CU_BRM_VERBOSE);